@@ -0,0 +1,209 @@
+/*
+ * Vega VM - Async fan-out stress benchmark
+ *
+ * Runs a hand-assembled program that spawns one agent per send, fires
+ * every send with <~ before awaiting any of them, then awaits them all:
+ *
+ *   fn main() {
+ *       let fs = [];
+ *       let i = 0;
+ *       while i < n { fs.push(spawn W <~ "ping"); i = i + 1; }
+ *       return await all fs;
+ *   }
+ *
+ * and reports how many succeeded, the wall time, and the CPU time the VM
+ * thread spent (polling costs scale with completions, not with sends in
+ * flight, so this stays small while the VM sleeps on the HTTP engine).
+ *
+ * Needs an endpoint, so it only runs when ANTHROPIC_BASE_URL is set.
+ * `make fanout-test` runs it against the local stand-in for the Messages
+ * API (tests/stub/messages_api.py) and fails unless every send succeeds.
+ *
+ * Usage: async_fanout_bench [sends]
+ */
+
+#include "vm/vm.h"
+#include "vm/http.h"
+#include "common/bytecode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_SENDS 1000
+
+typedef struct {
+    uint8_t data[512];
+    uint32_t size;
+} Buf;
+
+static void emit(Buf* b, uint8_t byte) { b->data[b->size++] = byte; }
+
+static void emit_u16(Buf* b, uint16_t v) {
+    emit(b, v & 0xFF);
+    emit(b, (v >> 8) & 0xFF);
+}
+
+static void emit_u32(Buf* b, uint32_t v) {
+    emit_u16(b, v & 0xFFFF);
+    emit_u16(b, (v >> 16) & 0xFFFF);
+}
+
+static void patch_i16(Buf* b, uint32_t at, int16_t v) {
+    b->data[at] = (uint16_t)v & 0xFF;
+    b->data[at + 1] = ((uint16_t)v >> 8) & 0xFF;
+}
+
+// Append a string constant, returning its pool offset
+static uint16_t emit_string(Buf* consts, const char* s) {
+    uint16_t offset = (uint16_t)consts->size;
+    uint16_t len = (uint16_t)strlen(s);
+    emit(consts, CONST_STRING);
+    emit_u16(consts, len);
+    memcpy(consts->data + consts->size, s, len);
+    consts->size += len;
+    return offset;
+}
+
+static uint8_t* build_program(uint32_t sends, uint32_t* out_size) {
+    Buf consts = {0};
+    uint16_t main_name = emit_string(&consts, "main");
+    uint16_t agent_name = emit_string(&consts, "W");
+    uint16_t model = emit_string(&consts, "claude-sonnet-4-20250514");
+    uint16_t ping = emit_string(&consts, "ping");
+
+    Buf code = {0};
+    emit(&code, OP_ARRAY_NEW); emit_u16(&code, 0);
+    emit(&code, OP_PUSH_INT); emit_u32(&code, 0);
+    emit(&code, OP_STORE_LOCAL); emit(&code, 0);
+
+    uint32_t loop_start = code.size;
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 0);
+    emit(&code, OP_PUSH_INT); emit_u32(&code, sends);
+    emit(&code, OP_LT);
+    emit(&code, OP_JUMP_IF_NOT);
+    uint32_t exit_jump = code.size;
+    emit_u16(&code, 0);
+
+    emit(&code, OP_SPAWN_AGENT); emit_u16(&code, agent_name);
+    emit(&code, OP_PUSH_CONST); emit_u16(&code, ping);
+    emit(&code, OP_SEND_ASYNC);
+    emit(&code, OP_ARRAY_PUSH);
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 0);
+    emit(&code, OP_PUSH_INT); emit_u32(&code, 1);
+    emit(&code, OP_ADD);
+    emit(&code, OP_STORE_LOCAL); emit(&code, 0);
+    emit(&code, OP_JUMP);
+    emit_u16(&code, 0);
+    patch_i16(&code, code.size - 2, (int16_t)(loop_start - code.size));
+    patch_i16(&code, exit_jump, (int16_t)(code.size - (exit_jump + 2)));
+
+    emit(&code, OP_AWAIT_ALL);
+    emit(&code, OP_RETURN);
+
+    VegaHeader header = {
+        .magic = VEGA_MAGIC,
+        .version = VEGA_VERSION,
+        .flags = 0,
+        .const_pool_size = consts.size,
+        .code_size = code.size
+    };
+    FunctionDef fn = {
+        .name_idx = main_name,
+        .param_count = 0,
+        .local_count = 1,
+        .code_offset = 0,
+        .code_length = code.size
+    };
+    // Temperature 1: identical sends must not be served from the cache
+    AgentDef agent = {
+        .name_idx = agent_name,
+        .model_idx = model,
+        .system_idx = 0xFFFF,
+        .tool_count = 0,
+        .temperature_x100 = 100,
+        .flags = AGENT_FLAG_NO_CACHE,
+        .hedge_percentile = 0
+    };
+    uint16_t func_count = 1;
+    uint16_t agent_count = 1;
+
+    uint32_t size = sizeof(header) + 4 + sizeof(fn) + sizeof(agent) + consts.size + code.size;
+    uint8_t* out = malloc(size);
+    uint8_t* p = out;
+    memcpy(p, &header, sizeof(header)); p += sizeof(header);
+    memcpy(p, &func_count, 2); p += 2;
+    memcpy(p, &agent_count, 2); p += 2;
+    memcpy(p, &fn, sizeof(fn)); p += sizeof(fn);
+    memcpy(p, &agent, sizeof(agent)); p += sizeof(agent);
+    memcpy(p, consts.data, consts.size); p += consts.size;
+    memcpy(p, code.data, code.size);
+
+    *out_size = size;
+    return out;
+}
+
+static double now_sec(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    if (!getenv("ANTHROPIC_BASE_URL")) {
+        printf("async_fanout_bench: skipped (set ANTHROPIC_BASE_URL)\n");
+        return 0;
+    }
+    setenv("ANTHROPIC_API_KEY", "bench", 0);
+
+    uint32_t sends = DEFAULT_SENDS;
+    if (argc > 1) sends = (uint32_t)strtoul(argv[1], NULL, 10);
+    if (sends < 1) sends = 1;
+
+    if (!http_init()) {
+        fprintf(stderr, "http_init failed\n");
+        return 1;
+    }
+
+    uint32_t size;
+    uint8_t* program = build_program(sends, &size);
+    VegaVM* vm = malloc(sizeof(VegaVM));
+    vm_init(vm);
+    if (!vm_load(vm, program, size)) {
+        fprintf(stderr, "load failed: %s\n", vm->error_msg);
+        return 1;
+    }
+
+    double wall = now_sec(CLOCK_MONOTONIC);
+    double cpu = now_sec(CLOCK_THREAD_CPUTIME_ID);
+    bool ok = vm_run(vm);
+    cpu = now_sec(CLOCK_THREAD_CPUTIME_ID) - cpu;
+    wall = now_sec(CLOCK_MONOTONIC) - wall;
+    if (!ok && vm->had_error) {
+        fprintf(stderr, "run failed: %s\n", vm->error_msg);
+        return 1;
+    }
+
+    uint32_t succeeded = 0;
+    Value result = vm->stack[vm->sp - 1];
+    if (value_type(result) == VAL_ARRAY) {
+        VegaArray* responses = value_as_array(result);
+        for (uint32_t i = 0; i < responses->count; i++) {
+            Value v = responses->items[i];
+            if (value_type(v) == VAL_STRING &&
+                strncmp(value_as_string(v)->data, "Error", 5) != 0) {
+                succeeded++;
+            }
+        }
+    }
+
+    printf("async_fanout_bench: %u concurrent sends, %u failed\n", sends, sends - succeeded);
+    printf("  wall time:        %8.3f s\n", wall);
+    printf("  VM thread CPU:    %8.3f s  (%.1f us per send)\n", cpu, cpu * 1e6 / sends);
+
+    vm_free(vm);
+    free(vm);
+    free(program);
+    http_cleanup();
+    return succeeded == sends ? 0 : 1;
+}
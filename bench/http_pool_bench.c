@@ -0,0 +1,80 @@
+/*
+ * Vega VM - HTTP connection pool benchmark
+ *
+ * Sends sequential Messages API requests through the pooled client and
+ * compares the first (cold: DNS + TCP + TLS) request with the warm ones
+ * that reuse its connection, then prints the pool counters.
+ *
+ * Needs an endpoint, so it only runs when ANTHROPIC_BASE_URL is set, e.g.
+ * against a local HTTPS stand-in (VEGA_CA_BUNDLE=its certificate).
+ *
+ * Usage: http_pool_bench [requests]
+ */
+
+#include "vm/http.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_REQUESTS 50
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char** argv) {
+    if (!getenv("ANTHROPIC_BASE_URL")) {
+        printf("http_pool_bench: skipped (set ANTHROPIC_BASE_URL)\n");
+        return 0;
+    }
+
+    int requests = DEFAULT_REQUESTS;
+    if (argc > 1) requests = atoi(argv[1]);
+    if (requests < 2) requests = 2;
+
+    if (!http_init()) {
+        fprintf(stderr, "http_init failed\n");
+        return 1;
+    }
+
+    const char* key = getenv("ANTHROPIC_API_KEY");
+    double cold_ms = 0.0;
+    double warm_ms = 0.0;
+    int failures = 0;
+
+    for (int i = 0; i < requests; i++) {
+        double start = now_ms();
+        HttpResponse* resp = anthropic_send_message(key, NULL, NULL, "ping", 0.0);
+        double elapsed = now_ms() - start;
+
+        if (!resp || resp->error || resp->status_code != 200) failures++;
+        http_response_free(resp);
+
+        if (i == 0) {
+            cold_ms = elapsed;
+        } else {
+            warm_ms += elapsed;
+        }
+    }
+    warm_ms /= requests - 1;
+
+    HttpPoolStats stats;
+    http_pool_stats(&stats);
+
+    printf("http_pool_bench: %d requests, %d failed\n", requests, failures);
+    printf("  cold request:     %8.2f ms\n", cold_ms);
+    printf("  warm request:     %8.2f ms (mean)\n", warm_ms);
+    printf("  connections:      %8llu (reused %llu of %llu)\n",
+           (unsigned long long)stats.connections,
+           (unsigned long long)stats.reused,
+           (unsigned long long)stats.requests);
+    if (stats.connections > 0) {
+        printf("  handshake:        %8.2f ms (mean TLS)\n",
+               stats.handshake_us / 1000.0 / stats.connections);
+    }
+
+    http_cleanup();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+/*
+ * Vega VM - Process context switch microbenchmark
+ *
+ * Spawns a batch of processes that each run a hand-assembled loop of
+ * OP_YIELDs, then drives them round-robin with scheduler_run(). Every
+ * yield is a full trip through the scheduler: save the registers into the
+ * process's ExecContext, pick the next ready process, and swap its stack
+ * and frame pointers in.
+ *
+ * Usage: process_switch_bench [processes] [yields]
+ */
+
+#include "vm/vm.h"
+#include "vm/process.h"
+#include "vm/scheduler.h"
+#include "common/bytecode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_PROCESSES 1000
+#define DEFAULT_YIELDS    1000
+
+typedef struct {
+    uint8_t data[512];
+    uint32_t size;
+} Buf;
+
+static void emit(Buf* b, uint8_t byte) { b->data[b->size++] = byte; }
+
+static void emit_u16(Buf* b, uint16_t v) {
+    emit(b, v & 0xFF);
+    emit(b, (v >> 8) & 0xFF);
+}
+
+static void emit_u32(Buf* b, uint32_t v) {
+    emit_u16(b, v & 0xFFFF);
+    emit_u16(b, (v >> 16) & 0xFFFF);
+}
+
+static void patch_i16(Buf* b, uint32_t at, int16_t v) {
+    b->data[at] = (uint16_t)v & 0xFF;
+    b->data[at + 1] = ((uint16_t)v >> 8) & 0xFF;
+}
+
+// worker() { let i = 0; while i < n { yield; i = i + 1; } return i; }
+static uint8_t* build_program(uint32_t yields, uint32_t* out_size) {
+    Buf consts = {0};
+    emit(&consts, CONST_STRING);
+    emit_u16(&consts, 6);
+    memcpy(consts.data + consts.size, "worker", 6);
+    consts.size += 6;
+
+    Buf code = {0};
+    emit(&code, OP_PUSH_INT); emit_u32(&code, 0);
+    emit(&code, OP_STORE_LOCAL); emit(&code, 0);
+
+    uint32_t loop_start = code.size;
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 0);
+    emit(&code, OP_PUSH_INT); emit_u32(&code, yields);
+    emit(&code, OP_LT);
+    emit(&code, OP_JUMP_IF_NOT);
+    uint32_t exit_jump = code.size;
+    emit_u16(&code, 0);
+
+    emit(&code, OP_YIELD);
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 0);
+    emit(&code, OP_PUSH_INT); emit_u32(&code, 1);
+    emit(&code, OP_ADD);
+    emit(&code, OP_STORE_LOCAL); emit(&code, 0);
+    emit(&code, OP_JUMP);
+    emit_u16(&code, 0);
+    patch_i16(&code, code.size - 2, (int16_t)(loop_start - code.size));
+    patch_i16(&code, exit_jump, (int16_t)(code.size - (exit_jump + 2)));
+
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 0);
+    emit(&code, OP_RETURN);
+
+    VegaHeader header = {
+        .magic = VEGA_MAGIC,
+        .version = VEGA_VERSION,
+        .flags = 0,
+        .const_pool_size = consts.size,
+        .code_size = code.size
+    };
+    FunctionDef fn = {
+        .name_idx = 0,
+        .param_count = 0,
+        .local_count = 1,
+        .code_offset = 0,
+        .code_length = code.size
+    };
+    uint16_t func_count = 1;
+    uint16_t agent_count = 0;
+
+    uint32_t size = sizeof(header) + 4 + sizeof(fn) + consts.size + code.size;
+    uint8_t* out = malloc(size);
+    uint8_t* p = out;
+    memcpy(p, &header, sizeof(header)); p += sizeof(header);
+    memcpy(p, &func_count, 2); p += 2;
+    memcpy(p, &agent_count, 2); p += 2;
+    memcpy(p, &fn, sizeof(fn)); p += sizeof(fn);
+    memcpy(p, consts.data, consts.size); p += consts.size;
+    memcpy(p, code.data, code.size);
+
+    *out_size = size;
+    return out;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    uint32_t processes = DEFAULT_PROCESSES;
+    uint32_t yields = DEFAULT_YIELDS;
+    if (argc > 1) processes = (uint32_t)strtoul(argv[1], NULL, 10);
+    if (argc > 2) yields = (uint32_t)strtoul(argv[2], NULL, 10);
+    if (processes > MAX_PROCESSES) processes = MAX_PROCESSES;
+
+    uint32_t size;
+    uint8_t* program = build_program(yields, &size);
+    VegaVM* vm = malloc(sizeof(VegaVM));
+    vm_init(vm);
+    if (!vm_load(vm, program, size)) {
+        fprintf(stderr, "load failed: %s\n", vm->error_msg);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < processes; i++) {
+        VegaProcess* proc = process_create(vm, 0);
+        if (!proc || !process_start_function(vm, proc, 0)) {
+            fprintf(stderr, "spawn failed at process %u\n", i);
+            return 1;
+        }
+        scheduler_add(&vm->scheduler, proc);
+        scheduler_enqueue(&vm->scheduler, proc->pid);
+    }
+
+    double start = now_sec();
+    scheduler_run(vm);
+    double elapsed = now_sec() - start;
+
+    // Every process should have run to completion with i == yields
+    for (uint32_t i = 0; i < vm->process_count; i++) {
+        VegaProcess* proc = vm->processes[i];
+        ExecContext* ctx = &proc->context;
+        if (proc->state != PROC_EXITED || proc->exit_reason != EXIT_NORMAL ||
+            ctx->sp == 0 || ctx->stack[ctx->sp - 1].as.integer != (int64_t)yields) {
+            fprintf(stderr, "process %u did not finish cleanly\n", proc->pid);
+            return 1;
+        }
+    }
+
+    uint64_t switches = vm->scheduler.context_switches;
+    printf("process_switch_bench: %u processes x %u yields\n", processes, yields);
+    printf("  context switches: %llu\n", (unsigned long long)switches);
+    printf("  total:            %8.3f s\n", elapsed);
+    printf("  per switch:       %8.1f ns\n", elapsed / switches * 1e9);
+
+    vm_free(vm);
+    free(vm);
+    free(program);
+    return 0;
+}
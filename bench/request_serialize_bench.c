@@ -0,0 +1,104 @@
+/*
+ * Vega VM - request serialization benchmark
+ *
+ * Serializes every request of a long agent conversation two ways: rebuilt
+ * from the message array each turn (http_body_from_messages, what the
+ * array-based senders do), and from an HttpConversation that escapes each
+ * message once and shares its history between requests. Checks that both
+ * produce the same bytes, then prints the per-turn cost of each.
+ *
+ * Usage: request_serialize_bench [turns]
+ */
+
+#include "vm/http.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_TURNS 200
+#define MESSAGE_SIZE 2000
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// A message with some text that needs escaping
+static char* make_message(int turn, const char* role) {
+    char* msg = malloc(MESSAGE_SIZE + 1);
+    int n = snprintf(msg, MESSAGE_SIZE + 1, "%s turn %d: \"quoted\"\n", role, turn);
+    for (int i = n; i < MESSAGE_SIZE; i++) {
+        msg[i] = (i % 61 == 0) ? '\n' : (char)('a' + i % 26);
+    }
+    msg[MESSAGE_SIZE] = '\0';
+    return msg;
+}
+
+int main(int argc, char** argv) {
+    int turns = DEFAULT_TURNS;
+    if (argc > 1) turns = atoi(argv[1]);
+    if (turns < 1) turns = 1;
+
+    const char* params[] = { "path", "limit" };
+    const char* types[] = { "str", "int" };
+    ToolDefinition tools[] = {
+        { "read_file", "Read a file from disk", params, types, 2 },
+        { "search", "Search the workspace", params, types, 2 },
+    };
+    const char* model = "claude-sonnet-4-20250514";
+    const char* system = "You are a careful assistant.\nAnswer \"briefly\".";
+
+    char** messages = malloc(2 * turns * sizeof(char*));
+    for (int t = 0; t < turns; t++) {
+        messages[2 * t] = make_message(t, "user");
+        messages[2 * t + 1] = make_message(t, "assistant");
+    }
+
+    // Old path: rebuild the whole body every turn
+    size_t old_bytes = 0;
+    char* old_last = NULL;
+    double start = now_ms();
+    for (int t = 0; t < turns; t++) {
+        HttpBody* body = http_body_from_messages(model, system, (const char**)messages,
+                                                 2 * t + 1, tools, 2, 0.7, false);
+        old_bytes += http_body_size(body);
+        if (t == turns - 1) old_last = http_body_flatten(body);
+        http_body_free(body);
+    }
+    double old_ms = now_ms() - start;
+
+    // New path: append each message once, snapshot the history per turn
+    size_t new_bytes = 0;
+    char* new_last = NULL;
+    start = now_ms();
+    HttpConversation* conv = http_conversation_new(model, system, 0.7, tools, 2, false, false);
+    for (int t = 0; t < turns; t++) {
+        if (t > 0) http_conversation_append(conv, messages[2 * t - 1]);
+        http_conversation_append(conv, messages[2 * t]);
+        HttpBody* body = http_conversation_request(conv);
+        new_bytes += http_body_size(body);
+        if (t == turns - 1) new_last = http_body_flatten(body);
+        http_body_free(body);
+    }
+    double new_ms = now_ms() - start;
+    http_conversation_free(conv);
+
+    bool same = old_last && new_last && old_bytes == new_bytes &&
+                strcmp(old_last, new_last) == 0;
+
+    printf("request_serialize_bench: %d turns, %.1f MB serialized, bodies %s\n",
+           turns, old_bytes / 1e6, same ? "identical" : "DIFFER");
+    printf("  rebuild per turn: %8.3f ms/turn (%.1f ms total)\n", old_ms / turns, old_ms);
+    printf("  incremental:      %8.3f ms/turn (%.1f ms total)\n", new_ms / turns, new_ms);
+    if (new_ms > 0) {
+        printf("  speedup:          %8.1fx\n", old_ms / new_ms);
+    }
+
+    free(old_last);
+    free(new_last);
+    for (int i = 0; i < 2 * turns; i++) free(messages[i]);
+    free(messages);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/*
+ * Vega VM - Dispatch loop microbenchmark
+ *
+ * Runs a hand-assembled counting loop two ways:
+ *   - one vm_step() call per instruction (async poll + dispatch every
+ *     instruction, the way the VM used to run everything)
+ *   - vm_run(), which stays inside the threaded dispatch loop and only
+ *     polls async work at safepoints
+ *
+ * Usage: vm_dispatch_bench [iterations]
+ */
+
+#include "vm/vm.h"
+#include "common/bytecode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_ITERATIONS 5000000
+
+typedef struct {
+    uint8_t data[512];
+    uint32_t size;
+} Buf;
+
+static void emit(Buf* b, uint8_t byte) { b->data[b->size++] = byte; }
+
+static void emit_u16(Buf* b, uint16_t v) {
+    emit(b, v & 0xFF);
+    emit(b, (v >> 8) & 0xFF);
+}
+
+static void emit_u32(Buf* b, uint32_t v) {
+    emit_u16(b, v & 0xFFFF);
+    emit_u16(b, (v >> 16) & 0xFFFF);
+}
+
+static void patch_i16(Buf* b, uint32_t at, int16_t v) {
+    b->data[at] = (uint16_t)v & 0xFF;
+    b->data[at + 1] = ((uint16_t)v >> 8) & 0xFF;
+}
+
+// main() { let i = 0; let sum = 0; while i < n { sum = sum + i; i = i + 1; } return sum; }
+static uint8_t* build_program(uint32_t iterations, uint32_t* out_size) {
+    Buf consts = {0};
+    emit(&consts, CONST_STRING);
+    emit_u16(&consts, 4);
+    memcpy(consts.data + consts.size, "main", 4);
+    consts.size += 4;
+
+    Buf code = {0};
+    emit(&code, OP_PUSH_INT); emit_u32(&code, 0);
+    emit(&code, OP_STORE_LOCAL); emit(&code, 0);
+    emit(&code, OP_PUSH_INT); emit_u32(&code, 0);
+    emit(&code, OP_STORE_LOCAL); emit(&code, 1);
+
+    uint32_t loop_start = code.size;
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 0);
+    emit(&code, OP_PUSH_INT); emit_u32(&code, iterations);
+    emit(&code, OP_LT);
+    emit(&code, OP_JUMP_IF_NOT);
+    uint32_t exit_jump = code.size;
+    emit_u16(&code, 0);
+
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 1);
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 0);
+    emit(&code, OP_ADD);
+    emit(&code, OP_STORE_LOCAL); emit(&code, 1);
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 0);
+    emit(&code, OP_PUSH_INT); emit_u32(&code, 1);
+    emit(&code, OP_ADD);
+    emit(&code, OP_STORE_LOCAL); emit(&code, 0);
+    emit(&code, OP_JUMP);
+    emit_u16(&code, 0);
+    patch_i16(&code, code.size - 2, (int16_t)(loop_start - code.size));
+    patch_i16(&code, exit_jump, (int16_t)(code.size - (exit_jump + 2)));
+
+    emit(&code, OP_LOAD_LOCAL); emit(&code, 1);
+    emit(&code, OP_RETURN);
+
+    VegaHeader header = {
+        .magic = VEGA_MAGIC,
+        .version = VEGA_VERSION,
+        .flags = 0,
+        .const_pool_size = consts.size,
+        .code_size = code.size
+    };
+    FunctionDef fn = {
+        .name_idx = 0,
+        .param_count = 0,
+        .local_count = 2,
+        .code_offset = 0,
+        .code_length = code.size
+    };
+    uint16_t func_count = 1;
+    uint16_t agent_count = 0;
+
+    uint32_t size = sizeof(header) + 4 + sizeof(fn) + consts.size + code.size;
+    uint8_t* out = malloc(size);
+    uint8_t* p = out;
+    memcpy(p, &header, sizeof(header)); p += sizeof(header);
+    memcpy(p, &func_count, 2); p += 2;
+    memcpy(p, &agent_count, 2); p += 2;
+    memcpy(p, &fn, sizeof(fn)); p += sizeof(fn);
+    memcpy(p, consts.data, consts.size); p += consts.size;
+    memcpy(p, code.data, code.size);
+
+    *out_size = size;
+    return out;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool load(VegaVM* vm, uint8_t* program, uint32_t size) {
+    vm_init(vm);
+    if (!vm_load(vm, program, size)) {
+        fprintf(stderr, "load failed: %s\n", vm->error_msg);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = DEFAULT_ITERATIONS;
+    if (argc > 1) iterations = (uint32_t)strtoul(argv[1], NULL, 10);
+
+    uint32_t size;
+    uint8_t* program = build_program(iterations, &size);
+    VegaVM* vm = malloc(sizeof(VegaVM));
+
+    // Per-instruction stepping
+    if (!load(vm, program, size)) return 1;
+    vm->ip = vm->functions[0].code_offset;
+    vm->running = true;
+    vm_push(vm, value_null());
+    vm_push(vm, value_null());
+
+    uint64_t instructions = 0;
+    double start = now_sec();
+    while (vm_step(vm)) {
+        instructions++;
+    }
+    instructions++;  // the final OP_RETURN
+    double step_time = now_sec() - start;
+    int64_t step_result = vm->stack[vm->sp - 1].as.integer;
+    vm_free(vm);
+
+    // Threaded dispatch
+    if (!load(vm, program, size)) return 1;
+    start = now_sec();
+    vm_run(vm);
+    double run_time = now_sec() - start;
+    int64_t run_result = vm->stack[vm->sp - 1].as.integer;
+    vm_free(vm);
+
+    if (step_result != run_result) {
+        fprintf(stderr, "result mismatch: %lld vs %lld\n",
+                (long long)step_result, (long long)run_result);
+        return 1;
+    }
+
+    printf("vm_dispatch_bench: %u iterations, %llu instructions\n",
+           iterations, (unsigned long long)instructions);
+    printf("  vm_step loop: %8.3f s  %8.1f M instr/s\n",
+           step_time, instructions / step_time / 1e6);
+    printf("  vm_run:       %8.3f s  %8.1f M instr/s\n",
+           run_time, instructions / run_time / 1e6);
+    printf("  speedup:      %8.2fx\n", step_time / run_time);
+
+    free(vm);
+    free(program);
+    return 0;
+}
@@ -66,6 +66,9 @@ typedef enum {
     OP_SPAWN_ASYNC  = 0x62,  // Spawn async agent: [agent_id:u16] -> future
     OP_AWAIT        = 0x63,  // Await future: future -> response
     OP_SEND_ASYNC   = 0x64,  // Send message (async): handle, msg -> future
+    OP_AWAIT_ALL    = 0x65,  // Await every future: futures -> responses
+    OP_AWAIT_ANY    = 0x66,  // Await the first success: futures -> response
+    OP_AWAIT_FIRST  = 0x67,  // Await the first n successes: n, futures -> responses
 
     // Object/Method Operations (0x70 - 0x7F)
     OP_GET_FIELD    = 0x70,  // Get field: obj, name -> value
@@ -89,6 +92,48 @@ typedef enum {
     OP_RESULT_IS_OK = 0xB2,  // Check if Result is Ok: result -> bool
     OP_RESULT_UNWRAP = 0xB3, // Unwrap Result value: result -> value
 
+    // Superinstructions (0xC0 - 0xCF), emitted by the codegen peephole pass
+    OP_LOAD_LOCAL2       = 0xC0,  // Load two locals: [a:u8, b:u8]
+    OP_INC_LOCAL         = 0xC1,  // local = local + imm: [slot:u8, imm:i8]
+    OP_DEC_LOCAL         = 0xC2,  // local = local - imm: [slot:u8, imm:i8]
+    OP_JUMP_IF_NOT_EQ    = 0xC3,  // Pop b, a; jump unless a == b: [offset:i16]
+    OP_JUMP_IF_NOT_NE    = 0xC4,  // Pop b, a; jump unless a != b: [offset:i16]
+    OP_JUMP_IF_NOT_LT    = 0xC5,  // Pop b, a; jump unless a < b: [offset:i16]
+    OP_JUMP_IF_NOT_LE    = 0xC6,  // Pop b, a; jump unless a <= b: [offset:i16]
+    OP_JUMP_IF_NOT_GT    = 0xC7,  // Pop b, a; jump unless a > b: [offset:i16]
+    OP_JUMP_IF_NOT_GE    = 0xC8,  // Pop b, a; jump unless a >= b: [offset:i16]
+    OP_JUMP_IF_NOT_EQ_II = 0xC9,  // Int compare-and-branch: [offset:i16]
+    OP_JUMP_IF_NOT_NE_II = 0xCA,
+    OP_JUMP_IF_NOT_LT_II = 0xCB,
+    OP_JUMP_IF_NOT_LE_II = 0xCC,
+    OP_JUMP_IF_NOT_GT_II = 0xCD,
+    OP_JUMP_IF_NOT_GE_II = 0xCE,
+
+    // Int-specialized operations (0xD0 - 0xDF), emitted when sema proves both
+    // operands are int. The VM re-checks the tags and falls back to the
+    // generic operation if that doesn't hold at runtime.
+    OP_ADD_II       = 0xD0,
+    OP_SUB_II       = 0xD1,
+    OP_MUL_II       = 0xD2,
+    OP_DIV_II       = 0xD3,
+    OP_MOD_II       = 0xD4,
+    OP_EQ_II        = 0xD5,
+    OP_NE_II        = 0xD6,
+    OP_LT_II        = 0xD7,
+    OP_LE_II        = 0xD8,
+    OP_GT_II        = 0xD9,
+    OP_GE_II        = 0xDA,
+
+    // Float-specialized operations (0xE0 - 0xEF), same contract as above
+    OP_ADD_FF       = 0xE0,
+    OP_SUB_FF       = 0xE1,
+    OP_MUL_FF       = 0xE2,
+    OP_DIV_FF       = 0xE3,
+    OP_LT_FF        = 0xE4,
+    OP_LE_FF        = 0xE5,
+    OP_GT_FF        = 0xE6,
+    OP_GE_FF        = 0xE7,
+
     // Process/Supervision (0x90 - 0x9F)
     OP_SPAWN_PROCESS     = 0x90,  // Spawn new process: [agent_id:u16] -> pid
     OP_EXIT_PROCESS      = 0x91,  // Exit current process: [reason:u8]
@@ -96,6 +141,7 @@ typedef enum {
     OP_SPAWN_SUPERVISED  = 0x93,  // Spawn with supervision: [agent_id:u16, config] -> pid
     OP_LINK              = 0x94,  // Link two processes: pid1, pid2
     OP_MONITOR           = 0x95,  // Monitor a process: pid -> monitor_ref
+    OP_SLEEP             = 0x96,  // Sleep: ms -> null
 
     // Debug/Utility (0xF0 - 0xFF)
     OP_PRINT        = 0xF0,  // Print top of stack
@@ -123,7 +169,7 @@ typedef enum {
  */
 
 #define VEGA_MAGIC      0x56454741  // "VEGA" in ASCII
-#define VEGA_VERSION    0x0001      // v0.1
+#define VEGA_VERSION    0x0004      // v0.4: AgentDef timeout_ms
 
 // File header
 typedef struct {
@@ -148,8 +194,15 @@ typedef struct {
     uint16_t system_idx;      // Index into constant pool for system prompt
     uint16_t tool_count;      // Number of tools
     uint16_t temperature_x100; // Temperature * 100 (e.g., 30 = 0.3)
+    uint16_t flags;           // AGENT_FLAG_* bits
+    uint16_t hedge_percentile; // Hedge slow requests at this latency percentile (0 = off)
+    uint16_t reserved;        // Zero (keeps timeout_ms aligned)
+    uint32_t timeout_ms;      // Deadline for each send, retries included (0 = none)
 } AgentDef;
 
+#define AGENT_FLAG_STREAM   0x0001  // Request streamed (SSE) responses
+#define AGENT_FLAG_NO_CACHE 0x0002  // Don't place prompt caching breakpoints
+
 // Tool definition
 typedef struct {
     uint16_t name_idx;        // Tool name in constant pool
@@ -181,4 +234,76 @@ typedef struct {
 // Read signed 16-bit value
 #define READ_I16(code, ip) ((int16_t)READ_U16(code, ip))
 
+// True for instructions whose operand is a relative i16 jump offset
+static inline int opcode_is_jump(uint8_t op) {
+    return op == OP_JUMP || op == OP_JUMP_IF || op == OP_JUMP_IF_NOT ||
+           (op >= OP_JUMP_IF_NOT_EQ && op <= OP_JUMP_IF_NOT_GE_II);
+}
+
+// Number of operand bytes following an opcode, or -1 if the opcode is unknown
+static inline int opcode_operand_size(uint8_t op) {
+    switch (op) {
+        case OP_LOAD_LOCAL:
+        case OP_STORE_LOCAL:
+        case OP_CALL:
+        case OP_EXIT_PROCESS:
+            return 1;
+        case OP_PUSH_CONST:
+        case OP_LOAD_GLOBAL:
+        case OP_STORE_GLOBAL:
+        case OP_JUMP:
+        case OP_JUMP_IF:
+        case OP_JUMP_IF_NOT:
+        case OP_CALL_NATIVE:
+        case OP_SPAWN_AGENT:
+        case OP_SPAWN_ASYNC:
+        case OP_GET_FIELD:
+        case OP_SET_FIELD:
+        case OP_ARRAY_NEW:
+        case OP_SPAWN_PROCESS:
+        case OP_LOAD_LOCAL2:
+        case OP_INC_LOCAL:
+        case OP_DEC_LOCAL:
+        case OP_JUMP_IF_NOT_EQ:
+        case OP_JUMP_IF_NOT_NE:
+        case OP_JUMP_IF_NOT_LT:
+        case OP_JUMP_IF_NOT_LE:
+        case OP_JUMP_IF_NOT_GT:
+        case OP_JUMP_IF_NOT_GE:
+        case OP_JUMP_IF_NOT_EQ_II:
+        case OP_JUMP_IF_NOT_NE_II:
+        case OP_JUMP_IF_NOT_LT_II:
+        case OP_JUMP_IF_NOT_LE_II:
+        case OP_JUMP_IF_NOT_GT_II:
+        case OP_JUMP_IF_NOT_GE_II:
+            return 2;
+        case OP_CALL_METHOD:
+            return 3;   // [name:u16, argc:u8]
+        case OP_PUSH_INT:
+            return 4;
+        case OP_SPAWN_SUPERVISED:
+            return 11;  // [agent:u16, strategy:u8, max_restarts:u32, window_ms:u32]
+        case OP_NOP: case OP_PUSH_TRUE: case OP_PUSH_FALSE: case OP_PUSH_NULL:
+        case OP_POP: case OP_DUP:
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD: case OP_NEG:
+        case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+        case OP_NOT: case OP_AND: case OP_OR:
+        case OP_RETURN:
+        case OP_SEND_MSG: case OP_AWAIT: case OP_SEND_ASYNC:
+        case OP_AWAIT_ALL: case OP_AWAIT_ANY: case OP_AWAIT_FIRST:
+        case OP_STR_CONCAT: case OP_STR_HAS:
+        case OP_ARRAY_PUSH: case OP_ARRAY_GET: case OP_ARRAY_SET: case OP_ARRAY_LEN:
+        case OP_RESULT_OK: case OP_RESULT_ERR: case OP_RESULT_IS_OK: case OP_RESULT_UNWRAP:
+        case OP_YIELD: case OP_LINK: case OP_MONITOR: case OP_SLEEP:
+        case OP_ADD_II: case OP_SUB_II: case OP_MUL_II: case OP_DIV_II: case OP_MOD_II:
+        case OP_EQ_II: case OP_NE_II: case OP_LT_II: case OP_LE_II: case OP_GT_II: case OP_GE_II:
+        case OP_ADD_FF: case OP_SUB_FF: case OP_MUL_FF: case OP_DIV_FF:
+        case OP_LT_FF: case OP_LE_FF: case OP_GT_FF: case OP_GE_FF:
+        case OP_PRINT: case OP_HALT:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
 #endif // VEGA_BYTECODE_H
@@ -90,6 +90,11 @@ void vega_obj_retain(void* obj) {
         return;
     }
 
+    // Interned strings are immortal
+    if (header->flags & OBJ_FLAG_INTERNED) {
+        return;
+    }
+
     header->refcount++;
 }
 
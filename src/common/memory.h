@@ -32,6 +32,7 @@ typedef enum {
     OBJ_RESULT  = 0x04,
     OBJ_MAP     = 0x05,
     OBJ_FUTURE  = 0x06,
+    OBJ_BOXED_INT = 0x07,  // Out-of-range int under VEGA_NAN_BOXING
 } VegaObjType;
 
 // Object flags
@@ -91,6 +91,7 @@ AstExpr* ast_binary(BinaryOp op, AstExpr* left, AstExpr* right, SourceLoc loc) {
     expr->as.binary.op = op;
     expr->as.binary.left = left;
     expr->as.binary.right = right;
+    expr->as.binary.operands = OPERANDS_DYNAMIC;
     return expr;
 }
 
@@ -187,6 +188,16 @@ AstExpr* ast_await(AstExpr* future, SourceLoc loc) {
     expr->kind = EXPR_AWAIT;
     expr->loc = loc;
     expr->as.await.future = future;
+    expr->as.await.count = NULL;
+    expr->as.await.mode = AWAIT_ONE;
+    return expr;
+}
+
+AstExpr* ast_await_group(AwaitMode mode, AstExpr* count, AstExpr* futures, SourceLoc loc) {
+    AstExpr* expr = ast_await(futures, loc);
+    if (!expr) return NULL;
+    expr->as.await.count = count;
+    expr->as.await.mode = mode;
     return expr;
 }
 
@@ -443,6 +454,7 @@ void ast_expr_free(AstExpr* expr) {
             break;
         case EXPR_AWAIT:
             ast_expr_free(expr->as.await.future);
+            ast_expr_free(expr->as.await.count);
             break;
         default:
             break;
@@ -671,7 +683,15 @@ void ast_print_expr(AstExpr* expr, int indent) {
             ast_print_expr(expr->as.message.message, indent + 1);
             break;
         case EXPR_AWAIT:
-            printf("Await\n");
+            switch (expr->as.await.mode) {
+                case AWAIT_ONE:   printf("Await\n"); break;
+                case AWAIT_ALL:   printf("Await(all)\n"); break;
+                case AWAIT_ANY:   printf("Await(any)\n"); break;
+                case AWAIT_FIRST: printf("Await(first)\n"); break;
+            }
+            if (expr->as.await.count) {
+                ast_print_expr(expr->as.await.count, indent + 1);
+            }
             ast_print_expr(expr->as.await.future, indent + 1);
             break;
         default:
@@ -767,6 +787,14 @@ void ast_print_decl(AstDecl* decl, int indent) {
             print_indent(indent + 1);
             printf("temperature: %f\n", decl->as.agent.temperature);
             print_indent(indent + 1);
+            printf("stream: %s\n", decl->as.agent.stream ? "true" : "false");
+            print_indent(indent + 1);
+            printf("cache: %s\n", decl->as.agent.cache ? "true" : "false");
+            print_indent(indent + 1);
+            printf("hedge: %u\n", decl->as.agent.hedge);
+            print_indent(indent + 1);
+            printf("timeout: %u ms\n", decl->as.agent.timeout_ms);
+            print_indent(indent + 1);
             printf("tools: %u\n", decl->as.agent.tool_count);
             break;
         case DECL_FUNCTION:
@@ -64,6 +64,21 @@ typedef enum {
     UNOP_NOT,           // !
 } UnaryOp;
 
+// Operand types proven by sema; codegen uses them to pick specialized opcodes
+typedef enum {
+    OPERANDS_DYNAMIC,   // Unknown or mixed
+    OPERANDS_INT,       // Both int
+    OPERANDS_FLOAT,     // Both float
+} OperandTypes;
+
+// What an await waits for
+typedef enum {
+    AWAIT_ONE,          // await f
+    AWAIT_ALL,          // await all fs
+    AWAIT_ANY,          // await any fs
+    AWAIT_FIRST,        // await n of fs
+} AwaitMode;
+
 // Supervision configuration (for supervised spawn)
 typedef enum {
     RESTART_STRATEGY_RESTART,
@@ -109,6 +124,7 @@ struct AstExpr {
             BinaryOp op;
             AstExpr* left;
             AstExpr* right;
+            OperandTypes operands;  // Filled in by sema
         } binary;
 
         // Unary expression
@@ -160,9 +176,11 @@ struct AstExpr {
             bool is_async;      // true for <~, false for <-
         } message;
 
-        // Await: await expr
+        // Await: await expr, or a combinator over an array of futures
         struct {
-            AstExpr* future;
+            AstExpr* future;    // The future, or the array (combinators)
+            AstExpr* count;     // n (AWAIT_FIRST only)
+            AwaitMode mode;
         } await;
 
         // Ok(value) and Err(value)
@@ -310,6 +328,10 @@ typedef struct {
     char* model;                // Model string
     char* system_prompt;        // System prompt
     double temperature;         // Temperature (0.0 - 1.0)
+    bool stream;                // Stream responses (SSE)
+    bool cache;                 // Prompt caching breakpoints (default on)
+    uint8_t hedge;              // Hedge after this latency percentile (0 = off)
+    uint32_t timeout_ms;        // Deadline for each send (0 = none)
     ToolDecl* tools;
     uint32_t tool_count;
     SourceLoc loc;
@@ -369,6 +391,7 @@ AstExpr* ast_spawn(const char* agent_name, bool is_async, SourceLoc loc);
 AstExpr* ast_spawn_supervised(const char* agent_name, AstSupervisionConfig* config, SourceLoc loc);
 AstExpr* ast_message(AstExpr* target, AstExpr* message, bool is_async, SourceLoc loc);
 AstExpr* ast_await(AstExpr* future, SourceLoc loc);
+AstExpr* ast_await_group(AwaitMode mode, AstExpr* count, AstExpr* futures, SourceLoc loc);
 AstExpr* ast_ok(AstExpr* value, SourceLoc loc);
 AstExpr* ast_err(AstExpr* value, SourceLoc loc);
 AstExpr* ast_match(AstExpr* scrutinee, MatchArm* arms, uint32_t arm_count, SourceLoc loc);
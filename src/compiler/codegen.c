@@ -194,10 +194,51 @@ static void patch_breaks(CodeGen* cg, uint32_t loop_end, uint32_t break_start_co
 
 static void emit_expr(CodeGen* cg, AstExpr* expr);
 
+// Specialized opcode for a binary op on proven int or float operands, or
+// OP_NOP if there is none
+static uint8_t specialized_binary_op(BinaryOp op, OperandTypes operands) {
+    if (operands == OPERANDS_INT) {
+        switch (op) {
+            case BINOP_ADD: return OP_ADD_II;
+            case BINOP_SUB: return OP_SUB_II;
+            case BINOP_MUL: return OP_MUL_II;
+            case BINOP_DIV: return OP_DIV_II;
+            case BINOP_MOD: return OP_MOD_II;
+            case BINOP_EQ:  return OP_EQ_II;
+            case BINOP_NE:  return OP_NE_II;
+            case BINOP_LT:  return OP_LT_II;
+            case BINOP_LE:  return OP_LE_II;
+            case BINOP_GT:  return OP_GT_II;
+            case BINOP_GE:  return OP_GE_II;
+            default:        return OP_NOP;
+        }
+    }
+    if (operands == OPERANDS_FLOAT) {
+        switch (op) {
+            case BINOP_ADD: return OP_ADD_FF;
+            case BINOP_SUB: return OP_SUB_FF;
+            case BINOP_MUL: return OP_MUL_FF;
+            case BINOP_DIV: return OP_DIV_FF;
+            case BINOP_LT:  return OP_LT_FF;
+            case BINOP_LE:  return OP_LE_FF;
+            case BINOP_GT:  return OP_GT_FF;
+            case BINOP_GE:  return OP_GE_FF;
+            default:        return OP_NOP;
+        }
+    }
+    return OP_NOP;
+}
+
 static void emit_binary(CodeGen* cg, AstExpr* expr) {
     emit_expr(cg, expr->as.binary.left);
     emit_expr(cg, expr->as.binary.right);
 
+    uint8_t specialized = specialized_binary_op(expr->as.binary.op, expr->as.binary.operands);
+    if (specialized != OP_NOP) {
+        emit_byte(cg, specialized);
+        return;
+    }
+
     switch (expr->as.binary.op) {
         case BINOP_ADD: emit_byte(cg, OP_ADD); break;
         case BINOP_SUB: emit_byte(cg, OP_SUB); break;
@@ -303,6 +344,10 @@ static void emit_expr(CodeGen* cg, AstExpr* expr) {
                     emit_byte(cg, OP_PRINT);
                     return;
                 }
+                if (strcmp(name, "sleep") == 0) {
+                    emit_byte(cg, OP_SLEEP);
+                    return;
+                }
 
                 // Check for module::function
                 if (strstr(name, "::")) {
@@ -371,8 +416,25 @@ static void emit_expr(CodeGen* cg, AstExpr* expr) {
             break;
 
         case EXPR_AWAIT:
-            emit_expr(cg, expr->as.await.future);
-            emit_byte(cg, OP_AWAIT);
+            switch (expr->as.await.mode) {
+                case AWAIT_ONE:
+                    emit_expr(cg, expr->as.await.future);
+                    emit_byte(cg, OP_AWAIT);
+                    break;
+                case AWAIT_ALL:
+                    emit_expr(cg, expr->as.await.future);
+                    emit_byte(cg, OP_AWAIT_ALL);
+                    break;
+                case AWAIT_ANY:
+                    emit_expr(cg, expr->as.await.future);
+                    emit_byte(cg, OP_AWAIT_ANY);
+                    break;
+                case AWAIT_FIRST:
+                    emit_expr(cg, expr->as.await.count);
+                    emit_expr(cg, expr->as.await.future);
+                    emit_byte(cg, OP_AWAIT_FIRST);
+                    break;
+            }
             break;
 
         case EXPR_ARRAY_LITERAL: {
@@ -672,6 +734,164 @@ static void emit_stmt(CodeGen* cg, AstStmt* stmt) {
     }
 }
 
+// ============================================================================
+// Peephole Optimization
+// ============================================================================
+
+/*
+ * Runs over one function's code after it has been emitted and fuses common
+ * sequences into superinstructions:
+ *
+ *   LOAD_LOCAL a; LOAD_LOCAL b             -> LOAD_LOCAL2 a b
+ *   LOAD_LOCAL a; PUSH_INT k; ADD|SUB;
+ *   STORE_LOCAL a                          -> INC_LOCAL|DEC_LOCAL a k
+ *   EQ|NE|LT|LE|GT|GE; JUMP_IF_NOT off     -> JUMP_IF_NOT_<cmp> off
+ *   <cmp>_II; JUMP_IF_NOT off              -> JUMP_IF_NOT_<cmp>_II off
+ *
+ * A sequence is only fused when none of its instructions after the first is
+ * a jump target. Jumps never leave their function, so all offsets can be
+ * remapped locally once the function has been rewritten.
+ */
+
+static bool peephole_inc_local(const uint8_t* code, uint32_t at, uint32_t end,
+                               const bool* is_target, uint32_t base,
+                               uint8_t* out_op, uint8_t* out_slot, int8_t* out_imm) {
+    // LOAD_LOCAL(2) PUSH_INT(5) ADD/SUB(1) STORE_LOCAL(2)
+    if (at + 10 > end) return false;
+    if (code[at] != OP_LOAD_LOCAL || code[at + 2] != OP_PUSH_INT) return false;
+    uint8_t arith = code[at + 7];
+    bool is_add = arith == OP_ADD || arith == OP_ADD_II;
+    bool is_sub = arith == OP_SUB || arith == OP_SUB_II;
+    if (!is_add && !is_sub) return false;
+    if (code[at + 8] != OP_STORE_LOCAL || code[at + 9] != code[at + 1]) return false;
+    if (is_target[at + 2 - base] || is_target[at + 7 - base] || is_target[at + 8 - base]) {
+        return false;
+    }
+
+    int32_t imm = (int32_t)READ_U32(code, at + 3);
+    if (imm < -128 || imm > 127) return false;
+
+    *out_op = is_add ? OP_INC_LOCAL : OP_DEC_LOCAL;
+    *out_slot = code[at + 1];
+    *out_imm = (int8_t)imm;
+    return true;
+}
+
+static uint8_t peephole_cmp_jump(uint8_t op) {
+    switch (op) {
+        case OP_EQ: return OP_JUMP_IF_NOT_EQ;
+        case OP_NE: return OP_JUMP_IF_NOT_NE;
+        case OP_LT: return OP_JUMP_IF_NOT_LT;
+        case OP_LE: return OP_JUMP_IF_NOT_LE;
+        case OP_GT: return OP_JUMP_IF_NOT_GT;
+        case OP_GE: return OP_JUMP_IF_NOT_GE;
+        case OP_EQ_II: return OP_JUMP_IF_NOT_EQ_II;
+        case OP_NE_II: return OP_JUMP_IF_NOT_NE_II;
+        case OP_LT_II: return OP_JUMP_IF_NOT_LT_II;
+        case OP_LE_II: return OP_JUMP_IF_NOT_LE_II;
+        case OP_GT_II: return OP_JUMP_IF_NOT_GT_II;
+        case OP_GE_II: return OP_JUMP_IF_NOT_GE_II;
+        default:    return OP_NOP;
+    }
+}
+
+static void peephole_function(CodeGen* cg, uint32_t start) {
+    uint8_t* code = cg->code;
+    uint32_t end = cg->code_size;
+    uint32_t len = end - start;
+    if (len == 0) return;
+
+    // Mark jump targets (offsets relative to start, end inclusive)
+    bool* is_target = calloc(len + 1, sizeof(bool));
+    for (uint32_t ip = start; ip < end; ) {
+        uint8_t op = code[ip];
+        int size = opcode_operand_size(op);
+        if (size < 0 || ip + 1 + (uint32_t)size > end) {
+            free(is_target);
+            return;  // Leave anything we can't decode alone
+        }
+        if (opcode_is_jump(op)) {
+            int64_t target = (int64_t)ip + 3 + READ_I16(code, ip + 1);
+            if (target < start || target > end) {
+                free(is_target);
+                return;
+            }
+            is_target[target - start] = true;
+        }
+        ip += 1 + (uint32_t)size;
+    }
+
+    uint8_t* out = malloc(len);
+    int32_t* new_offset = malloc((len + 1) * sizeof(int32_t));
+    uint32_t* jump_at = malloc(len * sizeof(uint32_t));     // Operand positions in out
+    uint32_t* jump_target = malloc(len * sizeof(uint32_t)); // Old relative targets
+    uint32_t jump_count = 0;
+    uint32_t n = 0;
+
+    for (uint32_t ip = start; ip < end; ) {
+        uint8_t op = code[ip];
+        uint32_t size = 1 + (uint32_t)opcode_operand_size(op);
+        new_offset[ip - start] = (int32_t)n;
+
+        uint8_t fused_op, slot;
+        int8_t imm;
+        if (peephole_inc_local(code, ip, end, is_target, start, &fused_op, &slot, &imm)) {
+            out[n++] = fused_op;
+            out[n++] = slot;
+            out[n++] = (uint8_t)imm;
+            ip += 10;
+            continue;
+        }
+
+        // Don't pair a load with the LOAD_LOCAL that starts an increment
+        if (op == OP_LOAD_LOCAL && ip + 4 <= end && code[ip + 2] == OP_LOAD_LOCAL &&
+            !is_target[ip + 2 - start] &&
+            !peephole_inc_local(code, ip + 2, end, is_target, start, &fused_op, &slot, &imm)) {
+            out[n++] = OP_LOAD_LOCAL2;
+            out[n++] = code[ip + 1];
+            out[n++] = code[ip + 3];
+            ip += 4;
+            continue;
+        }
+
+        uint8_t cmp_jump = peephole_cmp_jump(op);
+        if (cmp_jump != OP_NOP && ip + 4 <= end && code[ip + 1] == OP_JUMP_IF_NOT &&
+            !is_target[ip + 1 - start]) {
+            out[n++] = cmp_jump;
+            jump_at[jump_count] = n;
+            jump_target[jump_count++] = (uint32_t)(ip + 4 + READ_I16(code, ip + 2) - start);
+            n += 2;
+            ip += 4;
+            continue;
+        }
+
+        memcpy(out + n, code + ip, size);
+        if (opcode_is_jump(op)) {
+            jump_at[jump_count] = n + 1;
+            jump_target[jump_count++] = (uint32_t)(ip + 3 + READ_I16(code, ip + 1) - start);
+        }
+        n += size;
+        ip += size;
+    }
+    new_offset[len] = (int32_t)n;
+
+    // Re-resolve jumps against the rewritten layout
+    for (uint32_t i = 0; i < jump_count; i++) {
+        int32_t rel = new_offset[jump_target[i]] - (int32_t)(jump_at[i] + 2);
+        out[jump_at[i]] = rel & 0xFF;
+        out[jump_at[i] + 1] = (rel >> 8) & 0xFF;
+    }
+
+    memcpy(code + start, out, n);
+    cg->code_size = start + n;
+
+    free(out);
+    free(new_offset);
+    free(jump_at);
+    free(jump_target);
+    free(is_target);
+}
+
 // ============================================================================
 // Declaration Code Generation
 // ============================================================================
@@ -700,6 +920,10 @@ static void emit_function(CodeGen* cg, FunctionDecl* fn) {
         emit_byte(cg, OP_RETURN);
     }
 
+    if (cg->optimize) {
+        peephole_function(cg, start_offset);
+    }
+
     // Record function in table
     if (cg->func_count >= cg->func_capacity) {
         cg->func_capacity = cg->func_capacity == 0 ? 16 : cg->func_capacity * 2;
@@ -739,6 +963,10 @@ static void emit_tool(CodeGen* cg, const char* agent_name, ToolDecl* tool) {
         emit_byte(cg, OP_RETURN);
     }
 
+    if (cg->optimize) {
+        peephole_function(cg, start_offset);
+    }
+
     // Build qualified name: "AgentName$toolname"
     char qualified_name[256];
     snprintf(qualified_name, sizeof(qualified_name), "%s$%s", agent_name, tool->name);
@@ -787,6 +1015,7 @@ static void emit_agent(CodeGen* cg, AgentDecl* agent) {
     }
 
     AgentDef* def = &cg->agents[cg->agent_count++];
+    memset(def, 0, sizeof(AgentDef));
     def->name_idx = add_string_constant(cg, agent->name, strlen(agent->name));
     def->model_idx = agent->model ?
         add_string_constant(cg, agent->model, strlen(agent->model)) : 0;
@@ -794,6 +1023,10 @@ static void emit_agent(CodeGen* cg, AgentDecl* agent) {
         add_string_constant(cg, agent->system_prompt, strlen(agent->system_prompt)) : 0;
     def->tool_count = (uint16_t)agent->tool_count;
     def->temperature_x100 = (uint16_t)(agent->temperature * 100);
+    def->flags = (agent->stream ? AGENT_FLAG_STREAM : 0) |
+                 (agent->cache ? 0 : AGENT_FLAG_NO_CACHE);
+    def->hedge_percentile = agent->hedge;
+    def->timeout_ms = agent->timeout_ms;
 }
 
 // ============================================================================
@@ -802,6 +1035,7 @@ static void emit_agent(CodeGen* cg, AgentDecl* agent) {
 
 void codegen_init(CodeGen* cg) {
     memset(cg, 0, sizeof(CodeGen));
+    cg->optimize = true;
     cg->const_capacity = 1024;
     cg->constants = malloc(cg->const_capacity);
     cg->loop_capacity = 16;
@@ -904,8 +1138,13 @@ void codegen_disassemble(CodeGen* cg, FILE* out) {
     fprintf(out, "; Agents: %u\n", cg->agent_count);
     for (uint32_t i = 0; i < cg->agent_count; i++) {
         AgentDef* ag = &cg->agents[i];
-        fprintf(out, ";   [%u] name_idx=%u model_idx=%u tools=%u temp=%u\n",
-                i, ag->name_idx, ag->model_idx, ag->tool_count, ag->temperature_x100);
+        fprintf(out, ";   [%u] name_idx=%u model_idx=%u tools=%u temp=%u%s%s",
+                i, ag->name_idx, ag->model_idx, ag->tool_count, ag->temperature_x100,
+                (ag->flags & AGENT_FLAG_STREAM) ? " stream" : "",
+                (ag->flags & AGENT_FLAG_NO_CACHE) ? " nocache" : "");
+        if (ag->hedge_percentile) fprintf(out, " hedge=p%u", ag->hedge_percentile);
+        if (ag->timeout_ms) fprintf(out, " timeout=%ums", ag->timeout_ms);
+        fprintf(out, "\n");
     }
     fprintf(out, "\n");
 
@@ -956,8 +1195,46 @@ void codegen_disassemble(CodeGen* cg, FILE* out) {
             case OP_SEND_ASYNC:   fprintf(out, "SEND_ASYNC\n"); break;
             case OP_SPAWN_ASYNC:  fprintf(out, "SPAWN_ASYNC %u\n", READ_U16(cg->code, ip)); ip += 2; break;
             case OP_AWAIT:        fprintf(out, "AWAIT\n"); break;
+            case OP_AWAIT_ALL:    fprintf(out, "AWAIT_ALL\n"); break;
+            case OP_AWAIT_ANY:    fprintf(out, "AWAIT_ANY\n"); break;
+            case OP_AWAIT_FIRST:  fprintf(out, "AWAIT_FIRST\n"); break;
             case OP_GET_FIELD:    fprintf(out, "GET_FIELD %u\n", READ_U16(cg->code, ip)); ip += 2; break;
             case OP_CALL_METHOD:  fprintf(out, "CALL_METHOD %u %u\n", READ_U16(cg->code, ip), cg->code[ip+2]); ip += 3; break;
+            case OP_LOAD_LOCAL2:  fprintf(out, "LOAD_LOCAL2 %u %u\n", cg->code[ip], cg->code[ip+1]); ip += 2; break;
+            case OP_INC_LOCAL:    fprintf(out, "INC_LOCAL %u %d\n", cg->code[ip], (int8_t)cg->code[ip+1]); ip += 2; break;
+            case OP_DEC_LOCAL:    fprintf(out, "DEC_LOCAL %u %d\n", cg->code[ip], (int8_t)cg->code[ip+1]); ip += 2; break;
+            case OP_JUMP_IF_NOT_EQ: fprintf(out, "JUMP_IF_NOT_EQ %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_NE: fprintf(out, "JUMP_IF_NOT_NE %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_LT: fprintf(out, "JUMP_IF_NOT_LT %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_LE: fprintf(out, "JUMP_IF_NOT_LE %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_GT: fprintf(out, "JUMP_IF_NOT_GT %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_GE: fprintf(out, "JUMP_IF_NOT_GE %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_EQ_II: fprintf(out, "JUMP_IF_NOT_EQ_II %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_NE_II: fprintf(out, "JUMP_IF_NOT_NE_II %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_LT_II: fprintf(out, "JUMP_IF_NOT_LT_II %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_LE_II: fprintf(out, "JUMP_IF_NOT_LE_II %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_GT_II: fprintf(out, "JUMP_IF_NOT_GT_II %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_JUMP_IF_NOT_GE_II: fprintf(out, "JUMP_IF_NOT_GE_II %d\n", READ_I16(cg->code, ip)); ip += 2; break;
+            case OP_ADD_II:       fprintf(out, "ADD_II\n"); break;
+            case OP_SUB_II:       fprintf(out, "SUB_II\n"); break;
+            case OP_MUL_II:       fprintf(out, "MUL_II\n"); break;
+            case OP_DIV_II:       fprintf(out, "DIV_II\n"); break;
+            case OP_MOD_II:       fprintf(out, "MOD_II\n"); break;
+            case OP_EQ_II:        fprintf(out, "EQ_II\n"); break;
+            case OP_NE_II:        fprintf(out, "NE_II\n"); break;
+            case OP_LT_II:        fprintf(out, "LT_II\n"); break;
+            case OP_LE_II:        fprintf(out, "LE_II\n"); break;
+            case OP_GT_II:        fprintf(out, "GT_II\n"); break;
+            case OP_GE_II:        fprintf(out, "GE_II\n"); break;
+            case OP_ADD_FF:       fprintf(out, "ADD_FF\n"); break;
+            case OP_SUB_FF:       fprintf(out, "SUB_FF\n"); break;
+            case OP_MUL_FF:       fprintf(out, "MUL_FF\n"); break;
+            case OP_DIV_FF:       fprintf(out, "DIV_FF\n"); break;
+            case OP_LT_FF:        fprintf(out, "LT_FF\n"); break;
+            case OP_LE_FF:        fprintf(out, "LE_FF\n"); break;
+            case OP_GT_FF:        fprintf(out, "GT_FF\n"); break;
+            case OP_GE_FF:        fprintf(out, "GE_FF\n"); break;
+            case OP_SLEEP:        fprintf(out, "SLEEP\n"); break;
             case OP_PRINT:        fprintf(out, "PRINT\n"); break;
             case OP_HALT:         fprintf(out, "HALT\n"); break;
             default:              fprintf(out, "UNKNOWN(%02x)\n", op); break;
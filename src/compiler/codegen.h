@@ -55,6 +55,9 @@ typedef struct {
     uint32_t loop_depth;
     uint32_t loop_capacity;
 
+    // Run the peephole pass over each function (on by default)
+    bool optimize;
+
     // Error tracking
     bool had_error;
     char error_msg[256];
@@ -27,6 +27,10 @@ static const Keyword keywords[] = {
     {"model",       TOK_MODEL},
     {"system",      TOK_SYSTEM},
     {"temperature", TOK_TEMPERATURE},
+    {"stream",      TOK_STREAM},
+    {"cache",       TOK_CACHE},
+    {"hedge",       TOK_HEDGE},
+    {"timeout",     TOK_TIMEOUT},
     {"true",        TOK_TRUE},
     {"false",       TOK_FALSE},
     {"null",        TOK_NULL},
@@ -391,6 +395,10 @@ const char* token_type_name(TokenType type) {
         case TOK_MODEL:       return "MODEL";
         case TOK_SYSTEM:      return "SYSTEM";
         case TOK_TEMPERATURE: return "TEMPERATURE";
+        case TOK_STREAM:      return "STREAM";
+        case TOK_CACHE:       return "CACHE";
+        case TOK_HEDGE:       return "HEDGE";
+        case TOK_TIMEOUT:     return "TIMEOUT";
         case TOK_TRUE:        return "TRUE";
         case TOK_FALSE:       return "FALSE";
         case TOK_NULL:        return "NULL";
@@ -39,6 +39,10 @@ typedef enum {
     TOK_MODEL,          // model
     TOK_SYSTEM,         // system
     TOK_TEMPERATURE,    // temperature
+    TOK_STREAM,         // stream
+    TOK_CACHE,          // cache
+    TOK_HEDGE,          // hedge
+    TOK_TIMEOUT,        // timeout
     TOK_TRUE,           // true
     TOK_FALSE,          // false
     TOK_NULL,           // null
@@ -7,6 +7,7 @@
  *   vegac input.vega              # Output to input.vgb
  *   vegac input.vega -o out.vgb   # Output to specified file
  *   vegac input.vega -S           # Output disassembly
+ *   vegac input.vega -O0          # Disable the peephole optimizer
  */
 
 #include <stdio.h>
@@ -25,11 +26,12 @@
 #include "../common/memory.h"
 
 static void print_usage(const char* prog) {
-    fprintf(stderr, "Usage: %s <input.vega> [-o <output.vgb>] [-S]\n", prog);
+    fprintf(stderr, "Usage: %s <input.vega> [-o <output.vgb>] [-S] [-O0]\n", prog);
     fprintf(stderr, "\n");
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -o <file>   Write output to <file>\n");
     fprintf(stderr, "  -S          Output disassembly instead of bytecode\n");
+    fprintf(stderr, "  -O0         Disable peephole optimization (superinstructions)\n");
     fprintf(stderr, "  -v          Verbose output (show compilation stages)\n");
     fprintf(stderr, "  --ast       Print AST (for debugging)\n");
     fprintf(stderr, "  --tokens    Print tokens (for debugging)\n");
@@ -78,6 +80,7 @@ int main(int argc, char* argv[]) {
     bool print_ast = false;
     bool print_tokens = false;
     bool verbose = false;
+    bool optimize = true;
 
     // Parse arguments
     for (int i = 1; i < argc; i++) {
@@ -92,6 +95,8 @@ int main(int argc, char* argv[]) {
             output_file = argv[++i];
         } else if (strcmp(argv[i], "-S") == 0) {
             disassemble = true;
+        } else if (strcmp(argv[i], "-O0") == 0) {
+            optimize = false;
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
             verbose = true;
         } else if (strcmp(argv[i], "--ast") == 0) {
@@ -200,6 +205,7 @@ int main(int argc, char* argv[]) {
     if (verbose) fprintf(stderr, "[4/4] Generating bytecode...\n");
     CodeGen codegen;
     codegen_init(&codegen);
+    codegen.optimize = optimize;
 
     // Generate code for imported modules first
     AstProgram* modules[64];
@@ -268,8 +268,40 @@ static AstExpr* parse_spawn(Parser* parser) {
     return ast_spawn(name, is_async, loc);
 }
 
+// Contextual words ("all", "any", "of") are plain identifiers elsewhere
+static bool token_is_word(Token* token, const char* word) {
+    size_t len = strlen(word);
+    return token->type == TOK_IDENT && token->value.str.length == len &&
+           memcmp(token->value.str.start, word, len) == 0;
+}
+
+// await f, await all fs, await any fs, or await n of fs. "all" and "any"
+// start a combinator only when an array (a name or a literal) follows.
 static AstExpr* parse_await(Parser* parser) {
     SourceLoc loc = parser->previous.loc;
+
+    if (token_is_word(&parser->current, "all") || token_is_word(&parser->current, "any")) {
+        Token next = lexer_peek_token(parser->lexer);
+        if (next.type == TOK_IDENT || next.type == TOK_LBRACKET) {
+            AwaitMode mode = token_is_word(&parser->current, "all") ? AWAIT_ALL : AWAIT_ANY;
+            advance(parser);
+            AstExpr* futures = parse_expression(parser);
+            return ast_await_group(mode, NULL, futures, loc);
+        }
+    }
+
+    if (check(parser, TOK_INT) || check(parser, TOK_IDENT)) {
+        Token next = lexer_peek_token(parser->lexer);
+        if (token_is_word(&next, "of")) {
+            advance(parser);
+            AstExpr* count = parser->previous.type == TOK_INT
+                ? parse_number(parser) : parse_identifier(parser);
+            advance(parser);  // of
+            AstExpr* futures = parse_expression(parser);
+            return ast_await_group(AWAIT_FIRST, count, futures, loc);
+        }
+    }
+
     AstExpr* future = parse_expression(parser);
     return ast_await(future, loc);
 }
@@ -970,6 +1002,10 @@ static AstDecl* parse_agent(Parser* parser) {
     char* model = NULL;
     char* system_prompt = NULL;
     double temperature = 0.7;  // default
+    bool stream = false;
+    bool cache = true;
+    uint8_t hedge = 0;
+    uint32_t timeout_ms = 0;
 
     ToolDecl* tools = NULL;
     uint32_t tool_count = 0;
@@ -993,6 +1029,42 @@ static AstDecl* parse_agent(Parser* parser) {
                 error(parser, "Expected number for temperature");
             }
         }
+        else if (match(parser, TOK_STREAM)) {
+            if (match(parser, TOK_TRUE)) {
+                stream = true;
+            } else if (match(parser, TOK_FALSE)) {
+                stream = false;
+            } else {
+                error(parser, "Expected true or false for stream");
+            }
+        }
+        else if (match(parser, TOK_CACHE)) {
+            if (match(parser, TOK_TRUE)) {
+                cache = true;
+            } else if (match(parser, TOK_FALSE)) {
+                cache = false;
+            } else {
+                error(parser, "Expected true or false for cache");
+            }
+        }
+        else if (match(parser, TOK_HEDGE)) {
+            consume(parser, TOK_INT, "Expected a latency percentile for hedge");
+            int64_t percentile = parser->previous.value.int_val;
+            if (percentile < 0 || percentile > 99) {
+                error_at(parser, &parser->previous, "hedge percentile must be between 1 and 99");
+            } else {
+                hedge = (uint8_t)percentile;
+            }
+        }
+        else if (match(parser, TOK_TIMEOUT)) {
+            consume(parser, TOK_INT, "Expected a timeout in milliseconds");
+            int64_t ms = parser->previous.value.int_val;
+            if (ms < 1 || ms > UINT32_MAX) {
+                error_at(parser, &parser->previous, "timeout must be a positive number of milliseconds");
+            } else {
+                timeout_ms = (uint32_t)ms;
+            }
+        }
         else if (match(parser, TOK_TOOL)) {
             ToolDecl tool = parse_tool(parser);
             if (tool_count >= tool_capacity) {
@@ -1017,6 +1089,10 @@ static AstDecl* parse_agent(Parser* parser) {
     decl->as.agent.model = model;
     decl->as.agent.system_prompt = system_prompt;
     decl->as.agent.temperature = temperature;
+    decl->as.agent.stream = stream;
+    decl->as.agent.cache = cache;
+    decl->as.agent.hedge = hedge;
+    decl->as.agent.timeout_ms = timeout_ms;
     decl->as.agent.tools = tools;
     decl->as.agent.tool_count = tool_count;
 
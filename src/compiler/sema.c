@@ -427,6 +427,15 @@ static TypeInfo analyze_binary(SemanticAnalyzer* sema, AstExpr* expr) {
     TypeInfo left = analyze_expr(sema, expr->as.binary.left);
     TypeInfo right = analyze_expr(sema, expr->as.binary.right);
 
+    // Record proven operand types for codegen's specialized opcodes
+    if (left.kind == TYPE_INT && right.kind == TYPE_INT) {
+        expr->as.binary.operands = OPERANDS_INT;
+    } else if (left.kind == TYPE_FLOAT && right.kind == TYPE_FLOAT) {
+        expr->as.binary.operands = OPERANDS_FLOAT;
+    } else {
+        expr->as.binary.operands = OPERANDS_DYNAMIC;
+    }
+
     switch (expr->as.binary.op) {
         case BINOP_ADD:
             // Array concatenation
@@ -552,6 +561,18 @@ static TypeInfo analyze_expr(SemanticAnalyzer* sema, AstExpr* expr) {
                     }
                     return (TypeInfo){.kind = TYPE_VOID};
                 }
+                if (strcmp(name, "sleep") == 0) {
+                    // sleep(ms) suspends the caller, not the VM
+                    if (expr->as.call.arg_count != 1) {
+                        sema_error(sema, expr->loc, "sleep expects 1 argument (milliseconds)");
+                        return (TypeInfo){.kind = TYPE_VOID};
+                    }
+                    TypeInfo ms = analyze_expr(sema, expr->as.call.args[0]);
+                    if (ms.kind != TYPE_INT && ms.kind != TYPE_UNKNOWN) {
+                        sema_error(sema, expr->loc, "sleep expects an int (milliseconds)");
+                    }
+                    return (TypeInfo){.kind = TYPE_VOID};
+                }
 
                 // Check for module::function calls
                 if (strstr(name, "::") != NULL) {
@@ -629,9 +650,45 @@ static TypeInfo analyze_expr(SemanticAnalyzer* sema, AstExpr* expr) {
                     strcmp(expr->as.method_call.method, "contains") == 0) {
                     return (TypeInfo){.kind = TYPE_BOOL};
                 }
+                if (strcmp(expr->as.method_call.method, "len") == 0 ||
+                    strcmp(expr->as.method_call.method, "char_code") == 0 ||
+                    strcmp(expr->as.method_call.method, "split_len") == 0) {
+                    return (TypeInfo){.kind = TYPE_INT};
+                }
+                if (strcmp(expr->as.method_call.method, "char_at") == 0) {
+                    return (TypeInfo){.kind = TYPE_STRING};
+                }
+                if (strcmp(expr->as.method_call.method, "split") == 0) {
+                    return (TypeInfo){.kind = TYPE_ARRAY, .element_type = TYPE_STRING};
+                }
+            }
+
+            // Array methods
+            if (obj_type.kind == TYPE_ARRAY) {
                 if (strcmp(expr->as.method_call.method, "len") == 0) {
                     return (TypeInfo){.kind = TYPE_INT};
                 }
+                if (strcmp(expr->as.method_call.method, "contains") == 0) {
+                    return (TypeInfo){.kind = TYPE_BOOL};
+                }
+            }
+
+            // Result methods
+            if (obj_type.kind == TYPE_RESULT) {
+                if (strcmp(expr->as.method_call.method, "is_ok") == 0 ||
+                    strcmp(expr->as.method_call.method, "is_err") == 0) {
+                    return (TypeInfo){.kind = TYPE_BOOL};
+                }
+            }
+
+            // Future methods
+            if (obj_type.kind == TYPE_FUTURE) {
+                if (strcmp(expr->as.method_call.method, "is_ready") == 0) {
+                    return (TypeInfo){.kind = TYPE_BOOL};
+                }
+                if (strcmp(expr->as.method_call.method, "partial") == 0) {
+                    return (TypeInfo){.kind = TYPE_STRING};
+                }
             }
 
             // Analyze arguments
@@ -674,10 +731,34 @@ static TypeInfo analyze_expr(SemanticAnalyzer* sema, AstExpr* expr) {
                           type_name(target.kind));
             }
             analyze_expr(sema, expr->as.message.message);
+            if (expr->as.message.is_async) {
+                return (TypeInfo){.kind = TYPE_FUTURE};
+            }
             return (TypeInfo){.kind = TYPE_STRING};  // Responses are strings
         }
 
         case EXPR_AWAIT: {
+            if (expr->as.await.mode != AWAIT_ONE) {
+                if (expr->as.await.count) {
+                    TypeInfo count = analyze_expr(sema, expr->as.await.count);
+                    if (count.kind != TYPE_INT && count.kind != TYPE_UNKNOWN) {
+                        sema_error(sema, expr->as.await.count->loc,
+                                  "Await count must be int, got %s", type_name(count.kind));
+                    }
+                }
+                TypeInfo futures = analyze_expr(sema, expr->as.await.future);
+                if ((futures.kind != TYPE_ARRAY && futures.kind != TYPE_UNKNOWN) ||
+                    (futures.kind == TYPE_ARRAY && futures.element_type != TYPE_FUTURE &&
+                     futures.element_type != TYPE_UNKNOWN)) {
+                    sema_error(sema, expr->loc, "Can only await an array of futures");
+                }
+                // any yields one response, all and first n an array of them
+                if (expr->as.await.mode == AWAIT_ANY) {
+                    return (TypeInfo){.kind = TYPE_STRING};
+                }
+                return (TypeInfo){.kind = TYPE_ARRAY, .element_type = TYPE_STRING};
+            }
+
             TypeInfo future = analyze_expr(sema, expr->as.await.future);
             // Accept both futures and strings (strings are already-resolved values)
             if (future.kind != TYPE_FUTURE && future.kind != TYPE_STRING) {
@@ -0,0 +1,61 @@
+#include "../vm/value.h"
+#include "../vm/native.h"
+#include <stdlib.h>
+
+/*
+ * Array methods
+ *
+ * Methods:
+ *   arr.len() -> int
+ *   arr.push(value) -> null           (appends in place)
+ *   arr.pop() -> value                (null if empty)
+ *   arr.contains(value) -> bool
+ */
+
+// ============================================================================
+// Methods
+// ============================================================================
+
+// arr.len() -> int
+static Value method_array_len(Value* args) {
+    return value_int(array_length(value_as_array(args[0])));
+}
+
+// arr.push(value) -> null
+static Value method_array_push(Value* args) {
+    array_push(value_as_array(args[0]), args[1]);
+    return value_null();
+}
+
+// arr.pop() -> value
+static Value method_array_pop(Value* args) {
+    VegaArray* arr = value_as_array(args[0]);
+    if (!arr || arr->count == 0) return value_null();
+    // The array's reference moves to the caller
+    return arr->items[--arr->count];
+}
+
+// arr.contains(value) -> bool
+static Value method_array_contains(Value* args) {
+    VegaArray* arr = value_as_array(args[0]);
+    if (!arr) return value_bool(false);
+    for (uint32_t i = 0; i < arr->count; i++) {
+        if (value_equals(arr->items[i], args[1])) return value_bool(true);
+    }
+    return value_bool(false);
+}
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+static const NativeDef array_methods[] = {
+    {"len", 0, true, method_array_len},
+    {"push", 1, false, method_array_push},
+    {"pop", 0, false, method_array_pop},
+    {"contains", 1, true, method_array_contains},
+};
+
+void stdlib_array_register(void) {
+    native_register_methods(VAL_ARRAY, array_methods, sizeof(array_methods) / sizeof(array_methods[0]));
+}
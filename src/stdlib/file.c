@@ -1,4 +1,6 @@
 #include "../vm/value.h"
+#include "../vm/native.h"
+#include "../common/memory.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -11,8 +13,67 @@
  *   file::exists(path: str) -> bool
  */
 
-// file::read implementation is in vm.c (call_native)
-// file::write implementation is in vm.c (call_native)
-// file::exists implementation is in vm.c (call_native)
+// ============================================================================
+// Natives
+// ============================================================================
 
-// Additional functions can be added here as native implementations
+// file::read(path) -> str
+static Value native_file_read(Value* args) {
+    if (value_type(args[0]) != VAL_STRING) {
+        return value_null();
+    }
+    FILE* f = fopen(value_as_string(args[0])->data, "r");
+    if (!f) return value_null();
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char* content = malloc(size + 1);
+    size_t read = fread(content, 1, size, f);
+    content[read] = '\0';
+    fclose(f);
+
+    VegaString* str = vega_string_new(content, (uint32_t)read);
+    free(content);
+    return value_string(str);
+}
+
+// file::write(path, content) -> void
+static Value native_file_write(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_STRING) {
+        return value_null();
+    }
+    FILE* f = fopen(value_as_string(args[0])->data, "w");
+    if (!f) return value_null();
+    fwrite(value_as_string(args[1])->data, 1, value_as_string(args[1])->length, f);
+    fclose(f);
+    return value_null();
+}
+
+// file::exists(path) -> bool
+static Value native_file_exists(Value* args) {
+    if (value_type(args[0]) != VAL_STRING) {
+        return value_bool(false);
+    }
+    FILE* f = fopen(value_as_string(args[0])->data, "r");
+    if (f) {
+        fclose(f);
+        return value_bool(true);
+    }
+    return value_bool(false);
+}
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+static const NativeDef file_natives[] = {
+    {"file::read", 1, false, native_file_read},
+    {"file::write", 2, false, native_file_write},
+    {"file::exists", 1, false, native_file_exists},
+};
+
+void stdlib_file_register(void) {
+    native_register_module(file_natives, sizeof(file_natives) / sizeof(file_natives[0]));
+}
@@ -0,0 +1,48 @@
+#include "../vm/value.h"
+#include "../vm/native.h"
+#include <stdlib.h>
+
+/*
+ * Future methods
+ *
+ * Methods:
+ *   f.is_ready() -> bool
+ *   f.partial() -> str       (text streamed so far; the full response once
+ *                             ready; "" for agents that do not stream)
+ */
+
+// ============================================================================
+// Methods
+// ============================================================================
+
+// f.is_ready() -> bool
+static Value method_future_is_ready(Value* args) {
+    return value_bool(future_is_ready(value_as_future(args[0])));
+}
+
+// f.partial() -> str
+static Value method_future_partial(Value* args) {
+    VegaFuture* f = value_as_future(args[0]);
+    VegaString* result = future_get_result(f);
+    if (result) {
+        vega_obj_retain(result);
+        return value_string(result);
+    }
+    if (f && f->partial) {
+        return value_string(vega_string_new(f->partial, (uint32_t)f->partial_len));
+    }
+    return value_string(vega_string_from_cstr(""));
+}
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+static const NativeDef future_methods[] = {
+    {"is_ready", 0, false, method_future_is_ready},
+    {"partial", 0, false, method_future_partial},
+};
+
+void stdlib_future_register(void) {
+    native_register_methods(VAL_FUTURE, future_methods, sizeof(future_methods) / sizeof(future_methods[0]));
+}
@@ -0,0 +1,48 @@
+#include "../vm/value.h"
+#include "../vm/native.h"
+#include "../vm/http.h"
+#include "../common/memory.h"
+
+/*
+ * http module - Plain HTTP requests
+ *
+ * Functions:
+ *   http::get(url: str) -> str
+ */
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+// http::get(url) -> str (response body)
+static Value native_http_get(Value* args) {
+    if (value_type(args[0]) != VAL_STRING) {
+        return value_string(vega_string_from_cstr(""));
+    }
+    HttpResponse* resp = http_get(value_as_string(args[0])->data);
+    if (!resp) {
+        return value_string(vega_string_from_cstr(""));
+    }
+    VegaString* result;
+    if (resp->body) {
+        result = vega_string_new(resp->body, (uint32_t)resp->body_len);
+    } else if (resp->error) {
+        result = vega_string_from_cstr(resp->error);
+    } else {
+        result = vega_string_from_cstr("");
+    }
+    http_response_free(resp);
+    return value_string(result);
+}
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+static const NativeDef http_natives[] = {
+    {"http::get", 1, false, native_http_get},
+};
+
+void stdlib_http_register(void) {
+    native_register_module(http_natives, sizeof(http_natives) / sizeof(http_natives[0]));
+}
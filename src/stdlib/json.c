@@ -1,5 +1,6 @@
 #include "../vm/value.h"
 #include "../common/memory.h"
+#include "../vm/native.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -12,6 +13,12 @@
  *   json::parse(s: str) -> value
  *   json::stringify(v: value) -> str
  *   json::get(obj: value, key: str) -> value
+ *   json::get_string(json: str, key: str) -> str
+ *   json::get_int(json: str, key: str) -> int
+ *   json::get_float(json: str, key: str) -> float
+ *   json::get_array(json: str, key: str) -> str
+ *   json::array_len(array_json: str) -> int
+ *   json::array_get(array_json: str, index: int) -> str
  *
  * Note: This is a minimal JSON implementation.
  * For production use, consider integrating cJSON.
@@ -106,24 +113,24 @@ bool json_get_bool(const char* json, const char* key, bool* found) {
 VegaString* json_stringify_value(Value v) {
     char buffer[256];
 
-    switch (v.type) {
+    switch (value_type(v)) {
         case VAL_NULL:
             return vega_string_from_cstr("null");
 
         case VAL_BOOL:
-            return vega_string_from_cstr(v.as.boolean ? "true" : "false");
+            return vega_string_from_cstr(value_as_bool(v) ? "true" : "false");
 
         case VAL_INT:
-            snprintf(buffer, sizeof(buffer), "%lld", (long long)v.as.integer);
+            snprintf(buffer, sizeof(buffer), "%lld", (long long)value_as_int(v));
             return vega_string_from_cstr(buffer);
 
         case VAL_FLOAT:
-            snprintf(buffer, sizeof(buffer), "%g", v.as.floating);
+            snprintf(buffer, sizeof(buffer), "%g", value_as_float(v));
             return vega_string_from_cstr(buffer);
 
         case VAL_STRING: {
             // Need to escape the string
-            VegaString* s = v.as.string;
+            VegaString* s = value_as_string(v);
             size_t needed = s->length * 2 + 3;  // Worst case + quotes + null
             char* result = malloc(needed);
             char* p = result;
@@ -152,3 +159,240 @@ VegaString* json_stringify_value(Value v) {
             return vega_string_from_cstr("null");
     }
 }
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+// json::get_string(json, key) -> str
+static Value native_json_get_string(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_STRING) {
+        return value_string(vega_string_from_cstr(""));
+    }
+    const char* json = value_as_string(args[0])->data;
+    const char* key = value_as_string(args[1])->data;
+
+    // Build search pattern: "key":
+    char pattern[256];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+
+    const char* pos = strstr(json, pattern);
+    if (!pos) return value_string(vega_string_from_cstr(""));
+
+    pos += strlen(pattern);
+    while (*pos == ' ' || *pos == '\t' || *pos == '\n') pos++;
+
+    if (*pos != '"') return value_string(vega_string_from_cstr(""));
+    pos++;
+
+    const char* end = pos;
+    while (*end && *end != '"') {
+        if (*end == '\\' && *(end + 1)) end += 2;
+        else end++;
+    }
+
+    VegaString* result = vega_string_new(pos, (uint32_t)(end - pos));
+    return value_string(result);
+}
+
+// json::get_float(json, key) -> float
+static Value native_json_get_float(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_STRING) {
+        return value_float(0.0);
+    }
+    const char* json = value_as_string(args[0])->data;
+    const char* key = value_as_string(args[1])->data;
+
+    char pattern[256];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+
+    const char* pos = strstr(json, pattern);
+    if (!pos) return value_float(0.0);
+
+    pos += strlen(pattern);
+    while (*pos == ' ' || *pos == '\t' || *pos == '\n') pos++;
+
+    double val = atof(pos);
+    return value_float(val);
+}
+
+// json::get_int(json, key) -> int
+static Value native_json_get_int(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_STRING) {
+        return value_int(0);
+    }
+    const char* json = value_as_string(args[0])->data;
+    const char* key = value_as_string(args[1])->data;
+
+    char pattern[256];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+
+    const char* pos = strstr(json, pattern);
+    if (!pos) return value_int(0);
+
+    pos += strlen(pattern);
+    while (*pos == ' ' || *pos == '\t' || *pos == '\n') pos++;
+
+    int val = atoi(pos);
+    return value_int(val);
+}
+
+// json::get_array(json, key) -> str (array as JSON string)
+static Value native_json_get_array(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_STRING) {
+        return value_string(vega_string_from_cstr("[]"));
+    }
+    const char* json = value_as_string(args[0])->data;
+    const char* key = value_as_string(args[1])->data;
+
+    char pattern[256];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+
+    const char* pos = strstr(json, pattern);
+    if (!pos) return value_string(vega_string_from_cstr("[]"));
+
+    pos += strlen(pattern);
+    while (*pos == ' ' || *pos == '\t' || *pos == '\n') pos++;
+
+    if (*pos != '[') return value_string(vega_string_from_cstr("[]"));
+
+    const char* start = pos;
+    int depth = 1;
+    pos++;
+    while (*pos && depth > 0) {
+        if (*pos == '[') depth++;
+        else if (*pos == ']') depth--;
+        else if (*pos == '"') {
+            pos++;
+            while (*pos && *pos != '"') {
+                if (*pos == '\\' && *(pos + 1)) pos++;
+                pos++;
+            }
+        }
+        pos++;
+    }
+
+    VegaString* result = vega_string_new(start, (uint32_t)(pos - start));
+    return value_string(result);
+}
+
+// json::array_len(array_json) -> int
+static Value native_json_array_len(Value* args) {
+    if (value_type(args[0]) != VAL_STRING) {
+        return value_int(0);
+    }
+    const char* json = value_as_string(args[0])->data;
+    if (!json || *json != '[') return value_int(0);
+
+    int count = 0;
+    int depth = 0;
+    bool in_string = false;
+
+    for (const char* p = json; *p; p++) {
+        if (in_string) {
+            if (*p == '\\' && *(p + 1)) p++;
+            else if (*p == '"') in_string = false;
+            continue;
+        }
+        if (*p == '"') in_string = true;
+        else if (*p == '[') depth++;
+        else if (*p == ']') depth--;
+        else if (*p == ',' && depth == 1) count++;
+    }
+
+    // If we have any content, count is items - 1, so add 1
+    const char* p = json + 1;
+    while (*p == ' ' || *p == '\t' || *p == '\n') p++;
+    if (*p != ']') count++;
+
+    return value_int(count);
+}
+
+// json::array_get(array_json, index) -> str
+static Value native_json_array_get(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_INT) {
+        return value_string(vega_string_from_cstr(""));
+    }
+    const char* json = value_as_string(args[0])->data;
+    int64_t target_idx = value_as_int(args[1]);
+
+    if (!json || *json != '[') return value_string(vega_string_from_cstr(""));
+
+    int current_idx = 0;
+    int depth = 0;
+    bool in_string = false;
+    const char* item_start = NULL;
+
+    for (const char* p = json; *p; p++) {
+        if (in_string) {
+            if (*p == '\\' && *(p + 1)) p++;
+            else if (*p == '"') in_string = false;
+            continue;
+        }
+        if (*p == '"') {
+            in_string = true;
+            if (depth == 1 && item_start == NULL) {
+                item_start = p;
+            }
+        }
+        else if (*p == '[') {
+            depth++;
+            if (depth == 1) {
+                const char* next = p + 1;
+                while (*next == ' ' || *next == '\t' || *next == '\n') next++;
+                if (*next != ']') item_start = next;
+            }
+        }
+        else if (*p == ']') {
+            if (depth == 1 && current_idx == target_idx && item_start) {
+                if (*item_start == '"') {
+                    item_start++;
+                    const char* end = item_start;
+                    while (*end && *end != '"') {
+                        if (*end == '\\' && *(end + 1)) end++;
+                        end++;
+                    }
+                    return value_string(vega_string_new(item_start, (uint32_t)(end - item_start)));
+                }
+            }
+            depth--;
+        }
+        else if (*p == ',' && depth == 1) {
+            if (current_idx == target_idx && item_start) {
+                if (*item_start == '"') {
+                    item_start++;
+                    const char* end = item_start;
+                    while (*end && *end != '"') {
+                        if (*end == '\\' && *(end + 1)) end++;
+                        end++;
+                    }
+                    return value_string(vega_string_new(item_start, (uint32_t)(end - item_start)));
+                }
+            }
+            current_idx++;
+            item_start = NULL;
+            const char* next = p + 1;
+            while (*next == ' ' || *next == '\t' || *next == '\n') next++;
+            item_start = next;
+        }
+    }
+
+    return value_string(vega_string_from_cstr(""));
+}
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+static const NativeDef json_natives[] = {
+    {"json::get_string", 2, true, native_json_get_string},
+    {"json::get_float", 2, true, native_json_get_float},
+    {"json::get_int", 2, true, native_json_get_int},
+    {"json::get_array", 2, true, native_json_get_array},
+    {"json::array_len", 1, true, native_json_array_len},
+    {"json::array_get", 2, true, native_json_array_get},
+};
+
+void stdlib_json_register(void) {
+    native_register_module(json_natives, sizeof(json_natives) / sizeof(json_natives[0]));
+}
@@ -0,0 +1,60 @@
+#include "../vm/value.h"
+#include "../vm/native.h"
+#include <stdlib.h>
+
+/*
+ * Result methods
+ *
+ * Methods:
+ *   res.is_ok() -> bool
+ *   res.is_err() -> bool
+ *   res.unwrap() -> value             (the Ok or Err payload)
+ *   res.unwrap_or(default) -> value   (payload if Ok, else default)
+ */
+
+// ============================================================================
+// Methods
+// ============================================================================
+
+// res.is_ok() -> bool
+static Value method_result_is_ok(Value* args) {
+    VegaResult* r = value_as_result(args[0]);
+    return value_bool(r && r->is_ok);
+}
+
+// res.is_err() -> bool
+static Value method_result_is_err(Value* args) {
+    VegaResult* r = value_as_result(args[0]);
+    return value_bool(r && !r->is_ok);
+}
+
+// res.unwrap() -> value
+static Value method_result_unwrap(Value* args) {
+    VegaResult* r = value_as_result(args[0]);
+    if (!r) return value_null();
+    value_retain(r->value);
+    return r->value;
+}
+
+// res.unwrap_or(default) -> value
+static Value method_result_unwrap_or(Value* args) {
+    VegaResult* r = value_as_result(args[0]);
+    Value v = (r && r->is_ok) ? r->value : args[1];
+    value_retain(v);
+    return v;
+}
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+static const NativeDef result_methods[] = {
+    {"is_ok", 0, true, method_result_is_ok},
+    {"is_err", 0, true, method_result_is_err},
+    {"unwrap", 0, true, method_result_unwrap},
+    {"unwrap_or", 1, true, method_result_unwrap_or},
+};
+
+void stdlib_result_register(void) {
+    native_register_methods(VAL_RESULT, result_methods, sizeof(result_methods) / sizeof(result_methods[0]));
+}
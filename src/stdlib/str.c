@@ -1,4 +1,6 @@
 #include "../vm/value.h"
+#include "../vm/native.h"
+#include <stdio.h>
 #include "../common/memory.h"
 #include <string.h>
 #include <stdlib.h>
@@ -12,11 +14,21 @@
  *   str::concat(a: str, b: str) -> str
  *   str::substr(s: str, start: int, len: int) -> str
  *   str::split(s: str, delimiter: str) -> str[]
+ *   str::split_len(s: str, delimiter: str) -> int
+ *   str::char_at(s: str, index: int) -> str
+ *   str::char_code(c: str) -> int
+ *   str::char_lower(c: str) -> str
+ *   str::from_int(n: int) -> str
+ *
+ * Methods:
+ *   s.len() -> int
+ *   s.has(substr: str) -> bool          (alias: contains)
+ *   s.char_at(index: int) -> str
+ *   s.char_code() -> int
+ *   s.split(delimiter: str) -> str[]
+ *   s.split_len(delimiter: str) -> int
  */
 
-// str::len implementation is in vm.c (call_native)
-// str::contains implementation is in vm.c (call_native)
-
 // Additional string functions
 
 VegaString* str_concat(VegaString* a, VegaString* b) {
@@ -66,3 +78,155 @@ VegaString** str_split(VegaString* s, VegaString* delim, uint32_t* out_count) {
     *out_count = count;
     return result;
 }
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+// str::len(s) -> int
+static Value native_str_len(Value* args) {
+    if (value_type(args[0]) != VAL_STRING) return value_int(0);
+    return value_int(value_as_string(args[0])->length);
+}
+
+// str::contains(s, substr) -> bool
+static Value native_str_contains(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_STRING) {
+        return value_bool(false);
+    }
+    return value_bool(vega_string_contains(value_as_string(args[0]), value_as_string(args[1])));
+}
+
+// str::char_at(s, index) -> str (single character)
+static Value native_str_char_at(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_INT) {
+        return value_null();
+    }
+    VegaString* s = value_as_string(args[0]);
+    int64_t idx = value_as_int(args[1]);
+    if (idx < 0 || (uint32_t)idx >= s->length) {
+        return value_string(vega_string_new("", 0));
+    }
+    char buf[2] = {s->data[idx], '\0'};
+    return value_string(vega_string_new(buf, 1));
+}
+
+// str::from_int(n) -> str
+static Value native_str_from_int(Value* args) {
+    if (value_type(args[0]) != VAL_INT) {
+        return value_string(vega_string_from_cstr(""));
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%lld", (long long)value_as_int(args[0]));
+    return value_string(vega_string_from_cstr(buf));
+}
+
+// str::split(s, delimiter) -> str[] (array of strings)
+static Value native_str_split(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_STRING) {
+        return value_array(array_new(0));
+    }
+    VegaString* s = value_as_string(args[0]);
+    VegaString* delim = value_as_string(args[1]);
+
+    VegaArray* result = array_new(8);
+
+    if (delim->length == 0) {
+        // Empty delimiter - return array with original string
+        array_push(result, value_string(s));
+        return value_array(result);
+    }
+
+    const char* start = s->data;
+    const char* end = s->data + s->length;
+    const char* pos;
+
+    while ((pos = strstr(start, delim->data)) != NULL && start < end) {
+        uint32_t len = pos - start;
+        VegaString* part = vega_string_new(start, len);
+        array_push(result, value_string(part));
+        vega_obj_release(part);  // The array holds the reference
+        start = pos + delim->length;
+    }
+
+    // Add remaining part
+    if (start <= end) {
+        uint32_t len = end - start;
+        VegaString* part = vega_string_new(start, len);
+        array_push(result, value_string(part));
+        vega_obj_release(part);  // The array holds the reference
+    }
+
+    return value_array(result);
+}
+
+// str::char_code(c) -> int (ASCII value of first char)
+static Value native_str_char_code(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_as_string(args[0])->length == 0) {
+        return value_int(0);
+    }
+    return value_int((unsigned char)value_as_string(args[0])->data[0]);
+}
+
+// str::char_lower(c) -> str (lowercase single char)
+static Value native_str_char_lower(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_as_string(args[0])->length == 0) {
+        return value_string(vega_string_new("", 0));
+    }
+    char c = value_as_string(args[0])->data[0];
+    if (c >= 'A' && c <= 'Z') {
+        c = c + ('a' - 'A');
+    }
+    char buf[2] = {c, '\0'};
+    return value_string(vega_string_new(buf, 1));
+}
+
+// str::split_len(s, delimiter) -> int (count of parts after split)
+static Value native_str_split_len(Value* args) {
+    if (value_type(args[0]) != VAL_STRING || value_type(args[1]) != VAL_STRING) {
+        return value_int(0);
+    }
+    VegaString* s = value_as_string(args[0]);
+    VegaString* delim = value_as_string(args[1]);
+
+    if (delim->length == 0) return value_int(1);
+
+    int count = 1;
+    const char* pos = s->data;
+    while ((pos = strstr(pos, delim->data)) != NULL) {
+        count++;
+        pos += delim->length;
+    }
+    return value_int(count);
+}
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+static const NativeDef str_natives[] = {
+    {"str::len", 1, true, native_str_len},
+    {"str::contains", 2, true, native_str_contains},
+    {"str::char_at", 2, true, native_str_char_at},
+    {"str::from_int", 1, true, native_str_from_int},
+    {"str::split", 2, true, native_str_split},
+    {"str::char_code", 1, true, native_str_char_code},
+    {"str::char_lower", 1, true, native_str_char_lower},
+    {"str::split_len", 2, true, native_str_split_len},
+};
+
+// Methods reuse the natives: the receiver arrives as args[0]
+static const NativeDef str_methods[] = {
+    {"len", 0, true, native_str_len},
+    {"has", 1, true, native_str_contains},
+    {"contains", 1, true, native_str_contains},
+    {"char_at", 1, true, native_str_char_at},
+    {"char_code", 0, true, native_str_char_code},
+    {"split", 1, true, native_str_split},
+    {"split_len", 1, true, native_str_split_len},
+};
+
+void stdlib_str_register(void) {
+    native_register_module(str_natives, sizeof(str_natives) / sizeof(str_natives[0]));
+    native_register_methods(VAL_STRING, str_methods, sizeof(str_methods) / sizeof(str_methods[0]));
+}
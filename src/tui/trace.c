@@ -319,6 +319,107 @@ void trace_http_done(int status_code, uint64_t duration_ms,
     free(event.data);
 }
 
+void trace_http_pool(const char* stats_json) {
+    if (!trace_is_enabled()) return;
+
+    TraceEvent event = {
+        .type = TRACE_HTTP_POOL,
+        .timestamp_ms = trace_get_time_ms(),
+        .data = stats_json ? strdup(stats_json) : NULL,
+        .is_error = false
+    };
+
+    trace_emit(&event);
+
+    free(event.data);
+}
+
+void trace_msg_delta(uint32_t agent_id, const char* agent_name, const char* text) {
+    if (!trace_is_enabled()) return;
+
+    TraceEvent event = {
+        .type = TRACE_MSG_DELTA,
+        .timestamp_ms = trace_get_time_ms(),
+        .agent_id = agent_id,
+        .agent_name = agent_name ? strdup(agent_name) : NULL,
+        .data = text ? strdup(text) : NULL,
+        .is_error = false
+    };
+
+    trace_emit(&event);
+
+    free(event.agent_name);
+    free(event.data);
+}
+
+void trace_http_stream(double ttft_ms, double itl_ms, uint32_t deltas) {
+    if (!trace_is_enabled()) return;
+
+    char data[128];
+    snprintf(data, sizeof(data), "{\"ttft_ms\":%.1f,\"itl_ms\":%.2f,\"deltas\":%u}",
+             ttft_ms, itl_ms, deltas);
+
+    TraceEvent event = {
+        .type = TRACE_HTTP_STREAM,
+        .timestamp_ms = trace_get_time_ms(),
+        .duration_ms = (uint64_t)ttft_ms,
+        .data = data,
+        .is_error = false
+    };
+
+    trace_emit(&event);
+}
+
+void trace_http_throttle(const char* model, uint64_t wait_ms) {
+    if (!trace_is_enabled()) return;
+
+    TraceEvent event = {
+        .type = TRACE_HTTP_THROTTLE,
+        .timestamp_ms = trace_get_time_ms(),
+        .duration_ms = wait_ms,
+        .data = model ? strdup(model) : NULL,
+        .is_error = false
+    };
+
+    trace_emit(&event);
+
+    free(event.data);
+}
+
+void trace_http_queue(uint64_t wait_ms, uint32_t queued, uint32_t inflight) {
+    if (!trace_is_enabled()) return;
+
+    char data[96];
+    snprintf(data, sizeof(data), "{\"wait_ms\":%llu,\"queued\":%u,\"inflight\":%u}",
+             (unsigned long long)wait_ms, queued, inflight);
+
+    TraceEvent event = {
+        .type = TRACE_HTTP_QUEUE,
+        .timestamp_ms = trace_get_time_ms(),
+        .duration_ms = wait_ms,
+        .data = data,
+        .is_error = false
+    };
+
+    trace_emit(&event);
+}
+
+void trace_http_hedge(const char* model, uint64_t delay_ms) {
+    if (!trace_is_enabled()) return;
+
+    TraceEvent event = {
+        .type = TRACE_HTTP_HEDGE,
+        .timestamp_ms = trace_get_time_ms(),
+        .duration_ms = delay_ms,
+        .data = model ? strdup(model) : NULL,
+        .is_error = false
+    };
+
+    trace_emit(&event);
+
+    free(event.data);
+}
+
 void trace_error(uint32_t agent_id, const char* message) {
     if (!trace_is_enabled()) return;
 
@@ -373,6 +474,12 @@ const char* trace_event_type_name(TraceEventType type) {
         case TRACE_ERROR:       return "ERROR";
         case TRACE_VM_STEP:     return "VM_STEP";
         case TRACE_PRINT:       return "PRINT";
+        case TRACE_HTTP_POOL:   return "HTTP_POOL";
+        case TRACE_MSG_DELTA:   return "MSG_DELTA";
+        case TRACE_HTTP_STREAM: return "HTTP_STREAM";
+        case TRACE_HTTP_THROTTLE: return "HTTP_THROTTLE";
+        case TRACE_HTTP_QUEUE:  return "HTTP_QUEUE";
+        case TRACE_HTTP_HEDGE:  return "HTTP_HEDGE";
         default:                return "UNKNOWN";
     }
 }
@@ -27,6 +27,12 @@ typedef enum {
     TRACE_ERROR,            // Error occurred
     TRACE_VM_STEP,          // VM executed instruction (verbose)
     TRACE_PRINT,            // Program print output
+    TRACE_HTTP_POOL,        // Connection pool stats (after each HTTP request)
+    TRACE_MSG_DELTA,        // Streamed response text as it arrives
+    TRACE_HTTP_STREAM,      // Streamed response latency (TTFT, inter-token)
+    TRACE_HTTP_THROTTLE,    // Request held back by the client rate limiter
+    TRACE_HTTP_QUEUE,       // Request waited for an admission slot
+    TRACE_HTTP_HEDGE,       // Slow request duplicated (hedged)
 } TraceEventType;
 
 // ============================================================================
@@ -124,6 +130,24 @@ void trace_http_start(const char* url, const char* method);
 void trace_http_done(int status_code, uint64_t duration_ms,
                      TokenUsage* tokens, const char* error);
 
+// Emit connection pool stats (JSON object)
+void trace_http_pool(const char* stats_json);
+
+// Emit a chunk of streamed response text
+void trace_msg_delta(uint32_t agent_id, const char* agent_name, const char* text);
+
+// Emit streamed response latency (duration_ms carries the TTFT)
+void trace_http_stream(double ttft_ms, double itl_ms, uint32_t deltas);
+
+// Emit time a request spent held back by the rate limiter before dispatch
+void trace_http_throttle(const char* model, uint64_t wait_ms);
+
+// Emit admission wait; data carries the queue depth and requests in flight
+void trace_http_queue(uint64_t wait_ms, uint32_t queued, uint32_t inflight);
+
+// Emit a hedge: a request with no response after delay_ms was sent again
+void trace_http_hedge(const char* model, uint64_t delay_ms);
+
 // Emit error event
 void trace_error(uint32_t agent_id, const char* message);
 
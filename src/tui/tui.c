@@ -246,6 +246,21 @@ static void tui_draw_header(TuiState* tui) {
     uint64_t out_tokens = tui->vm ? tui->vm->budget_used_output_tokens : tui->total_output_tokens;
     double cost = tui->vm ? tui->vm->budget_used_cost_usd : 0.0;
 
+    if (tui->last_ttft_ms > 0) {
+        mvwprintw(tui->header_win, 0, 7, "ttft %.0fms  itl %.1fms",
+                  tui->last_ttft_ms, tui->last_itl_ms);
+    }
+
+    if (tui->throttled_ms > 0) {
+        mvwprintw(tui->header_win, 0, 34, "throttled %.1fs", tui->throttled_ms / 1000.0);
+    }
+    if (tui->queued_requests > 0) {
+        mvwprintw(tui->header_win, 0, 51, "queued %u", tui->queued_requests);
+    }
+    if (tui->hedged_requests > 0) {
+        mvwprintw(tui->header_win, 0, 62, "hedged %u", tui->hedged_requests);
+    }
+
     if (in_tokens > 0 || out_tokens > 0) {
         char stats_str[96];
         snprintf(stats_str, sizeof(stats_str), "%lluk in / %lluk out | $%.4f",
@@ -308,6 +323,15 @@ static void tui_draw_agents(TuiState* tui) {
                         wattroff(tui->agents_win, A_DIM);
                         break;
 
+                    case AGENT_STATUS_STREAMING:
+                        wattron(tui->agents_win, COLOR_PAIR(COLOR_THINKING) | A_BOLD);
+                        mvwprintw(tui->agents_win, y, 4, "[streaming]");
+                        wattroff(tui->agents_win, COLOR_PAIR(COLOR_THINKING) | A_BOLD);
+                        wattron(tui->agents_win, A_DIM);
+                        wprintw(tui->agents_win, " receiving response...");
+                        wattroff(tui->agents_win, A_DIM);
+                        break;
+
                     case AGENT_STATUS_TOOL_CALL:
                         wattron(tui->agents_win, COLOR_PAIR(COLOR_TOOL) | A_BOLD);
                         mvwprintw(tui->agents_win, y, 4, "[tool]");
@@ -774,6 +798,60 @@ int tui_run(TuiState* tui) {
 // Trace Callback
 // ============================================================================
 
+static TuiAgentInfo* tui_find_agent(TuiState* tui, uint32_t agent_id) {
+    for (uint32_t i = 0; i < tui->agent_count; i++) {
+        if (tui->agents[i].agent_id == agent_id) return &tui->agents[i];
+    }
+    return NULL;
+}
+
+// The agent's live line, unless the ring buffer has since reused it
+static OutputLine* tui_stream_line(TuiState* tui, TuiAgentInfo* agent) {
+    if (!agent || agent->stream_line < 0) return NULL;
+    OutputLine* line = &tui->output_buffer[agent->stream_line];
+    if (line->type != OUTPUT_AGENT_MSG || !line->agent_name ||
+        strcmp(line->agent_name, agent->name) != 0) {
+        agent->stream_line = -1;
+        return NULL;
+    }
+    return line;
+}
+
+// Append streamed text to the agent's live line in the Messages panel
+static void tui_stream_output(TuiState* tui, uint32_t agent_id, const char* agent_name,
+                              const char* text) {
+    TuiAgentInfo* agent = tui_find_agent(tui, agent_id);
+    if (!agent) return;
+
+    OutputLine* line = tui_stream_line(tui, agent);
+    if (!line) {
+        tui_add_output(tui, OUTPUT_AGENT_MSG, agent_name ? agent_name : agent->name, "");
+        agent->stream_line = (int)((tui->output_head + TUI_OUTPUT_BUFFER_SIZE - 1) % TUI_OUTPUT_BUFFER_SIZE);
+        line = &tui->output_buffer[agent->stream_line];
+    }
+
+    size_t len = strlen(line->text);
+    if (len >= TUI_STREAM_PREVIEW) return;  // Already ends in "..."
+
+    size_t add = strlen(text);
+    bool truncated = len + add > TUI_STREAM_PREVIEW;
+    if (truncated) add = TUI_STREAM_PREVIEW - len;
+
+    char* grown = realloc(line->text, len + add + 4);
+    if (!grown) return;
+    for (size_t i = 0; i < add; i++) {
+        char c = text[i];
+        grown[len + i] = (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+    }
+    len += add;
+    if (truncated) {
+        memcpy(grown + len, "...", 3);
+        len += 3;
+    }
+    grown[len] = '\0';
+    line->text = grown;
+}
+
 static void trace_callback(TraceEvent* event, void* userdata) {
     TuiState* tui = (TuiState*)userdata;
     if (!tui) return;
@@ -802,17 +880,56 @@ static void trace_callback(TraceEvent* event, void* userdata) {
             tui_refresh(tui);
             break;
 
-        case TRACE_MSG_RECV:
+        case TRACE_MSG_RECV: {
             tui_set_agent_status(tui, event->agent_id, AGENT_STATUS_IDLE, NULL);
             tui_update_agent_tokens(tui, event->agent_id, &event->tokens, event->duration_ms);
+            TuiAgentInfo* agent = tui_find_agent(tui, event->agent_id);
+            OutputLine* live = tui_stream_line(tui, agent);
             if (event->data) {
                 char preview[100];
                 snprintf(preview, sizeof(preview), "%.80s%s",
                          event->data, strlen(event->data) > 80 ? "..." : "");
-                tui_add_output(tui, OUTPUT_AGENT_MSG, agent_name, preview);
+                if (live) {
+                    // The streamed line becomes the final response
+                    free(live->text);
+                    live->text = strdup(preview);
+                } else {
+                    tui_add_output(tui, OUTPUT_AGENT_MSG, agent_name, preview);
+                }
+            }
+            if (agent) agent->stream_line = -1;
+            break;
+        }
+
+        case TRACE_MSG_DELTA:
+            if (event->data) {
+                tui_set_agent_status(tui, event->agent_id, AGENT_STATUS_STREAMING, NULL);
+                tui_stream_output(tui, event->agent_id, agent_name, event->data);
             }
             break;
 
+        case TRACE_HTTP_STREAM: {
+            const char* itl = event->data ? strstr(event->data, "\"itl_ms\":") : NULL;
+            const char* ttft = event->data ? strstr(event->data, "\"ttft_ms\":") : NULL;
+            if (ttft) tui->last_ttft_ms = strtod(ttft + 10, NULL);
+            if (itl) tui->last_itl_ms = strtod(itl + 9, NULL);
+            break;
+        }
+
+        case TRACE_HTTP_THROTTLE:
+            tui->throttled_ms += event->duration_ms;
+            break;
+
+        case TRACE_HTTP_QUEUE: {
+            const char* queued = event->data ? strstr(event->data, "\"queued\":") : NULL;
+            if (queued) tui->queued_requests = (uint32_t)strtoul(queued + 9, NULL, 10);
+            break;
+        }
+
+        case TRACE_HTTP_HEDGE:
+            tui->hedged_requests++;
+            break;
+
         case TRACE_TOOL_CALL:
             tui_set_agent_status(tui, event->agent_id, AGENT_STATUS_TOOL_CALL, event->data);
             tui_add_output(tui, OUTPUT_TOOL, agent_name, event->data);
@@ -924,6 +1041,7 @@ void tui_track_agent(TuiState* tui, uint32_t agent_id, const char* name, const c
     agent->name = name ? strdup(name) : strdup("unnamed");
     agent->active = true;
     agent->status = AGENT_STATUS_IDLE;
+    agent->stream_line = -1;
 
     // Extract model from JSON if provided
     if (model && strstr(model, "\"model\":")) {
@@ -34,6 +34,7 @@
 #define TUI_INPUT_BUFFER_SIZE   1024  // Input buffer
 #define TUI_HISTORY_SIZE        100   // Command history
 #define TUI_OUTPUT_BUFFER_SIZE  512   // Max output lines
+#define TUI_STREAM_PREVIEW      200   // Max chars of a live streamed line
 
 // ============================================================================
 // Agent Info
@@ -43,6 +44,7 @@ typedef enum {
     AGENT_STATUS_IDLE,
     AGENT_STATUS_THINKING,   // Waiting for API response
     AGENT_STATUS_TOOL_CALL,  // Executing a tool
+    AGENT_STATUS_STREAMING,  // Receiving a streamed response
 } AgentStatus;
 
 typedef struct {
@@ -55,6 +57,7 @@ typedef struct {
     bool active;
     AgentStatus status;
     char* current_tool;      // Tool name if in TOOL_CALL status
+    int stream_line;         // Output line being streamed into (-1 if none)
 } TuiAgentInfo;
 
 // ============================================================================
@@ -105,6 +108,19 @@ typedef struct TuiState {
     uint64_t total_input_tokens;
     uint64_t total_output_tokens;
 
+    // Latency of the most recent streamed response
+    double last_ttft_ms;
+    double last_itl_ms;
+
+    // Total time requests waited on the client rate limiter
+    uint64_t throttled_ms;
+
+    // Requests waiting for an admission slot (as of the last one to start)
+    uint32_t queued_requests;
+
+    // Slow requests duplicated by hedging
+    uint32_t hedged_requests;
+
     // Input
     char input_buffer[TUI_INPUT_BUFFER_SIZE];
     int input_pos;
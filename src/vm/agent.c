@@ -1,13 +1,13 @@
 #include "agent.h"
 #include "vm.h"
 #include "http.h"
+#include "message.h"
 #include "scheduler.h"
 #include "../tui/trace.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/time.h>
-#include <unistd.h>  // for usleep
 
 // ============================================================================
 // Error Classification
@@ -19,8 +19,8 @@ typedef enum {
     ERROR_FATAL,          // Auth error, bad request, etc.
 } ErrorType;
 
-// Classify an HTTP status code and response body
-static ErrorType classify_error(int status_code, const char* body) {
+// Classify an HTTP status code and decoded response body
+static ErrorType classify_error(int status_code, const ApiMessage* msg) {
     if (status_code == 200) {
         return ERROR_NONE;
     }
@@ -40,8 +40,8 @@ static ErrorType classify_error(int status_code, const char* body) {
         return ERROR_RETRIABLE;
     }
 
-    // Check for overloaded error in body
-    if (body && strstr(body, "overloaded")) {
+    // Overloaded error reported with another status
+    if (msg && msg->error_type && strcmp(msg->error_type, "overloaded_error") == 0) {
         return ERROR_RETRIABLE;
     }
 
@@ -98,6 +98,27 @@ static char* json_get_value(const char* json, const char* key, bool* is_string)
 // Agent Lifecycle
 // ============================================================================
 
+// Helper to build tool definitions array
+static ToolDefinition* build_tool_defs(VegaAgent* agent) {
+    if (agent->tool_count == 0) return NULL;
+
+    ToolDefinition* tool_defs = calloc(agent->tool_count, sizeof(ToolDefinition));
+    if (!tool_defs) return NULL;
+    for (uint32_t i = 0; i < agent->tool_count; i++) {
+        tool_defs[i].name = agent->tools[i].name;
+        tool_defs[i].description = agent->tools[i].description ?
+            agent->tools[i].description : "A tool function";
+        tool_defs[i].param_names = agent->tools[i].param_names;
+        tool_defs[i].param_types = agent->tools[i].param_types;
+        tool_defs[i].param_count = agent->tools[i].param_count;
+    }
+    return tool_defs;
+}
+
+static void agent_retry_fire(VegaVM* vm, Timer* timer);
+static void agent_deadline_fire(VegaVM* vm, Timer* timer);
+static void stop_backoff(VegaAgent* agent);
+
 VegaAgent* agent_spawn(VegaVM* vm, uint32_t agent_def_id) {
     AgentDef* def = vm_get_agent(vm, agent_def_id);
     if (!def) {
@@ -111,7 +132,24 @@ VegaAgent* agent_spawn(VegaVM* vm, uint32_t agent_def_id) {
         return NULL;
     }
 
+    // Everything agent_free() looks at is set up before the first failure
+    // path that calls it
     agent->agent_id = agent_def_id;
+    agent->is_valid = false;
+    agent->messages = NULL;
+    agent->message_count = 0;
+    agent->message_capacity = 0;
+    agent->conversation = NULL;
+    agent->process = NULL;
+    agent->pending_request = NULL;
+    agent->async_state = AGENT_ASYNC_IDLE;
+    agent->failed = false;
+    agent->notify = 0;
+    agent->abort_reason = NULL;
+    memset(&agent->tool_ctx, 0, sizeof(AgentToolContext));
+    agent->tool_ctx.max_iterations = 10;
+    timer_init(&agent->retry_timer, agent_retry_fire, agent);
+    timer_init(&agent->deadline_timer, agent_deadline_fire, agent);
 
     // Get name from constant pool
     uint32_t len;
@@ -143,6 +181,10 @@ VegaAgent* agent_spawn(VegaVM* vm, uint32_t agent_def_id) {
 
     // Temperature
     agent->temperature = def->temperature_x100 / 100.0;
+    agent->stream = (def->flags & AGENT_FLAG_STREAM) != 0;
+    agent->prompt_cache = (def->flags & AGENT_FLAG_NO_CACHE) == 0;
+    agent->hedge_percentile = def->hedge_percentile < 100 ? (uint8_t)def->hedge_percentile : 0;
+    agent->timeout_ms = def->timeout_ms;
 
     // Load tools - look for functions named "AgentName$toolname"
     agent->tools = NULL;
@@ -251,17 +293,21 @@ VegaAgent* agent_spawn(VegaVM* vm, uint32_t agent_def_id) {
         }
     }
 
-    // Initialize conversation history
-    agent->messages = NULL;
-    agent->message_count = 0;
-    agent->message_capacity = 0;
+    // The request header and tool schemas are serialized once, here
+    ToolDefinition* tool_defs = build_tool_defs(agent);
+    agent->conversation = http_conversation_new(agent->model, agent->system_prompt,
+                                                agent->temperature, tool_defs,
+                                                tool_defs ? (int)agent->tool_count : 0,
+                                                agent->stream, agent->prompt_cache);
+    free(tool_defs);
+    if (!agent->conversation) {
+        agent_free(agent);
+        return NULL;
+    }
+    http_conversation_set_flow(agent->conversation, agent->agent_id + 1);
+    http_conversation_set_hedge(agent->conversation, agent->hedge_percentile);
 
     agent->is_valid = true;
-    agent->process = NULL;
-    agent->pending_request = NULL;
-    agent->async_state = AGENT_ASYNC_IDLE;
-    memset(&agent->tool_ctx, 0, sizeof(AgentToolContext));
-    agent->tool_ctx.max_iterations = 10;
 
     // Emit trace event
     trace_agent_spawn(agent_def_id, agent->name, agent->model);
@@ -286,11 +332,13 @@ static void clear_tool_context(AgentToolContext* ctx) {
 static void agent_cleanup(VegaAgent* agent) {
     if (!agent) return;
 
-    // Cancel any pending async request
+    // Cancel any pending async request and its timers
     if (agent->pending_request) {
         http_async_cancel(agent->pending_request);
         agent->pending_request = NULL;
     }
+    stop_backoff(agent);
+    timer_cancel(&agent->deadline_timer);
 
     // Clean up tool context
     clear_tool_context(&agent->tool_ctx);
@@ -321,6 +369,7 @@ static void agent_cleanup(VegaAgent* agent) {
         free(agent->messages[i]);
     }
     free(agent->messages);
+    http_conversation_free(agent->conversation);
 }
 
 void agent_free(VegaAgent* agent) {
@@ -342,9 +391,12 @@ VegaAgent* agent_spawn_supervised(VegaVM* vm, uint32_t agent_def_id,
         return NULL;
     }
 
-    // Apply supervision config
+    // Apply the restart policy; backoff and circuit breaker settings keep
+    // the defaults from process_create
     if (config) {
-        proc->supervision = *config;
+        proc->supervision.strategy = config->strategy;
+        proc->supervision.max_restarts = config->max_restarts;
+        proc->supervision.window_ms = config->window_ms;
     }
 
     // Link agent and process
@@ -352,11 +404,8 @@ VegaAgent* agent_spawn_supervised(VegaVM* vm, uint32_t agent_def_id,
     proc->agent = agent;
     proc->agent_def_id = agent_def_id;
 
-    // Add to VM's process table
-    if (vm->process_count < MAX_PROCESSES) {
-        vm->processes[vm->process_count++] = proc;
-        vm->scheduler.processes_spawned++;
-    } else {
+    // Add to VM's process table (a record: the scheduler never runs it)
+    if (!scheduler_add(&vm->scheduler, proc)) {
         fprintf(stderr, "Warning: Max processes reached, agent not supervised\n");
         process_free(proc);
         agent->process = NULL;
@@ -433,7 +482,7 @@ static char* execute_tool(VegaVM* vm, VegaAgent* agent, const char* tool_name, c
     }
 
     // Set up call frame
-    if (vm->frame_count < VM_FRAMES_MAX) {
+    if (vm_reserve_frames(vm, 1)) {
         CallFrame* frame = &vm->frames[vm->frame_count++];
         frame->function_id = tool->function_id;
         frame->ip = vm->ip;
@@ -450,6 +499,7 @@ static char* execute_tool(VegaVM* vm, VegaAgent* agent, const char* tool_name, c
         // Run until return
         while (vm->running && vm->frame_count > saved_frame_count) {
             vm_step(vm);
+            vm_wait_async(vm);
         }
     }
 
@@ -494,6 +544,10 @@ static bool add_message(VegaAgent* agent, const char* message) {
     if (!msg_copy) {
         return false;  // strdup failed
     }
+    if (!http_conversation_append(agent->conversation, message)) {
+        free(msg_copy);
+        return false;
+    }
     agent->messages[agent->message_count++] = msg_copy;
     return true;
 }
@@ -519,57 +573,22 @@ VegaString* agent_send_message(VegaVM* vm, VegaAgent* agent, const char* message
         return vega_string_from_cstr("Error: Out of memory");
     }
 
-    // Build tool definitions if agent has tools
-    ToolDefinition* tool_defs = NULL;
-    if (agent->tool_count > 0) {
-        tool_defs = calloc(agent->tool_count, sizeof(ToolDefinition));
-        for (uint32_t i = 0; i < agent->tool_count; i++) {
-            tool_defs[i].name = agent->tools[i].name;
-            tool_defs[i].description = agent->tools[i].description ?
-                agent->tools[i].description : "A tool function";
-            tool_defs[i].param_names = agent->tools[i].param_names;
-            tool_defs[i].param_types = agent->tools[i].param_types;
-            tool_defs[i].param_count = agent->tools[i].param_count;
-        }
-    }
-
     // Tool use loop
     int max_iterations = 10;  // Prevent infinite loops
     for (int iter = 0; iter < max_iterations; iter++) {
-        HttpResponse* resp;
-
-        if (tool_defs && agent->tool_count > 0) {
-            resp = anthropic_send_with_tools(
-                vm->api_key,
-                agent->model,
-                agent->system_prompt,
-                (const char**)agent->messages,
-                (int)agent->message_count,
-                tool_defs,
-                (int)agent->tool_count,
-                agent->temperature
-            );
-        } else {
-            resp = anthropic_send_messages(
-                vm->api_key,
-                agent->model,
-                agent->system_prompt,
-                (const char**)agent->messages,
-                (int)agent->message_count,
-                agent->temperature
-            );
-        }
+        HttpResponse* resp = anthropic_send_body(
+            vm->api_key, http_conversation_request(agent->conversation));
 
         fflush(stderr);
 
         if (!resp) {
             trace_error(agent->agent_id, "Failed to send HTTP request");
-            free(tool_defs);
             return vega_string_from_cstr("Error: Failed to send message");
         }
 
         // Track token usage for budget
-        vm_add_token_usage(vm, resp->tokens.input_tokens, resp->tokens.output_tokens);
+        vm_add_token_usage(vm, resp->tokens.input_tokens, resp->tokens.output_tokens,
+                       resp->tokens.cache_read_tokens, resp->tokens.cache_write_tokens);
 
         // Check budget limits
         if (vm_budget_exceeded(vm)) {
@@ -581,7 +600,6 @@ VegaString* agent_send_message(VegaVM* vm, VegaAgent* agent, const char* message
                     vm->budget_used_cost_usd);
             VegaString* result = vega_string_from_cstr(error_buf);
             http_response_free(resp);
-            free(tool_defs);
             trace_error(agent->agent_id, "Budget exceeded");
             return result;
         }
@@ -591,7 +609,6 @@ VegaString* agent_send_message(VegaVM* vm, VegaAgent* agent, const char* message
             snprintf(error_buf, sizeof(error_buf), "Error: %s", resp->error);
             VegaString* result = vega_string_from_cstr(error_buf);
             http_response_free(resp);
-            free(tool_defs);
             return result;
         }
 
@@ -601,107 +618,59 @@ VegaString* agent_send_message(VegaVM* vm, VegaAgent* agent, const char* message
                     "Error: API returned status %d", resp->status_code);
             VegaString* result = vega_string_from_cstr(error_buf);
             http_response_free(resp);
-            free(tool_defs);
             return result;
         }
 
         // Check for tool use
-        if (resp->body && anthropic_has_tool_use(resp->body)) {
-            char* tool_id = NULL;
-            char* tool_input = NULL;
-
-            char* tool_name = anthropic_extract_tool_use(resp->body, &tool_id, &tool_input);
-            if (tool_name) {
-                // Emit trace for tool call
-                trace_tool_call(agent->agent_id, agent->name, tool_name, tool_input);
-
-                // Execute the tool
-                char* tool_result = execute_tool(vm, agent, tool_name, tool_input);
-
-                // Emit trace for tool result
-                trace_tool_result(agent->agent_id, agent->name, tool_name, tool_result);
-
-                // Extract content array from assistant response for proper API formatting
-                char* assistant_content = NULL;
-                const char* content_start = strstr(resp->body, "\"content\":");
-                if (content_start) {
-                    content_start += 10;
-                    while (*content_start == ' ' || *content_start == '\t' || *content_start == '\n') content_start++;
-                    if (*content_start == '[') {
-                        const char* content_end = content_start + 1;
-                        int depth = 1;
-                        while (*content_end && depth > 0) {
-                            if (*content_end == '[') depth++;
-                            else if (*content_end == ']') depth--;
-                            else if (*content_end == '"') {
-                                content_end++;
-                                while (*content_end && *content_end != '"') {
-                                    if (*content_end == '\\' && *(content_end + 1)) content_end++;
-                                    content_end++;
-                                }
-                            }
-                            if (*content_end) content_end++;
-                        }
-                        assistant_content = strndup(content_start, content_end - content_start);
-                    }
-                }
+        const ApiBlock* tool = api_message_tool_use(resp->message);
+        if (tool && tool->name) {
+            // Emit trace for tool call
+            trace_tool_call(agent->agent_id, agent->name, tool->name, tool->input);
 
-                // Send tool result back with assistant content
-                http_response_free(resp);
-                resp = anthropic_send_tool_result_v2(
-                    vm->api_key,
-                    agent->model,
-                    agent->system_prompt,
-                    (const char**)agent->messages,
-                    (int)agent->message_count,
-                    assistant_content,
-                    tool_id,
-                    tool_result,
-                    tool_defs,
-                    (int)agent->tool_count,
-                    agent->temperature
-                );
-                free(assistant_content);
-
-                free(tool_id);
-                free(tool_name);
-                free(tool_input);
-                free(tool_result);
-
-                if (!resp || resp->status_code != 200) {
-                    free(tool_defs);
-                    if (resp) http_response_free(resp);
-                    return vega_string_from_cstr("Error: Tool result submission failed");
-                }
+            // Execute the tool
+            char* tool_result = execute_tool(vm, agent, tool->name, tool->input);
+
+            // Emit trace for tool result
+            trace_tool_result(agent->agent_id, agent->name, tool->name, tool_result);
+
+            // Send tool result back with the assistant's content array
+            HttpBody* body = http_conversation_tool_result(agent->conversation,
+                                                           resp->message->content,
+                                                           tool->id, tool_result);
+            http_response_free(resp);
+            free(tool_result);
+            resp = anthropic_send_body(vm->api_key, body);
 
-                // Check if we got a final response or another tool call
-                if (resp->body && !anthropic_has_tool_use(resp->body)) {
-                    // Got final response
-                    char* text = anthropic_extract_text(resp->body);
-                    if (text) {
-                        uint64_t duration = get_time_ms() - start_time;
-                        TokenUsage tokens = {0};  // TODO: parse from response
-                        trace_msg_recv(agent->agent_id, agent->name, text, &tokens, duration);
-
-                        // Best effort - history add failure is non-fatal
-                        (void)add_message(agent, text);
-                        VegaString* result = vega_string_from_cstr(text);
-                        free(text);
-                        http_response_free(resp);
-                        free(tool_defs);
-                        return result;
-                    }
+            if (!resp || resp->status_code != 200) {
+                if (resp) http_response_free(resp);
+                return vega_string_from_cstr("Error: Tool result submission failed");
+            }
+
+            // Check if we got a final response or another tool call
+            if (!api_message_tool_use(resp->message)) {
+                // Got final response
+                char* text = api_message_text(resp->message);
+                if (text) {
+                    uint64_t duration = get_time_ms() - start_time;
+                    TokenUsage tokens = {0};  // TODO: parse from response
+                    trace_msg_recv(agent->agent_id, agent->name, text, &tokens, duration);
+
+                    // Best effort - history add failure is non-fatal
+                    (void)add_message(agent, text);
+                    VegaString* result = vega_string_from_cstr(text);
+                    free(text);
+                    http_response_free(resp);
+                    return result;
                 }
-                // Continue loop for another tool call
-                http_response_free(resp);
-                continue;
             }
+            // Continue loop for another tool call
+            http_response_free(resp);
+            continue;
         }
 
         // No tool use - extract text response
-        char* text = anthropic_extract_text(resp->body);
+        char* text = api_message_text(resp->message);
         http_response_free(resp);
-        free(tool_defs);
 
         if (text) {
             uint64_t duration = get_time_ms() - start_time;
@@ -719,7 +688,6 @@ VegaString* agent_send_message(VegaVM* vm, VegaAgent* agent, const char* message
         return vega_string_from_cstr("Error: No response from API");
     }
 
-    free(tool_defs);
     return vega_string_from_cstr("Error: Max tool iterations exceeded");
 }
 
@@ -742,13 +710,84 @@ void agent_clear_history(VegaAgent* agent) {
         free(agent->messages[i]);
     }
     agent->message_count = 0;
+    http_conversation_clear(agent->conversation);
 }
 
 // ============================================================================
 // Async Message API
 // ============================================================================
 
-bool agent_start_message_async(VegaVM* vm, VegaAgent* agent, const char* message) {
+// Withdraw the message a send got no reply to, keeping the history
+// alternating user/assistant
+static void withdraw_message(VegaAgent* agent) {
+    if (http_conversation_drop_last(agent->conversation) && agent->message_count > 0) {
+        free(agent->messages[--agent->message_count]);
+    }
+}
+
+// Send the conversation so far again (after a retriable error)
+static bool resend_request(VegaVM* vm, VegaAgent* agent) {
+    HttpAsyncRequest* req = http_async_send_body(
+        vm->api_key, http_conversation_request(agent->conversation));
+    if (!req) return false;
+    agent->pending_request = req;
+    agent->async_state = AGENT_ASYNC_WAITING;
+    return true;
+}
+
+// Stop waiting out a retry backoff; the agent's process is runnable again
+static void stop_backoff(VegaAgent* agent) {
+    timer_cancel(&agent->retry_timer);
+    if (agent->process && agent->process->state == PROC_WAITING) {
+        agent->process->state = PROC_READY;
+    }
+}
+
+// End the current send without a response. The result is reason, as an
+// error; the send's token is posted so an awaiting future is polled.
+static void abort_send(VegaAgent* agent, const char* reason) {
+    if (agent->pending_request) {
+        http_async_cancel(agent->pending_request);
+        agent->pending_request = NULL;
+    }
+    stop_backoff(agent);
+    agent->async_state = AGENT_ASYNC_ABORTED;
+    agent->abort_reason = reason;
+    http_async_notify(agent->notify);
+}
+
+// The backoff after a retriable error has passed: send again
+static void agent_retry_fire(VegaVM* vm, Timer* timer) {
+    VegaAgent* agent = timer->owner;
+    if (agent->async_state != AGENT_ASYNC_BACKOFF) return;
+
+    stop_backoff(agent);
+    if (!resend_request(vm, agent)) {
+        trace_error(agent->agent_id, "Failed to resend request");
+        abort_send(agent, "Error: Failed to resend request");
+    }
+}
+
+// The send ran past the agent's timeout: abandon it, retries included
+static void agent_deadline_fire(VegaVM* vm, Timer* timer) {
+    VegaAgent* agent = timer->owner;
+    if (agent->async_state == AGENT_ASYNC_IDLE || agent->async_state == AGENT_ASYNC_ABORTED) {
+        return;
+    }
+
+    // Between tool turns (a tool is running) the next request hasn't
+    // started yet; expire it as soon as it has
+    if (!agent->pending_request && agent->async_state != AGENT_ASYNC_BACKOFF) {
+        timer_arm(&vm->scheduler.timers, timer, timer_now_ms() + 1);
+        return;
+    }
+
+    trace_error(agent->agent_id, "Request timed out");
+    abort_send(agent, "Error: Request timed out");
+}
+
+bool agent_start_message_async(VegaVM* vm, VegaAgent* agent, const char* message,
+                               uint64_t notify) {
     if (!agent || !agent->is_valid) {
         trace_error(0, "Invalid agent");
         return false;
@@ -760,7 +799,7 @@ bool agent_start_message_async(VegaVM* vm, VegaAgent* agent, const char* message
     }
 
     // Can't start a new request if one is pending
-    if (agent->pending_request) {
+    if (agent_has_pending_request(agent)) {
         trace_error(agent->agent_id, "Agent already has pending request");
         return false;
     }
@@ -774,54 +813,25 @@ bool agent_start_message_async(VegaVM* vm, VegaAgent* agent, const char* message
         return false;
     }
 
-    // Build tool definitions if agent has tools
-    ToolDefinition* tool_defs = NULL;
-    if (agent->tool_count > 0) {
-        tool_defs = calloc(agent->tool_count, sizeof(ToolDefinition));
-        for (uint32_t i = 0; i < agent->tool_count; i++) {
-            tool_defs[i].name = agent->tools[i].name;
-            tool_defs[i].description = agent->tools[i].description ?
-                agent->tools[i].description : "A tool function";
-            tool_defs[i].param_names = agent->tools[i].param_names;
-            tool_defs[i].param_types = agent->tools[i].param_types;
-            tool_defs[i].param_count = agent->tools[i].param_count;
-        }
-    }
-
-    // Start async request
-    HttpAsyncRequest* req;
-    if (tool_defs && agent->tool_count > 0) {
-        req = http_async_send_with_tools(
-            vm->api_key,
-            agent->model,
-            agent->system_prompt,
-            (const char**)agent->messages,
-            (int)agent->message_count,
-            tool_defs,
-            (int)agent->tool_count,
-            agent->temperature
-        );
-    } else {
-        req = http_async_send_messages(
-            vm->api_key,
-            agent->model,
-            agent->system_prompt,
-            (const char**)agent->messages,
-            (int)agent->message_count,
-            agent->temperature
-        );
-    }
-
-    free(tool_defs);
+    // Start async request; the tool loop and retries reuse the token
+    http_conversation_set_notify(agent->conversation, notify);
+    HttpAsyncRequest* req = http_async_send_body(
+        vm->api_key, http_conversation_request(agent->conversation));
 
     if (!req) {
         trace_error(agent->agent_id, "Failed to start async request");
+        withdraw_message(agent);
         return false;
     }
 
     agent->pending_request = req;
     agent->async_state = AGENT_ASYNC_WAITING;
     agent->tool_ctx.iteration = 0;
+    agent->notify = notify;
+    if (agent->timeout_ms) {
+        timer_arm(&vm->scheduler.timers, &agent->deadline_timer,
+                  timer_now_ms() + agent->timeout_ms);
+    }
     return true;
 }
 
@@ -832,6 +842,9 @@ int agent_poll_message(VegaAgent* agent) {
     if (agent->async_state == AGENT_ASYNC_IDLE) {
         return -1;  // No active request
     }
+    if (agent->async_state == AGENT_ASYNC_BACKOFF) {
+        return 0;   // The retry starts when retry_timer fires
+    }
 
     if (!agent->pending_request) {
         return -1;  // Error - bad state
@@ -849,55 +862,33 @@ int agent_poll_message(VegaAgent* agent) {
     }
 }
 
-// Helper to extract assistant content array from response body
-static char* extract_assistant_content(const char* body) {
-    const char* content_start = strstr(body, "\"content\":");
-    if (!content_start) return NULL;
-
-    content_start += 10;
-    while (*content_start == ' ' || *content_start == '\t' || *content_start == '\n') content_start++;
-
-    if (*content_start != '[') return NULL;
-
-    const char* content_end = content_start + 1;
-    int depth = 1;
-    while (*content_end && depth > 0) {
-        if (*content_end == '[') depth++;
-        else if (*content_end == ']') depth--;
-        else if (*content_end == '"') {
-            content_end++;
-            while (*content_end && *content_end != '"') {
-                if (*content_end == '\\' && *(content_end + 1)) content_end++;
-                content_end++;
-            }
-        }
-        if (*content_end) content_end++;
-    }
-    return strndup(content_start, content_end - content_start);
-}
+static VegaString* take_message_result(VegaVM* vm, VegaAgent* agent);
 
-// Helper to build tool definitions array
-static ToolDefinition* build_tool_defs(VegaAgent* agent) {
-    if (agent->tool_count == 0) return NULL;
-
-    ToolDefinition* tool_defs = calloc(agent->tool_count, sizeof(ToolDefinition));
-    for (uint32_t i = 0; i < agent->tool_count; i++) {
-        tool_defs[i].name = agent->tools[i].name;
-        tool_defs[i].description = agent->tools[i].description ?
-            agent->tools[i].description : "A tool function";
-        tool_defs[i].param_names = agent->tools[i].param_names;
-        tool_defs[i].param_types = agent->tools[i].param_types;
-        tool_defs[i].param_count = agent->tools[i].param_count;
+VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
+    if (agent && agent->async_state == AGENT_ASYNC_ABORTED) {
+        agent->async_state = AGENT_ASYNC_IDLE;
+        clear_tool_context(&agent->tool_ctx);
+        agent->failed = true;
+        withdraw_message(agent);
+        return vega_string_from_cstr(agent->abort_reason);
     }
-    return tool_defs;
-}
 
-VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
     if (!agent || !agent->pending_request) {
-        agent->async_state = AGENT_ASYNC_IDLE;
+        if (agent) agent->async_state = AGENT_ASYNC_IDLE;
         return vega_string_from_cstr("Error: No pending request");
     }
 
+    agent->failed = true;  // Until a final text response arrives
+    VegaString* result = take_message_result(vm, agent);
+    if (result) {
+        timer_cancel(&agent->deadline_timer);  // The send is over
+        if (agent->failed) withdraw_message(agent);
+    }
+    return result;
+}
+
+static VegaString* take_message_result(VegaVM* vm, VegaAgent* agent) {
+
     // Get the response
     HttpResponse* resp = http_async_get_response(agent->pending_request);
     agent->pending_request = NULL;  // Request is consumed
@@ -910,7 +901,8 @@ VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
     }
 
     // Track token usage for budget
-    vm_add_token_usage(vm, resp->tokens.input_tokens, resp->tokens.output_tokens);
+    vm_add_token_usage(vm, resp->tokens.input_tokens, resp->tokens.output_tokens,
+                       resp->tokens.cache_read_tokens, resp->tokens.cache_write_tokens);
 
     // Check budget limits
     if (vm_budget_exceeded(vm)) {
@@ -929,7 +921,7 @@ VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
     }
 
     // Check for errors and handle retry with supervision
-    ErrorType err_type = classify_error(resp->status_code, resp->body);
+    ErrorType err_type = classify_error(resp->status_code, resp->message);
 
     if (resp->error || err_type != ERROR_NONE) {
         // Record failure for circuit breaker
@@ -962,37 +954,24 @@ VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
                         agent->process->supervision.restart_count + 1,
                         agent->process->supervision.max_restarts);
 
-                // Wait for backoff delay (this is blocking but necessary for retry)
-                if (delay > 0) {
-                    usleep(delay * 1000);
-                }
-
                 // Increment retry count
                 agent->process->supervision.restart_count++;
 
-                // Restart the request - rebuild and send again
-                ToolDefinition* tool_defs = build_tool_defs(agent);
-                HttpAsyncRequest* retry_req;
-
-                if (tool_defs && agent->tool_count > 0) {
-                    retry_req = http_async_send_with_tools(
-                        vm->api_key, agent->model, agent->system_prompt,
-                        (const char**)agent->messages, (int)agent->message_count,
-                        tool_defs, (int)agent->tool_count, agent->temperature
-                    );
-                } else {
-                    retry_req = http_async_send_messages(
-                        vm->api_key, agent->model, agent->system_prompt,
-                        (const char**)agent->messages, (int)agent->message_count,
-                        agent->temperature
-                    );
+                // Wait out the backoff on a timer: the agent's process is
+                // parked and everything else keeps running. retry_timer
+                // sends the history again.
+                if (delay > 0) {
+                    http_response_free(resp);
+                    agent->async_state = AGENT_ASYNC_BACKOFF;
+                    agent->process->state = PROC_WAITING;
+                    timer_arm(&vm->scheduler.timers, &agent->retry_timer,
+                              timer_now_ms() + (uint64_t)delay);
+                    return NULL;  // Signal: retry in progress, keep polling
                 }
-                free(tool_defs);
-                http_response_free(resp);
 
-                if (retry_req) {
-                    agent->pending_request = retry_req;
-                    agent->async_state = AGENT_ASYNC_WAITING;
+                // Restart the request - send the history again
+                if (resend_request(vm, agent)) {
+                    http_response_free(resp);
                     return NULL;  // Signal: retry in progress, keep polling
                 }
             }
@@ -1019,7 +998,8 @@ VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
     }
 
     // Check for tool use
-    if (resp->body && anthropic_has_tool_use(resp->body)) {
+    const ApiBlock* tool = api_message_tool_use(resp->message);
+    if (tool) {
         // Check iteration limit
         if (agent->tool_ctx.iteration >= agent->tool_ctx.max_iterations) {
             http_response_free(resp);
@@ -1028,45 +1008,20 @@ VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
             return vega_string_from_cstr("Error: Max tool iterations exceeded");
         }
 
-        // Extract tool use info
-        char* tool_id = NULL;
-        char* tool_input = NULL;
-        char* tool_name = anthropic_extract_tool_use(resp->body, &tool_id, &tool_input);
-
-        if (tool_name) {
+        if (tool->name) {
             // Execute tool (sync - local execution is fast)
-            trace_tool_call(agent->agent_id, agent->name, tool_name, tool_input);
-            char* tool_result = execute_tool(vm, agent, tool_name, tool_input);
-            trace_tool_result(agent->agent_id, agent->name, tool_name, tool_result);
-
-            // Extract assistant content for proper API formatting
-            char* assistant_content = extract_assistant_content(resp->body);
-
-            // Build tool definitions
-            ToolDefinition* tool_defs = build_tool_defs(agent);
-
-            // Start ASYNC request for tool result (not sync!)
-            HttpAsyncRequest* req = http_async_send_tool_result_v2(
-                vm->api_key,
-                agent->model,
-                agent->system_prompt,
-                (const char**)agent->messages,
-                (int)agent->message_count,
-                assistant_content,
-                tool_id,
-                tool_result,
-                tool_defs,
-                (int)agent->tool_count,
-                agent->temperature
-            );
+            trace_tool_call(agent->agent_id, agent->name, tool->name, tool->input);
+            char* tool_result = execute_tool(vm, agent, tool->name, tool->input);
+            trace_tool_result(agent->agent_id, agent->name, tool->name, tool_result);
+
+            // Start ASYNC request for tool result (not sync!), echoing the
+            // assistant's content array
+            HttpAsyncRequest* req = http_async_send_body(vm->api_key,
+                http_conversation_tool_result(agent->conversation, resp->message->content,
+                                              tool->id, tool_result));
 
             // Clean up
-            free(assistant_content);
-            free(tool_id);
-            free(tool_name);
-            free(tool_input);
             free(tool_result);
-            free(tool_defs);
             http_response_free(resp);
 
             if (req) {
@@ -1085,7 +1040,7 @@ VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
     }
 
     // No tool use - extract final text response
-    char* text = anthropic_extract_text(resp->body);
+    char* text = api_message_text(resp->message);
     http_response_free(resp);
 
     // Reset state
@@ -1098,6 +1053,7 @@ VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
         (void)add_message(agent, text);
         VegaString* result = vega_string_from_cstr(text);
         free(text);
+        agent->failed = false;
         return result;
     }
 
@@ -1105,16 +1061,37 @@ VegaString* agent_get_message_result(VegaVM* vm, VegaAgent* agent) {
     return vega_string_from_cstr("Error: No response from API");
 }
 
+char* agent_take_stream_text(VegaAgent* agent) {
+    if (!agent || !agent->stream || !agent->pending_request) return NULL;
+
+    char* text = http_async_take_text(agent->pending_request);
+    if (text) {
+        trace_msg_delta(agent->agent_id, agent->name, text);
+    }
+    return text;
+}
+
 bool agent_has_pending_request(VegaAgent* agent) {
-    return agent && agent->async_state != AGENT_ASYNC_IDLE;
+    if (!agent) return false;
+    if (agent->async_state == AGENT_ASYNC_BACKOFF || agent->async_state == AGENT_ASYNC_ABORTED) {
+        return true;
+    }
+    // Between tool turns (while the tool runs) no request is in flight
+    return agent->async_state != AGENT_ASYNC_IDLE && agent->pending_request;
 }
 
 void agent_cancel_pending(VegaAgent* agent) {
     if (!agent) return;
 
+    timer_cancel(&agent->deadline_timer);
     if (agent->pending_request) {
         http_async_cancel(agent->pending_request);
         agent->pending_request = NULL;
+        withdraw_message(agent);
+    } else if (agent->async_state == AGENT_ASYNC_BACKOFF ||
+               agent->async_state == AGENT_ASYNC_ABORTED) {
+        stop_backoff(agent);
+        withdraw_message(agent);
     }
     agent->async_state = AGENT_ASYNC_IDLE;
     clear_tool_context(&agent->tool_ctx);
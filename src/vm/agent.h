@@ -15,8 +15,9 @@
 // Forward declare VM (defined in vm.h)
 struct VegaVM;
 
-// Forward declare async request (defined in http.h)
+// Forward declare HTTP types (defined in http.h)
 struct HttpAsyncRequest;
+struct HttpConversation;
 
 // ============================================================================
 // Agent State
@@ -27,6 +28,8 @@ typedef enum {
     AGENT_ASYNC_IDLE,           // No pending request
     AGENT_ASYNC_WAITING,        // Waiting for initial/next response
     AGENT_ASYNC_TOOL_PENDING,   // Tool use detected, need to execute and send result
+    AGENT_ASYNC_BACKOFF,        // Waiting out a supervised retry delay (retry_timer)
+    AGENT_ASYNC_ABORTED,        // Ended without a response (abort_reason)
 } AgentAsyncState;
 
 // Tool info stored in agent
@@ -58,6 +61,10 @@ typedef struct VegaAgent {
     char* model;
     char* system_prompt;
     double temperature;
+    bool stream;                // Request streamed (SSE) responses
+    bool prompt_cache;          // Place prompt caching breakpoints
+    uint8_t hedge_percentile;   // Duplicate requests slower than this (0 = off)
+    uint32_t timeout_ms;        // Deadline for each send (0 = none)
 
     // Tools
     AgentTool* tools;
@@ -67,6 +74,7 @@ typedef struct VegaAgent {
     char** messages;            // Alternating user/assistant
     uint32_t message_count;
     uint32_t message_capacity;
+    struct HttpConversation* conversation;  // The same history, serialized
 
     // State
     bool is_valid;              // Set to false when freed
@@ -78,6 +86,11 @@ typedef struct VegaAgent {
     struct HttpAsyncRequest* pending_request;  // NULL when idle
     AgentAsyncState async_state;               // Current state in async loop
     AgentToolContext tool_ctx;                 // Context for tool use loop
+    bool failed;                               // The last result was an error
+    uint64_t notify;                           // Ready queue token of the current send
+    const char* abort_reason;                  // Result text when ABORTED
+    Timer retry_timer;                         // Resends after a backoff delay
+    Timer deadline_timer;                      // Aborts a send past timeout_ms
 } VegaAgent;
 
 // ============================================================================
@@ -111,22 +124,34 @@ void agent_clear_history(VegaAgent* agent);
 // ============================================================================
 
 // Start an async message send (non-blocking)
-// Returns true if request was started, false on error
-bool agent_start_message_async(struct VegaVM* vm, VegaAgent* agent, const char* message);
+// Returns true if request was started, false on error. Its requests post
+// notify to the HTTP ready queue (0 = none; the caller polls).
+bool agent_start_message_async(struct VegaVM* vm, VegaAgent* agent, const char* message,
+                               uint64_t notify);
 
 // Poll for async message completion (non-blocking)
-// Returns: 0 = pending, 1 = complete, -1 = error
+// Returns: 0 = pending (in flight, or waiting to retry), 1 = complete,
+// -1 = error (including a send aborted at its deadline)
 int agent_poll_message(VegaAgent* agent);
 
 // Get the result of a completed async message
-// Returns NULL if not complete or error
+// Returns NULL if not complete or error; agent->failed tells an error
+// message apart from a response
 // Caller must not free the result - it's owned by the agent
 VegaString* agent_get_message_result(struct VegaVM* vm, VegaAgent* agent);
 
-// Check if agent has a pending async request
+// Take response text streamed since the last call (caller frees), tracing
+// it as a delta. Returns NULL if nothing new arrived or the agent does not
+// stream. Call after agent_poll_message so a completed request's tail is
+// collected before agent_get_message_result consumes it.
+char* agent_take_stream_text(VegaAgent* agent);
+
+// Check if agent has a send outstanding: a request in flight, a retry
+// waiting out its backoff, or an aborted send whose error is uncollected
 bool agent_has_pending_request(VegaAgent* agent);
 
-// Cancel any pending async request
+// Cancel any pending async request, withdrawing the message it was
+// sending from the history
 void agent_cancel_pending(VegaAgent* agent);
 
 #endif // VEGA_AGENT_H
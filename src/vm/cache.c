@@ -0,0 +1,376 @@
+#include "cache.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE_FILE_MAGIC "VGCACHE1"
+#define CACHE_HEADER_SIZE 8
+#define CACHE_RECORD_MAGIC 0x52434756u     // "VGCR"
+#define CACHE_DEFAULT_MAX_MB 256
+
+// Record header; the body follows, padded to 8 bytes
+typedef struct {
+    uint32_t magic;
+    uint32_t len;           // Body bytes
+    uint64_t key_lo;
+    uint64_t key_hi;
+    uint64_t created;       // Unix seconds
+    uint64_t check;         // Hash of the body; catches torn appends
+} CacheRecord;
+
+typedef struct {
+    CacheKey key;
+    uint64_t offset;        // Of the body
+    uint32_t len;
+    uint64_t created;
+    bool used;
+} CacheEntry;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_once_t once;
+    bool enabled;
+
+    char* path;
+    int fd;
+    uint64_t ttl;           // Seconds; 0 = entries never expire
+    uint64_t max_bytes;
+    uint64_t size;          // End of the last valid record
+
+    const char* map;        // PROT_READ mapping of the file
+    size_t map_len;
+
+    CacheEntry* entries;    // Open addressing, power-of-two capacity
+    uint32_t count;
+    uint32_t capacity;
+} g_cache = { .lock = PTHREAD_MUTEX_INITIALIZER, .once = PTHREAD_ONCE_INIT, .fd = -1 };
+
+static uint64_t padded(uint64_t len) {
+    return (len + 7) & ~(uint64_t)7;
+}
+
+// ============================================================================
+// Hashing
+// ============================================================================
+
+// Two independent 64-bit lanes: FNV-1a, and a multiply-xorshift mix
+
+void cache_hash_init(CacheHasher* h) {
+    h->a = 0xcbf29ce484222325ull;
+    h->b = 0x9e3779b97f4a7c15ull;
+    h->len = 0;
+}
+
+void cache_hash_update(CacheHasher* h, const void* data, size_t len) {
+    const unsigned char* p = data;
+    uint64_t a = h->a;
+    uint64_t b = h->b;
+    for (size_t i = 0; i < len; i++) {
+        a = (a ^ p[i]) * 0x100000001b3ull;
+        b = (b + p[i]) * 0xff51afd7ed558ccdull;
+        b ^= b >> 29;
+    }
+    h->a = a;
+    h->b = b;
+    h->len += len;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+CacheKey cache_hash_final(const CacheHasher* h) {
+    CacheKey key = { mix64(h->a ^ h->len), mix64(h->b + h->len) };
+    return key;
+}
+
+static uint64_t body_check(const char* body, size_t len) {
+    CacheHasher h;
+    cache_hash_init(&h);
+    cache_hash_update(&h, body, len);
+    return cache_hash_final(&h).lo;
+}
+
+// ============================================================================
+// Index
+// ============================================================================
+
+static CacheEntry* index_slot(CacheEntry* entries, uint32_t capacity, const CacheKey* key) {
+    uint32_t i = (uint32_t)key->lo & (capacity - 1);
+    while (entries[i].used &&
+           (entries[i].key.lo != key->lo || entries[i].key.hi != key->hi)) {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &entries[i];
+}
+
+static bool index_put(const CacheKey* key, uint64_t offset, uint32_t len, uint64_t created) {
+    if ((g_cache.count + 1) * 10 > g_cache.capacity * 7) {
+        uint32_t capacity = g_cache.capacity ? g_cache.capacity * 2 : 256;
+        CacheEntry* entries = calloc(capacity, sizeof(CacheEntry));
+        if (!entries) return false;
+        for (uint32_t i = 0; i < g_cache.capacity; i++) {
+            if (g_cache.entries[i].used) {
+                *index_slot(entries, capacity, &g_cache.entries[i].key) = g_cache.entries[i];
+            }
+        }
+        free(g_cache.entries);
+        g_cache.entries = entries;
+        g_cache.capacity = capacity;
+    }
+
+    CacheEntry* slot = index_slot(g_cache.entries, g_cache.capacity, key);
+    if (!slot->used) g_cache.count++;
+    slot->key = *key;
+    slot->offset = offset;
+    slot->len = len;
+    slot->created = created;
+    slot->used = true;
+    return true;
+}
+
+static bool expired(uint64_t created, uint64_t now) {
+    return g_cache.ttl > 0 && now > created && now - created > g_cache.ttl;
+}
+
+// ============================================================================
+// File
+// ============================================================================
+
+static void cache_unmap(void) {
+    if (g_cache.map) munmap((void*)g_cache.map, g_cache.map_len);
+    g_cache.map = NULL;
+    g_cache.map_len = 0;
+}
+
+// Map the file as it is now (records appended since the last map included)
+static bool cache_remap(void) {
+    struct stat st;
+    if (fstat(g_cache.fd, &st) != 0) return false;
+    cache_unmap();
+    if (st.st_size == 0) return true;
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, g_cache.fd, 0);
+    if (map == MAP_FAILED) return false;
+    g_cache.map = map;
+    g_cache.map_len = (size_t)st.st_size;
+    return true;
+}
+
+// Index every valid record. Returns the end of the last one; anything
+// after it is a torn append.
+static uint64_t cache_scan(uint64_t now) {
+    uint64_t offset = CACHE_HEADER_SIZE;
+    while (offset + sizeof(CacheRecord) <= g_cache.map_len) {
+        CacheRecord rec;
+        memcpy(&rec, g_cache.map + offset, sizeof(rec));
+        uint64_t body = offset + sizeof(CacheRecord);
+        if (rec.magic != CACHE_RECORD_MAGIC || body + rec.len > g_cache.map_len ||
+            body_check(g_cache.map + body, rec.len) != rec.check) {
+            break;
+        }
+        if (!expired(rec.created, now)) {
+            CacheKey key = { rec.key_lo, rec.key_hi };
+            index_put(&key, body, rec.len, rec.created);
+        }
+        offset = body + padded(rec.len);
+    }
+    return offset;
+}
+
+static int by_newest(const void* a, const void* b) {
+    const CacheEntry* x = *(const CacheEntry* const*)a;
+    const CacheEntry* y = *(const CacheEntry* const*)b;
+    return (x->created < y->created) - (x->created > y->created);
+}
+
+// Rewrite the file with the newest live entries, filling at most half the
+// cap so the next run has room to grow. Called with the file locked.
+static void cache_compact(void) {
+    CacheEntry** live = malloc((g_cache.count + 1) * sizeof(CacheEntry*));
+    size_t tmp_len = strlen(g_cache.path) + 5;
+    char* tmp = malloc(tmp_len);
+    if (!live || !tmp) {
+        free(live);
+        free(tmp);
+        return;
+    }
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < g_cache.capacity; i++) {
+        if (g_cache.entries[i].used) live[n++] = &g_cache.entries[i];
+    }
+    qsort(live, n, sizeof(CacheEntry*), by_newest);
+
+    snprintf(tmp, tmp_len, "%s.tmp", g_cache.path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(live);
+        free(tmp);
+        return;
+    }
+
+    bool ok = write(fd, CACHE_FILE_MAGIC, CACHE_HEADER_SIZE) == CACHE_HEADER_SIZE;
+    uint64_t size = CACHE_HEADER_SIZE;
+    static const char zeros[8] = {0};
+    for (uint32_t i = 0; i < n && ok; i++) {
+        CacheEntry* e = live[i];
+        uint64_t record = sizeof(CacheRecord) + padded(e->len);
+        if (size + record > g_cache.max_bytes / 2) break;
+        const char* body = g_cache.map + e->offset;
+        CacheRecord rec = {
+            CACHE_RECORD_MAGIC, e->len, e->key.lo, e->key.hi, e->created,
+            body_check(body, e->len)
+        };
+        ok = write(fd, &rec, sizeof(rec)) == (ssize_t)sizeof(rec) &&
+             write(fd, body, e->len) == (ssize_t)e->len &&
+             write(fd, zeros, padded(e->len) - e->len) == (ssize_t)(padded(e->len) - e->len);
+        size += record;
+    }
+    close(fd);
+
+    // Renaming over the path leaves other readers on the old file
+    if (ok) ok = rename(tmp, g_cache.path) == 0;
+    if (!ok) unlink(tmp);
+    free(live);
+    free(tmp);
+}
+
+static bool cache_open_file(uint64_t now) {
+    g_cache.fd = open(g_cache.path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (g_cache.fd < 0) return false;
+
+    flock(g_cache.fd, LOCK_EX);
+    struct stat st;
+    bool ok = fstat(g_cache.fd, &st) == 0;
+    if (ok && st.st_size == 0) {
+        ok = write(g_cache.fd, CACHE_FILE_MAGIC, CACHE_HEADER_SIZE) == CACHE_HEADER_SIZE;
+    }
+    ok = ok && cache_remap() && g_cache.map_len >= CACHE_HEADER_SIZE &&
+         memcmp(g_cache.map, CACHE_FILE_MAGIC, CACHE_HEADER_SIZE) == 0;
+    if (ok) {
+        g_cache.size = cache_scan(now);
+        if (g_cache.size < g_cache.map_len) {
+            // Drop a torn append so new records follow valid ones
+            ok = ftruncate(g_cache.fd, (off_t)g_cache.size) == 0;
+        }
+    }
+    flock(g_cache.fd, LOCK_UN);
+    return ok;
+}
+
+static void cache_reset(void) {
+    cache_unmap();
+    if (g_cache.fd >= 0) close(g_cache.fd);
+    g_cache.fd = -1;
+    free(g_cache.entries);
+    g_cache.entries = NULL;
+    g_cache.count = 0;
+    g_cache.capacity = 0;
+}
+
+static void cache_init(void) {
+    const char* path = getenv("VEGA_CACHE");
+    if (!path || !*path) return;
+
+    const char* ttl = getenv("VEGA_CACHE_TTL");
+    g_cache.ttl = ttl ? strtoull(ttl, NULL, 10) : 0;
+    const char* max_mb = getenv("VEGA_CACHE_MAX_MB");
+    uint64_t mb = max_mb ? strtoull(max_mb, NULL, 10) : 0;
+    g_cache.max_bytes = (mb ? mb : CACHE_DEFAULT_MAX_MB) * 1024 * 1024;
+    g_cache.path = strdup(path);
+    if (!g_cache.path) return;
+
+    uint64_t now = (uint64_t)time(NULL);
+    if (!cache_open_file(now)) {
+        fprintf(stderr, "Warning: response cache %s unusable; caching disabled\n", path);
+        cache_reset();
+        return;
+    }
+
+    if (g_cache.size > g_cache.max_bytes) {
+        flock(g_cache.fd, LOCK_EX);
+        cache_compact();
+        flock(g_cache.fd, LOCK_UN);
+        cache_reset();
+        if (!cache_open_file(now)) {
+            cache_reset();
+            return;
+        }
+    }
+    g_cache.enabled = true;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+bool cache_enabled(void) {
+    pthread_once(&g_cache.once, cache_init);
+    return g_cache.enabled;
+}
+
+char* cache_lookup(const CacheKey* key, size_t* len) {
+    if (!cache_enabled()) return NULL;
+
+    pthread_mutex_lock(&g_cache.lock);
+    char* body = NULL;
+    CacheEntry* e = g_cache.capacity ? index_slot(g_cache.entries, g_cache.capacity, key) : NULL;
+    if (e && e->used && !expired(e->created, (uint64_t)time(NULL))) {
+        if (e->offset + e->len > g_cache.map_len) cache_remap();
+        if (e->offset + e->len <= g_cache.map_len) {
+            body = malloc(e->len + 1);
+            if (body) {
+                memcpy(body, g_cache.map + e->offset, e->len);
+                body[e->len] = '\0';
+                *len = e->len;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_cache.lock);
+    return body;
+}
+
+void cache_store(const CacheKey* key, const char* body, size_t len) {
+    if (!cache_enabled() || !body || len > UINT32_MAX) return;
+
+    uint64_t record = sizeof(CacheRecord) + padded(len);
+    char* buf = calloc(1, record);
+    if (!buf) return;
+    uint64_t now = (uint64_t)time(NULL);
+    CacheRecord rec = {
+        CACHE_RECORD_MAGIC, (uint32_t)len, key->lo, key->hi, now, body_check(body, len)
+    };
+    memcpy(buf, &rec, sizeof(rec));
+    memcpy(buf + sizeof(rec), body, len);
+
+    pthread_mutex_lock(&g_cache.lock);
+    flock(g_cache.fd, LOCK_EX);
+    struct stat st;
+    if (fstat(g_cache.fd, &st) == 0 && (uint64_t)st.st_size + record <= g_cache.max_bytes &&
+        write(g_cache.fd, buf, record) == (ssize_t)record) {
+        index_put(key, (uint64_t)st.st_size + sizeof(CacheRecord), (uint32_t)len, now);
+    }
+    flock(g_cache.fd, LOCK_UN);
+    pthread_mutex_unlock(&g_cache.lock);
+    free(buf);
+}
+
+void cache_close(void) {
+    pthread_mutex_lock(&g_cache.lock);
+    if (g_cache.enabled) {
+        g_cache.enabled = false;
+        cache_reset();
+        free(g_cache.path);
+        g_cache.path = NULL;
+    }
+    pthread_mutex_unlock(&g_cache.lock);
+}
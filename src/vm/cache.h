@@ -0,0 +1,59 @@
+#ifndef VEGA_CACHE_H
+#define VEGA_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Vega Response Cache
+ *
+ * Optional on-disk cache of Messages API responses, so CI and batch jobs
+ * that re-run the same deterministic (temperature 0) programs don't pay for
+ * identical calls. Entries are content-addressed by a 128-bit hash of the
+ * serialized request body, which covers the model, system prompt, messages,
+ * tools, temperature and max_tokens.
+ *
+ * The cache is one append-only file of self-describing records. It is
+ * mapped and scanned once when the cache opens to rebuild the in-memory
+ * index, and hits are copied straight out of the mapping. Several
+ * processes may share the file: appends hold an exclusive flock and go out
+ * in a single write.
+ *
+ * Configured from the environment on first use:
+ *   VEGA_CACHE=<file>       enable, storing entries in <file>
+ *   VEGA_CACHE_TTL=<secs>   ignore entries older than this (default: never)
+ *   VEGA_CACHE_MAX_MB=<n>   size cap (default 256). Past the cap nothing
+ *                           new is stored; a file opened over the cap is
+ *                           compacted to its newest live entries.
+ */
+
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} CacheKey;
+
+// Incremental key hashing over the pieces of a request body
+typedef struct {
+    uint64_t a;
+    uint64_t b;
+    uint64_t len;
+} CacheHasher;
+
+void cache_hash_init(CacheHasher* h);
+void cache_hash_update(CacheHasher* h, const void* data, size_t len);
+CacheKey cache_hash_final(const CacheHasher* h);
+
+// True if VEGA_CACHE is set and the file could be opened
+bool cache_enabled(void);
+
+// Cached response body for key (caller frees), or NULL on a miss
+char* cache_lookup(const CacheKey* key, size_t* len);
+
+// Record a response body. Best effort: failures just leave it uncached.
+void cache_store(const CacheKey* key, const char* body, size_t len);
+
+// Unmap and close the cache file
+void cache_close(void);
+
+#endif // VEGA_CACHE_H
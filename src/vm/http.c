@@ -1,10 +1,20 @@
 #include "http.h"
+#include "sse.h"
+#include "message.h"
+#include "cache.h"
+#include "ratelimit.h"
 #include "../tui/trace.h"
 #include <curl/curl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/time.h>
+#include <time.h>
+
+static void engine_stop(void);
 
 // Helper to get current time in milliseconds
 static uint64_t http_get_time_ms(void) {
@@ -13,48 +23,11 @@ static uint64_t http_get_time_ms(void) {
     return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
 }
 
-// Parse token usage from API response (populates HttpTokenUsage)
-static HttpTokenUsage parse_token_usage(const char* response) {
-    HttpTokenUsage usage = {0};
-    if (!response) return usage;
-
-    // Look for "usage" object
-    const char* usage_pos = strstr(response, "\"usage\"");
-    if (!usage_pos) return usage;
-
-    // Extract input_tokens
-    const char* input_pos = strstr(usage_pos, "\"input_tokens\":");
-    if (input_pos) {
-        input_pos += 15;
-        while (*input_pos == ' ') input_pos++;
-        usage.input_tokens = (uint32_t)strtoul(input_pos, NULL, 10);
-    }
-
-    // Extract output_tokens
-    const char* output_pos = strstr(usage_pos, "\"output_tokens\":");
-    if (output_pos) {
-        output_pos += 16;
-        while (*output_pos == ' ') output_pos++;
-        usage.output_tokens = (uint32_t)strtoul(output_pos, NULL, 10);
-    }
-
-    // Extract cache_read_input_tokens (if present)
-    const char* cache_read_pos = strstr(usage_pos, "\"cache_read_input_tokens\":");
-    if (cache_read_pos) {
-        cache_read_pos += 26;
-        while (*cache_read_pos == ' ') cache_read_pos++;
-        usage.cache_read_tokens = (uint32_t)strtoul(cache_read_pos, NULL, 10);
-    }
-
-    // Extract cache_creation_input_tokens (if present)
-    const char* cache_write_pos = strstr(usage_pos, "\"cache_creation_input_tokens\":");
-    if (cache_write_pos) {
-        cache_write_pos += 30;
-        while (*cache_write_pos == ' ') cache_write_pos++;
-        usage.cache_write_tokens = (uint32_t)strtoul(cache_write_pos, NULL, 10);
-    }
-
-    return usage;
+// Monotonic microseconds, for stream latency
+static uint64_t http_get_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
 }
 
 // ============================================================================
@@ -81,6 +54,191 @@ static size_t write_callback(void* contents, size_t size, size_t nmemb, void* us
     return realsize;
 }
 
+// ============================================================================
+// Connection Pool
+// ============================================================================
+
+/*
+ * Every Messages API request runs on the engine's multi handle, whose
+ * connection cache keeps connections to the API alive between requests
+ * and, over HTTP/2, multiplexes concurrent requests onto one connection.
+ * A share handle adds DNS and TLS session caching for every handle,
+ * including http_get. Easy handles are recycled rather than re-created.
+ *
+ * Environment:
+ *   ANTHROPIC_BASE_URL   API endpoint (default https://api.anthropic.com)
+ *   VEGA_CA_BUNDLE       CA certificate bundle to verify the endpoint with
+ *   VEGA_HTTP2=0         Disable HTTP/2 (one request per connection)
+ */
+
+#define POOL_IDLE_HANDLES   32      // Easy handles kept for reuse
+#define POOL_MAX_CONNECTS   32      // Connection cache size
+
+static struct {
+    pthread_mutex_t lock;
+    bool initialized;
+    bool http2;
+    bool tls;                   // Endpoint is https
+    const char* ca_bundle;
+    char url[512];
+
+    CURLSH* share;
+    pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+    CURL* idle[POOL_IDLE_HANDLES];
+    int idle_count;
+
+    HttpPoolStats stats;
+} g_pool = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void share_lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr) {
+    (void)handle; (void)access; (void)userptr;
+    pthread_mutex_lock(&g_pool.share_locks[data]);
+}
+
+static void share_unlock(CURL* handle, curl_lock_data data, void* userptr) {
+    (void)handle; (void)userptr;
+    pthread_mutex_unlock(&g_pool.share_locks[data]);
+}
+
+static void pool_init(void) {
+    pthread_mutex_lock(&g_pool.lock);
+    if (g_pool.initialized) {
+        pthread_mutex_unlock(&g_pool.lock);
+        return;
+    }
+
+    const char* base = getenv("ANTHROPIC_BASE_URL");
+    if (!base || !*base) base = "https://api.anthropic.com";
+    size_t base_len = strlen(base);
+    while (base_len > 0 && base[base_len - 1] == '/') base_len--;
+    snprintf(g_pool.url, sizeof(g_pool.url), "%.*s/v1/messages", (int)base_len, base);
+    g_pool.tls = strncmp(base, "https://", 8) == 0;
+
+    const char* http2 = getenv("VEGA_HTTP2");
+    g_pool.http2 = !(http2 && strcmp(http2, "0") == 0);
+    g_pool.ca_bundle = getenv("VEGA_CA_BUNDLE");
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&g_pool.share_locks[i], NULL);
+    }
+    g_pool.share = curl_share_init();
+    if (g_pool.share) {
+        curl_share_setopt(g_pool.share, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(g_pool.share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(g_pool.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(g_pool.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    g_pool.initialized = true;
+    pthread_mutex_unlock(&g_pool.lock);
+}
+
+static const char* anthropic_url(void) {
+    pool_init();
+    return g_pool.url;
+}
+
+// Options every transfer gets, whatever the host: the shared DNS and TLS
+// session caches, and keepalive. Endpoint settings are left to
+// anthropic_easy_setup.
+static void pool_share_configure(CURL* curl) {
+    pool_init();
+    if (g_pool.share) curl_easy_setopt(curl, CURLOPT_SHARE, g_pool.share);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 15L);
+}
+
+static CURL* easy_acquire(void) {
+    pthread_mutex_lock(&g_pool.lock);
+    CURL* curl = g_pool.idle_count > 0 ? g_pool.idle[--g_pool.idle_count] : NULL;
+    pthread_mutex_unlock(&g_pool.lock);
+    return curl ? curl : curl_easy_init();
+}
+
+// The handle must not be attached to a multi handle
+static void easy_release(CURL* curl) {
+    if (!curl) return;
+    curl_easy_reset(curl);
+
+    pthread_mutex_lock(&g_pool.lock);
+    if (g_pool.idle_count < POOL_IDLE_HANDLES) {
+        g_pool.idle[g_pool.idle_count++] = curl;
+        curl = NULL;
+    }
+    pthread_mutex_unlock(&g_pool.lock);
+
+    if (curl) curl_easy_cleanup(curl);
+}
+
+// Account a finished transfer and publish the running totals
+static void pool_record(CURL* curl, CURLcode res) {
+    long connects = 0;
+    long version = 0;
+    curl_off_t connect_us = 0;
+    curl_off_t handshake_us = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect_us);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &handshake_us);
+
+    pthread_mutex_lock(&g_pool.lock);
+    HttpPoolStats* stats = &g_pool.stats;
+    stats->requests++;
+    if (res != CURLE_OK) {
+        stats->failures++;
+    } else if (connects == 0) {
+        stats->reused++;
+    } else {
+        stats->connections += (uint64_t)connects;
+        stats->connect_us += (uint64_t)connect_us;
+        stats->handshake_us += (uint64_t)(handshake_us > connect_us ? handshake_us - connect_us : 0);
+    }
+    if (version == CURL_HTTP_VERSION_2_0) stats->http2++;
+    HttpPoolStats snapshot = *stats;
+    pthread_mutex_unlock(&g_pool.lock);
+
+    if (trace_is_enabled()) {
+        uint64_t completed = snapshot.requests - snapshot.failures;
+        char data[256];
+        snprintf(data, sizeof(data),
+                 "{\"requests\":%llu,\"reused\":%llu,\"reuse_rate\":%.2f,"
+                 "\"connections\":%llu,\"avg_connect_ms\":%.1f,"
+                 "\"avg_handshake_ms\":%.1f,\"http2\":%llu}",
+                 (unsigned long long)snapshot.requests,
+                 (unsigned long long)snapshot.reused,
+                 completed ? (double)snapshot.reused / completed : 0.0,
+                 (unsigned long long)snapshot.connections,
+                 snapshot.connections ? snapshot.connect_us / 1000.0 / snapshot.connections : 0.0,
+                 snapshot.connections ? snapshot.handshake_us / 1000.0 / snapshot.connections : 0.0,
+                 (unsigned long long)snapshot.http2);
+        trace_http_pool(data);
+    }
+}
+
+void http_pool_stats(HttpPoolStats* out) {
+    pthread_mutex_lock(&g_pool.lock);
+    *out = g_pool.stats;
+    pthread_mutex_unlock(&g_pool.lock);
+}
+
+static void pool_cleanup(void) {
+    pthread_mutex_lock(&g_pool.lock);
+    while (g_pool.idle_count > 0) {
+        curl_easy_cleanup(g_pool.idle[--g_pool.idle_count]);
+    }
+    if (g_pool.share && curl_share_cleanup(g_pool.share) == CURLSHE_OK) {
+        g_pool.share = NULL;
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&g_pool.share_locks[i]);
+        }
+        g_pool.initialized = false;
+    }
+    pthread_mutex_unlock(&g_pool.lock);
+}
+
 // ============================================================================
 // Initialization
 // ============================================================================
@@ -91,6 +249,10 @@ bool http_init(void) {
 }
 
 void http_cleanup(void) {
+    engine_stop();
+    pool_cleanup();
+    cache_close();
+    ratelimit_cleanup();
     curl_global_cleanup();
 }
 
@@ -98,15 +260,10 @@ void http_cleanup(void) {
 // JSON Helpers (simple, no external dependency)
 // ============================================================================
 
-static char* json_escape_string(const char* str) {
-    if (!str) return strdup("");
-
-    size_t len = strlen(str);
-    size_t escaped_len = len * 2 + 1;  // Worst case
-    char* escaped = malloc(escaped_len);
-    if (!escaped) return NULL;
-
-    char* p = escaped;
+// Escape len bytes of str into dst, which must have room for 2 * len bytes.
+// Returns the end of the written text (not terminated).
+static char* json_escape_into(char* dst, const char* str, size_t len) {
+    char* p = dst;
     for (size_t i = 0; i < len; i++) {
         char c = str[i];
         switch (c) {
@@ -118,580 +275,839 @@ static char* json_escape_string(const char* str) {
             default:   *p++ = c; break;
         }
     }
-    *p = '\0';
+    return p;
+}
+
+static char* json_escape_string(const char* str) {
+    if (!str) return strdup("");
+
+    size_t len = strlen(str);
+    char* escaped = malloc(len * 2 + 1);  // Worst case
+    if (!escaped) return NULL;
 
+    *json_escape_into(escaped, str, len) = '\0';
     return escaped;
 }
 
 // ============================================================================
-// Anthropic API
+// Request Bodies
 // ============================================================================
 
-HttpResponse* anthropic_send_message(
-    const char* api_key,
-    const char* model,
-    const char* system_prompt,
-    const char* user_message,
-    double temperature
-) {
-    const char* messages[1] = { user_message };
-    return anthropic_send_messages(api_key, model, system_prompt, messages, 1, temperature);
-}
 
-HttpResponse* anthropic_send_messages(
-    const char* api_key,
-    const char* model,
-    const char* system_prompt,
-    const char** messages,
-    int message_count,
-    double temperature
-) {
-    // Emit trace event for HTTP start
-    trace_http_start("https://api.anthropic.com/v1/messages", "POST");
-    uint64_t start_time = http_get_time_ms();
+typedef struct {
+    char* data;
+    size_t len;
+    size_t capacity;
+    bool failed;        // Sticky out-of-memory flag
+} BodyBuilder;
+
+static void body_init(BodyBuilder* b, size_t capacity) {
+    b->data = malloc(capacity);
+    b->len = 0;
+    b->capacity = capacity;
+    b->failed = b->data == NULL;
+    if (b->data) b->data[0] = '\0';
+}
 
-    HttpResponse* resp = calloc(1, sizeof(HttpResponse));
-    if (!resp) return NULL;
+static void body_reserve(BodyBuilder* b, size_t extra) {
+    if (b->failed || b->len + extra < b->capacity) return;
+    size_t capacity = b->capacity * 2 + extra;
+    char* data = realloc(b->data, capacity);
+    if (!data) {
+        b->failed = true;
+        return;
+    }
+    b->data = data;
+    b->capacity = capacity;
+}
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        resp->error = strdup("Failed to initialize CURL");
-        return resp;
+static void body_append(BodyBuilder* b, const char* fmt, ...) {
+    if (b->failed) return;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(b->data + b->len, b->capacity - b->len, fmt, args);
+    va_end(args);
+    if (n < 0) {
+        b->failed = true;
+        return;
+    }
+    if (b->len + (size_t)n >= b->capacity) {
+        body_reserve(b, (size_t)n + 1);
+        if (b->failed) return;
+        va_start(args, fmt);
+        vsnprintf(b->data + b->len, b->capacity - b->len, fmt, args);
+        va_end(args);
     }
+    b->len += (size_t)n;
+}
 
-    // Build JSON body
-    size_t body_capacity = 4096;
-    char* body = malloc(body_capacity);
-    if (!body) {
-        resp->error = strdup("Out of memory");
-        curl_easy_cleanup(curl);
-        return resp;
+// Returns the finished body, or NULL if any allocation failed
+static char* body_finish(BodyBuilder* b) {
+    if (b->failed) {
+        free(b->data);
+        return NULL;
     }
+    return b->data;
+}
 
-    char* escaped_model = json_escape_string(model ? model : "claude-sonnet-4-20250514");
+#define DEFAULT_MODEL "claude-sonnet-4-20250514"
+
+// Prompt caching breakpoint: the prefix up to and including the block
+// carrying it is cached server-side
+#define CACHE_CONTROL "\"cache_control\": {\"type\": \"ephemeral\"}"
+
+static void body_append_header(BodyBuilder* b, const char* model,
+                               const char* system_prompt, double temperature,
+                               bool stream, bool prompt_cache) {
+    char* escaped_model = json_escape_string(model ? model : DEFAULT_MODEL);
     char* escaped_system = json_escape_string(system_prompt ? system_prompt : "You are a helpful assistant.");
 
-    int offset = snprintf(body, body_capacity,
+    body_append(b,
         "{"
         "\"model\": \"%s\","
         "\"max_tokens\": 4096,"
         "\"temperature\": %.2f,"
-        "\"system\": \"%s\","
-        "\"messages\": [",
+        "%s",
         escaped_model,
         temperature,
-        escaped_system
+        stream ? "\"stream\": true," : ""
     );
+    if (prompt_cache) {
+        body_append(b, "\"system\": [{\"type\": \"text\", \"text\": \"%s\", " CACHE_CONTROL "}],",
+            escaped_system);
+    } else {
+        body_append(b, "\"system\": \"%s\",", escaped_system);
+    }
+    body_append(b, "\"messages\": [");
 
     free(escaped_model);
     free(escaped_system);
+}
 
-    // Add messages
+// Messages alternate user/assistant, starting with user
+static void body_append_messages(BodyBuilder* b, const char** messages, int message_count) {
     for (int i = 0; i < message_count; i++) {
         const char* role = (i % 2 == 0) ? "user" : "assistant";
         char* escaped_content = json_escape_string(messages[i]);
-
-        size_t needed = strlen(escaped_content) + 100;
-        if (offset + needed >= body_capacity) {
-            body_capacity = body_capacity * 2 + needed;
-            char* new_body = realloc(body, body_capacity);
-            if (!new_body) {
-                free(escaped_content);
-                free(body);
-                curl_easy_cleanup(curl);
-                resp->error = strdup("Out of memory building request");
-                return resp;
-            }
-            body = new_body;
+        if (!escaped_content) {
+            b->failed = true;
+            return;
         }
 
-        offset += snprintf(body + offset, body_capacity - offset,
-            "%s{\"role\": \"%s\", \"content\": \"%s\"}",
-            i > 0 ? "," : "",
-            role,
-            escaped_content
-        );
-
+        body_append(b, "%s{\"role\": \"%s\", \"content\": \"%s\"}",
+            i > 0 ? "," : "", role, escaped_content);
         free(escaped_content);
     }
+}
 
-    // Close JSON
-    snprintf(body + offset, body_capacity - offset, "]}");
-
-    // Set up CURL
-    ResponseBuffer response_buf = {0};
-
-    struct curl_slist* headers = NULL;
-    char auth_header[256];
-    snprintf(auth_header, sizeof(auth_header), "x-api-key: %s", api_key ? api_key : "");
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "content-type: application/json");
-    headers = curl_slist_append(headers, "anthropic-version: 2023-06-01");
-
-    curl_easy_setopt(curl, CURLOPT_URL, "https://api.anthropic.com/v1/messages");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buf);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
-
-    // Perform request
-    CURLcode res = curl_easy_perform(curl);
-    uint64_t duration = http_get_time_ms() - start_time;
+// With prompt_cache, the last tool carries a breakpoint covering every schema
+static void body_append_tools(BodyBuilder* b, ToolDefinition* tools, int tool_count,
+                              bool prompt_cache) {
+    if (tool_count <= 0 || !tools) return;
+
+    body_append(b, ",\"tools\": [");
+    for (int t = 0; t < tool_count; t++) {
+        char* escaped_name = json_escape_string(tools[t].name);
+        char* escaped_desc = json_escape_string(tools[t].description ? tools[t].description : "");
+
+        body_append(b,
+            "%s{\"name\": \"%s\", \"description\": \"%s\", \"input_schema\": {\"type\": \"object\", \"properties\": {",
+            t > 0 ? "," : "", escaped_name, escaped_desc);
+
+        free(escaped_name);
+        free(escaped_desc);
+
+        // Add parameters
+        for (int p = 0; p < tools[t].param_count; p++) {
+            const char* ptype = "string";  // Default to string
+            if (tools[t].param_types && tools[t].param_types[p]) {
+                if (strcmp(tools[t].param_types[p], "int") == 0) ptype = "integer";
+                else if (strcmp(tools[t].param_types[p], "bool") == 0) ptype = "boolean";
+                else if (strcmp(tools[t].param_types[p], "float") == 0) ptype = "number";
+            }
 
-    if (res != CURLE_OK) {
-        resp->error = strdup(curl_easy_strerror(res));
-        trace_http_done(0, duration, NULL, resp->error);
-    } else {
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &resp->status_code);
-        resp->body = response_buf.data;
-        resp->body_len = response_buf.size;
+            body_append(b, "%s\"%s\": {\"type\": \"%s\"}",
+                p > 0 ? "," : "", tools[t].param_names[p], ptype);
+        }
 
-        // Parse and trace token usage
-        resp->tokens = parse_token_usage(resp->body);
-        trace_http_done(resp->status_code, duration, (TokenUsage*)&resp->tokens,
-                       resp->status_code >= 400 ? resp->body : NULL);
+        // Add required array
+        body_append(b, "}, \"required\": [");
+        for (int p = 0; p < tools[t].param_count; p++) {
+            body_append(b, "%s\"%s\"", p > 0 ? "," : "", tools[t].param_names[p]);
+        }
+        body_append(b, "]}");
+        if (prompt_cache && t == tool_count - 1) body_append(b, ", " CACHE_CONTROL);
+        body_append(b, "}");
     }
-
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    free(body);
-
-    return resp;
+    body_append(b, "]");
 }
 
-void http_response_free(HttpResponse* resp) {
-    if (!resp) return;
-    free(resp->body);
-    free(resp->error);
-    free(resp);
+static char* build_messages_body(
+    const char* model,
+    const char* system_prompt,
+    const char** messages,
+    int message_count,
+    ToolDefinition* tools,
+    int tool_count,
+    double temperature,
+    bool stream
+) {
+    BodyBuilder b;
+    body_init(&b, 8192);
+    body_append_header(&b, model, system_prompt, temperature, stream, false);
+    body_append_messages(&b, messages, message_count);
+    body_append(&b, "]");
+    body_append_tools(&b, tools, tool_count, false);
+    body_append(&b, "}");
+    return body_finish(&b);
 }
 
-// ============================================================================
-// General HTTP GET
-// ============================================================================
-
-HttpResponse* http_get(const char* url) {
-    HttpResponse* resp = calloc(1, sizeof(HttpResponse));
-    if (!resp) return NULL;
+// assistant_content is the raw JSON content array of the tool_use turn
+static char* build_tool_result_body(
+    const char* model,
+    const char* system_prompt,
+    const char** messages,
+    int message_count,
+    const char* assistant_content,
+    const char* tool_use_id,
+    const char* tool_result,
+    ToolDefinition* tools,
+    int tool_count,
+    double temperature,
+    bool stream
+) {
+    BodyBuilder b;
+    body_init(&b, 16384);
+    body_append_header(&b, model, system_prompt, temperature, stream, false);
+    body_append_messages(&b, messages, message_count);
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        resp->error = strdup("Failed to initialize CURL");
-        return resp;
+    if (assistant_content) {
+        body_append(&b, ",{\"role\": \"assistant\", \"content\": %s}", assistant_content);
     }
 
-    ResponseBuffer response_buf = {0};
-
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buf);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-
-    CURLcode res = curl_easy_perform(curl);
-
-    if (res != CURLE_OK) {
-        resp->error = strdup(curl_easy_strerror(res));
-    } else {
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &resp->status_code);
-        resp->body = response_buf.data;
-        resp->body_len = response_buf.size;
-    }
+    char* escaped_result = json_escape_string(tool_result);
+    body_append(&b,
+        ",{\"role\": \"user\", \"content\": [{\"type\": \"tool_result\", \"tool_use_id\": \"%s\", \"content\": \"%s\"}]}]",
+        tool_use_id, escaped_result ? escaped_result : "");
+    free(escaped_result);
 
-    curl_easy_cleanup(curl);
-    return resp;
+    body_append_tools(&b, tools, tool_count, false);
+    body_append(&b, "}");
+    return body_finish(&b);
 }
 
 // ============================================================================
-// JSON Parsing (minimal, just for extracting text)
+// Scatter Bodies
 // ============================================================================
 
-char* anthropic_extract_text(const char* json_response) {
-    if (!json_response) return NULL;
+/*
+ * A request body is a list of segments, each a prefix of a refcounted
+ * chunk. Chunks are append-only: bytes below a chunk's length never change
+ * and the buffer never moves, so a body in flight on the engine thread can
+ * share a conversation's history chunks while the VM thread keeps
+ * appending to them. curl pulls the segments through a read callback, so
+ * nothing is copied into a contiguous buffer.
+ */
 
-    // Look for "text": "..." in the response
-    // This is a simple parser - in production you'd use a JSON library
-
-    const char* text_key = "\"text\":";
-    const char* pos = strstr(json_response, text_key);
-    if (!pos) {
-        // Try looking for error message
-        const char* error_key = "\"message\":";
-        pos = strstr(json_response, error_key);
-        if (pos) {
-            pos += strlen(error_key);
-            while (*pos == ' ' || *pos == '\t') pos++;
-            if (*pos == '"') {
-                pos++;
-                const char* end = pos;
-                while (*end && *end != '"') {
-                    if (*end == '\\' && *(end + 1)) end += 2;
-                    else end++;
-                }
-                size_t len = end - pos;
-                char* result = malloc(len + 20);
-                if (!result) return NULL;
-                snprintf(result, len + 20, "API Error: %.*s", (int)len, pos);
-                return result;
-            }
-        }
-        return strdup("Failed to parse response");
-    }
+#define CHUNK_SIZE (64 * 1024)
 
-    pos += strlen(text_key);
+typedef struct {
+    atomic_uint refs;
+    size_t len;             // Bytes written; owner thread only
+    size_t capacity;
+    char* data;
+} HttpChunk;
 
-    // Skip whitespace
-    while (*pos == ' ' || *pos == '\t' || *pos == '\n') pos++;
+typedef struct {
+    HttpChunk* chunk;
+    size_t len;             // Prefix of the chunk in this body
+} HttpSegment;
 
-    if (*pos != '"') {
-        return strdup("Invalid response format");
+struct HttpBody {
+    HttpSegment* segments;
+    uint32_t count;
+    size_t size;
+    bool stream;
+    bool cacheable;         // Temperature 0: may be served from the cache
+    char* model;            // Rate limits are per model
+    uint32_t flow;          // Admission queue (agent id; 0 = shared)
+    uint8_t hedge_percentile; // Duplicate when this slow (0 = never)
+    uint64_t notify;        // Ready queue token (0 = none)
+
+    // Upload position (engine thread)
+    uint32_t cursor;
+    size_t offset;
+};
+
+static HttpChunk* chunk_new(size_t capacity) {
+    HttpChunk* chunk = malloc(sizeof(HttpChunk));
+    if (!chunk) return NULL;
+    chunk->data = malloc(capacity);
+    if (!chunk->data) {
+        free(chunk);
+        return NULL;
     }
-    pos++;
+    atomic_init(&chunk->refs, 1);
+    chunk->len = 0;
+    chunk->capacity = capacity;
+    return chunk;
+}
 
-    // Find end of string
-    const char* start = pos;
-    while (*pos && *pos != '"') {
-        if (*pos == '\\' && *(pos + 1)) {
-            pos += 2;
-        } else {
-            pos++;
-        }
+// Takes ownership of data (freed on failure)
+static HttpChunk* chunk_wrap(char* data, size_t len) {
+    if (!data) return NULL;
+    HttpChunk* chunk = malloc(sizeof(HttpChunk));
+    if (!chunk) {
+        free(data);
+        return NULL;
     }
+    atomic_init(&chunk->refs, 1);
+    chunk->len = len;
+    chunk->capacity = len;
+    chunk->data = data;
+    return chunk;
+}
 
-    size_t len = pos - start;
-    char* result = malloc(len + 1);
-    if (!result) return NULL;
-
-    // Unescape the string
-    char* dest = result;
-    const char* src = start;
-    while (src < pos) {
-        if (*src == '\\' && src + 1 < pos) {
-            src++;
-            switch (*src) {
-                case 'n': *dest++ = '\n'; break;
-                case 'r': *dest++ = '\r'; break;
-                case 't': *dest++ = '\t'; break;
-                case '"': *dest++ = '"'; break;
-                case '\\': *dest++ = '\\'; break;
-                default: *dest++ = *src; break;
-            }
-            src++;
-        } else {
-            *dest++ = *src++;
-        }
+static void chunk_release(HttpChunk* chunk) {
+    if (!chunk) return;
+    if (atomic_fetch_sub_explicit(&chunk->refs, 1, memory_order_acq_rel) == 1) {
+        free(chunk->data);
+        free(chunk);
     }
-    *dest = '\0';
-
-    return result;
 }
 
-bool anthropic_has_tool_use(const char* json_response) {
-    if (!json_response) return false;
-    return strstr(json_response, "\"type\": \"tool_use\"") != NULL ||
-           strstr(json_response, "\"type\":\"tool_use\"") != NULL;
+static HttpBody* body_new(uint32_t capacity, const char* model, bool stream) {
+    HttpBody* body = calloc(1, sizeof(HttpBody));
+    if (!body) return NULL;
+    body->segments = malloc(capacity * sizeof(HttpSegment));
+    body->model = strdup(model ? model : DEFAULT_MODEL);
+    if (!body->segments || !body->model) {
+        free(body->segments);
+        free(body->model);
+        free(body);
+        return NULL;
+    }
+    body->stream = stream;
+    return body;
 }
 
-char* anthropic_extract_tool_use(const char* json_response, char** tool_id, char** input_json) {
-    if (!json_response) return NULL;
-
-    // Initialize output params
-    if (tool_id) *tool_id = NULL;
-    if (input_json) *input_json = NULL;
+// Append a reference to the first len bytes of chunk (room is reserved
+// by body_new)
+static void body_add(HttpBody* body, HttpChunk* chunk, size_t len) {
+    if (len == 0) return;
+    atomic_fetch_add_explicit(&chunk->refs, 1, memory_order_relaxed);
+    body->segments[body->count].chunk = chunk;
+    body->segments[body->count].len = len;
+    body->count++;
+    body->size += len;
+}
 
-    // Find tool_use block
-    const char* tool_use = strstr(json_response, "\"type\": \"tool_use\"");
-    if (!tool_use) tool_use = strstr(json_response, "\"type\":\"tool_use\"");
-    if (!tool_use) return NULL;
-
-    // Find the containing object by going back to find {
-    const char* obj_start = tool_use;
-    int brace_count = 0;
-    while (obj_start > json_response) {
-        obj_start--;
-        if (*obj_start == '}') brace_count++;
-        if (*obj_start == '{') {
-            if (brace_count == 0) break;
-            brace_count--;
-        }
+// A second body over the same segments, with its own upload position
+static HttpBody* body_share(const HttpBody* body) {
+    HttpBody* copy = body_new(body->count ? body->count : 1, body->model, body->stream);
+    if (!copy) return NULL;
+    for (uint32_t i = 0; i < body->count; i++) {
+        body_add(copy, body->segments[i].chunk, body->segments[i].len);
     }
+    copy->cacheable = body->cacheable;
+    copy->flow = body->flow;
+    copy->hedge_percentile = body->hedge_percentile;
+    copy->notify = body->notify;
+    return copy;
+}
 
-    char* local_tool_id = NULL;
-    char* tool_name = NULL;
-    char* local_input_json = NULL;
-
-    // Extract "id" field
-    const char* id_key = strstr(obj_start, "\"id\":");
-    if (id_key) {
-        id_key += 5;
-        while (*id_key == ' ' || *id_key == '\t') id_key++;
-        if (*id_key == '"') {
-            id_key++;
-            const char* id_end = id_key;
-            while (*id_end && *id_end != '"') id_end++;
-            local_tool_id = strndup(id_key, id_end - id_key);
-            if (!local_tool_id) goto fail;
-        }
+// Wrap a contiguous body (takes ownership of data)
+static HttpBody* body_from_string(char* data, const char* model, bool stream,
+                                  double temperature) {
+    HttpChunk* chunk = chunk_wrap(data, data ? strlen(data) : 0);
+    if (!chunk) return NULL;
+    HttpBody* body = body_new(1, model, stream);
+    if (body) {
+        body_add(body, chunk, chunk->len);
+        body->cacheable = temperature == 0.0;
     }
+    chunk_release(chunk);
+    return body;
+}
 
-    // Extract "name" field
-    const char* name_key = strstr(obj_start, "\"name\":");
-    if (name_key) {
-        name_key += 7;
-        while (*name_key == ' ' || *name_key == '\t') name_key++;
-        if (*name_key == '"') {
-            name_key++;
-            const char* name_end = name_key;
-            while (*name_end && *name_end != '"') name_end++;
-            tool_name = strndup(name_key, name_end - name_key);
-            if (!tool_name) goto fail;
-        }
-    }
+size_t http_body_size(const HttpBody* body) {
+    return body ? body->size : 0;
+}
 
-    // Extract "input" field (as raw JSON)
-    const char* input_key = strstr(obj_start, "\"input\":");
-    if (input_key) {
-        input_key += 8;
-        while (*input_key == ' ' || *input_key == '\t' || *input_key == '\n') input_key++;
-        if (*input_key == '{') {
-            // Find matching }
-            const char* input_end = input_key + 1;
-            int depth = 1;
-            while (*input_end && depth > 0) {
-                if (*input_end == '{') depth++;
-                else if (*input_end == '}') depth--;
-                else if (*input_end == '"') {
-                    // Skip string
-                    input_end++;
-                    while (*input_end && *input_end != '"') {
-                        if (*input_end == '\\' && *(input_end + 1)) input_end++;
-                        input_end++;
-                    }
-                }
-                input_end++;
-            }
-            local_input_json = strndup(input_key, input_end - input_key);
-            if (!local_input_json) goto fail;
-        }
+char* http_body_flatten(const HttpBody* body) {
+    if (!body) return NULL;
+    char* data = malloc(body->size + 1);
+    if (!data) return NULL;
+    char* p = data;
+    for (uint32_t i = 0; i < body->count; i++) {
+        memcpy(p, body->segments[i].chunk->data, body->segments[i].len);
+        p += body->segments[i].len;
     }
+    *p = '\0';
+    return data;
+}
 
-    // Success - transfer ownership to caller
-    if (tool_id) *tool_id = local_tool_id;
-    else free(local_tool_id);
-
-    if (input_json) *input_json = local_input_json;
-    else free(local_input_json);
-
-    return tool_name;
-
-fail:
-    free(local_tool_id);
-    free(tool_name);
-    free(local_input_json);
-    return NULL;
+void http_body_free(HttpBody* body) {
+    if (!body) return;
+    for (uint32_t i = 0; i < body->count; i++) {
+        chunk_release(body->segments[i].chunk);
+    }
+    free(body->segments);
+    free(body->model);
+    free(body);
 }
 
-HttpResponse* anthropic_send_with_tools(
-    const char* api_key,
+HttpBody* http_body_from_messages(
     const char* model,
     const char* system_prompt,
     const char** messages,
     int message_count,
     ToolDefinition* tools,
     int tool_count,
-    double temperature
+    double temperature,
+    bool stream
 ) {
-    trace_http_start("https://api.anthropic.com/v1/messages", "POST");
-    uint64_t start_time = http_get_time_ms();
-
-    HttpResponse* resp = calloc(1, sizeof(HttpResponse));
-    if (!resp) return NULL;
+    return body_from_string(build_messages_body(model, system_prompt, messages,
+                                                message_count, tools, tool_count,
+                                                temperature, stream), model, stream, temperature);
+}
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        resp->error = strdup("Failed to initialize CURL");
-        return resp;
+// curl read callback: copy the next bytes of the body
+static size_t body_read_callback(char* buffer, size_t size, size_t nitems, void* userp) {
+    HttpBody* body = userp;
+    size_t room = size * nitems;
+    size_t written = 0;
+
+    while (room > 0 && body->cursor < body->count) {
+        HttpSegment* seg = &body->segments[body->cursor];
+        size_t n = seg->len - body->offset;
+        if (n > room) n = room;
+        memcpy(buffer + written, seg->chunk->data + body->offset, n);
+        written += n;
+        room -= n;
+        body->offset += n;
+        if (body->offset == seg->len) {
+            body->cursor++;
+            body->offset = 0;
+        }
     }
+    return written;
+}
 
-    // Build JSON body
-    size_t body_capacity = 8192;
-    char* body = malloc(body_capacity);
-    if (!body) {
-        resp->error = strdup("Out of memory");
-        curl_easy_cleanup(curl);
-        return resp;
+// curl seek callback: rewind for a retry on a fresh connection
+static int body_seek_callback(void* userp, curl_off_t offset, int origin) {
+    HttpBody* body = userp;
+    if (origin != SEEK_SET || offset < 0) return CURL_SEEKFUNC_CANTSEEK;
+
+    size_t remaining = (size_t)offset;
+    body->cursor = 0;
+    body->offset = 0;
+    while (body->cursor < body->count && remaining >= body->segments[body->cursor].len) {
+        remaining -= body->segments[body->cursor].len;
+        body->cursor++;
     }
+    if (body->cursor == body->count && remaining > 0) return CURL_SEEKFUNC_FAIL;
+    body->offset = remaining;
+    return CURL_SEEKFUNC_OK;
+}
 
-    char* escaped_model = json_escape_string(model ? model : "claude-sonnet-4-20250514");
-    char* escaped_system = json_escape_string(system_prompt ? system_prompt : "You are a helpful assistant.");
+// ============================================================================
+// Serialized Conversations
+// ============================================================================
 
-    int offset = snprintf(body, body_capacity,
-        "{"
-        "\"model\": \"%s\","
-        "\"max_tokens\": 4096,"
-        "\"temperature\": %.2f,"
-        "\"system\": \"%s\","
-        "\"messages\": [",
-        escaped_model,
-        temperature,
-        escaped_system
-    );
+struct HttpConversation {
+    HttpChunk* header;      // Model, system prompt, ..., "messages": [
+    HttpChunk* close;       // "]", tool schemas, "}"
+    HttpChunk* tools;       // Tool schemas, "}" (after a tool result tail)
+    HttpChunk* mark;        // Breakpoint closing the last message (prompt_cache)
+    char* model;
+    uint32_t flow;
+    uint8_t hedge;
+    uint64_t notify;
+
+    // History, escaped once; the last chunk is the one being filled
+    HttpChunk** chunks;
+    uint32_t chunk_count;
+    uint32_t chunk_capacity;
+    uint32_t message_count;
+    size_t last_start;      // Offset of the last message in the last chunk
+    bool droppable;         // The last message may still be withdrawn
+    bool stream;
+    bool cacheable;
+    bool prompt_cache;      // Messages are single text blocks, see MESSAGE_CLOSE
+};
+
+/*
+ * With prompt caching each message is written as one text block, closed
+ * by MESSAGE_CLOSE. The last message always ends the last history chunk, so
+ * a request body moves the conversation breakpoint forward by cutting that
+ * chunk short of its MESSAGE_CLOSE and sending the mark chunk (the
+ * breakpoint, then MESSAGE_CLOSE) in its place. The history never changes.
+ */
+#define MESSAGE_CLOSE "}]}"
+#define MESSAGE_CLOSE_LEN 3
+
+HttpConversation* http_conversation_new(
+    const char* model,
+    const char* system_prompt,
+    double temperature,
+    ToolDefinition* tools,
+    int tool_count,
+    bool stream,
+    bool prompt_cache
+) {
+    HttpConversation* conv = calloc(1, sizeof(HttpConversation));
+    if (!conv) return NULL;
+    conv->stream = stream;
+    conv->cacheable = temperature == 0.0;
+    conv->prompt_cache = prompt_cache;
+    conv->model = strdup(model ? model : DEFAULT_MODEL);
+
+    BodyBuilder b;
+    body_init(&b, 1024);
+    body_append_header(&b, model, system_prompt, temperature, stream, prompt_cache);
+    char* header = body_finish(&b);
+    conv->header = chunk_wrap(header, header ? strlen(header) : 0);
+
+    if (prompt_cache) {
+        char* mark = strdup(", " CACHE_CONTROL MESSAGE_CLOSE);
+        conv->mark = chunk_wrap(mark, mark ? strlen(mark) : 0);
+        if (!conv->mark) {
+            http_conversation_free(conv);
+            return NULL;
+        }
+    }
 
-    free(escaped_model);
-    free(escaped_system);
+    body_init(&b, 4096);
+    body_append_tools(&b, tools, tool_count, prompt_cache);
+    body_append(&b, "}");
+    char* tail = body_finish(&b);
+    conv->tools = chunk_wrap(tail, tail ? strlen(tail) : 0);
+
+    size_t tail_len = conv->tools ? conv->tools->len : 0;
+    conv->close = chunk_new(tail_len + 1);
+    if (conv->close && conv->tools) {
+        conv->close->data[0] = ']';
+        memcpy(conv->close->data + 1, conv->tools->data, tail_len);
+        conv->close->len = tail_len + 1;
+    }
 
-    // Add messages
-    for (int i = 0; i < message_count; i++) {
-        const char* role = (i % 2 == 0) ? "user" : "assistant";
-        char* escaped_content = json_escape_string(messages[i]);
+    if (!conv->model || !conv->header || !conv->tools || !conv->close) {
+        http_conversation_free(conv);
+        return NULL;
+    }
+    return conv;
+}
 
-        size_t needed = strlen(escaped_content) + 100;
-        if (offset + needed >= body_capacity) {
-            body_capacity = body_capacity * 2 + needed;
-            char* new_body = realloc(body, body_capacity);
-            if (!new_body) {
-                free(escaped_content);
-                free(body);
-                curl_easy_cleanup(curl);
-                resp->error = strdup("Out of memory building request");
-                return resp;
-            }
-            body = new_body;
-        }
+// Room for n more bytes at the end of the history
+static HttpChunk* conversation_reserve(HttpConversation* conv, size_t n) {
+    if (conv->chunk_count > 0) {
+        HttpChunk* last = conv->chunks[conv->chunk_count - 1];
+        if (last->capacity - last->len >= n) return last;
+    }
 
-        offset += snprintf(body + offset, body_capacity - offset,
-            "%s{\"role\": \"%s\", \"content\": \"%s\"}",
-            i > 0 ? "," : "",
-            role,
-            escaped_content
-        );
+    if (conv->chunk_count >= conv->chunk_capacity) {
+        uint32_t capacity = conv->chunk_capacity ? conv->chunk_capacity * 2 : 4;
+        HttpChunk** chunks = realloc(conv->chunks, capacity * sizeof(HttpChunk*));
+        if (!chunks) return NULL;
+        conv->chunks = chunks;
+        conv->chunk_capacity = capacity;
+    }
+    HttpChunk* chunk = chunk_new(n > CHUNK_SIZE ? n : CHUNK_SIZE);
+    if (!chunk) return NULL;
+    conv->chunks[conv->chunk_count++] = chunk;
+    return chunk;
+}
 
-        free(escaped_content);
+bool http_conversation_append(HttpConversation* conv, const char* message) {
+    if (!conv) return false;
+    if (!message) message = "";
+
+    const char* role = (conv->message_count % 2 == 0) ? "user" : "assistant";
+    char prefix[96];
+    int prefix_len = snprintf(prefix, sizeof(prefix),
+                              conv->prompt_cache
+                                  ? "%s{\"role\": \"%s\", \"content\": [{\"type\": \"text\", \"text\": \""
+                                  : "%s{\"role\": \"%s\", \"content\": \"",
+                              conv->message_count > 0 ? "," : "", role);
+    const char* close = conv->prompt_cache ? "\"" MESSAGE_CLOSE : "\"}";
+    size_t close_len = strlen(close);
+    size_t len = strlen(message);
+
+    HttpChunk* chunk = conversation_reserve(conv, (size_t)prefix_len + len * 2 + close_len);
+    if (!chunk) return false;
+
+    conv->last_start = chunk->len;
+    conv->droppable = true;
+    char* p = chunk->data + chunk->len;
+    memcpy(p, prefix, (size_t)prefix_len);
+    p = json_escape_into(p + prefix_len, message, len);
+    memcpy(p, close, close_len);
+    p += close_len;
+    chunk->len = (size_t)(p - chunk->data);
+    conv->message_count++;
+    return true;
+}
+
+void http_conversation_set_flow(HttpConversation* conv, uint32_t flow) {
+    if (conv) conv->flow = flow;
+}
+
+void http_conversation_set_hedge(HttpConversation* conv, uint8_t percentile) {
+    if (conv) conv->hedge = percentile;
+}
+
+void http_conversation_set_notify(HttpConversation* conv, uint64_t token) {
+    if (conv) conv->notify = token;
+}
+
+bool http_conversation_drop_last(HttpConversation* conv) {
+    if (!conv || !conv->droppable) return false;
+
+    // Bodies still in flight may be sending these bytes, so the part kept
+    // is copied to a fresh chunk instead of being cut short in place
+    HttpChunk* chunk = conv->chunks[conv->chunk_count - 1];
+    if (conv->last_start == 0) {
+        conv->chunk_count--;
+    } else {
+        HttpChunk* kept = chunk_new(chunk->capacity);
+        if (!kept) return false;
+        memcpy(kept->data, chunk->data, conv->last_start);
+        kept->len = conv->last_start;
+        conv->chunks[conv->chunk_count - 1] = kept;
     }
+    chunk_release(chunk);
+    conv->message_count--;
+    conv->droppable = false;
+    return true;
+}
 
-    offset += snprintf(body + offset, body_capacity - offset, "]");
+void http_conversation_clear(HttpConversation* conv) {
+    if (!conv) return;
+    // Bodies still in flight keep their own references
+    for (uint32_t i = 0; i < conv->chunk_count; i++) {
+        chunk_release(conv->chunks[i]);
+    }
+    conv->chunk_count = 0;
+    conv->message_count = 0;
+    conv->droppable = false;
+}
 
-    // Add tools if provided
-    if (tool_count > 0 && tools) {
-        offset += snprintf(body + offset, body_capacity - offset, ",\"tools\": [");
+void http_conversation_free(HttpConversation* conv) {
+    if (!conv) return;
+    http_conversation_clear(conv);
+    free(conv->chunks);
+    chunk_release(conv->header);
+    chunk_release(conv->mark);
+    chunk_release(conv->close);
+    chunk_release(conv->tools);
+    free(conv->model);
+    free(conv);
+}
 
-        for (int t = 0; t < tool_count; t++) {
-            if (offset + 1024 >= (int)body_capacity) {
-                body_capacity *= 2;
-                char* new_body = realloc(body, body_capacity);
-                if (!new_body) {
-                    free(body);
-                    curl_easy_cleanup(curl);
-                    resp->error = strdup("Out of memory building request");
-                    return resp;
-                }
-                body = new_body;
-            }
+// Snapshot the history between the header and the given closing chunks.
+// Without a tail (which then carries the breakpoint itself), a prompt
+// caching conversation marks its last message.
+static HttpBody* conversation_body(HttpConversation* conv, HttpChunk* tail, HttpChunk* close) {
+    HttpBody* body = body_new(conv->chunk_count + 4, conv->model, conv->stream);
+    if (!body) return NULL;
+    body->cacheable = conv->cacheable;
+    body->flow = conv->flow;
+    body->hedge_percentile = conv->hedge;
+    body->notify = conv->notify;
+    body_add(body, conv->header, conv->header->len);
+    bool mark = conv->prompt_cache && !tail && conv->message_count > 0;
+    for (uint32_t i = 0; i < conv->chunk_count; i++) {
+        size_t len = conv->chunks[i]->len;
+        if (mark && i == conv->chunk_count - 1) len -= MESSAGE_CLOSE_LEN;
+        body_add(body, conv->chunks[i], len);
+    }
+    if (mark) body_add(body, conv->mark, conv->mark->len);
+    if (tail) body_add(body, tail, tail->len);
+    body_add(body, close, close->len);
+    return body;
+}
 
-            char* escaped_name = json_escape_string(tools[t].name);
-            char* escaped_desc = json_escape_string(tools[t].description ? tools[t].description : "");
-
-            offset += snprintf(body + offset, body_capacity - offset,
-                "%s{\"name\": \"%s\", \"description\": \"%s\", \"input_schema\": {\"type\": \"object\", \"properties\": {",
-                t > 0 ? "," : "",
-                escaped_name,
-                escaped_desc
-            );
-
-            free(escaped_name);
-            free(escaped_desc);
-
-            // Add parameters
-            for (int p = 0; p < tools[t].param_count; p++) {
-                const char* ptype = "string";  // Default to string
-                if (tools[t].param_types && tools[t].param_types[p]) {
-                    if (strcmp(tools[t].param_types[p], "int") == 0) ptype = "integer";
-                    else if (strcmp(tools[t].param_types[p], "bool") == 0) ptype = "boolean";
-                    else if (strcmp(tools[t].param_types[p], "float") == 0) ptype = "number";
-                }
-
-                offset += snprintf(body + offset, body_capacity - offset,
-                    "%s\"%s\": {\"type\": \"%s\"}",
-                    p > 0 ? "," : "",
-                    tools[t].param_names[p],
-                    ptype
-                );
-            }
+HttpBody* http_conversation_request(HttpConversation* conv) {
+    if (!conv) return NULL;
+    return conversation_body(conv, NULL, conv->close);
+}
 
-            // Add required array
-            offset += snprintf(body + offset, body_capacity - offset, "}, \"required\": [");
-            for (int p = 0; p < tools[t].param_count; p++) {
-                offset += snprintf(body + offset, body_capacity - offset,
-                    "%s\"%s\"",
-                    p > 0 ? "," : "",
-                    tools[t].param_names[p]
-                );
-            }
-            offset += snprintf(body + offset, body_capacity - offset, "]}}");
-        }
+HttpBody* http_conversation_tool_result(
+    HttpConversation* conv,
+    const char* assistant_content,
+    const char* tool_use_id,
+    const char* tool_result
+) {
+    if (!conv) return NULL;
 
-        offset += snprintf(body + offset, body_capacity - offset, "]");
+    BodyBuilder b;
+    body_init(&b, 1024);
+    bool first = conv->message_count == 0;
+    if (assistant_content) {
+        body_append(&b, "%s{\"role\": \"assistant\", \"content\": %s}",
+            first ? "" : ",", assistant_content);
+        first = false;
     }
+    char* escaped_result = json_escape_string(tool_result);
+    body_append(&b,
+        "%s{\"role\": \"user\", \"content\": [{\"type\": \"tool_result\", \"tool_use_id\": \"%s\", \"content\": \"%s\"%s}]}]",
+        first ? "" : ",", tool_use_id ? tool_use_id : "", escaped_result ? escaped_result : "",
+        conv->prompt_cache ? ", " CACHE_CONTROL : "");
+    free(escaped_result);
 
-    // Close JSON
-    snprintf(body + offset, body_capacity - offset, "}");
+    char* data = body_finish(&b);
+    HttpChunk* tail = chunk_wrap(data, data ? strlen(data) : 0);
+    if (!tail) return NULL;
+    HttpBody* body = conversation_body(conv, tail, conv->tools);
+    chunk_release(tail);
+    return body;
+}
 
-    // Set up CURL
-    ResponseBuffer response_buf = {0};
+// ============================================================================
+// Anthropic API
+// ============================================================================
 
+// Request headers for a Messages API POST (caller frees)
+static struct curl_slist* anthropic_headers(const char* api_key) {
     struct curl_slist* headers = NULL;
     char auth_header[256];
     snprintf(auth_header, sizeof(auth_header), "x-api-key: %s", api_key ? api_key : "");
     headers = curl_slist_append(headers, auth_header);
     headers = curl_slist_append(headers, "content-type: application/json");
     headers = curl_slist_append(headers, "anthropic-version: 2023-06-01");
+    // The body is streamed from its segments; don't wait for a 100-continue
+    headers = curl_slist_append(headers, "Expect:");
+    return headers;
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://api.anthropic.com/v1/messages");
+// Configure a (pooled) easy handle for a Messages API POST. The body,
+// headers and response buffer must outlive the transfer.
+static void anthropic_easy_setup(CURL* curl, struct curl_slist* headers, HttpBody* body,
+                                 ResponseBuffer* response_buf) {
+    curl_easy_setopt(curl, CURLOPT_URL, anthropic_url());
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)body->size);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, body_read_callback);
+    curl_easy_setopt(curl, CURLOPT_READDATA, body);
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, body_seek_callback);
+    curl_easy_setopt(curl, CURLOPT_SEEKDATA, body);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buf);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response_buf);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
+    pool_share_configure(curl);
+
+    // VEGA_CA_BUNDLE and the HTTP version apply to the API endpoint only
+    if (g_pool.ca_bundle) curl_easy_setopt(curl, CURLOPT_CAINFO, g_pool.ca_bundle);
+    if (g_pool.http2) {
+        // HTTP/2 is only negotiated over TLS; there, wait for a connection
+        // that can multiplex rather than opening another one
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, g_pool.tls ? 1L : 0L);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
+    }
+}
 
-    CURLcode res = curl_easy_perform(curl);
+// Turn a finished transfer into a response. Takes ownership of the
+// response buffer. A nonzero status overrides the HTTP status (a stream
+// that failed after its 200 header was sent).
+static HttpResponse* anthropic_finish(CURL* curl, CURLcode res,
+                                      ResponseBuffer* response_buf,
+                                      uint64_t start_time, int status_override) {
     uint64_t duration = http_get_time_ms() - start_time;
 
+    HttpResponse* resp = calloc(1, sizeof(HttpResponse));
+    if (!resp) {
+        free(response_buf->data);
+        return NULL;
+    }
+
     if (res != CURLE_OK) {
         resp->error = strdup(curl_easy_strerror(res));
         trace_http_done(0, duration, NULL, resp->error);
+        free(response_buf->data);
     } else {
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &resp->status_code);
-        resp->body = response_buf.data;
-        resp->body_len = response_buf.size;
-
-        resp->tokens = parse_token_usage(resp->body);
+        long status = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        resp->status_code = status_override ? status_override : (int)status;
+        resp->body = response_buf->data;
+        resp->body_len = response_buf->size;
+
+        // Decode the body once; consumers read resp->message
+        resp->message = api_message_decode(resp->body, resp->body_len);
+        if (resp->message) resp->tokens = resp->message->usage;
         trace_http_done(resp->status_code, duration, (TokenUsage*)&resp->tokens,
                        resp->status_code >= 400 ? resp->body : NULL);
     }
+    response_buf->data = NULL;
+    response_buf->size = 0;
+    return resp;
+}
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    free(body);
-
+static HttpResponse* response_error(const char* message) {
+    HttpResponse* resp = calloc(1, sizeof(HttpResponse));
+    if (resp) resp->error = strdup(message);
     return resp;
 }
 
-HttpResponse* anthropic_send_tool_result(
+static HttpAsyncRequest* async_submit(const char* api_key, HttpBody* body);
+static HttpResponse* async_wait(HttpAsyncRequest* req);
+
+// Blocking POST. It still runs on the engine thread so that sync and async
+// requests share one connection pool. Takes ownership of body.
+HttpResponse* anthropic_send_body(const char* api_key, HttpBody* body) {
+    if (!body) return response_error("Out of memory building request");
+
+    HttpAsyncRequest* req = async_submit(api_key, body);
+    if (!req) return response_error("Failed to start HTTP request");
+    return async_wait(req);
+}
+
+static HttpResponse* anthropic_post(const char* api_key, char* body, const char* model,
+                                    double temperature) {
+    if (!body) return response_error("Out of memory building request");
+    return anthropic_send_body(api_key, body_from_string(body, model, false, temperature));
+}
+
+HttpResponse* anthropic_send_message(
+    const char* api_key,
+    const char* model,
+    const char* system_prompt,
+    const char* user_message,
+    double temperature
+) {
+    const char* messages[1] = { user_message };
+    return anthropic_send_messages(api_key, model, system_prompt, messages, 1, temperature);
+}
+
+HttpResponse* anthropic_send_messages(
     const char* api_key,
     const char* model,
     const char* system_prompt,
     const char** messages,
     int message_count,
-    const char* tool_use_id,
-    const char* tool_result,
-    ToolDefinition* tools,
-    int tool_count,
     double temperature
 ) {
-    trace_http_start("https://api.anthropic.com/v1/messages", "POST");
-    uint64_t start_time = http_get_time_ms();
+    char* body = build_messages_body(model, system_prompt, messages, message_count,
+                                     NULL, 0, temperature, false);
+    return anthropic_post(api_key, body, model, temperature);
+}
+
+void http_response_free(HttpResponse* resp) {
+    if (!resp) return;
+    free(resp->body);
+    free(resp->error);
+    api_message_free(resp->message);
+    free(resp);
+}
 
+// ============================================================================
+// General HTTP GET
+// ============================================================================
+
+HttpResponse* http_get(const char* url) {
     HttpResponse* resp = calloc(1, sizeof(HttpResponse));
     if (!resp) return NULL;
 
@@ -701,539 +1117,1211 @@ HttpResponse* anthropic_send_tool_result(
         return resp;
     }
 
-    size_t body_capacity = 8192;
-    char* body = malloc(body_capacity);
+    ResponseBuffer response_buf = {0};
 
-    char* escaped_model = json_escape_string(model ? model : "claude-sonnet-4-20250514");
-    char* escaped_system = json_escape_string(system_prompt ? system_prompt : "You are a helpful assistant.");
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buf);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    pool_share_configure(curl);
 
-    int offset = snprintf(body, body_capacity,
-        "{"
-        "\"model\": \"%s\","
-        "\"max_tokens\": 4096,"
-        "\"temperature\": %.2f,"
-        "\"system\": \"%s\","
-        "\"messages\": [",
-        escaped_model,
-        temperature,
-        escaped_system
-    );
+    CURLcode res = curl_easy_perform(curl);
 
-    free(escaped_model);
-    free(escaped_system);
+    if (res != CURLE_OK) {
+        resp->error = strdup(curl_easy_strerror(res));
+    } else {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &resp->status_code);
+        resp->body = response_buf.data;
+        resp->body_len = response_buf.size;
+    }
 
-    // Add previous messages
-    for (int i = 0; i < message_count; i++) {
-        const char* role = (i % 2 == 0) ? "user" : "assistant";
-        char* escaped_content = json_escape_string(messages[i]);
+    curl_easy_cleanup(curl);
+    return resp;
+}
 
-        size_t needed = strlen(escaped_content) + 100;
-        if (offset + needed >= body_capacity) {
-            body_capacity = body_capacity * 2 + needed;
-            char* new_body = realloc(body, body_capacity);
-            if (!new_body) {
-                free(escaped_content);
-                free(body);
-                curl_easy_cleanup(curl);
-                resp->error = strdup("Out of memory building request");
-                return resp;
-            }
-            body = new_body;
+// ============================================================================
+// Response Helpers
+// ============================================================================
+
+// Responses from the senders carry a decoded resp->message; these decode a
+// raw body for callers that only have the JSON.
+
+char* anthropic_extract_text(const char* json_response) {
+    if (!json_response) return NULL;
+
+    ApiMessage* msg = api_message_decode(json_response, strlen(json_response));
+    if (!msg) return NULL;
+
+    char* text = api_message_text(msg);
+    if (!text && msg->error_message) {
+        size_t len = strlen(msg->error_message) + 20;
+        text = malloc(len);
+        if (text) snprintf(text, len, "API Error: %s", msg->error_message);
+    } else if (!text) {
+        text = strdup("Failed to parse response");
+    }
+    api_message_free(msg);
+    return text;
+}
+
+bool anthropic_has_tool_use(const char* json_response) {
+    if (!json_response) return false;
+
+    ApiMessage* msg = api_message_decode(json_response, strlen(json_response));
+    bool found = api_message_tool_use(msg) != NULL;
+    api_message_free(msg);
+    return found;
+}
+
+char* anthropic_extract_tool_use(const char* json_response, char** tool_id, char** input_json) {
+    if (tool_id) *tool_id = NULL;
+    if (input_json) *input_json = NULL;
+    if (!json_response) return NULL;
+
+    ApiMessage* msg = api_message_decode(json_response, strlen(json_response));
+    const ApiBlock* tool = api_message_tool_use(msg);
+    char* name = NULL;
+    if (tool && tool->name) {
+        name = strdup(tool->name);
+        if (name && tool_id && tool->id) *tool_id = strdup(tool->id);
+        if (name && input_json && tool->input) *input_json = strdup(tool->input);
+    }
+    api_message_free(msg);
+    return name;
+}
+
+HttpResponse* anthropic_send_with_tools(
+    const char* api_key,
+    const char* model,
+    const char* system_prompt,
+    const char** messages,
+    int message_count,
+    ToolDefinition* tools,
+    int tool_count,
+    double temperature
+) {
+    char* body = build_messages_body(model, system_prompt, messages, message_count,
+                                     tools, tool_count, temperature, false);
+    return anthropic_post(api_key, body, model, temperature);
+}
+
+HttpResponse* anthropic_send_tool_result(
+    const char* api_key,
+    const char* model,
+    const char* system_prompt,
+    const char** messages,
+    int message_count,
+    const char* tool_use_id,
+    const char* tool_result,
+    ToolDefinition* tools,
+    int tool_count,
+    double temperature
+) {
+    char* body = build_tool_result_body(model, system_prompt, messages, message_count,
+                                        NULL, tool_use_id, tool_result,
+                                        tools, tool_count, temperature, false);
+    return anthropic_post(api_key, body, model, temperature);
+}
+
+HttpResponse* anthropic_send_tool_result_v2(
+    const char* api_key,
+    const char* model,
+    const char* system_prompt,
+    const char** messages,
+    int message_count,
+    const char* assistant_content,
+    const char* tool_use_id,
+    const char* tool_result,
+    ToolDefinition* tools,
+    int tool_count,
+    double temperature
+) {
+    char* body = build_tool_result_body(model, system_prompt, messages, message_count,
+                                        assistant_content, tool_use_id, tool_result,
+                                        tools, tool_count, temperature, false);
+    return anthropic_post(api_key, body, model, temperature);
+}
+
+// ============================================================================
+// Async HTTP Engine
+// ============================================================================
+
+/*
+ * All async requests share one I/O thread driving a curl multi handle.
+ * Submitting a request builds its body on the caller's thread and
+ * queues it; the engine thread adds it to the multi handle, and when the
+ * transfer finishes, appends it to a completion list. The VM thread drains
+ * that list (http_async_poll), so a request's status is only ever written
+ * by the thread that reads it. An atomic completion counter lets polls skip
+ * the lock entirely when nothing has finished. Blocking sends submit the
+ * same way and wait on a condition variable.
+ *
+ * Streamed requests feed their bytes through an SSE decoder on the engine
+ * thread. Decoded text is appended to a per-request buffer under the
+ * engine lock and flagged with an atomic, so the VM thread only takes the
+ * lock when there is text to collect.
+ *
+ * Both completions and streamed text bump an event counter and broadcast
+ * the condition variable, so a VM with nothing to run sleeps in
+ * http_async_wait instead of re-polling.
+ */
+
+typedef enum {
+    STREAM_UNKNOWN,     // No response bytes yet
+    STREAM_SSE,         // text/event-stream: decode events
+    STREAM_PLAIN,       // Anything else (e.g. a JSON error): buffer as-is
+} StreamMode;
+
+typedef enum {
+    REQ_QUEUED,     // On the submit list, not yet seen by the engine
+    REQ_ACTIVE,     // Transfer in progress on the multi handle
+    REQ_DONE,       // Finished, on the completion list
+    REQ_DRAINED,    // Moved off the completion list; owned by the VM thread
+} RequestState;
+
+struct HttpAsyncRequest {
+    struct HttpAsyncRequest* next;  // Submit / cancel / completion list link
+
+    // Guarded by the engine lock
+    RequestState state;
+    bool cancelled;
+
+    // Engine thread only
+    CURL* curl;
+    struct curl_slist* headers;
+    HttpBody* body;
+    ResponseBuffer response_buf;
+    uint64_t start_time;
+    bool in_multi;
+    bool cacheable;                 // Store a successful response under cache_key
+    CacheKey cache_key;
+
+    // Admission and rate limiting (engine thread)
+    struct HttpAsyncRequest* queue_next;
+    struct Flow* flow;              // Queue the request waits in; NULL once started
+    uint64_t queued_us;
+    RateLimitHeaders limits;
+    uint32_t input_estimate;
+    uint64_t throttled_since;       // When first held back; 0 if never
+
+    // Hedging (engine thread)
+    struct HttpAsyncRequest* hedge;      // Duplicate racing this request
+    struct HttpAsyncRequest* hedge_of;   // On a duplicate: the request it races for
+    struct HttpAsyncRequest* hedge_next; // Watch or race list link
+    uint64_t sent_us;                    // When this copy was dispatched
+    uint64_t first_byte_us;              // First response byte; 0 until then
+    bool watched;                        // On the watch list
+    bool lost;                           // The other copy answered first
+
+    // Streaming (engine thread)
+    bool stream;
+    StreamMode stream_mode;
+    SseDecoder sse;
+    uint64_t start_us;
+    uint64_t first_delta_us;
+    uint64_t last_delta_us;
+    uint64_t delta_gap_us;          // Sum of gaps between deltas
+    uint32_t deltas;
+
+    // Streamed text not yet taken by the VM thread (engine lock)
+    char* stream_text;
+    size_t stream_text_len;
+    size_t stream_text_capacity;
+    atomic_bool stream_ready;
+
+    // Result (published with the REQ_DONE transition)
+    HttpResponse* response;
+    HttpAsyncStatus status;         // VM thread only
+};
+
+#define ENGINE_MAX_INFLIGHT 64      // Concurrent API requests (VEGA_MAX_INFLIGHT)
+#define HEDGE_WINDOW        64      // First-byte latencies kept per model
+#define HEDGE_MIN_SAMPLES   16      // Hedge only once a model has this many
+
+typedef struct {
+    HttpAsyncRequest* head;
+    HttpAsyncRequest* tail;
+} RequestList;
+
+// Requests of one flow (an agent, or 0 for everything else) waiting to
+// start, linked through queue_next
+typedef struct Flow {
+    uint32_t id;
+    HttpAsyncRequest* head;
+    HttpAsyncRequest* tail;
+    struct Flow* next;              // Round-robin order of backlogged flows
+} Flow;
+
+// Recent time to first response byte of one model, a ring of microseconds
+typedef struct {
+    char* model;
+    uint32_t samples[HEDGE_WINDOW];
+    uint32_t count;
+    uint32_t next;
+} LatencyWindow;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t done;                // Signalled on every completion
+    pthread_t thread;
+    bool started;
+    bool running;
+    CURLM* multi;
+
+    RequestList submitted;
+    RequestList cancelled;
+    RequestList completed;
+
+    // Admission (engine thread only): at most max_inflight transfers run;
+    // the rest wait in per-flow queues served round-robin, so a chatty
+    // agent can't starve the others
+    Flow* flow_head;
+    Flow* flow_tail;
+    uint32_t flow_count;
+    uint32_t inflight;
+    atomic_uint max_inflight;           // 0 until the engine starts
+    HttpAdmissionStats admission;       // Guarded by the engine lock
+
+    // Hedging (engine thread only): hedgeable requests still waiting for
+    // a first byte, and requests racing a duplicate, linked through
+    // hedge_next
+    HttpAsyncRequest* hedge_watch;
+    HttpAsyncRequest* hedge_race;
+    LatencyWindow* latency;
+    uint32_t latency_count;
+    uint32_t latency_capacity;
+
+    // Ready queue (engine lock): notify tokens of requests that completed
+    // or streamed new text, handed to the VM thread in a batch
+    uint64_t* ready;
+    uint32_t ready_count;
+    uint32_t ready_capacity;
+    bool ready_dropped;                 // A token was lost; poll everything
+
+    atomic_uint_fast64_t completions;   // Bumped on every completion
+    uint64_t drained;                   // Completions seen by the VM thread
+    atomic_uint_fast64_t events;        // Completions and streamed text, bumped
+                                        // under the lock with a broadcast
+} g_engine = { .lock = PTHREAD_MUTEX_INITIALIZER, .done = PTHREAD_COND_INITIALIZER };
+
+static void list_push(RequestList* list, HttpAsyncRequest* req) {
+    req->next = NULL;
+    if (list->tail) {
+        list->tail->next = req;
+    } else {
+        list->head = req;
+    }
+    list->tail = req;
+}
+
+static HttpAsyncRequest* list_take_all(RequestList* list) {
+    HttpAsyncRequest* head = list->head;
+    list->head = list->tail = NULL;
+    return head;
+}
+
+static void list_remove(RequestList* list, HttpAsyncRequest* req) {
+    HttpAsyncRequest* prev = NULL;
+    for (HttpAsyncRequest* r = list->head; r; prev = r, r = r->next) {
+        if (r != req) continue;
+        if (prev) {
+            prev->next = r->next;
+        } else {
+            list->head = r->next;
         }
+        if (list->tail == r) list->tail = prev;
+        return;
+    }
+}
 
-        offset += snprintf(body + offset, body_capacity - offset,
-            "%s{\"role\": \"%s\", \"content\": \"%s\"}",
-            i > 0 ? "," : "",
-            role,
-            escaped_content
-        );
+static void request_free(HttpAsyncRequest* req) {
+    if (req->hedge) request_free(req->hedge);
+    easy_release(req->curl);
+    curl_slist_free_all(req->headers);
+    http_body_free(req->body);
+    free(req->response_buf.data);
+    sse_free(&req->sse);
+    free(req->stream_text);
+    http_response_free(req->response);
+    free(req);
+}
 
-        free(escaped_content);
+// Append a token to the ready queue (engine lock held)
+static void ready_push(uint64_t token) {
+    if (g_engine.ready_count >= g_engine.ready_capacity) {
+        uint32_t capacity = g_engine.ready_capacity ? g_engine.ready_capacity * 2 : 64;
+        uint64_t* ready = realloc(g_engine.ready, capacity * sizeof(uint64_t));
+        if (!ready) {
+            g_engine.ready_dropped = true;
+            return;
+        }
+        g_engine.ready = ready;
+        g_engine.ready_capacity = capacity;
     }
+    g_engine.ready[g_engine.ready_count++] = token;
+}
 
-    // Add tool result message
-    char* escaped_result = json_escape_string(tool_result);
-    size_t needed = strlen(escaped_result) + strlen(tool_use_id) + 200;
-    if (offset + needed >= body_capacity) {
-        body_capacity = body_capacity * 2 + needed;
-        char* new_body = realloc(body, body_capacity);
-        if (!new_body) {
-            free(escaped_result);
-            free(body);
-            curl_easy_cleanup(curl);
-            resp->error = strdup("Out of memory building request");
-            return resp;
+// Post the request's notify token to the ready queue (engine lock held)
+static void ready_post(HttpAsyncRequest* req) {
+    uint64_t token = req->body ? req->body->notify : 0;
+    if (token) ready_push(token);
+}
+
+// Engine thread: a text delta was decoded
+static void stream_on_text(void* userdata, const char* text, size_t len) {
+    HttpAsyncRequest* req = userdata;
+    if (req->lost) return;
+
+    uint64_t now = http_get_time_us();
+    if (req->deltas == 0) {
+        req->first_delta_us = now;
+    } else {
+        req->delta_gap_us += now - req->last_delta_us;
+    }
+    req->last_delta_us = now;
+    req->deltas++;
+
+    // A duplicate that won its race streams into the original
+    if (req->hedge_of) req = req->hedge_of;
+
+    pthread_mutex_lock(&g_engine.lock);
+    size_t needed = req->stream_text_len + len + 1;
+    if (needed > req->stream_text_capacity) {
+        size_t capacity = req->stream_text_capacity ? req->stream_text_capacity * 2 : 256;
+        while (capacity < needed) capacity *= 2;
+        char* grown = realloc(req->stream_text, capacity);
+        if (!grown) {
+            // The text still arrives with the final response
+            pthread_mutex_unlock(&g_engine.lock);
+            return;
         }
-        body = new_body;
+        req->stream_text = grown;
+        req->stream_text_capacity = capacity;
+    }
+    memcpy(req->stream_text + req->stream_text_len, text, len);
+    req->stream_text_len += len;
+    req->stream_text[req->stream_text_len] = '\0';
+    // Posted once per batch of text: the VM takes all of it together
+    if (!atomic_exchange_explicit(&req->stream_ready, true, memory_order_release)) {
+        ready_post(req);
     }
+    atomic_fetch_add_explicit(&g_engine.events, 1, memory_order_release);
+    pthread_cond_broadcast(&g_engine.done);
+    pthread_mutex_unlock(&g_engine.lock);
+}
 
-    offset += snprintf(body + offset, body_capacity - offset,
-        ",{\"role\": \"user\", \"content\": [{\"type\": \"tool_result\", \"tool_use_id\": \"%s\", \"content\": \"%s\"}]}",
-        tool_use_id,
-        escaped_result
-    );
-    free(escaped_result);
+static size_t stream_write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
+    HttpAsyncRequest* req = userp;
+    size_t realsize = size * nmemb;
+
+    if (req->stream_mode == STREAM_UNKNOWN) {
+        char* type = NULL;
+        curl_easy_getinfo(req->curl, CURLINFO_CONTENT_TYPE, &type);
+        req->stream_mode = (type && strstr(type, "text/event-stream")) ? STREAM_SSE : STREAM_PLAIN;
+    }
+    if (req->stream_mode == STREAM_PLAIN) {
+        return write_callback(contents, size, nmemb, &req->response_buf);
+    }
+    return sse_feed(&req->sse, contents, realsize) ? realsize : 0;
+}
+
+// Status to report for an error event inside a 200 stream, so retries
+// treat it like the equivalent non-streamed failure
+static int stream_error_status(const char* type) {
+    if (strcmp(type, "overloaded_error") == 0) return 529;
+    if (strcmp(type, "rate_limit_error") == 0) return 429;
+    if (strcmp(type, "invalid_request_error") == 0) return 400;
+    return 500;
+}
+
+// Engine thread: replace the event stream with the rebuilt message body
+static int stream_finish(HttpAsyncRequest* req, CURLcode* res) {
+    if (req->stream_mode != STREAM_SSE) return 0;
+
+    char* body = sse_finish(&req->sse);
+    free(req->response_buf.data);
+    req->response_buf.data = body;
+    req->response_buf.size = body ? strlen(body) : 0;
+    if (!body && *res == CURLE_OK) {
+        *res = CURLE_OUT_OF_MEMORY;
+    }
+    return req->sse.error ? stream_error_status(req->sse.error_type) : 0;
+}
+
+static void stream_record(HttpAsyncRequest* req, HttpResponse* response) {
+    if (!response || req->stream_mode != STREAM_SSE) return;
+
+    HttpStreamStats* stats = &response->stream;
+    stats->streamed = true;
+    stats->deltas = req->deltas;
+    if (req->deltas > 0) {
+        stats->ttft_ms = (req->first_delta_us - req->start_us) / 1000.0;
+    }
+    if (req->deltas > 1) {
+        stats->itl_ms = req->delta_gap_us / 1000.0 / (req->deltas - 1);
+    }
+    trace_http_stream(stats->ttft_ms, stats->itl_ms, stats->deltas);
+}
+
+static void engine_take_slot(void) {
+    g_engine.inflight++;
+    pthread_mutex_lock(&g_engine.lock);
+    g_engine.admission.inflight = g_engine.inflight;
+    pthread_mutex_unlock(&g_engine.lock);
+}
+
+static void engine_release_slot(void) {
+    g_engine.inflight--;
+    pthread_mutex_lock(&g_engine.lock);
+    g_engine.admission.inflight = g_engine.inflight;
+    pthread_mutex_unlock(&g_engine.lock);
+}
 
-    offset += snprintf(body + offset, body_capacity - offset, "]");
-
-    // Add tools
-    if (tool_count > 0 && tools) {
-        offset += snprintf(body + offset, body_capacity - offset, ",\"tools\": [");
-        for (int t = 0; t < tool_count; t++) {
-            if (offset + 1024 >= (int)body_capacity) {
-                body_capacity *= 2;
-                char* new_body = realloc(body, body_capacity);
-                if (!new_body) {
-                    free(body);
-                    curl_easy_cleanup(curl);
-                    resp->error = strdup("Out of memory building request");
-                    return resp;
-                }
-                body = new_body;
-            }
+// Take a transfer off the multi handle before it finishes
+static void transfer_stop(HttpAsyncRequest* req) {
+    curl_multi_remove_handle(g_engine.multi, req->curl);
+    engine_release_slot();
+    req->in_multi = false;
+}
 
-            char* escaped_name = json_escape_string(tools[t].name);
-            char* escaped_desc = json_escape_string(tools[t].description ? tools[t].description : "");
-
-            offset += snprintf(body + offset, body_capacity - offset,
-                "%s{\"name\": \"%s\", \"description\": \"%s\", \"input_schema\": {\"type\": \"object\", \"properties\": {",
-                t > 0 ? "," : "",
-                escaped_name,
-                escaped_desc
-            );
-
-            free(escaped_name);
-            free(escaped_desc);
-
-            for (int p = 0; p < tools[t].param_count; p++) {
-                const char* ptype = "string";
-                if (tools[t].param_types && tools[t].param_types[p]) {
-                    if (strcmp(tools[t].param_types[p], "int") == 0) ptype = "integer";
-                    else if (strcmp(tools[t].param_types[p], "bool") == 0) ptype = "boolean";
-                    else if (strcmp(tools[t].param_types[p], "float") == 0) ptype = "number";
-                }
-
-                offset += snprintf(body + offset, body_capacity - offset,
-                    "%s\"%s\": {\"type\": \"%s\"}",
-                    p > 0 ? "," : "",
-                    tools[t].param_names[p],
-                    ptype
-                );
-            }
+// ============================================================================
+// Hedging
+// ============================================================================
 
-            offset += snprintf(body + offset, body_capacity - offset, "}, \"required\": [");
-            for (int p = 0; p < tools[t].param_count; p++) {
-                offset += snprintf(body + offset, body_capacity - offset,
-                    "%s\"%s\"",
-                    p > 0 ? "," : "",
-                    tools[t].param_names[p]
-                );
-            }
-            offset += snprintf(body + offset, body_capacity - offset, "]}}");
-        }
-        offset += snprintf(body + offset, body_capacity - offset, "]");
+/*
+ * A request whose body asks for hedging goes on a watch list when it is
+ * dispatched. If it has had no response byte by the chosen percentile of
+ * its model's recent first-byte latency, the engine sends a duplicate over
+ * the same body segments. Whichever copy's headers arrive first wins; the
+ * other is marked lost and taken off the multi handle once the transfer
+ * loop is out of curl's callbacks. A copy that fails before answering
+ * while the other is still running loses the same way, so a hedge also
+ * masks a dropped connection.
+ *
+ * Only the winner produces a response, so only its tokens are counted;
+ * the loser's rate limit charge is refunded. The duplicate belongs to the
+ * original and is freed with it.
+ */
+
+static LatencyWindow* latency_window(const char* model, bool create) {
+    for (uint32_t i = 0; i < g_engine.latency_count; i++) {
+        if (strcmp(g_engine.latency[i].model, model) == 0) return &g_engine.latency[i];
+    }
+    if (!create) return NULL;
+
+    if (g_engine.latency_count >= g_engine.latency_capacity) {
+        uint32_t capacity = g_engine.latency_capacity ? g_engine.latency_capacity * 2 : 4;
+        LatencyWindow* windows = realloc(g_engine.latency, capacity * sizeof(LatencyWindow));
+        if (!windows) return NULL;
+        g_engine.latency = windows;
+        g_engine.latency_capacity = capacity;
     }
+    char* name = strdup(model);
+    if (!name) return NULL;
 
-    snprintf(body + offset, body_capacity - offset, "}");
+    LatencyWindow* w = &g_engine.latency[g_engine.latency_count++];
+    memset(w, 0, sizeof(LatencyWindow));
+    w->model = name;
+    return w;
+}
 
-    // Set up CURL
-    ResponseBuffer response_buf = {0};
+static void latency_record(const char* model, uint64_t latency_us) {
+    LatencyWindow* w = latency_window(model, true);
+    if (!w) return;
+    w->samples[w->next] = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    w->next = (w->next + 1) % HEDGE_WINDOW;
+    if (w->count < HEDGE_WINDOW) w->count++;
+}
 
-    struct curl_slist* headers = NULL;
-    char auth_header[256];
-    snprintf(auth_header, sizeof(auth_header), "x-api-key: %s", api_key ? api_key : "");
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "content-type: application/json");
-    headers = curl_slist_append(headers, "anthropic-version: 2023-06-01");
+// The percentile of a model's recent first-byte latency in microseconds,
+// or 0 while there are too few samples to tell
+static uint64_t latency_percentile(const char* model, uint8_t percentile) {
+    LatencyWindow* w = latency_window(model, false);
+    if (!w || w->count < HEDGE_MIN_SAMPLES) return 0;
+
+    uint32_t sorted[HEDGE_WINDOW];
+    for (uint32_t i = 0; i < w->count; i++) {
+        uint32_t v = w->samples[i];
+        uint32_t j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+    uint32_t rank = (w->count * percentile + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://api.anthropic.com/v1/messages");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buf);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
+static void latency_free(void) {
+    for (uint32_t i = 0; i < g_engine.latency_count; i++) {
+        free(g_engine.latency[i].model);
+    }
+    free(g_engine.latency);
+    g_engine.latency = NULL;
+    g_engine.latency_count = 0;
+    g_engine.latency_capacity = 0;
+}
 
-    CURLcode res = curl_easy_perform(curl);
-    uint64_t duration = http_get_time_ms() - start_time;
+// Unlink req from a hedge_next list it may be on
+static void hedge_list_remove(HttpAsyncRequest** list, HttpAsyncRequest* req) {
+    for (HttpAsyncRequest** link = list; *link; link = &(*link)->hedge_next) {
+        if (*link != req) continue;
+        *link = req->hedge_next;
+        req->hedge_next = NULL;
+        return;
+    }
+}
 
-    if (res != CURLE_OK) {
-        resp->error = strdup(curl_easy_strerror(res));
-        trace_http_done(0, duration, NULL, resp->error);
-    } else {
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &resp->status_code);
-        resp->body = response_buf.data;
-        resp->body_len = response_buf.size;
+// The other copy answered first: req produces no response
+static void hedge_lose(HttpAsyncRequest* req) {
+    req->lost = true;
+    ratelimit_complete(req->body->model, 0, NULL, req->input_estimate, NULL);
+}
 
-        resp->tokens = parse_token_usage(resp->body);
-        trace_http_done(resp->status_code, duration, (TokenUsage*)&resp->tokens,
-                       resp->status_code >= 400 ? resp->body : NULL);
+// Stop and free req's duplicate
+static void hedge_discard(HttpAsyncRequest* req) {
+    HttpAsyncRequest* hedge = req->hedge;
+    if (hedge->in_multi) transfer_stop(hedge);
+    req->hedge = NULL;
+    request_free(hedge);
+}
+
+// req is finishing or cancelled: stop watching it and drop any duplicate
+static void hedge_forget(HttpAsyncRequest* req) {
+    if (req->watched) {
+        hedge_list_remove(&g_engine.hedge_watch, req);
+        req->watched = false;
+    }
+    if (req->hedge) {
+        hedge_list_remove(&g_engine.hedge_race, req);
+        hedge_discard(req);
     }
+}
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    free(body);
+// Engine thread, from curl's header callback: req's first response byte
+static void hedge_first_byte(HttpAsyncRequest* req) {
+    req->first_byte_us = http_get_time_us();
+    if (req->lost) return;
+    latency_record(req->body->model, req->first_byte_us - req->sent_us);
 
-    return resp;
+    HttpAsyncRequest* peer = req->hedge ? req->hedge : req->hedge_of;
+    if (peer && !peer->lost) hedge_lose(peer);
 }
 
-HttpResponse* anthropic_send_tool_result_v2(
-    const char* api_key,
-    const char* model,
-    const char* system_prompt,
-    const char** messages,
-    int message_count,
-    const char* assistant_content,
-    const char* tool_use_id,
-    const char* tool_result,
-    ToolDefinition* tools,
-    int tool_count,
-    double temperature
-) {
-    trace_http_start("https://api.anthropic.com/v1/messages", "POST");
-    uint64_t start_time = http_get_time_ms();
+static bool request_setup(HttpAsyncRequest* req, struct curl_slist* headers);
 
-    HttpResponse* resp = calloc(1, sizeof(HttpResponse));
-    if (!resp) return NULL;
+// Send a duplicate of req, sharing its body segments and headers
+static bool hedge_launch(HttpAsyncRequest* req, uint64_t delay_us) {
+    // Don't hedge into a rate limit
+    if (ratelimit_acquire(req->body->model, req->input_estimate) > 0) return false;
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        resp->error = strdup("Failed to initialize CURL");
-        return resp;
+    HttpAsyncRequest* hedge = calloc(1, sizeof(HttpAsyncRequest));
+    if (hedge) hedge->body = body_share(req->body);
+    if (!hedge || !hedge->body) {
+        free(hedge);
+        ratelimit_complete(req->body->model, 0, NULL, req->input_estimate, NULL);
+        return false;
     }
+    hedge->hedge_of = req;
+    hedge->state = REQ_ACTIVE;
+    hedge->cacheable = req->cacheable;
+    hedge->cache_key = req->cache_key;
+    // Latency is reported from the original's start
+    hedge->start_time = req->start_time;
+    hedge->start_us = req->start_us;
+
+    if (!request_setup(hedge, req->headers) ||
+        curl_multi_add_handle(g_engine.multi, hedge->curl) != CURLM_OK) {
+        ratelimit_complete(req->body->model, 0, NULL, req->input_estimate, NULL);
+        request_free(hedge);
+        return false;
+    }
+    hedge->in_multi = true;
+    hedge->sent_us = http_get_time_us();
+    engine_take_slot();
+    req->hedge = hedge;
 
-    size_t body_capacity = 16384;
-    char* body = malloc(body_capacity);
-
-    char* escaped_model = json_escape_string(model ? model : "claude-sonnet-4-20250514");
-    char* escaped_system = json_escape_string(system_prompt ? system_prompt : "You are a helpful assistant.");
-
-    int offset = snprintf(body, body_capacity,
-        "{\"model\": \"%s\",\"max_tokens\": 4096,\"temperature\": %.2f,\"system\": \"%s\",\"messages\": [",
-        escaped_model, temperature, escaped_system
-    );
+    trace_http_hedge(req->body->model, delay_us / 1000);
+    return true;
+}
 
-    free(escaped_model);
-    free(escaped_system);
+// Duplicate watched requests that have gone longer without a response
+// byte than their percentile of recent first-byte latency. Returns how
+// long the engine may sleep: timeout_ms, or less if one is due sooner.
+static long engine_hedge(long timeout_ms) {
+    uint32_t max_inflight = atomic_load_explicit(&g_engine.max_inflight, memory_order_relaxed);
+    uint64_t now = http_get_time_us();
+
+    HttpAsyncRequest** link = &g_engine.hedge_watch;
+    while (*link) {
+        HttpAsyncRequest* req = *link;
+        if (req->first_byte_us) {
+            *link = req->hedge_next;
+            req->hedge_next = NULL;
+            req->watched = false;
+            continue;
+        }
 
-    for (int i = 0; i < message_count; i++) {
-        const char* role = (i % 2 == 0) ? "user" : "assistant";
-        char* escaped_content = json_escape_string(messages[i]);
-        size_t needed = strlen(escaped_content) + 100;
-        if (offset + needed >= body_capacity) {
-            body_capacity = body_capacity * 2 + needed;
-            char* new_body = realloc(body, body_capacity);
-            if (!new_body) {
-                free(escaped_content);
-                free(body);
-                curl_easy_cleanup(curl);
-                resp->error = strdup("Out of memory building request");
-                return resp;
-            }
-            body = new_body;
+        uint64_t delay = latency_percentile(req->body->model, req->body->hedge_percentile);
+        uint64_t elapsed = now - req->sent_us;
+        if (delay == 0 || g_engine.inflight >= max_inflight) {
+            // Not enough history yet, or no free slot (a completion wakes us)
+            link = &req->hedge_next;
+            continue;
+        }
+        if (elapsed < delay) {
+            long due_ms = (long)((delay - elapsed + 999) / 1000);
+            if (due_ms < timeout_ms) timeout_ms = due_ms;
+            link = &req->hedge_next;
+            continue;
         }
-        offset += snprintf(body + offset, body_capacity - offset,
-            "%s{\"role\": \"%s\", \"content\": \"%s\"}",
-            i > 0 ? "," : "", role, escaped_content);
-        free(escaped_content);
-    }
 
-    if (assistant_content) {
-        size_t needed = strlen(assistant_content) + 100;
-        if (offset + needed >= body_capacity) {
-            body_capacity = body_capacity * 2 + needed;
-            char* new_body = realloc(body, body_capacity);
-            if (!new_body) {
-                free(body);
-                curl_easy_cleanup(curl);
-                resp->error = strdup("Out of memory building request");
-                return resp;
-            }
-            body = new_body;
+        *link = req->hedge_next;
+        req->hedge_next = NULL;
+        req->watched = false;
+        if (hedge_launch(req, delay)) {
+            req->hedge_next = g_engine.hedge_race;
+            g_engine.hedge_race = req;
         }
-        offset += snprintf(body + offset, body_capacity - offset,
-            ",{\"role\": \"assistant\", \"content\": %s}", assistant_content);
     }
+    return timeout_ms;
+}
 
-    char* escaped_result = json_escape_string(tool_result);
-    size_t needed = strlen(escaped_result) + strlen(tool_use_id) + 200;
-    if (offset + needed >= body_capacity) {
-        body_capacity = body_capacity * 2 + needed;
-        char* new_body = realloc(body, body_capacity);
-        if (!new_body) {
-            free(escaped_result);
-            free(body);
-            curl_easy_cleanup(curl);
-            resp->error = strdup("Out of memory building request");
-            return resp;
+// Take the losers of decided races off the multi handle
+static void hedge_settle(void) {
+    HttpAsyncRequest** link = &g_engine.hedge_race;
+    while (*link) {
+        HttpAsyncRequest* req = *link;
+        if (req->lost && req->in_multi) transfer_stop(req);
+        if (req->hedge && req->hedge->lost) hedge_discard(req);
+        if (!req->hedge) {
+            *link = req->hedge_next;
+            req->hedge_next = NULL;
+            continue;
         }
-        body = new_body;
+        link = &req->hedge_next;
     }
-    offset += snprintf(body + offset, body_capacity - offset,
-        ",{\"role\": \"user\", \"content\": [{\"type\": \"tool_result\", \"tool_use_id\": \"%s\", \"content\": \"%s\"}]}]",
-        tool_use_id, escaped_result);
-    free(escaped_result);
+}
 
-    if (tool_count > 0 && tools) {
-        offset += snprintf(body + offset, body_capacity - offset, ",\"tools\": [");
-        for (int t = 0; t < tool_count; t++) {
-            if (offset + 1024 >= (int)body_capacity) {
-                body_capacity *= 2;
-                char* new_body = realloc(body, body_capacity);
-                if (!new_body) {
-                    free(body);
-                    curl_easy_cleanup(curl);
-                    resp->error = strdup("Out of memory building request");
-                    return resp;
-                }
-                body = new_body;
-            }
-            char* escaped_name = json_escape_string(tools[t].name);
-            char* escaped_desc = json_escape_string(tools[t].description ? tools[t].description : "");
-            offset += snprintf(body + offset, body_capacity - offset,
-                "%s{\"name\": \"%s\", \"description\": \"%s\", \"input_schema\": {\"type\": \"object\", \"properties\": {",
-                t > 0 ? "," : "", escaped_name, escaped_desc);
-            free(escaped_name);
-            free(escaped_desc);
-
-            for (int p = 0; p < tools[t].param_count; p++) {
-                const char* ptype = "string";
-                if (tools[t].param_types && tools[t].param_types[p]) {
-                    if (strcmp(tools[t].param_types[p], "int") == 0) ptype = "integer";
-                    else if (strcmp(tools[t].param_types[p], "bool") == 0) ptype = "boolean";
-                    else if (strcmp(tools[t].param_types[p], "float") == 0) ptype = "number";
-                }
-                offset += snprintf(body + offset, body_capacity - offset,
-                    "%s\"%s\": {\"type\": \"%s\"}", p > 0 ? "," : "", tools[t].param_names[p], ptype);
-            }
+static size_t header_callback(char* buffer, size_t size, size_t nitems, void* userp) {
+    HttpAsyncRequest* req = userp;
+    if (!req->first_byte_us) hedge_first_byte(req);
+    ratelimit_header_line(&req->limits, buffer, size * nitems);
+    return size * nitems;
+}
 
-            offset += snprintf(body + offset, body_capacity - offset, "}, \"required\": [");
-            for (int p = 0; p < tools[t].param_count; p++) {
-                offset += snprintf(body + offset, body_capacity - offset,
-                    "%s\"%s\"", p > 0 ? "," : "", tools[t].param_names[p]);
-            }
-            offset += snprintf(body + offset, body_capacity - offset, "]}}");
-        }
-        offset += snprintf(body + offset, body_capacity - offset, "]");
+// Give req a configured easy handle for its body. headers must outlive it.
+static bool request_setup(HttpAsyncRequest* req, struct curl_slist* headers) {
+    req->curl = easy_acquire();
+    if (!req->curl) return false;
+
+    HttpBody* body = req->body;
+    anthropic_easy_setup(req->curl, headers, body, &req->response_buf);
+    curl_easy_setopt(req->curl, CURLOPT_PRIVATE, req);
+    curl_easy_setopt(req->curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(req->curl, CURLOPT_HEADERDATA, req);
+    ratelimit_headers_init(&req->limits);
+    req->input_estimate = ratelimit_estimate_input(body->size);
+    if (body->stream) {
+        req->stream = true;
+        sse_init(&req->sse, stream_on_text, req);
+        curl_easy_setopt(req->curl, CURLOPT_WRITEFUNCTION, stream_write_callback);
+        curl_easy_setopt(req->curl, CURLOPT_WRITEDATA, req);
+        // A stream may legitimately outlast the overall timeout; give up
+        // only when it stalls (the server pings while generating)
+        curl_easy_setopt(req->curl, CURLOPT_TIMEOUT, 0L);
+        curl_easy_setopt(req->curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(req->curl, CURLOPT_LOW_SPEED_TIME, 60L);
     }
+    return true;
+}
 
-    snprintf(body + offset, body_capacity - offset, "}");
-
-    ResponseBuffer response_buf = {0};
-    struct curl_slist* headers = NULL;
-    char auth_header[256];
-    snprintf(auth_header, sizeof(auth_header), "x-api-key: %s", api_key ? api_key : "");
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "content-type: application/json");
-    headers = curl_slist_append(headers, "anthropic-version: 2023-06-01");
+// Engine thread: a transfer finished (or failed)
+static void engine_complete(HttpAsyncRequest* req, CURLcode res) {
+    curl_multi_remove_handle(g_engine.multi, req->curl);
+    if (req->in_multi) engine_release_slot();
+    req->in_multi = false;
+    pool_record(req->curl, res);
+
+    // A hedged pair answers once
+    HttpAsyncRequest* peer = req->hedge ? req->hedge : req->hedge_of;
+    if (peer && !req->lost && !req->first_byte_us && peer->in_multi) hedge_lose(req);
+    if (req->lost) return;  // Freed or kept by hedge_settle
+
+    HttpAsyncRequest* owner = req->hedge_of ? req->hedge_of : req;
+    int status_override = stream_finish(req, &res);
+    HttpResponse* response = anthropic_finish(req->curl, res, &req->response_buf,
+                                              owner->start_time, status_override);
+    stream_record(req, response);
+    ratelimit_complete(req->body->model, response ? response->status_code : 0, &req->limits,
+                       req->input_estimate,
+                       response && response->message ? &response->tokens : NULL);
+    if (req->cacheable && response && response->status_code == 200 &&
+        response->message && response->message->ok && !response->message->is_error) {
+        cache_store(&req->cache_key, response->body, response->body_len);
+    }
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://api.anthropic.com/v1/messages");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buf);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
+    if (req != owner) {
+        // The duplicate won; it answers for the original
+        if (response) response->hedged = true;
+        hedge_list_remove(&g_engine.hedge_race, owner);
+        if (owner->in_multi) transfer_stop(owner);
+        owner->hedge = NULL;
+        request_free(req);
+        req = owner;
+    } else {
+        hedge_forget(req);
+    }
 
-    CURLcode res = curl_easy_perform(curl);
-    uint64_t duration = http_get_time_ms() - start_time;
+    pthread_mutex_lock(&g_engine.lock);
+    if (req->cancelled) {
+        // Already on the cancel list; freed there
+        pthread_mutex_unlock(&g_engine.lock);
+        http_response_free(response);
+        return;
+    }
+    req->response = response;
+    req->state = REQ_DONE;
+    list_push(&g_engine.completed, req);
+    ready_post(req);
+    atomic_fetch_add_explicit(&g_engine.completions, 1, memory_order_release);
+    atomic_fetch_add_explicit(&g_engine.events, 1, memory_order_release);
+    pthread_cond_broadcast(&g_engine.done);
+    pthread_mutex_unlock(&g_engine.lock);
+}
 
-    if (res != CURLE_OK) {
-        resp->error = strdup(curl_easy_strerror(res));
-        trace_http_done(0, duration, NULL, resp->error);
+static void flow_push(Flow* flow) {
+    flow->next = NULL;
+    if (g_engine.flow_tail) {
+        g_engine.flow_tail->next = flow;
     } else {
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &resp->status_code);
-        resp->body = response_buf.data;
-        resp->body_len = response_buf.size;
-
-        resp->tokens = parse_token_usage(resp->body);
-        trace_http_done(resp->status_code, duration, (TokenUsage*)&resp->tokens,
-                       resp->status_code >= 400 ? resp->body : NULL);
+        g_engine.flow_head = flow;
     }
+    g_engine.flow_tail = flow;
+    g_engine.flow_count++;
+}
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    free(body);
+static Flow* flow_pop(void) {
+    Flow* flow = g_engine.flow_head;
+    g_engine.flow_head = flow->next;
+    if (!g_engine.flow_head) g_engine.flow_tail = NULL;
+    g_engine.flow_count--;
+    return flow;
+}
 
-    return resp;
+static void flow_unlink(Flow* flow) {
+    Flow* prev = NULL;
+    for (Flow* f = g_engine.flow_head; f; prev = f, f = f->next) {
+        if (f != flow) continue;
+        if (prev) {
+            prev->next = f->next;
+        } else {
+            g_engine.flow_head = f->next;
+        }
+        if (g_engine.flow_tail == f) g_engine.flow_tail = prev;
+        g_engine.flow_count--;
+        return;
+    }
 }
 
-// ============================================================================
-// Async HTTP Implementation
-// ============================================================================
+// Queue a submitted request behind the others of its flow. A flow exists
+// only while it has requests waiting.
+static bool admission_enqueue(HttpAsyncRequest* req) {
+    Flow* flow = g_engine.flow_head;
+    while (flow && flow->id != req->body->flow) flow = flow->next;
+    if (!flow) {
+        flow = calloc(1, sizeof(Flow));
+        if (!flow) return false;
+        flow->id = req->body->flow;
+        flow_push(flow);
+    }
+
+    req->queue_next = NULL;
+    if (flow->tail) {
+        flow->tail->queue_next = req;
+    } else {
+        flow->head = req;
+    }
+    flow->tail = req;
+    req->flow = flow;
 
-static char* strdup_safe(const char* s) {
-    return s ? strdup(s) : NULL;
+    pthread_mutex_lock(&g_engine.lock);
+    g_engine.admission.queued++;
+    pthread_mutex_unlock(&g_engine.lock);
+    return true;
 }
 
-static char** copy_messages(const char** messages, int count) {
-    if (!messages || count <= 0) return NULL;
-    char** copy = malloc(count * sizeof(char*));
-    if (!copy) return NULL;
-    for (int i = 0; i < count; i++) {
-        if (messages[i]) {
-            copy[i] = strdup(messages[i]);
-            if (!copy[i]) {
-                // Allocation failed - clean up and return NULL
-                for (int j = 0; j < i; j++) {
-                    free(copy[j]);
-                }
-                free(copy);
-                return NULL;
-            }
+// Take a queued request out of its flow (started or cancelled)
+static void admission_remove(HttpAsyncRequest* req) {
+    Flow* flow = req->flow;
+    if (!flow) return;
+    req->flow = NULL;
+
+    HttpAsyncRequest* prev = NULL;
+    for (HttpAsyncRequest* r = flow->head; r; prev = r, r = r->queue_next) {
+        if (r != req) continue;
+        if (prev) {
+            prev->queue_next = r->queue_next;
         } else {
-            copy[i] = NULL;
+            flow->head = r->queue_next;
         }
+        if (flow->tail == r) flow->tail = prev;
+        break;
     }
-    return copy;
+    if (!flow->head) {
+        flow_unlink(flow);
+        free(flow);
+    }
+
+    pthread_mutex_lock(&g_engine.lock);
+    g_engine.admission.queued--;
+    pthread_mutex_unlock(&g_engine.lock);
 }
 
-static void free_messages_copy(char** messages, int count) {
-    if (!messages) return;
-    for (int i = 0; i < count; i++) {
-        free(messages[i]);
+static void admission_start(HttpAsyncRequest* req) {
+    uint64_t now_us = http_get_time_us();
+    uint64_t wait_us = now_us - req->queued_us;
+    if (req->throttled_since) {
+        trace_http_throttle(req->body->model, http_get_time_ms() - req->throttled_since);
+    }
+    if (req->throttled_since || wait_us >= 1000) {
+        // Latency is measured from dispatch
+        req->start_time = http_get_time_ms();
+        req->start_us = now_us;
     }
-    free(messages);
-}
 
-// Forward declaration for cleanup on failure
-static void free_tools_copy(ToolDefinition* tools, int count);
+    pthread_mutex_lock(&g_engine.lock);
+    HttpAdmissionStats* stats = &g_engine.admission;
+    stats->admitted++;
+    stats->wait_us += wait_us;
+    if (wait_us > stats->max_wait_us) stats->max_wait_us = wait_us;
+    HttpAdmissionStats snapshot = *stats;
+    pthread_mutex_unlock(&g_engine.lock);
 
-static ToolDefinition* copy_tools(ToolDefinition* tools, int count) {
-    if (!tools || count <= 0) return NULL;
+    if (wait_us >= 1000) {
+        trace_http_queue(wait_us / 1000, snapshot.queued, g_engine.inflight + 1);
+    }
 
-    ToolDefinition* copy = calloc(count, sizeof(ToolDefinition));
-    if (!copy) return NULL;
+    if (curl_multi_add_handle(g_engine.multi, req->curl) == CURLM_OK) {
+        req->in_multi = true;
+        req->sent_us = now_us;
+        engine_take_slot();
+        if (req->body->hedge_percentile) {
+            req->watched = true;
+            req->hedge_next = g_engine.hedge_watch;
+            g_engine.hedge_watch = req;
+        }
+    } else {
+        engine_complete(req, CURLE_FAILED_INIT);
+    }
+}
 
-    for (int i = 0; i < count; i++) {
-        // Copy name (required)
-        if (tools[i].name) {
-            copy[i].name = strdup(tools[i].name);
-            if (!copy[i].name) goto fail;
+// Start queued requests while there is room in the in-flight window,
+// taking one from each backlogged flow in turn. A flow whose model is
+// over its rate limit is skipped. Returns how long the engine may sleep:
+// timeout_ms, or less if a held request becomes eligible sooner.
+static long engine_dispatch(long timeout_ms) {
+    uint32_t max_inflight = atomic_load_explicit(&g_engine.max_inflight, memory_order_relaxed);
+    uint32_t skipped = 0;   // Flows passed over since the last start
+
+    while (g_engine.flow_head && g_engine.inflight < max_inflight &&
+           skipped < g_engine.flow_count) {
+        Flow* flow = flow_pop();
+        HttpAsyncRequest* req = flow->head;
+        flow_push(flow);
+
+        uint64_t wait = ratelimit_acquire(req->body->model, req->input_estimate);
+        if (wait > 0) {
+            if (!req->throttled_since) req->throttled_since = http_get_time_ms();
+            if ((long)wait < timeout_ms) timeout_ms = (long)wait;
+            skipped++;
+            continue;
         }
+        skipped = 0;
+        admission_remove(req);
+        admission_start(req);
+    }
+    return timeout_ms;
+}
+
+static void* engine_thread(void* arg) {
+    (void)arg;
 
-        // Copy description (optional)
-        if (tools[i].description) {
-            copy[i].description = strdup(tools[i].description);
-            if (!copy[i].description) goto fail;
+    for (;;) {
+        pthread_mutex_lock(&g_engine.lock);
+        bool running = g_engine.running;
+        HttpAsyncRequest* submitted = list_take_all(&g_engine.submitted);
+        HttpAsyncRequest* cancelled = list_take_all(&g_engine.cancelled);
+        for (HttpAsyncRequest* r = submitted; r; r = r->next) {
+            r->state = REQ_ACTIVE;
+        }
+        pthread_mutex_unlock(&g_engine.lock);
+
+        if (!running) break;
+
+        // Cancelled requests are off every list and owned by this thread
+        while (cancelled) {
+            HttpAsyncRequest* next = cancelled->next;
+            hedge_forget(cancelled);
+            if (cancelled->in_multi) {
+                curl_multi_remove_handle(g_engine.multi, cancelled->curl);
+                engine_release_slot();
+            } else {
+                admission_remove(cancelled);
+            }
+            request_free(cancelled);
+            cancelled = next;
         }
 
-        copy[i].param_count = tools[i].param_count;
-
-        if (tools[i].param_count > 0) {
-            copy[i].param_names = calloc(tools[i].param_count, sizeof(char*));
-            copy[i].param_types = calloc(tools[i].param_count, sizeof(char*));
-            if (!copy[i].param_names || !copy[i].param_types) goto fail;
-
-            for (int j = 0; j < tools[i].param_count; j++) {
-                if (tools[i].param_names[j]) {
-                    copy[i].param_names[j] = strdup(tools[i].param_names[j]);
-                    if (!copy[i].param_names[j]) goto fail;
-                }
-                if (tools[i].param_types[j]) {
-                    copy[i].param_types[j] = strdup(tools[i].param_types[j]);
-                    if (!copy[i].param_types[j]) goto fail;
-                }
+        while (submitted) {
+            HttpAsyncRequest* next = submitted->next;
+            submitted->next = NULL;
+            if (!admission_enqueue(submitted)) {
+                engine_complete(submitted, CURLE_OUT_OF_MEMORY);
             }
+            submitted = next;
         }
+        engine_dispatch(0);
+
+        int still_running = 0;
+        curl_multi_perform(g_engine.multi, &still_running);
+
+        CURLMsg* msg;
+        int msgs_left;
+        while ((msg = curl_multi_info_read(g_engine.multi, &msgs_left))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            HttpAsyncRequest* req = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&req);
+            if (req) engine_complete(req, msg->data.result);
+        }
+        hedge_settle();
+
+        // Completions freed slots; anything started here is picked up by
+        // the poll, whose timeout curl shortens for new transfers
+        long timeout_ms = engine_hedge(engine_dispatch(1000));
+
+        // Sleep until socket activity, a timeout, curl_multi_wakeup, the
+        // next rate limited request may go, or a request is due a hedge
+        curl_multi_poll(g_engine.multi, NULL, 0, (int)timeout_ms, NULL);
     }
-    return copy;
 
-fail:
-    free_tools_copy(copy, count);
     return NULL;
 }
 
-static void free_tools_copy(ToolDefinition* tools, int count) {
-    if (!tools) return;
-    for (int i = 0; i < count; i++) {
-        free((char*)tools[i].name);
-        free((char*)tools[i].description);
-        for (int j = 0; j < tools[i].param_count; j++) {
-            free((char*)tools[i].param_names[j]);
-            free((char*)tools[i].param_types[j]);
-        }
-        free(tools[i].param_names);
-        free(tools[i].param_types);
+void http_set_max_inflight(uint32_t max_inflight) {
+    atomic_store(&g_engine.max_inflight, max_inflight);
+}
+
+void http_admission_stats(HttpAdmissionStats* out) {
+    pthread_mutex_lock(&g_engine.lock);
+    *out = g_engine.admission;
+    pthread_mutex_unlock(&g_engine.lock);
+    out->max_inflight = atomic_load(&g_engine.max_inflight);
+}
+
+static bool engine_start(void) {
+    if (g_engine.started) return g_engine.running;
+    g_engine.started = true;
+
+    if (atomic_load(&g_engine.max_inflight) == 0) {
+        const char* env = getenv("VEGA_MAX_INFLIGHT");
+        long max_inflight = env ? strtol(env, NULL, 10) : 0;
+        atomic_store(&g_engine.max_inflight,
+                     max_inflight > 0 ? (uint32_t)max_inflight : ENGINE_MAX_INFLIGHT);
+    }
+
+    g_engine.multi = curl_multi_init();
+    if (!g_engine.multi) return false;
+    curl_multi_setopt(g_engine.multi, CURLMOPT_MAXCONNECTS, (long)POOL_MAX_CONNECTS);
+    curl_multi_setopt(g_engine.multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+
+    g_engine.running = true;
+    if (pthread_create(&g_engine.thread, NULL, engine_thread, NULL) != 0) {
+        g_engine.running = false;
+        curl_multi_cleanup(g_engine.multi);
+        g_engine.multi = NULL;
+        return false;
     }
-    free(tools);
+    return true;
 }
 
-static void* async_thread_func(void* arg) {
-    HttpAsyncRequest* req = (HttpAsyncRequest*)arg;
-    HttpResponse* response = NULL;
+static void engine_stop(void) {
+    if (!g_engine.running) return;
 
-    switch (req->type) {
-        case HTTP_REQ_MESSAGES:
-            response = anthropic_send_messages(
-                req->api_key, req->model, req->system_prompt,
-                (const char**)req->messages, req->message_count,
-                req->temperature
-            );
-            break;
+    pthread_mutex_lock(&g_engine.lock);
+    g_engine.running = false;
+    pthread_mutex_unlock(&g_engine.lock);
+    curl_multi_wakeup(g_engine.multi);
+    pthread_join(g_engine.thread, NULL);
 
-        case HTTP_REQ_WITH_TOOLS:
-            response = anthropic_send_with_tools(
-                req->api_key, req->model, req->system_prompt,
-                (const char**)req->messages, req->message_count,
-                req->tools, req->tool_count, req->temperature
-            );
-            break;
+    HttpAsyncRequest* cancelled = list_take_all(&g_engine.cancelled);
+    while (cancelled) {
+        HttpAsyncRequest* next = cancelled->next;
+        request_free(cancelled);
+        cancelled = next;
+    }
 
-        case HTTP_REQ_TOOL_RESULT_V2:
-            response = anthropic_send_tool_result_v2(
-                req->api_key, req->model, req->system_prompt,
-                (const char**)req->messages, req->message_count,
-                req->assistant_content, req->tool_use_id, req->tool_result,
-                req->tools, req->tool_count, req->temperature
-            );
-            break;
+    // Requests still in flight or queued are abandoned; their owners free
+    // them through http_async_cancel, which no longer needs the engine
+    while (g_engine.flow_head) {
+        Flow* flow = flow_pop();
+        for (HttpAsyncRequest* r = flow->head; r; r = r->queue_next) r->flow = NULL;
+        free(flow);
     }
+    g_engine.inflight = 0;
+    g_engine.hedge_watch = NULL;
+    g_engine.hedge_race = NULL;
+    latency_free();
+    pthread_mutex_lock(&g_engine.lock);
+    g_engine.admission.queued = 0;
+    g_engine.admission.inflight = 0;
+    free(g_engine.ready);
+    g_engine.ready = NULL;
+    g_engine.ready_count = 0;
+    g_engine.ready_capacity = 0;
+    pthread_mutex_unlock(&g_engine.lock);
+    curl_multi_cleanup(g_engine.multi);
+    g_engine.multi = NULL;
+    g_engine.started = false;
+}
 
-    pthread_mutex_lock(&req->mutex);
-    req->response = response;
-    req->status = response ? HTTP_ASYNC_COMPLETE : HTTP_ASYNC_ERROR;
-    pthread_mutex_unlock(&req->mutex);
+// Move finished requests off the completion list (VM thread)
+static void engine_drain(void) {
+    uint64_t completions = atomic_load_explicit(&g_engine.completions, memory_order_acquire);
+    if (completions == g_engine.drained) return;
+
+    pthread_mutex_lock(&g_engine.lock);
+    HttpAsyncRequest* req = list_take_all(&g_engine.completed);
+    g_engine.drained = atomic_load_explicit(&g_engine.completions, memory_order_relaxed);
+    pthread_mutex_unlock(&g_engine.lock);
+
+    while (req) {
+        HttpAsyncRequest* next = req->next;
+        req->next = NULL;
+        req->state = REQ_DRAINED;
+        req->status = req->response ? HTTP_ASYNC_COMPLETE : HTTP_ASYNC_ERROR;
+        req = next;
+    }
+}
 
-    return NULL;
+// Cache key of a request: the serialized body covers the model, system
+// prompt, messages, tools, temperature, max_tokens and stream flag
+static CacheKey body_key(const HttpBody* body) {
+    CacheHasher hasher;
+    cache_hash_init(&hasher);
+    for (uint32_t i = 0; i < body->count; i++) {
+        const HttpSegment* seg = &body->segments[i];
+        cache_hash_update(&hasher, seg->chunk->data, seg->len);
+    }
+    return cache_hash_final(&hasher);
+}
+
+// Complete req from a cached body without touching the network. Counts no
+// tokens: nothing was billed.
+static bool cache_serve(HttpAsyncRequest* req, const CacheKey* key) {
+    size_t len = 0;
+    char* cached = cache_lookup(key, &len);
+    if (!cached) return false;
+
+    HttpResponse* resp = calloc(1, sizeof(HttpResponse));
+    if (!resp) {
+        free(cached);
+        return false;
+    }
+    resp->status_code = 200;
+    resp->body = cached;
+    resp->body_len = len;
+    resp->message = api_message_decode(cached, len);
+    resp->cached = true;
+
+    trace_http_start(anthropic_url(), "POST");
+    trace_http_done(200, 0, (TokenUsage*)&resp->tokens, NULL);
+
+    pthread_mutex_lock(&g_engine.lock);
+    req->response = resp;
+    req->state = REQ_DONE;
+    list_push(&g_engine.completed, req);
+    ready_post(req);
+    atomic_fetch_add_explicit(&g_engine.completions, 1, memory_order_release);
+    atomic_fetch_add_explicit(&g_engine.events, 1, memory_order_release);
+    pthread_cond_broadcast(&g_engine.done);
+    pthread_mutex_unlock(&g_engine.lock);
+    return true;
 }
 
-static HttpAsyncRequest* create_async_request(void) {
+// Queue a request whose body is already built. Takes ownership of body.
+static HttpAsyncRequest* async_submit(const char* api_key, HttpBody* body) {
+    if (!body) return NULL;
+
+    pthread_mutex_lock(&g_engine.lock);
+    bool running = engine_start();
+    pthread_mutex_unlock(&g_engine.lock);
+    if (!running) {
+        http_body_free(body);
+        return NULL;
+    }
+
     HttpAsyncRequest* req = calloc(1, sizeof(HttpAsyncRequest));
-    if (!req) return NULL;
-    if (pthread_mutex_init(&req->mutex, NULL) != 0) {
-        free(req);
+    if (!req) {
+        http_body_free(body);
         return NULL;
     }
+    req->body = body;
     req->status = HTTP_ASYNC_PENDING;
-    req->thread_started = false;
+    if (body->cacheable && cache_enabled()) {
+        req->cache_key = body_key(body);
+        if (cache_serve(req, &req->cache_key)) return req;
+        req->cacheable = true;
+    }
+    req->headers = anthropic_headers(api_key);
+    if (!req->headers || !request_setup(req, req->headers)) {
+        request_free(req);
+        return NULL;
+    }
+    req->queued_us = http_get_time_us();
+
+    trace_http_start(anthropic_url(), "POST");
+    req->start_time = http_get_time_ms();
+    req->start_us = http_get_time_us();
+
+    pthread_mutex_lock(&g_engine.lock);
+    req->state = REQ_QUEUED;
+    list_push(&g_engine.submitted, req);
+    pthread_mutex_unlock(&g_engine.lock);
+    curl_multi_wakeup(g_engine.multi);
+
     return req;
 }
 
+// Block until a submitted request finishes, then consume it
+static HttpResponse* async_wait(HttpAsyncRequest* req) {
+    pthread_mutex_lock(&g_engine.lock);
+    while (req->state == REQ_QUEUED || req->state == REQ_ACTIVE) {
+        pthread_cond_wait(&g_engine.done, &g_engine.lock);
+    }
+    if (req->state == REQ_DONE) {
+        list_remove(&g_engine.completed, req);
+        req->state = REQ_DRAINED;
+    }
+    pthread_mutex_unlock(&g_engine.lock);
+
+    HttpResponse* response = req->response;
+    req->response = NULL;
+    request_free(req);
+    return response;
+}
+
 HttpAsyncRequest* http_async_send_messages(
     const char* api_key,
     const char* model,
     const char* system_prompt,
     const char** messages,
     int message_count,
-    double temperature
+    double temperature,
+    bool stream
 ) {
-    HttpAsyncRequest* req = create_async_request();
-    if (!req) return NULL;
-
-    req->type = HTTP_REQ_MESSAGES;
-    req->api_key = strdup_safe(api_key);
-    req->model = strdup_safe(model);
-    req->system_prompt = strdup_safe(system_prompt);
-    req->messages = copy_messages(messages, message_count);
-    req->message_count = message_count;
-    req->temperature = temperature;
-
-    if (pthread_create(&req->thread, NULL, async_thread_func, req) != 0) {
-        http_async_cancel(req);
-        return NULL;
-    }
-    req->thread_started = true;
-
-    return req;
+    char* body = build_messages_body(model, system_prompt, messages, message_count,
+                                     NULL, 0, temperature, stream);
+    return async_submit(api_key, body_from_string(body, model, stream, temperature));
 }
 
 HttpAsyncRequest* http_async_send_with_tools(
@@ -1244,28 +2332,12 @@ HttpAsyncRequest* http_async_send_with_tools(
     int message_count,
     ToolDefinition* tools,
     int tool_count,
-    double temperature
+    double temperature,
+    bool stream
 ) {
-    HttpAsyncRequest* req = create_async_request();
-    if (!req) return NULL;
-
-    req->type = HTTP_REQ_WITH_TOOLS;
-    req->api_key = strdup_safe(api_key);
-    req->model = strdup_safe(model);
-    req->system_prompt = strdup_safe(system_prompt);
-    req->messages = copy_messages(messages, message_count);
-    req->message_count = message_count;
-    req->tools = copy_tools(tools, tool_count);
-    req->tool_count = tool_count;
-    req->temperature = temperature;
-
-    if (pthread_create(&req->thread, NULL, async_thread_func, req) != 0) {
-        http_async_cancel(req);
-        return NULL;
-    }
-    req->thread_started = true;
-
-    return req;
+    char* body = build_messages_body(model, system_prompt, messages, message_count,
+                                     tools, tool_count, temperature, stream);
+    return async_submit(api_key, body_from_string(body, model, stream, temperature));
 }
 
 HttpAsyncRequest* http_async_send_tool_result_v2(
@@ -1279,95 +2351,129 @@ HttpAsyncRequest* http_async_send_tool_result_v2(
     const char* tool_result,
     ToolDefinition* tools,
     int tool_count,
-    double temperature
+    double temperature,
+    bool stream
 ) {
-    HttpAsyncRequest* req = create_async_request();
-    if (!req) return NULL;
+    char* body = build_tool_result_body(model, system_prompt, messages, message_count,
+                                        assistant_content, tool_use_id, tool_result,
+                                        tools, tool_count, temperature, stream);
+    return async_submit(api_key, body_from_string(body, model, stream, temperature));
+}
 
-    req->type = HTTP_REQ_TOOL_RESULT_V2;
-    req->api_key = strdup_safe(api_key);
-    req->model = strdup_safe(model);
-    req->system_prompt = strdup_safe(system_prompt);
-    req->messages = copy_messages(messages, message_count);
-    req->message_count = message_count;
-    req->assistant_content = strdup_safe(assistant_content);
-    req->tool_use_id = strdup_safe(tool_use_id);
-    req->tool_result = strdup_safe(tool_result);
-    req->tools = copy_tools(tools, tool_count);
-    req->tool_count = tool_count;
-    req->temperature = temperature;
-
-    if (pthread_create(&req->thread, NULL, async_thread_func, req) != 0) {
-        http_async_cancel(req);
-        return NULL;
+HttpAsyncRequest* http_async_send_body(const char* api_key, HttpBody* body) {
+    return async_submit(api_key, body);
+}
+
+uint64_t http_async_events(void) {
+    return atomic_load_explicit(&g_engine.events, memory_order_acquire);
+}
+
+void http_async_wait(uint64_t seen, int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
     }
-    req->thread_started = true;
 
-    return req;
+    pthread_mutex_lock(&g_engine.lock);
+    while (atomic_load_explicit(&g_engine.events, memory_order_relaxed) == seen) {
+        if (pthread_cond_timedwait(&g_engine.done, &g_engine.lock, &deadline) != 0) break;
+    }
+    pthread_mutex_unlock(&g_engine.lock);
 }
 
-HttpAsyncStatus http_async_poll(HttpAsyncRequest* req) {
-    if (!req) return HTTP_ASYNC_ERROR;
+void http_async_notify(uint64_t token) {
+    if (!token) return;
+    pthread_mutex_lock(&g_engine.lock);
+    ready_push(token);
+    atomic_fetch_add_explicit(&g_engine.events, 1, memory_order_release);
+    pthread_cond_broadcast(&g_engine.done);
+    pthread_mutex_unlock(&g_engine.lock);
+}
 
-    pthread_mutex_lock(&req->mutex);
-    HttpAsyncStatus status = req->status;
-    pthread_mutex_unlock(&req->mutex);
+bool http_async_take_ready(uint64_t** tokens, uint32_t* count) {
+    pthread_mutex_lock(&g_engine.lock);
+    *tokens = g_engine.ready;
+    *count = g_engine.ready_count;
+    bool complete = !g_engine.ready_dropped;
+    g_engine.ready = NULL;
+    g_engine.ready_count = 0;
+    g_engine.ready_capacity = 0;
+    g_engine.ready_dropped = false;
+    pthread_mutex_unlock(&g_engine.lock);
+    return complete;
+}
 
-    return status;
+HttpAsyncStatus http_async_poll(HttpAsyncRequest* req) {
+    if (!req) return HTTP_ASYNC_ERROR;
+    if (req->status == HTTP_ASYNC_PENDING) {
+        engine_drain();
+    }
+    return req->status;
 }
 
 HttpResponse* http_async_get_response(HttpAsyncRequest* req) {
     if (!req) return NULL;
 
-    // Wait for thread to finish
-    pthread_join(req->thread, NULL);
+    // Only valid once drained; a still-pending request is cancelled
+    if (req->state != REQ_DRAINED) {
+        http_async_cancel(req);
+        return NULL;
+    }
 
     HttpResponse* response = req->response;
     req->response = NULL;  // Transfer ownership
-
-    // Free request resources
-    free(req->api_key);
-    free(req->model);
-    free(req->system_prompt);
-    free_messages_copy(req->messages, req->message_count);
-    free_tools_copy(req->tools, req->tool_count);
-    free(req->assistant_content);
-    free(req->tool_use_id);
-    free(req->tool_result);
-    pthread_mutex_destroy(&req->mutex);
-    free(req);
+    request_free(req);
 
     return response;
 }
 
+char* http_async_take_text(HttpAsyncRequest* req) {
+    if (!req || !req->stream) return NULL;
+    if (!atomic_exchange_explicit(&req->stream_ready, false, memory_order_acquire)) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_engine.lock);
+    char* text = req->stream_text;
+    req->stream_text = NULL;
+    req->stream_text_len = 0;
+    req->stream_text_capacity = 0;
+    pthread_mutex_unlock(&g_engine.lock);
+    return text;
+}
+
 void http_async_cancel(HttpAsyncRequest* req) {
     if (!req) return;
 
-    // Only join if thread was actually started
-    if (req->thread_started) {
-        // Note: We can't really cancel a running HTTP request cleanly,
-        // so we just wait for it to finish and discard the result
-        pthread_mutex_lock(&req->mutex);
-        HttpAsyncStatus status = req->status;
-        pthread_mutex_unlock(&req->mutex);
-
-        if (status == HTTP_ASYNC_PENDING) {
-            pthread_join(req->thread, NULL);
-        }
+    pthread_mutex_lock(&g_engine.lock);
+    bool free_now = true;
+    switch (req->state) {
+        case REQ_QUEUED:
+            list_remove(&g_engine.submitted, req);
+            break;
+        case REQ_ACTIVE:
+            if (g_engine.running) {
+                // The engine owns the easy handle; it frees the request
+                req->cancelled = true;
+                list_push(&g_engine.cancelled, req);
+                free_now = false;
+            }
+            break;
+        case REQ_DONE:
+            list_remove(&g_engine.completed, req);
+            break;
+        case REQ_DRAINED:
+            break;
     }
+    pthread_mutex_unlock(&g_engine.lock);
 
-    if (req->response) {
-        http_response_free(req->response);
+    if (free_now) {
+        request_free(req);
+    } else {
+        curl_multi_wakeup(g_engine.multi);
     }
-
-    free(req->api_key);
-    free(req->model);
-    free(req->system_prompt);
-    free_messages_copy(req->messages, req->message_count);
-    free_tools_copy(req->tools, req->tool_count);
-    free(req->assistant_content);
-    free(req->tool_use_id);
-    free(req->tool_result);
-    pthread_mutex_destroy(&req->mutex);
-    free(req);
 }
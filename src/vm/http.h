@@ -3,7 +3,6 @@
 
 #include "../common/memory.h"
 #include <stdbool.h>
-#include <pthread.h>
 
 /*
  * Vega HTTP Client
@@ -27,12 +26,24 @@ typedef struct {
 // Response Structure
 // ============================================================================
 
+// Latency of a streamed response (zero unless it arrived as SSE)
+typedef struct {
+    bool streamed;
+    uint32_t deltas;        // Text deltas received
+    double ttft_ms;         // Request start to first text delta
+    double itl_ms;          // Mean gap between successive text deltas
+} HttpStreamStats;
+
 typedef struct {
     int status_code;
-    char* body;
-    size_t body_len;
+    char* body;             // Streamed responses are rebuilt into the
+    size_t body_len;        // same shape as non-streamed ones
     char* error;
     HttpTokenUsage tokens;  // Parsed token usage from response
+    HttpStreamStats stream;
+    struct ApiMessage* message; // Decoded body (message.h); NULL if empty
+    bool cached;            // Served from the response cache (cache.h)
+    bool hedged;            // Answered by a hedged duplicate request
 } HttpResponse;
 
 // ============================================================================
@@ -92,6 +103,42 @@ HttpResponse* anthropic_send_with_tools(
 // Free response
 void http_response_free(HttpResponse* resp);
 
+// ============================================================================
+// Connection Pool Stats
+// ============================================================================
+
+typedef struct {
+    uint64_t requests;          // Completed transfers (including failures)
+    uint64_t failures;          // Transfers that failed at the transport level
+    uint64_t reused;            // Transfers served on an existing connection
+    uint64_t connections;       // New connections opened
+    uint64_t connect_us;        // Total TCP connect time of new connections
+    uint64_t handshake_us;      // Total TLS handshake time of new connections
+    uint64_t http2;             // Transfers that ran over HTTP/2
+} HttpPoolStats;
+
+// Snapshot the pool counters (also traced as TRACE_HTTP_POOL events)
+void http_pool_stats(HttpPoolStats* out);
+
+// Admission control: at most max_inflight API requests run at once (set
+// here, by VEGA_MAX_INFLIGHT, or 64). The rest queue per flow and start
+// round-robin across flows as slots free up. Agents use their declaration
+// as the flow, so many spawned workers of one kind share a single turn
+// with a lone latency-critical agent.
+typedef struct {
+    uint32_t max_inflight;
+    uint32_t inflight;          // Requests running now
+    uint32_t queued;            // Requests waiting for a slot
+    uint64_t admitted;          // Requests started so far
+    uint64_t wait_us;           // Total time they spent queued
+    uint64_t max_wait_us;
+} HttpAdmissionStats;
+
+void http_set_max_inflight(uint32_t max_inflight);
+
+// Snapshot the admission counters (waits are traced as TRACE_HTTP_QUEUE)
+void http_admission_stats(HttpAdmissionStats* out);
+
 // Extract text content from API response JSON
 // Returns allocated string that must be freed
 char* anthropic_extract_text(const char* json_response);
@@ -132,6 +179,92 @@ HttpResponse* anthropic_send_tool_result_v2(
     double temperature
 );
 
+// ============================================================================
+// Request Bodies
+// ============================================================================
+
+// A serialized request body, held as a list of shared buffers that are
+// sent in place. Bodies are immutable once built.
+typedef struct HttpBody HttpBody;
+
+// One-shot body for a message array (what the senders above build)
+HttpBody* http_body_from_messages(
+    const char* model,
+    const char* system_prompt,
+    const char** messages,
+    int message_count,
+    ToolDefinition* tools,
+    int tool_count,
+    double temperature,
+    bool stream
+);
+
+size_t http_body_size(const HttpBody* body);
+
+// Contiguous copy of the body (caller frees); for diagnostics
+char* http_body_flatten(const HttpBody* body);
+
+void http_body_free(HttpBody* body);
+
+// Blocking send. Takes ownership of body.
+HttpResponse* anthropic_send_body(const char* api_key, HttpBody* body);
+
+// An agent's conversation, kept serialized between turns. The header
+// (model, system prompt, temperature) and tool schemas are escaped once,
+// and each message is escaped once when appended to an append-only
+// history. Building a request body then only references those buffers, so
+// a turn costs O(new message) rather than O(conversation).
+//
+// With prompt_cache, bodies carry prompt caching breakpoints on the tool
+// schemas, the system prompt and the newest message (or tool result), so
+// each turn reads the conversation so far from the server-side cache.
+typedef struct HttpConversation HttpConversation;
+
+HttpConversation* http_conversation_new(
+    const char* model,
+    const char* system_prompt,
+    double temperature,
+    ToolDefinition* tools,
+    int tool_count,
+    bool stream,
+    bool prompt_cache
+);
+
+// Append the next message (roles alternate user/assistant, starting with user)
+bool http_conversation_append(HttpConversation* conv, const char* message);
+
+// Queue the conversation's requests under flow for admission (0 = shared)
+void http_conversation_set_flow(HttpConversation* conv, uint32_t flow);
+
+// Hedge the conversation's requests: one that has produced no response
+// byte by the given percentile of recent first-byte latency for its model
+// is sent again, and whichever copy answers first is used (0 = off)
+void http_conversation_set_hedge(HttpConversation* conv, uint8_t percentile);
+
+// Tag the conversation's requests with a ready queue token (0 = none),
+// see http_async_take_ready
+void http_conversation_set_notify(HttpConversation* conv, uint64_t token);
+
+// Withdraw the last message appended, once (a send that was cancelled
+// before its reply). Returns false if there is none to withdraw.
+bool http_conversation_drop_last(HttpConversation* conv);
+
+// Drop the history (bodies already built are unaffected)
+void http_conversation_clear(HttpConversation* conv);
+void http_conversation_free(HttpConversation* conv);
+
+// Body for the next turn: the history as it stands
+HttpBody* http_conversation_request(HttpConversation* conv);
+
+// Body answering a tool_use turn: the history, then the assistant's raw
+// content array and the tool result (neither is added to the history)
+HttpBody* http_conversation_tool_result(
+    HttpConversation* conv,
+    const char* assistant_content,
+    const char* tool_use_id,
+    const char* tool_result
+);
+
 // ============================================================================
 // Async HTTP Support
 // ============================================================================
@@ -142,38 +275,14 @@ typedef enum {
     HTTP_ASYNC_ERROR       // Request failed
 } HttpAsyncStatus;
 
-typedef enum {
-    HTTP_REQ_MESSAGES,         // anthropic_send_messages
-    HTTP_REQ_WITH_TOOLS,       // anthropic_send_with_tools
-    HTTP_REQ_TOOL_RESULT_V2    // anthropic_send_tool_result_v2
-} HttpRequestType;
-
-typedef struct HttpAsyncRequest {
-    // Thread management
-    pthread_t thread;
-    pthread_mutex_t mutex;
-    HttpAsyncStatus status;
-    bool thread_started;  // True if pthread_create succeeded
-
-    // Request type and parameters
-    HttpRequestType type;
-    char* api_key;
-    char* model;
-    char* system_prompt;
-    char** messages;
-    int message_count;
-    double temperature;
-
-    // For tool requests
-    ToolDefinition* tools;
-    int tool_count;
-    char* assistant_content;  // For tool_result_v2
-    char* tool_use_id;
-    char* tool_result;
-
-    // Result
-    HttpResponse* response;
-} HttpAsyncRequest;
+// Async requests run on a single I/O thread that drives every in-flight
+// transfer through curl multi. The request body is serialized before the
+// send call returns, so callers need not keep their arguments alive.
+//
+// With stream set, the request asks for server-sent events. Text is decoded
+// as it arrives and can be collected with http_async_take_text while the
+// request is pending; the final response looks like a non-streamed one.
+typedef struct HttpAsyncRequest HttpAsyncRequest;
 
 // Start an async messages request
 HttpAsyncRequest* http_async_send_messages(
@@ -182,7 +291,8 @@ HttpAsyncRequest* http_async_send_messages(
     const char* system_prompt,
     const char** messages,
     int message_count,
-    double temperature
+    double temperature,
+    bool stream
 );
 
 // Start an async request with tools
@@ -194,7 +304,8 @@ HttpAsyncRequest* http_async_send_with_tools(
     int message_count,
     ToolDefinition* tools,
     int tool_count,
-    double temperature
+    double temperature,
+    bool stream
 );
 
 // Start an async tool result request
@@ -209,17 +320,47 @@ HttpAsyncRequest* http_async_send_tool_result_v2(
     const char* tool_result,
     ToolDefinition* tools,
     int tool_count,
-    double temperature
+    double temperature,
+    bool stream
 );
 
+// Start an async request with a prebuilt body (takes ownership; streams
+// if the body was built for streaming)
+HttpAsyncRequest* http_async_send_body(const char* api_key, HttpBody* body);
+
 // Check if async request is complete (non-blocking)
 HttpAsyncStatus http_async_poll(HttpAsyncRequest* req);
 
 // Get result and free request (call after HTTP_ASYNC_COMPLETE)
-// Transfers ownership of response to caller
+// Transfers ownership of response to caller; returns NULL (and cancels) if
+// the request has not completed
 HttpResponse* http_async_get_response(HttpAsyncRequest* req);
 
+// Take the text streamed since the last call (caller frees). Returns NULL
+// if nothing new has arrived or the request is not streaming.
+char* http_async_take_text(HttpAsyncRequest* req);
+
 // Cancel and free an async request
 void http_async_cancel(HttpAsyncRequest* req);
 
+// Take the tokens that requests tagged with one (a body built from a
+// conversation with http_conversation_set_notify) posted since the last
+// call: once on completion, and once per batch of streamed text not yet
+// taken. Caller frees *tokens (NULL when there are none). Returns false if
+// tokens were lost for lack of memory, in which case every request should
+// be polled.
+bool http_async_take_ready(uint64_t** tokens, uint32_t* count);
+
+// Post a token as if a request tagged with it had completed, for a send
+// that ended without one (e.g. its deadline passed); wakes http_async_wait
+void http_async_notify(uint64_t token);
+
+// Count of engine events (completions and streamed text) so far. Read it
+// before polling, then pass it to http_async_wait to sleep until something
+// changes: an event in between returns at once, so none is missed.
+uint64_t http_async_events(void);
+
+// Block until the event count moves past seen, or timeout_ms passes
+void http_async_wait(uint64_t seen, int timeout_ms);
+
 #endif // VEGA_HTTP_H
@@ -36,6 +36,7 @@ static void print_usage(const char* prog) {
     fprintf(stderr, "  --budget-cost N      Set max cost in USD (e.g., 0.50)\n");
     fprintf(stderr, "  --budget-input N     Set max input tokens\n");
     fprintf(stderr, "  --budget-output N    Set max output tokens\n");
+    fprintf(stderr, "  --max-inflight N     Max concurrent API requests (default 64)\n");
     fprintf(stderr, "  -h, --help           Show this help message\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Environment:\n");
@@ -259,6 +260,7 @@ int main(int argc, char* argv[]) {
     double budget_cost = 0.0;
     uint64_t budget_input = 0;
     uint64_t budget_output = 0;
+    uint32_t max_inflight = 0;
 
     // Parse arguments
     for (int i = 1; i < argc; i++) {
@@ -285,6 +287,12 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             budget_output = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-inflight") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: --max-inflight requires a value\n");
+                return 1;
+            }
+            max_inflight = (uint32_t)strtoul(argv[++i], NULL, 10);
         } else if (argv[i][0] == '-') {
             fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
             print_usage(argv[0]);
@@ -315,6 +323,9 @@ int main(int argc, char* argv[]) {
         vega_memory_shutdown();
         return 1;
     }
+    if (max_inflight > 0) {
+        http_set_max_inflight(max_inflight);
+    }
 
     // Initialize VM
     VegaVM vm;
@@ -370,6 +381,11 @@ int main(int argc, char* argv[]) {
         printf("\n--- Token Usage ---\n");
         printf("Input:  %llu tokens\n", (unsigned long long)vm.budget_used_input_tokens);
         printf("Output: %llu tokens\n", (unsigned long long)vm.budget_used_output_tokens);
+        if (vm.budget_used_cache_read_tokens > 0 || vm.budget_used_cache_write_tokens > 0) {
+            printf("Cached: %llu read, %llu written\n",
+                   (unsigned long long)vm.budget_used_cache_read_tokens,
+                   (unsigned long long)vm.budget_used_cache_write_tokens);
+        }
         printf("Cost:   $%.4f\n", vm.budget_used_cost_usd);
     }
 
@@ -0,0 +1,370 @@
+#include "message.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Nesting deeper than this is rejected rather than recursed into
+#define MAX_DEPTH 64
+
+// ============================================================================
+// Strings
+// ============================================================================
+
+static unsigned hex4(const char* s) {
+    unsigned v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= (unsigned)(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= (unsigned)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v |= (unsigned)(c - 'A' + 10);
+        else return 0xFFFFFFFFu;
+    }
+    return v;
+}
+
+size_t json_unescape(const char* s, size_t len, char* out) {
+    const char* end = s + len;
+    char* d = out;
+    while (s < end) {
+        if (*s != '\\' || s + 1 >= end) {
+            *d++ = *s++;
+            continue;
+        }
+        s++;
+        switch (*s) {
+            case 'n': *d++ = '\n'; s++; break;
+            case 'r': *d++ = '\r'; s++; break;
+            case 't': *d++ = '\t'; s++; break;
+            case 'b': *d++ = '\b'; s++; break;
+            case 'f': *d++ = '\f'; s++; break;
+            case 'u': {
+                unsigned cp = s + 5 <= end ? hex4(s + 1) : 0xFFFFFFFFu;
+                if (cp == 0xFFFFFFFFu) {
+                    *d++ = *s++;
+                    break;
+                }
+                s += 5;
+                if (cp >= 0xD800 && cp <= 0xDBFF && s + 6 <= end &&
+                    s[0] == '\\' && s[1] == 'u') {
+                    unsigned lo = hex4(s + 2);
+                    if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        s += 6;
+                    }
+                }
+                if (cp < 0x80) {
+                    *d++ = (char)cp;
+                } else if (cp < 0x800) {
+                    *d++ = (char)(0xC0 | (cp >> 6));
+                    *d++ = (char)(0x80 | (cp & 0x3F));
+                } else if (cp < 0x10000) {
+                    *d++ = (char)(0xE0 | (cp >> 12));
+                    *d++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    *d++ = (char)(0x80 | (cp & 0x3F));
+                } else {
+                    *d++ = (char)(0xF0 | (cp >> 18));
+                    *d++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+                    *d++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    *d++ = (char)(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default: *d++ = *s++; break;   // \" \\ \/
+        }
+    }
+    return (size_t)(d - out);
+}
+
+// ============================================================================
+// Tokenizer
+// ============================================================================
+
+typedef struct {
+    const char* p;
+    const char* end;
+} Cursor;
+
+static void skip_ws(Cursor* c) {
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r')) {
+        c->p++;
+    }
+}
+
+static bool expect(Cursor* c, char ch) {
+    skip_ws(c);
+    if (c->p >= c->end || *c->p != ch) return false;
+    c->p++;
+    return true;
+}
+
+// A string token; start/len are its contents, still escaped
+static bool scan_string(Cursor* c, const char** start, size_t* len) {
+    skip_ws(c);
+    if (c->p >= c->end || *c->p != '"') return false;
+    const char* s = ++c->p;
+    while (c->p < c->end && *c->p != '"') {
+        if (*c->p == '\\') c->p++;
+        c->p++;
+    }
+    if (c->p >= c->end) return false;
+    *start = s;
+    *len = (size_t)(c->p - s);
+    c->p++;
+    return true;
+}
+
+static bool skip_value(Cursor* c, int depth) {
+    skip_ws(c);
+    if (c->p >= c->end || depth > MAX_DEPTH) return false;
+
+    char open = *c->p;
+    if (open == '"') {
+        const char* s;
+        size_t len;
+        return scan_string(c, &s, &len);
+    }
+    if (open != '{' && open != '[') {
+        // Number, true, false or null
+        const char* start = c->p;
+        while (c->p < c->end && !strchr(",}] \t\r\n", *c->p)) c->p++;
+        return c->p > start;
+    }
+
+    char close = open == '{' ? '}' : ']';
+    c->p++;
+    if (expect(c, close)) return true;
+    do {
+        if (open == '{') {
+            const char* key;
+            size_t key_len;
+            if (!scan_string(c, &key, &key_len) || !expect(c, ':')) return false;
+        }
+        if (!skip_value(c, depth + 1)) return false;
+    } while (expect(c, ','));
+    return expect(c, close);
+}
+
+static bool key_is(const char* key, size_t len, const char* name) {
+    return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+// Unescaped copy of a string value; a null value yields NULL
+static bool read_string(Cursor* c, char** out) {
+    skip_ws(c);
+    if (c->end - c->p >= 4 && memcmp(c->p, "null", 4) == 0) {
+        c->p += 4;
+        return true;
+    }
+    const char* s;
+    size_t len;
+    if (!scan_string(c, &s, &len)) return false;
+    char* text = malloc(len + 1);
+    if (!text) return false;
+    text[json_unescape(s, len, text)] = '\0';
+    free(*out);
+    *out = text;
+    return true;
+}
+
+static bool read_u32(Cursor* c, uint32_t* out) {
+    skip_ws(c);
+    const char* start = c->p;
+    uint64_t v = 0;
+    while (c->p < c->end && *c->p >= '0' && *c->p <= '9') {
+        v = v * 10 + (uint64_t)(*c->p - '0');
+        if (v > UINT32_MAX) v = UINT32_MAX;
+        c->p++;
+    }
+    if (c->p == start) return skip_value(c, 0);     // null, or not a count
+    *out = (uint32_t)v;
+    return true;
+}
+
+// Copy of the raw JSON value at the cursor
+static bool read_raw(Cursor* c, char** out) {
+    skip_ws(c);
+    const char* start = c->p;
+    if (!skip_value(c, 1)) return false;
+    free(*out);
+    *out = strndup(start, (size_t)(c->p - start));
+    return *out != NULL;
+}
+
+// Calls field() for each member of an object; field consumes the value
+typedef bool (*FieldFn)(Cursor* c, const char* key, size_t key_len, void* target);
+
+static bool read_object(Cursor* c, FieldFn field, void* target) {
+    if (!expect(c, '{')) return false;
+    if (expect(c, '}')) return true;
+    do {
+        const char* key;
+        size_t key_len;
+        if (!scan_string(c, &key, &key_len) || !expect(c, ':')) return false;
+        if (!field(c, key, key_len, target)) return false;
+    } while (expect(c, ','));
+    return expect(c, '}');
+}
+
+// ============================================================================
+// Messages API Fields
+// ============================================================================
+
+static bool block_field(Cursor* c, const char* key, size_t len, void* target) {
+    ApiBlock* block = target;
+    if (key_is(key, len, "type")) {
+        char* type = NULL;
+        if (!read_string(c, &type)) return false;
+        block->type = !type ? API_BLOCK_OTHER :
+                      strcmp(type, "text") == 0 ? API_BLOCK_TEXT :
+                      strcmp(type, "tool_use") == 0 ? API_BLOCK_TOOL_USE : API_BLOCK_OTHER;
+        free(type);
+        return true;
+    }
+    if (key_is(key, len, "text")) return read_string(c, &block->text);
+    if (key_is(key, len, "id")) return read_string(c, &block->id);
+    if (key_is(key, len, "name")) return read_string(c, &block->name);
+    if (key_is(key, len, "input")) return read_raw(c, &block->input);
+    return skip_value(c, 2);
+}
+
+static void block_free(ApiBlock* block) {
+    free(block->text);
+    free(block->id);
+    free(block->name);
+    free(block->input);
+}
+
+static bool read_content(Cursor* c, ApiMessage* msg) {
+    skip_ws(c);
+    const char* start = c->p;
+    if (!expect(c, '[')) return skip_value(c, 1);
+    bool tool_use = false;
+
+    if (!expect(c, ']')) {
+        do {
+            if (msg->block_count % 4 == 0) {
+                ApiBlock* grown = realloc(msg->blocks, (msg->block_count + 4) * sizeof(ApiBlock));
+                if (!grown) return false;
+                msg->blocks = grown;
+            }
+            ApiBlock* block = &msg->blocks[msg->block_count++];
+            memset(block, 0, sizeof(ApiBlock));
+            block->type = API_BLOCK_OTHER;
+            if (!read_object(c, block_field, block)) return false;
+            tool_use |= block->type == API_BLOCK_TOOL_USE;
+        } while (expect(c, ','));
+        if (!expect(c, ']')) return false;
+    }
+
+    if (tool_use) {
+        free(msg->content);
+        msg->content = strndup(start, (size_t)(c->p - start));
+        if (!msg->content) return false;
+    }
+    return true;
+}
+
+static bool usage_field(Cursor* c, const char* key, size_t len, void* target) {
+    HttpTokenUsage* usage = target;
+    if (key_is(key, len, "input_tokens")) return read_u32(c, &usage->input_tokens);
+    if (key_is(key, len, "output_tokens")) return read_u32(c, &usage->output_tokens);
+    if (key_is(key, len, "cache_read_input_tokens")) return read_u32(c, &usage->cache_read_tokens);
+    if (key_is(key, len, "cache_creation_input_tokens")) return read_u32(c, &usage->cache_write_tokens);
+    return skip_value(c, 2);
+}
+
+static bool error_field(Cursor* c, const char* key, size_t len, void* target) {
+    ApiMessage* msg = target;
+    if (key_is(key, len, "type")) return read_string(c, &msg->error_type);
+    if (key_is(key, len, "message")) return read_string(c, &msg->error_message);
+    return skip_value(c, 2);
+}
+
+static bool message_field(Cursor* c, const char* key, size_t len, void* target) {
+    ApiMessage* msg = target;
+    if (key_is(key, len, "type")) {
+        char* type = NULL;
+        if (!read_string(c, &type)) return false;
+        msg->is_error = type && strcmp(type, "error") == 0;
+        free(type);
+        return true;
+    }
+    if (key_is(key, len, "content")) return read_content(c, msg);
+    if (key_is(key, len, "stop_reason")) return read_string(c, &msg->stop_reason);
+    if (key_is(key, len, "usage")) {
+        skip_ws(c);
+        if (c->p < c->end && *c->p == '{') return read_object(c, usage_field, &msg->usage);
+        return skip_value(c, 1);
+    }
+    if (key_is(key, len, "error")) {
+        skip_ws(c);
+        if (c->p < c->end && *c->p == '{') return read_object(c, error_field, msg);
+        return skip_value(c, 1);
+    }
+    return skip_value(c, 1);
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+ApiMessage* api_message_decode(const char* body, size_t len) {
+    ApiMessage* msg = calloc(1, sizeof(ApiMessage));
+    if (!msg || !body) return msg;
+
+    Cursor c = { body, body + len };
+    msg->ok = read_object(&c, message_field, msg);
+    if (msg->ok) {
+        skip_ws(&c);
+        msg->ok = c.p == c.end;
+    }
+    return msg;
+}
+
+void api_message_free(ApiMessage* msg) {
+    if (!msg) return;
+    for (uint32_t i = 0; i < msg->block_count; i++) {
+        block_free(&msg->blocks[i]);
+    }
+    free(msg->blocks);
+    free(msg->content);
+    free(msg->stop_reason);
+    free(msg->error_type);
+    free(msg->error_message);
+    free(msg);
+}
+
+const ApiBlock* api_message_tool_use(const ApiMessage* msg) {
+    if (!msg) return NULL;
+    for (uint32_t i = 0; i < msg->block_count; i++) {
+        if (msg->blocks[i].type == API_BLOCK_TOOL_USE) return &msg->blocks[i];
+    }
+    return NULL;
+}
+
+char* api_message_text(const ApiMessage* msg) {
+    if (!msg) return NULL;
+
+    size_t total = 0;
+    bool found = false;
+    for (uint32_t i = 0; i < msg->block_count; i++) {
+        if (msg->blocks[i].type == API_BLOCK_TEXT && msg->blocks[i].text) {
+            total += strlen(msg->blocks[i].text);
+            found = true;
+        }
+    }
+    if (!found) return NULL;
+
+    char* text = malloc(total + 1);
+    if (!text) return NULL;
+    char* p = text;
+    for (uint32_t i = 0; i < msg->block_count; i++) {
+        if (msg->blocks[i].type == API_BLOCK_TEXT && msg->blocks[i].text) {
+            size_t n = strlen(msg->blocks[i].text);
+            memcpy(p, msg->blocks[i].text, n);
+            p += n;
+        }
+    }
+    *p = '\0';
+    return text;
+}
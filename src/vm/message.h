@@ -0,0 +1,65 @@
+#ifndef VEGA_MESSAGE_H
+#define VEGA_MESSAGE_H
+
+#include "http.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Vega Messages API Response Decoder
+ *
+ * Decodes a Messages API response body in one tokenizing pass. Only the
+ * fields of the top-level object (and of its content blocks, usage and
+ * error objects) are interpreted; every other value is skipped as a whole,
+ * so text that happens to contain "type": "tool_use" or "usage" cannot be
+ * mistaken for the real fields. HTTP responses are decoded once on the
+ * engine thread, and every consumer reads the result.
+ */
+
+typedef enum {
+    API_BLOCK_TEXT,
+    API_BLOCK_TOOL_USE,
+    API_BLOCK_OTHER,            // Thinking, images, ... (kept in content)
+} ApiBlockType;
+
+typedef struct {
+    ApiBlockType type;
+    char* text;                 // Text block: unescaped text
+    char* id;                   // tool_use: id
+    char* name;                 // tool_use: tool name
+    char* input;                // tool_use: input object, raw JSON
+} ApiBlock;
+
+typedef struct ApiMessage {
+    bool ok;                    // Body was a well-formed JSON object
+    bool is_error;              // "type": "error"
+
+    ApiBlock* blocks;
+    uint32_t block_count;
+    char* content;              // Raw content array, kept only when it has a
+                                // tool_use block (it is echoed back)
+    char* stop_reason;
+    HttpTokenUsage usage;
+
+    char* error_type;           // error.type, e.g. "overloaded_error"
+    char* error_message;        // error.message
+} ApiMessage;
+
+// Decode len bytes of body. Always returns a message (NULL only when out of
+// memory); ok is false if the body was not a JSON object.
+ApiMessage* api_message_decode(const char* body, size_t len);
+
+void api_message_free(ApiMessage* msg);
+
+// First tool_use block, or NULL
+const ApiBlock* api_message_tool_use(const ApiMessage* msg);
+
+// All text blocks joined (caller frees), or NULL if there are none
+char* api_message_text(const ApiMessage* msg);
+
+// Unescape len bytes of JSON string contents into out (at least len bytes;
+// unescaping never grows the text). Returns the decoded length.
+size_t json_unescape(const char* s, size_t len, char* out);
+
+#endif // VEGA_MESSAGE_H
@@ -0,0 +1,93 @@
+#include "native.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Registry
+// ============================================================================
+
+static const NativeDef** g_natives = NULL;
+static uint32_t g_native_count = 0;
+static uint32_t g_native_capacity = 0;
+static bool g_natives_initialized = false;
+
+// Method tables, indexed by receiver ValueType
+#define METHOD_TYPES (VAL_FUNCTION + 1)
+
+typedef struct {
+    const NativeDef** defs;
+    uint32_t count;
+    uint32_t capacity;
+} MethodTable;
+
+static MethodTable g_methods[METHOD_TYPES];
+
+void native_init(void) {
+    if (g_natives_initialized) return;
+    g_natives_initialized = true;
+
+    stdlib_file_register();
+    stdlib_str_register();
+    stdlib_json_register();
+    stdlib_http_register();
+    stdlib_array_register();
+    stdlib_result_register();
+    stdlib_future_register();
+}
+
+void native_register_module(const NativeDef* defs, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (g_native_count >= g_native_capacity) {
+            g_native_capacity = g_native_capacity < 32 ? 32 : g_native_capacity * 2;
+            g_natives = realloc(g_natives, g_native_capacity * sizeof(NativeDef*));
+        }
+        g_natives[g_native_count++] = &defs[i];
+    }
+}
+
+void native_register_methods(ValueType type, const NativeDef* defs, uint32_t count) {
+    if ((uint32_t)type >= METHOD_TYPES) return;
+    MethodTable* table = &g_methods[type];
+    for (uint32_t i = 0; i < count; i++) {
+        if (table->count >= table->capacity) {
+            table->capacity = table->capacity < 16 ? 16 : table->capacity * 2;
+            table->defs = realloc(table->defs, table->capacity * sizeof(NativeDef*));
+        }
+        table->defs[table->count++] = &defs[i];
+    }
+}
+
+// ============================================================================
+// Lookup
+// ============================================================================
+
+int native_find(const char* name, uint32_t len) {
+    for (uint32_t i = 0; i < g_native_count; i++) {
+        const char* candidate = g_natives[i]->name;
+        if (strncmp(candidate, name, len) == 0 && candidate[len] == '\0') {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+const NativeDef* native_get(uint32_t index) {
+    if (index >= g_native_count) return NULL;
+    return g_natives[index];
+}
+
+uint32_t native_count(void) {
+    return g_native_count;
+}
+
+const NativeDef* native_find_method(ValueType type, const char* name, uint32_t len) {
+    if ((uint32_t)type >= METHOD_TYPES) return NULL;
+    MethodTable* table = &g_methods[type];
+    for (uint32_t i = 0; i < table->count; i++) {
+        const char* candidate = table->defs[i]->name;
+        if (strncmp(candidate, name, len) == 0 && candidate[len] == '\0') {
+            return table->defs[i];
+        }
+    }
+    return NULL;
+}
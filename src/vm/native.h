@@ -0,0 +1,55 @@
+#ifndef VEGA_NATIVE_H
+#define VEGA_NATIVE_H
+
+#include "value.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Vega Native Function Registry
+ *
+ * Stdlib modules register their "module::function" natives here. vm_load
+ * rewrites every OP_CALL_NATIVE operand to a registry index, so a native
+ * call is one indirect call with its arguments read in place off the stack.
+ *
+ * Methods ("hello".len(), arr.push(x), res.unwrap()) live in per-type
+ * tables here too. They use the same NativeDef shape with the receiver
+ * passed as args[0]; arity counts only the explicit arguments.
+ */
+
+// Arguments are borrowed (the VM releases them after the call); the
+// returned value is owned by the caller.
+typedef Value (*NativeFn)(Value* args);
+
+typedef struct {
+    const char* name;       // Qualified name, e.g. "str::len"
+    uint8_t arity;          // Exact number of arguments
+    bool pure;              // No side effects; result depends only on args
+    NativeFn fn;
+} NativeDef;
+
+// Register all built-in modules (idempotent)
+void native_init(void);
+
+// Register natives (the table must outlive the registry)
+void native_register_module(const NativeDef* defs, uint32_t count);
+
+// Lookup
+int native_find(const char* name, uint32_t len);
+const NativeDef* native_get(uint32_t index);
+uint32_t native_count(void);
+
+// Per-type method tables (the table must outlive the registry)
+void native_register_methods(ValueType type, const NativeDef* defs, uint32_t count);
+const NativeDef* native_find_method(ValueType type, const char* name, uint32_t len);
+
+// Module registration (src/stdlib/)
+void stdlib_file_register(void);
+void stdlib_str_register(void);
+void stdlib_json_register(void);
+void stdlib_http_register(void);
+void stdlib_array_register(void);
+void stdlib_result_register(void);
+void stdlib_future_register(void);
+
+#endif // VEGA_NATIVE_H
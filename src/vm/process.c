@@ -29,9 +29,21 @@ VegaProcess* process_create(VegaVM* vm, uint32_t parent_pid) {
     proc->parent_pid = parent_pid;
 
     // Initialize stack
-    proc->sp = 0;
-    proc->frame_count = 0;
-    proc->ip = 0;
+    proc->context.stack = calloc(PROCESS_STACK_INITIAL, sizeof(Value));
+    proc->context.frames = calloc(PROCESS_FRAMES_INITIAL, sizeof(CallFrame));
+    if (!proc->context.stack || !proc->context.frames) {
+        free(proc->context.stack);
+        free(proc->context.frames);
+        free(proc);
+        return NULL;
+    }
+    proc->context.stack_capacity = PROCESS_STACK_INITIAL;
+    proc->context.frame_capacity = PROCESS_FRAMES_INITIAL;
+    proc->context.sp = 0;
+    proc->context.frame_count = 0;
+    proc->context.ip = 0;
+    proc->context.waiting_for_agent = NULL;
+    proc->context.waiting_msg = value_null();
 
     // Default supervision config
     proc->supervision.strategy = STRATEGY_RESTART;
@@ -66,10 +78,21 @@ VegaProcess* process_create(VegaVM* vm, uint32_t parent_pid) {
 void process_free(VegaProcess* proc) {
     if (!proc) return;
 
+    timer_cancel(&proc->timer);
+
+    // A sync send the process was parked on (saved with its registers)
+    if (proc->context.waiting_for_agent) {
+        agent_cancel_pending(proc->context.waiting_for_agent);
+        proc->context.waiting_for_agent = NULL;
+    }
+    value_release(proc->context.waiting_msg);
+
     // Release stack values
-    for (uint32_t i = 0; i < proc->sp; i++) {
-        value_release(proc->stack[i]);
+    for (uint32_t i = 0; i < proc->context.sp; i++) {
+        value_release(proc->context.stack[i]);
     }
+    free(proc->context.stack);
+    free(proc->context.frames);
 
     // Break circular reference: agent has a pointer to this process
     // Don't free the agent here - it's owned by the Value on the stack
@@ -83,6 +106,58 @@ void process_free(VegaProcess* proc) {
     free(proc);
 }
 
+bool process_start_function(VegaVM* vm, VegaProcess* proc, uint32_t function_id) {
+    if (!proc || function_id >= vm->func_count) return false;
+
+    FunctionDef* fn = &vm->functions[function_id];
+    ExecContext* ctx = &proc->context;
+    if (!context_reserve_stack(&ctx->stack, &ctx->stack_capacity, ctx->sp + fn->local_count)) {
+        return false;
+    }
+
+    // Runs like main(): no frame, locals at the bottom of the stack
+    ctx->ip = fn->code_offset;
+    ctx->frame_count = 0;
+    while (ctx->sp < fn->local_count) {
+        ctx->stack[ctx->sp++] = value_null();
+    }
+    return true;
+}
+
+// ============================================================================
+// Execution Contexts
+// ============================================================================
+
+static uint32_t grown_capacity(uint32_t capacity, uint32_t needed, uint32_t limit) {
+    uint32_t grown = capacity < 8 ? 8 : capacity;
+    while (grown < needed) grown *= 2;
+    return grown > limit ? limit : grown;
+}
+
+bool context_reserve_stack(Value** stack, uint32_t* capacity, uint32_t needed) {
+    if (needed <= *capacity) return true;
+    if (needed > CONTEXT_STACK_LIMIT) return false;
+
+    uint32_t grown = grown_capacity(*capacity, needed, CONTEXT_STACK_LIMIT);
+    Value* data = realloc(*stack, grown * sizeof(Value));
+    if (!data) return false;
+    *stack = data;
+    *capacity = grown;
+    return true;
+}
+
+bool context_reserve_frames(CallFrame** frames, uint32_t* capacity, uint32_t needed) {
+    if (needed <= *capacity) return true;
+    if (needed > CONTEXT_FRAMES_LIMIT) return false;
+
+    uint32_t grown = grown_capacity(*capacity, needed, CONTEXT_FRAMES_LIMIT);
+    CallFrame* data = realloc(*frames, grown * sizeof(CallFrame));
+    if (!data) return false;
+    *frames = data;
+    *capacity = grown;
+    return true;
+}
+
 uint32_t process_spawn_agent(VegaVM* vm, VegaProcess* parent,
                              uint32_t agent_def_id, SupervisionConfig* config) {
     // Create new process
@@ -104,11 +179,10 @@ uint32_t process_spawn_agent(VegaVM* vm, VegaProcess* parent,
     child->agent_def_id = agent_def_id;
 
     // Add to VM's process table
-    if (vm->process_count >= MAX_PROCESSES) {
+    if (!scheduler_add(&vm->scheduler, child)) {
         process_free(child);
         return 0;
     }
-    vm->processes[vm->process_count++] = child;
 
     return child->pid;
 }
@@ -116,19 +190,14 @@ uint32_t process_spawn_agent(VegaVM* vm, VegaProcess* parent,
 void process_exit(VegaVM* vm, VegaProcess* proc, ExitReason reason, const char* message) {
     if (!proc || proc->state == PROC_EXITED) return;
 
-    proc->state = PROC_EXITED;
+    timer_cancel(&proc->timer);  // Killed in its sleep
+    scheduler_set_state(&vm->scheduler, proc, PROC_EXITED);
     proc->exit_reason = reason;
     proc->exit_message = message ? strdup(message) : NULL;
 
     // Notify parent (supervisor)
     if (proc->parent_pid > 0) {
-        VegaProcess* parent = NULL;
-        for (uint32_t i = 0; i < vm->process_count; i++) {
-            if (vm->processes[i]->pid == proc->parent_pid) {
-                parent = vm->processes[i];
-                break;
-            }
-        }
+        VegaProcess* parent = scheduler_find(&vm->scheduler, proc->parent_pid);
         if (parent && parent->state != PROC_EXITED) {
             process_handle_child_exit(vm, parent, proc->pid, reason);
         }
@@ -136,11 +205,9 @@ void process_exit(VegaVM* vm, VegaProcess* proc, ExitReason reason, const char*
 
     // Exit all children (propagate failure)
     for (uint32_t i = 0; i < proc->child_count; i++) {
-        for (uint32_t j = 0; j < vm->process_count; j++) {
-            if (vm->processes[j]->pid == proc->children[i] &&
-                vm->processes[j]->state != PROC_EXITED) {
-                process_exit(vm, vm->processes[j], EXIT_KILLED, "parent exited");
-            }
+        VegaProcess* child = scheduler_find(&vm->scheduler, proc->children[i]);
+        if (child && child->state != PROC_EXITED) {
+            process_exit(vm, child, EXIT_KILLED, "parent exited");
         }
     }
 }
@@ -163,13 +230,7 @@ uint32_t process_restart(VegaVM* vm, VegaProcess* proc) {
     if (!proc || !process_can_restart(proc)) return 0;
 
     // Find parent
-    VegaProcess* parent = NULL;
-    for (uint32_t i = 0; i < vm->process_count; i++) {
-        if (vm->processes[i]->pid == proc->parent_pid) {
-            parent = vm->processes[i];
-            break;
-        }
-    }
+    VegaProcess* parent = scheduler_find(&vm->scheduler, proc->parent_pid);
 
     // Increment restart count
     proc->supervision.restart_count++;
@@ -216,13 +277,7 @@ void process_handle_child_exit(VegaVM* vm, VegaProcess* supervisor,
     if (!supervisor) return;
 
     // Find the child process
-    VegaProcess* child = NULL;
-    for (uint32_t i = 0; i < vm->process_count; i++) {
-        if (vm->processes[i]->pid == child_pid) {
-            child = vm->processes[i];
-            break;
-        }
-    }
+    VegaProcess* child = scheduler_find(&vm->scheduler, child_pid);
     if (!child) return;
 
     // Normal exit - just clean up
@@ -259,10 +314,9 @@ void process_handle_child_exit(VegaVM* vm, VegaProcess* supervisor,
                     child_pid);
             // Restart all children
             for (uint32_t i = 0; i < supervisor->child_count; i++) {
-                for (uint32_t j = 0; j < vm->process_count; j++) {
-                    if (vm->processes[j]->pid == supervisor->children[i]) {
-                        process_restart(vm, vm->processes[j]);
-                    }
+                VegaProcess* sibling = scheduler_find(&vm->scheduler, supervisor->children[i]);
+                if (sibling) {
+                    process_restart(vm, sibling);
                 }
             }
             break;
@@ -397,19 +451,21 @@ void process_record_failure(VegaProcess* proc) {
 // ============================================================================
 
 void process_push(VegaProcess* proc, Value v) {
-    if (!proc || proc->sp >= PROCESS_STACK_SIZE) return;
+    if (!proc) return;
+    ExecContext* ctx = &proc->context;
+    if (!context_reserve_stack(&ctx->stack, &ctx->stack_capacity, ctx->sp + 1)) return;
     value_retain(v);
-    proc->stack[proc->sp++] = v;
+    proc->context.stack[proc->context.sp++] = v;
 }
 
 Value process_pop(VegaProcess* proc) {
-    if (!proc || proc->sp == 0) return value_null();
-    return proc->stack[--proc->sp];
+    if (!proc || proc->context.sp == 0) return value_null();
+    return proc->context.stack[--proc->context.sp];
 }
 
 Value process_peek(VegaProcess* proc, uint32_t distance) {
-    if (!proc || distance >= proc->sp) return value_null();
-    return proc->stack[proc->sp - 1 - distance];
+    if (!proc || distance >= proc->context.sp) return value_null();
+    return proc->context.stack[proc->context.sp - 1 - distance];
 }
 
 // ============================================================================
@@ -442,8 +498,8 @@ void process_print(VegaProcess* proc) {
     printf("  state: %s\n", state_name(proc->state));
     printf("  parent: %u\n", proc->parent_pid);
     printf("  children: %u\n", proc->child_count);
-    printf("  stack depth: %u\n", proc->sp);
-    printf("  frame count: %u\n", proc->frame_count);
+    printf("  stack depth: %u\n", proc->context.sp);
+    printf("  frame count: %u\n", proc->context.frame_count);
 
     if (proc->state == PROC_EXITED) {
         printf("  exit reason: %s\n", reason_name(proc->exit_reason));
@@ -2,6 +2,7 @@
 #define VEGA_PROCESS_H
 
 #include "value.h"
+#include "timer.h"
 #include "../common/bytecode.h"
 #include <stdint.h>
 #include <stdbool.h>
@@ -17,8 +18,13 @@
 // Constants
 // ============================================================================
 
-#define PROCESS_STACK_SIZE  256
-#define PROCESS_FRAMES_MAX  32
+// Process stacks start small and grow on demand (see context_reserve_stack)
+#define PROCESS_STACK_INITIAL   32
+#define PROCESS_FRAMES_INITIAL  4
+
+// Upper bounds for any execution context; only runaway recursion hits these
+#define CONTEXT_STACK_LIMIT     (1u << 22)
+#define CONTEXT_FRAMES_LIMIT    (1u << 20)
 #define MAX_PROCESSES       1024
 #define MAX_CHILDREN        64
 
@@ -29,7 +35,7 @@
 typedef enum {
     PROC_READY,         // Ready to run
     PROC_RUNNING,       // Currently executing
-    PROC_WAITING,       // Waiting for I/O (agent call)
+    PROC_WAITING,       // Waiting for I/O (agent call), a sleep or a retry
     PROC_EXITED,        // Process has terminated
 } ProcessState;
 
@@ -58,12 +64,30 @@ typedef enum {
     CIRCUIT_HALF_OPEN,      // Testing if service recovered
 } CircuitState;
 
-// Call frame for process-local call stack
+// Call frame (shared by the VM's root context and every process)
 typedef struct {
     uint32_t function_id;
     uint32_t ip;            // Return address
-    uint32_t bp;            // Base pointer
-} ProcessFrame;
+    uint32_t bp;            // Base pointer (stack frame start)
+} CallFrame;
+
+// Execution context: a stack, a call stack and an instruction pointer. The
+// VM runs directly on a context's storage; switching contexts swaps
+// pointers (see vm_switch_context) rather than copying stacks. Both arrays
+// are reallocated as they fill, so positions are kept as indices. A sync
+// send in flight belongs to the context that made it and is swapped with
+// the registers, so a process can be parked on one.
+typedef struct {
+    uint32_t ip;                // Instruction pointer
+    Value* stack;
+    uint32_t sp;                // Stack pointer
+    uint32_t stack_capacity;
+    CallFrame* frames;
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+    struct VegaAgent* waiting_for_agent;  // Sync send in flight
+    Value waiting_msg;
+} ExecContext;
 
 // Supervision configuration
 typedef struct {
@@ -94,14 +118,11 @@ struct VegaVM;
 // Process structure
 typedef struct VegaProcess {
     uint32_t pid;               // Process ID
-    ProcessState state;
+    ProcessState state;         // Scheduled ones move with scheduler_set_state
+    bool scheduled;             // Run by the scheduler (see scheduler_enqueue)
 
-    // Execution state
-    uint32_t ip;                // Instruction pointer
-    Value stack[PROCESS_STACK_SIZE];
-    uint32_t sp;                // Stack pointer
-    ProcessFrame frames[PROCESS_FRAMES_MAX];
-    uint32_t frame_count;
+    // Execution state (swapped in by vm_execute_process)
+    ExecContext context;
 
     // Relationships
     uint32_t parent_pid;        // 0 = no parent (root process)
@@ -122,6 +143,7 @@ typedef struct VegaProcess {
 
     // Waiting state (for async operations)
     void* wait_data;            // Data being waited on (e.g., HTTP response)
+    Timer timer;                // Wakes the process from a sleep
 
 } VegaProcess;
 
@@ -135,6 +157,15 @@ VegaProcess* process_create(struct VegaVM* vm, uint32_t parent_pid);
 // Free a process
 void process_free(VegaProcess* proc);
 
+// Point a process at a function: it starts there with a fresh stack once
+// scheduled and exits when the function returns
+bool process_start_function(struct VegaVM* vm, VegaProcess* proc, uint32_t function_id);
+
+// Grow a context's stack or call stack to hold at least `needed` entries.
+// Returns false past CONTEXT_STACK_LIMIT / CONTEXT_FRAMES_LIMIT.
+bool context_reserve_stack(Value** stack, uint32_t* capacity, uint32_t needed);
+bool context_reserve_frames(CallFrame** frames, uint32_t* capacity, uint32_t needed);
+
 // Spawn a child process for an agent
 uint32_t process_spawn_agent(struct VegaVM* vm, VegaProcess* parent,
                              uint32_t agent_def_id, SupervisionConfig* config);
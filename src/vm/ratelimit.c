@@ -0,0 +1,218 @@
+#include "ratelimit.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define RATE_WINDOW_MS        60000.0   // Limits are per minute
+#define RATE_DEFAULT_BLOCK_MS 1000      // A 429 without retry-after
+#define RATE_CHARS_PER_TOKEN  4
+
+typedef struct {
+    double limit;           // Per minute; 0 = not reported yet (unlimited)
+    double level;           // Available now; output may go negative
+} Bucket;
+
+typedef struct {
+    char* model;
+    Bucket requests;
+    Bucket input;
+    Bucket output;
+    uint64_t refilled_ms;
+    uint64_t blocked_until_ms;
+} ModelLimits;
+
+static struct {
+    ModelLimits* models;
+    uint32_t count;
+    uint32_t capacity;
+} g_limits;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// ============================================================================
+// Buckets
+// ============================================================================
+
+static void bucket_refill(Bucket* b, uint64_t elapsed_ms) {
+    if (b->limit <= 0) return;
+    b->level += b->limit * (double)elapsed_ms / RATE_WINDOW_MS;
+    if (b->level > b->limit) b->level = b->limit;
+}
+
+// Milliseconds until the bucket holds need (0 if it does now). A request
+// larger than the whole bucket waits for a full one.
+static uint64_t bucket_wait(const Bucket* b, double need) {
+    if (b->limit <= 0) return 0;
+    if (need > b->limit) need = b->limit;
+    if (b->level >= need) return 0;
+    return (uint64_t)((need - b->level) * RATE_WINDOW_MS / b->limit) + 1;
+}
+
+static void bucket_take(Bucket* b, double amount) {
+    if (b->limit > 0) b->level -= amount;
+}
+
+// The server's view wins when it is tighter than ours: it also counts
+// traffic from other clients on the same key
+static void bucket_seed(Bucket* b, int64_t limit, int64_t remaining) {
+    if (limit > 0) {
+        if (b->limit <= 0) b->level = (double)limit;
+        b->limit = (double)limit;
+    }
+    if (b->limit > 0 && remaining >= 0 && (double)remaining < b->level) {
+        b->level = (double)remaining;
+    }
+}
+
+static ModelLimits* model_limits(const char* model) {
+    if (!model) model = "";
+    for (uint32_t i = 0; i < g_limits.count; i++) {
+        if (strcmp(g_limits.models[i].model, model) == 0) return &g_limits.models[i];
+    }
+
+    if (g_limits.count >= g_limits.capacity) {
+        uint32_t capacity = g_limits.capacity ? g_limits.capacity * 2 : 4;
+        ModelLimits* models = realloc(g_limits.models, capacity * sizeof(ModelLimits));
+        if (!models) return NULL;
+        g_limits.models = models;
+        g_limits.capacity = capacity;
+    }
+    char* name = strdup(model);
+    if (!name) return NULL;
+
+    ModelLimits* m = &g_limits.models[g_limits.count++];
+    memset(m, 0, sizeof(ModelLimits));
+    m->model = name;
+    m->refilled_ms = now_ms();
+    return m;
+}
+
+static void model_refill(ModelLimits* m, uint64_t now) {
+    uint64_t elapsed = now - m->refilled_ms;
+    m->refilled_ms = now;
+    bucket_refill(&m->requests, elapsed);
+    bucket_refill(&m->input, elapsed);
+    bucket_refill(&m->output, elapsed);
+}
+
+// ============================================================================
+// Headers
+// ============================================================================
+
+void ratelimit_headers_init(RateLimitHeaders* h) {
+    h->requests_limit = h->requests_remaining = -1;
+    h->input_limit = h->input_remaining = -1;
+    h->output_limit = h->output_remaining = -1;
+    h->retry_after_s = -1;
+}
+
+static const struct {
+    const char* name;
+    size_t offset;
+} g_header_fields[] = {
+    { "anthropic-ratelimit-requests-limit",          offsetof(RateLimitHeaders, requests_limit) },
+    { "anthropic-ratelimit-requests-remaining",      offsetof(RateLimitHeaders, requests_remaining) },
+    { "anthropic-ratelimit-input-tokens-limit",      offsetof(RateLimitHeaders, input_limit) },
+    { "anthropic-ratelimit-input-tokens-remaining",  offsetof(RateLimitHeaders, input_remaining) },
+    { "anthropic-ratelimit-output-tokens-limit",     offsetof(RateLimitHeaders, output_limit) },
+    { "anthropic-ratelimit-output-tokens-remaining", offsetof(RateLimitHeaders, output_remaining) },
+    { "retry-after",                                 offsetof(RateLimitHeaders, retry_after_s) },
+};
+
+void ratelimit_header_line(RateLimitHeaders* h, const char* line, size_t len) {
+    const char* colon = memchr(line, ':', len);
+    if (!colon) return;
+    size_t name_len = (size_t)(colon - line);
+
+    for (size_t i = 0; i < sizeof(g_header_fields) / sizeof(g_header_fields[0]); i++) {
+        const char* name = g_header_fields[i].name;
+        if (strlen(name) != name_len || strncasecmp(line, name, name_len) != 0) continue;
+
+        // Integer values only (a retry-after HTTP date is ignored)
+        const char* p = colon + 1;
+        const char* end = line + len;
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        int64_t value = 0;
+        bool digits = false;
+        while (p < end && isdigit((unsigned char)*p)) {
+            value = value * 10 + (*p++ - '0');
+            digits = true;
+        }
+        if (digits) *(int64_t*)((char*)h + g_header_fields[i].offset) = value;
+        return;
+    }
+}
+
+// ============================================================================
+// Admission
+// ============================================================================
+
+uint32_t ratelimit_estimate_input(size_t body_size) {
+    size_t tokens = body_size / RATE_CHARS_PER_TOKEN + 1;
+    return tokens > UINT32_MAX ? UINT32_MAX : (uint32_t)tokens;
+}
+
+uint64_t ratelimit_acquire(const char* model, uint32_t input_estimate) {
+    ModelLimits* m = model_limits(model);
+    if (!m) return 0;
+
+    uint64_t now = now_ms();
+    model_refill(m, now);
+
+    uint64_t wait = m->blocked_until_ms > now ? m->blocked_until_ms - now : 0;
+    uint64_t w;
+    if ((w = bucket_wait(&m->requests, 1)) > wait) wait = w;
+    if ((w = bucket_wait(&m->input, input_estimate)) > wait) wait = w;
+    if ((w = bucket_wait(&m->output, 1)) > wait) wait = w;
+    if (wait > 0) return wait;
+
+    bucket_take(&m->requests, 1);
+    bucket_take(&m->input, input_estimate);
+    return 0;
+}
+
+void ratelimit_complete(const char* model, int status_code, const RateLimitHeaders* h,
+                        uint32_t input_estimate, const HttpTokenUsage* usage) {
+    ModelLimits* m = model_limits(model);
+    if (!m) return;
+
+    uint64_t now = now_ms();
+    model_refill(m, now);
+
+    // Replace the estimate with what was counted (cache reads are free)
+    double input = usage ? (double)usage->input_tokens + usage->cache_write_tokens : 0;
+    bucket_take(&m->input, input - input_estimate);
+    if (usage) bucket_take(&m->output, usage->output_tokens);
+
+    if (h) {
+        bucket_seed(&m->requests, h->requests_limit, h->requests_remaining);
+        bucket_seed(&m->input, h->input_limit, h->input_remaining);
+        bucket_seed(&m->output, h->output_limit, h->output_remaining);
+    }
+
+    uint64_t block_ms = 0;
+    if (h && h->retry_after_s >= 0) {
+        block_ms = (uint64_t)h->retry_after_s * 1000;
+    } else if (status_code == 429) {
+        block_ms = RATE_DEFAULT_BLOCK_MS;
+    }
+    if (block_ms > 0 && now + block_ms > m->blocked_until_ms) {
+        m->blocked_until_ms = now + block_ms;
+    }
+}
+
+void ratelimit_cleanup(void) {
+    for (uint32_t i = 0; i < g_limits.count; i++) {
+        free(g_limits.models[i].model);
+    }
+    free(g_limits.models);
+    g_limits.models = NULL;
+    g_limits.count = 0;
+    g_limits.capacity = 0;
+}
@@ -0,0 +1,58 @@
+#ifndef VEGA_RATELIMIT_H
+#define VEGA_RATELIMIT_H
+
+#include "http.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Vega Client-Side Rate Limiter
+ *
+ * One set of token buckets per model: requests, input tokens and output
+ * tokens per minute, each refilling continuously at limit / 60 per second.
+ * A bucket has no limit until a response reports one through the
+ * anthropic-ratelimit-* headers, which also pull its level down to what
+ * the server says remains. A retry-after header (or a 429 without one)
+ * blocks the model outright until it passes.
+ *
+ * The HTTP engine asks before dispatching each request and holds it back
+ * while its model is over a limit, so concurrent agents queue behind the
+ * limit instead of all retrying into it. Input tokens are estimated from
+ * the body size at dispatch and corrected with the reported usage;
+ * output tokens are charged when the response arrives.
+ *
+ * Engine thread only; there is no locking.
+ */
+
+// Rate limit headers of one response (-1 where absent)
+typedef struct {
+    int64_t requests_limit;
+    int64_t requests_remaining;
+    int64_t input_limit;
+    int64_t input_remaining;
+    int64_t output_limit;
+    int64_t output_remaining;
+    int64_t retry_after_s;
+} RateLimitHeaders;
+
+void ratelimit_headers_init(RateLimitHeaders* h);
+
+// Feed one raw header line ("name: value\r\n"); others are ignored
+void ratelimit_header_line(RateLimitHeaders* h, const char* line, size_t len);
+
+// Input tokens a body of body_size bytes is charged at dispatch
+uint32_t ratelimit_estimate_input(size_t body_size);
+
+// Admit a request for model, charging one request and input_estimate
+// tokens. Returns 0 when admitted, else the milliseconds to wait.
+uint64_t ratelimit_acquire(const char* model, uint32_t input_estimate);
+
+// Account a finished request: seed the buckets from its headers and
+// replace the input estimate with the reported usage (NULL if none)
+void ratelimit_complete(const char* model, int status_code, const RateLimitHeaders* h,
+                        uint32_t input_estimate, const HttpTokenUsage* usage);
+
+void ratelimit_cleanup(void);
+
+#endif // VEGA_RATELIMIT_H
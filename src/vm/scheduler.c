@@ -1,7 +1,9 @@
 #include "scheduler.h"
 #include "vm.h"
+#include "http.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 // ============================================================================
 // Queue Operations
@@ -70,31 +72,78 @@ void scheduler_init(Scheduler* sched, VegaProcess** processes, uint32_t* count)
     sched->processes = processes;
     sched->process_count = count;
     sched->current = NULL;
+    sched->by_pid = NULL;
+    sched->by_pid_capacity = 0;
+    sched->ready_count = 0;
+    sched->waiting_count = 0;
     sched->context_switches = 0;
     sched->processes_spawned = 0;
     sched->processes_exited = 0;
 
     queue_init(&sched->ready_queue, 64);
+    timer_wheel_init(&sched->timers);
 }
 
 void scheduler_cleanup(Scheduler* sched) {
     queue_free(&sched->ready_queue);
+    timer_wheel_cleanup(&sched->timers);
+    free(sched->by_pid);
+    sched->by_pid = NULL;
+    sched->by_pid_capacity = 0;
     sched->processes = NULL;
     sched->process_count = NULL;
     sched->current = NULL;
 }
 
 // ============================================================================
-// Process Lookup
+// Process Table
 // ============================================================================
 
-static VegaProcess* find_process(Scheduler* sched, uint32_t pid) {
-    for (uint32_t i = 0; i < *sched->process_count; i++) {
-        if (sched->processes[i]->pid == pid) {
-            return sched->processes[i];
-        }
+bool scheduler_add(Scheduler* sched, VegaProcess* proc) {
+    if (*sched->process_count >= MAX_PROCESSES) return false;
+
+    if (proc->pid >= sched->by_pid_capacity) {
+        uint32_t capacity = sched->by_pid_capacity ? sched->by_pid_capacity : 64;
+        while (capacity <= proc->pid) capacity *= 2;
+        VegaProcess** by_pid = realloc(sched->by_pid, capacity * sizeof(VegaProcess*));
+        if (!by_pid) return false;
+        memset(by_pid + sched->by_pid_capacity, 0,
+               (capacity - sched->by_pid_capacity) * sizeof(VegaProcess*));
+        sched->by_pid = by_pid;
+        sched->by_pid_capacity = capacity;
+    }
+
+    sched->by_pid[proc->pid] = proc;
+    sched->processes[(*sched->process_count)++] = proc;
+    sched->processes_spawned++;
+    return true;
+}
+
+VegaProcess* scheduler_find(Scheduler* sched, uint32_t pid) {
+    return pid < sched->by_pid_capacity ? sched->by_pid[pid] : NULL;
+}
+
+// The count a state is tallied in (running and exited ones aren't)
+static uint32_t* state_count(Scheduler* sched, ProcessState state) {
+    switch (state) {
+        case PROC_READY:   return &sched->ready_count;
+        case PROC_WAITING: return &sched->waiting_count;
+        default:           return NULL;
+    }
+}
+
+void scheduler_set_state(Scheduler* sched, VegaProcess* proc, ProcessState state) {
+    if (proc->scheduled && proc->state != state) {
+        uint32_t* from = state_count(sched, proc->state);
+        uint32_t* to = state_count(sched, state);
+        if (from) (*from)--;
+        if (to) (*to)++;
+        if (state == PROC_EXITED) sched->processes_exited++;
+    }
+    proc->state = state;
+    if (state == PROC_EXITED && sched->current == proc) {
+        sched->current = NULL;
     }
-    return NULL;
 }
 
 // ============================================================================
@@ -102,11 +151,13 @@ static VegaProcess* find_process(Scheduler* sched, uint32_t pid) {
 // ============================================================================
 
 void scheduler_enqueue(Scheduler* sched, uint32_t pid) {
-    VegaProcess* proc = find_process(sched, pid);
-    if (!proc) return;
+    VegaProcess* proc = scheduler_find(sched, pid);
+    if (!proc || proc->scheduled) return;
 
     // Only enqueue if ready
     if (proc->state == PROC_READY) {
+        proc->scheduled = true;
+        sched->ready_count++;
         queue_push(&sched->ready_queue, pid);
     }
 }
@@ -116,9 +167,9 @@ VegaProcess* scheduler_next(Scheduler* sched) {
 
     // Find next ready process
     while (queue_pop(&sched->ready_queue, &pid)) {
-        VegaProcess* proc = find_process(sched, pid);
+        VegaProcess* proc = scheduler_find(sched, pid);
         if (proc && proc->state == PROC_READY) {
-            proc->state = PROC_RUNNING;
+            scheduler_set_state(sched, proc, PROC_RUNNING);
             sched->current = proc;
             sched->context_switches++;
             return proc;
@@ -135,7 +186,7 @@ void scheduler_yield(Scheduler* sched) {
 
     VegaProcess* proc = sched->current;
     if (proc->state == PROC_RUNNING) {
-        proc->state = PROC_READY;
+        scheduler_set_state(sched, proc, PROC_READY);
         queue_push(&sched->ready_queue, proc->pid);
     }
     sched->current = NULL;
@@ -146,30 +197,39 @@ void scheduler_block(Scheduler* sched) {
 
     VegaProcess* proc = sched->current;
     if (proc->state == PROC_RUNNING) {
-        proc->state = PROC_WAITING;
+        scheduler_set_state(sched, proc, PROC_WAITING);
     }
     sched->current = NULL;
 }
 
-void scheduler_unblock(Scheduler* sched, uint32_t pid) {
-    VegaProcess* proc = find_process(sched, pid);
+static void process_wake(VegaVM* vm, Timer* timer) {
+    VegaProcess* proc = timer->owner;
+    scheduler_unblock(&vm->scheduler, proc->pid);
+}
+
+void scheduler_sleep(Scheduler* sched, uint64_t deadline) {
+    VegaProcess* proc = sched->current;
     if (!proc) return;
 
-    if (proc->state == PROC_WAITING) {
-        proc->state = PROC_READY;
+    scheduler_block(sched);
+    timer_init(&proc->timer, process_wake, proc);
+    timer_arm(&sched->timers, &proc->timer, deadline);
+}
+
+void scheduler_unblock(Scheduler* sched, uint32_t pid) {
+    VegaProcess* proc = scheduler_find(sched, pid);
+    if (!proc || !proc->scheduled) return;
+
+    // A sleeping process is woken only by its timer; a late completion
+    // of something it no longer waits on must not cut the sleep short
+    if (proc->state == PROC_WAITING && !timer_armed(&proc->timer)) {
+        scheduler_set_state(sched, proc, PROC_READY);
         queue_push(&sched->ready_queue, pid);
     }
 }
 
 bool scheduler_has_runnable(Scheduler* sched) {
-    // Check if any process is ready or running
-    for (uint32_t i = 0; i < *sched->process_count; i++) {
-        ProcessState state = sched->processes[i]->state;
-        if (state == PROC_READY || state == PROC_RUNNING || state == PROC_WAITING) {
-            return true;
-        }
-    }
-    return false;
+    return sched->current || sched->ready_count > 0 || sched->waiting_count > 0;
 }
 
 VegaProcess* scheduler_current(Scheduler* sched) {
@@ -180,6 +240,30 @@ VegaProcess* scheduler_current(Scheduler* sched) {
 // Main Run Loop
 // ============================================================================
 
+// Longest sleep with nothing ready and no timer due. Every wake-up comes
+// with an HTTP event or a timer, so this only bounds a missed one.
+#define SCHEDULER_WAIT_MS 1000
+
+// Nothing is ready: sleep until a request moves or a timer is due, then
+// let the VM wake the processes waiting on them
+static void scheduler_wait(VegaVM* vm) {
+    Scheduler* sched = &vm->scheduler;
+
+    // Anything that lands after this read ends the wait
+    uint64_t seen = http_async_events();
+    vm_poll_events(vm);
+    if (sched->ready_count > 0) return;
+
+    uint64_t timeout = SCHEDULER_WAIT_MS;
+    uint64_t next = timer_wheel_next_tick(&sched->timers);
+    if (next != UINT64_MAX) {
+        uint64_t now = timer_now_ms();
+        if (next <= now) return;
+        if (next - now < timeout) timeout = next - now;
+    }
+    http_async_wait(seen, (int)timeout);
+}
+
 void scheduler_run(VegaVM* vm) {
     Scheduler* sched = &vm->scheduler;
 
@@ -187,17 +271,13 @@ void scheduler_run(VegaVM* vm) {
         // Get next process to run
         VegaProcess* proc = scheduler_next(sched);
         if (!proc) {
-            // No ready processes, but some are waiting
-            // In real implementation, would poll I/O here
-            break;
+            scheduler_wait(vm);
+            continue;
         }
 
-        // Execute process until it yields or exits
-        // This will be implemented in vm.c
+        // Execute process until it yields, blocks or exits; the state
+        // updates happen in the yield/block/exit functions
         vm_execute_process(vm, proc);
-
-        // Process may have yielded, blocked, or exited
-        // State updates happen in the yield/block/exit functions
     }
 }
 
@@ -211,6 +291,8 @@ void scheduler_print(Scheduler* sched) {
     printf("  processes spawned: %llu\n", (unsigned long long)sched->processes_spawned);
     printf("  processes exited: %llu\n", (unsigned long long)sched->processes_exited);
     printf("  ready queue size: %u\n", sched->ready_queue.count);
+    printf("  ready / waiting: %u / %u\n", sched->ready_count, sched->waiting_count);
+    printf("  armed timers: %u\n", sched->timers.count);
     printf("  current process: %s\n",
            sched->current ? "yes" : "none");
 
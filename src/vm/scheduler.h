@@ -2,6 +2,7 @@
 #define VEGA_SCHEDULER_H
 
 #include "process.h"
+#include "timer.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -10,6 +11,12 @@
  *
  * Cooperative scheduler for lightweight processes.
  * Processes yield at await points (agent calls, sleep, explicit yield).
+ *
+ * A process that waits is parked (PROC_WAITING) and woken by pid when its
+ * wait ends: a sync send's requests are tagged with the pid, a future
+ * remembers the process awaiting it, and a sleep is a timer on the
+ * scheduler's wheel (see timer.h). When nothing is ready the run loop
+ * sleeps on the HTTP engine's events and the next timer.
  */
 
 // ============================================================================
@@ -38,6 +45,19 @@ typedef struct Scheduler {
     // Current process
     VegaProcess* current;
 
+    // Processes by pid (pids are never reused)
+    VegaProcess** by_pid;
+    uint32_t by_pid_capacity;
+
+    // Scheduled processes by state, kept as they move so the run loop
+    // never scans the table. An agent's supervision record is never run
+    // by the scheduler, so it isn't counted.
+    uint32_t ready_count;
+    uint32_t waiting_count;
+
+    // Timers of sleeping processes, retry backoffs and request deadlines
+    TimerWheel timers;
+
     // Stats
     uint64_t context_switches;
     uint64_t processes_spawned;
@@ -55,7 +75,16 @@ void scheduler_init(Scheduler* sched, VegaProcess** processes, uint32_t* count);
 // Cleanup scheduler
 void scheduler_cleanup(Scheduler* sched);
 
-// Add process to ready queue
+// Add a process to the process table; false if the table is full
+bool scheduler_add(Scheduler* sched, VegaProcess* proc);
+
+// Look up a process by pid (NULL if there is none)
+VegaProcess* scheduler_find(Scheduler* sched, uint32_t pid);
+
+// Move a process to another state, keeping the counts
+void scheduler_set_state(Scheduler* sched, VegaProcess* proc, ProcessState state);
+
+// Start scheduling a process: add it to the ready queue
 void scheduler_enqueue(Scheduler* sched, uint32_t pid);
 
 // Get next process to run (returns NULL if none ready)
@@ -67,13 +96,17 @@ void scheduler_yield(Scheduler* sched);
 // Block current process (waiting for I/O)
 void scheduler_block(Scheduler* sched);
 
-// Unblock a process (I/O completed)
+// Block the current process until deadline (timer_now_ms clock)
+void scheduler_sleep(Scheduler* sched, uint64_t deadline);
+
+// Unblock a process (I/O completed). A spurious wake-up is harmless: a
+// process replays its wait and blocks again if it isn't over.
 void scheduler_unblock(Scheduler* sched, uint32_t pid);
 
 // Run scheduler loop until all processes exit
 void scheduler_run(struct VegaVM* vm);
 
-// Check if any processes are still running
+// Check if any scheduled process is ready, running or waiting
 bool scheduler_has_runnable(Scheduler* sched);
 
 // Get current process
@@ -0,0 +1,407 @@
+#include "sse.h"
+#include "message.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// ============================================================================
+// Buffers
+// ============================================================================
+
+static bool buf_append(char** data, size_t* len, size_t* capacity,
+                       const char* src, size_t n) {
+    if (*len + n + 1 > *capacity) {
+        size_t new_capacity = *capacity ? *capacity : 64;
+        while (*len + n + 1 > new_capacity) new_capacity *= 2;
+        char* grown = realloc(*data, new_capacity);
+        if (!grown) return false;
+        *data = grown;
+        *capacity = new_capacity;
+    }
+    memcpy(*data + *len, src, n);
+    *len += n;
+    (*data)[*len] = '\0';
+    return true;
+}
+
+// ============================================================================
+// JSON Scanning
+// ============================================================================
+
+// Event payloads are single small objects, so fields are found by scanning
+// for "key": — a quoted key followed by a colon cannot occur inside a
+// string value, where the quotes would be escaped.
+
+// Returns the value following "key": at or after json, or NULL
+static const char* json_field(const char* json, const char* key) {
+    if (!json) return NULL;
+    size_t key_len = strlen(key);
+    for (const char* p = json; (p = strchr(p, '"')); p++) {
+        if (strncmp(p + 1, key, key_len) != 0 || p[key_len + 1] != '"') continue;
+        const char* v = p + key_len + 2;
+        while (*v == ' ' || *v == '\t') v++;
+        if (*v != ':') continue;
+        v++;
+        while (*v == ' ' || *v == '\t') v++;
+        return v;
+    }
+    return NULL;
+}
+
+// Contents of the string value at p, still escaped
+static bool json_raw_string(const char* p, const char** start, size_t* len) {
+    if (!p || *p != '"') return false;
+    const char* s = ++p;
+    while (*p && *p != '"') {
+        if (*p == '\\' && p[1]) p++;
+        p++;
+    }
+    if (*p != '"') return false;
+    *start = s;
+    *len = (size_t)(p - s);
+    return true;
+}
+
+static bool json_string_is(const char* p, const char* expected) {
+    const char* s;
+    size_t len;
+    return json_raw_string(p, &s, &len) &&
+           len == strlen(expected) && memcmp(s, expected, len) == 0;
+}
+
+static uint32_t json_u32(const char* json, const char* key, uint32_t fallback) {
+    const char* v = json_field(json, key);
+    if (!v || *v < '0' || *v > '9') return fallback;
+    return (uint32_t)strtoul(v, NULL, 10);
+}
+
+// Append text as JSON string contents, escaping only what JSON requires.
+// Non-ASCII stays UTF-8, which the response helpers read verbatim.
+static bool buf_append_escaped(char** data, size_t* len, size_t* capacity,
+                               const char* text, size_t n) {
+    size_t run = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)text[i];
+        char esc[8];
+        size_t esc_len = 0;
+        if (c == '"' || c == '\\') {
+            esc[0] = '\\';
+            esc[1] = (char)c;
+            esc_len = 2;
+        } else if (c == '\n') {
+            memcpy(esc, "\\n", 2);
+            esc_len = 2;
+        } else if (c == '\r') {
+            memcpy(esc, "\\r", 2);
+            esc_len = 2;
+        } else if (c == '\t') {
+            memcpy(esc, "\\t", 2);
+            esc_len = 2;
+        } else if (c < 0x20) {
+            esc_len = (size_t)snprintf(esc, sizeof(esc), "\\u%04x", c);
+        } else {
+            continue;
+        }
+        if (!buf_append(data, len, capacity, text + run, i - run) ||
+            !buf_append(data, len, capacity, esc, esc_len)) {
+            return false;
+        }
+        run = i + 1;
+    }
+    return buf_append(data, len, capacity, text + run, n - run);
+}
+
+static char* raw_dup(const char* p) {
+    const char* s;
+    size_t len;
+    if (!json_raw_string(p, &s, &len)) return NULL;
+    return strndup(s, len);
+}
+
+// ============================================================================
+// Events
+// ============================================================================
+
+static SseBlock* block_at(SseDecoder* dec, const char* data) {
+    const char* v = json_field(data, "index");
+    if (!v || *v < '0' || *v > '9') return NULL;
+    unsigned long index = strtoul(v, NULL, 10);
+    if (index >= 1024) return NULL;
+
+    if (index >= dec->block_count) {
+        SseBlock* grown = realloc(dec->blocks, (index + 1) * sizeof(SseBlock));
+        if (!grown) {
+            dec->failed = true;
+            return NULL;
+        }
+        memset(grown + dec->block_count, 0,
+               (index + 1 - dec->block_count) * sizeof(SseBlock));
+        dec->blocks = grown;
+        dec->block_count = (uint32_t)index + 1;
+    }
+    return &dec->blocks[index];
+}
+
+static void block_append(SseDecoder* dec, SseBlock* block, const char* p) {
+    const char* s;
+    size_t len;
+    if (!json_raw_string(p, &s, &len) || len == 0) return;
+    if (!buf_append(&block->raw, &block->len, &block->capacity, s, len)) {
+        dec->failed = true;
+    }
+}
+
+static void read_usage(SseDecoder* dec, const char* usage) {
+    if (!usage) return;
+    dec->input_tokens = json_u32(usage, "input_tokens", dec->input_tokens);
+    dec->output_tokens = json_u32(usage, "output_tokens", dec->output_tokens);
+    dec->cache_read_tokens = json_u32(usage, "cache_read_input_tokens", dec->cache_read_tokens);
+    dec->cache_write_tokens = json_u32(usage, "cache_creation_input_tokens", dec->cache_write_tokens);
+}
+
+static void emit_text(SseDecoder* dec, const char* p) {
+    const char* s;
+    size_t len;
+    if (!dec->on_text || !json_raw_string(p, &s, &len) || len == 0) return;
+
+    char stack_buf[512];
+    char* text = len < sizeof(stack_buf) ? stack_buf : malloc(len + 1);
+    if (!text) return;
+    size_t text_len = json_unescape(s, len, text);
+    text[text_len] = '\0';
+    dec->on_text(dec->userdata, text, text_len);
+    if (text != stack_buf) free(text);
+}
+
+static void dispatch(SseDecoder* dec) {
+    const char* data = dec->data;
+    if (!data || dec->data_len == 0) return;
+
+    // Proxies may drop "event:" lines; the payload carries its type too
+    char type[32];
+    if (dec->event[0]) {
+        snprintf(type, sizeof(type), "%s", dec->event);
+    } else {
+        const char* s;
+        size_t len;
+        if (!json_raw_string(json_field(data, "type"), &s, &len) || len >= sizeof(type)) return;
+        memcpy(type, s, len);
+        type[len] = '\0';
+    }
+
+    if (strcmp(type, "content_block_delta") == 0) {
+        SseBlock* block = block_at(dec, data);
+        const char* delta = json_field(data, "delta");
+        if (!block || !delta) return;
+        const char* text = json_field(delta, "text");
+        if (json_string_is(json_field(delta, "type"), "text_delta") && text) {
+            block_append(dec, block, text);
+            emit_text(dec, text);
+        } else if (json_string_is(json_field(delta, "type"), "input_json_delta")) {
+            block_append(dec, block, json_field(delta, "partial_json"));
+        }
+    } else if (strcmp(type, "content_block_start") == 0) {
+        SseBlock* block = block_at(dec, data);
+        const char* cb = json_field(data, "content_block");
+        if (!block || !cb) return;
+        if (json_string_is(json_field(cb, "type"), "tool_use")) {
+            block->tool_use = true;
+            free(block->id);
+            free(block->name);
+            block->id = raw_dup(json_field(cb, "id"));
+            block->name = raw_dup(json_field(cb, "name"));
+        } else {
+            const char* text = json_field(cb, "text");
+            block_append(dec, block, text);
+            emit_text(dec, text);
+        }
+    } else if (strcmp(type, "message_start") == 0) {
+        read_usage(dec, json_field(data, "usage"));
+    } else if (strcmp(type, "message_delta") == 0) {
+        const char* delta = json_field(data, "delta");
+        char* stop = raw_dup(json_field(delta, "stop_reason"));
+        if (stop) {
+            free(dec->stop_reason);
+            dec->stop_reason = stop;
+        }
+        read_usage(dec, json_field(data, "usage"));
+    } else if (strcmp(type, "error") == 0) {
+        free(dec->error);
+        dec->error = strndup(data, dec->data_len);
+        const char* s;
+        size_t len;
+        if (json_raw_string(json_field(json_field(data, "error"), "type"), &s, &len) &&
+            len < sizeof(dec->error_type)) {
+            memcpy(dec->error_type, s, len);
+            dec->error_type[len] = '\0';
+        }
+    }
+    // ping, content_block_stop and message_stop carry nothing we keep
+}
+
+static void handle_line(SseDecoder* dec, const char* line, size_t len) {
+    if (len > 0 && line[len - 1] == '\r') len--;
+
+    if (len == 0) {
+        dispatch(dec);
+        dec->event[0] = '\0';
+        dec->data_len = 0;
+        if (dec->data) dec->data[0] = '\0';
+        return;
+    }
+    if (line[0] == ':') return;  // Comment / keep-alive
+
+    const char* colon = memchr(line, ':', len);
+    size_t field_len = colon ? (size_t)(colon - line) : len;
+    const char* value = colon ? colon + 1 : line + len;
+    if (value < line + len && *value == ' ') value++;
+    size_t value_len = (size_t)(line + len - value);
+
+    if (field_len == 5 && memcmp(line, "event", 5) == 0) {
+        if (value_len >= sizeof(dec->event)) value_len = sizeof(dec->event) - 1;
+        memcpy(dec->event, value, value_len);
+        dec->event[value_len] = '\0';
+    } else if (field_len == 4 && memcmp(line, "data", 4) == 0) {
+        if ((dec->data_len > 0 &&
+             !buf_append(&dec->data, &dec->data_len, &dec->data_capacity, "\n", 1)) ||
+            !buf_append(&dec->data, &dec->data_len, &dec->data_capacity, value, value_len)) {
+            dec->failed = true;
+        }
+    }
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+void sse_init(SseDecoder* dec, SseTextFn on_text, void* userdata) {
+    memset(dec, 0, sizeof(*dec));
+    dec->on_text = on_text;
+    dec->userdata = userdata;
+}
+
+bool sse_feed(SseDecoder* dec, const char* data, size_t len) {
+    const char* end = data + len;
+    while (data < end && !dec->failed) {
+        const char* nl = memchr(data, '\n', (size_t)(end - data));
+        if (!nl) {
+            // Partial line; finish it on the next feed
+            if (!buf_append(&dec->line, &dec->line_len, &dec->line_capacity,
+                            data, (size_t)(end - data))) {
+                dec->failed = true;
+            }
+            break;
+        }
+        if (dec->line_len > 0) {
+            if (!buf_append(&dec->line, &dec->line_len, &dec->line_capacity,
+                            data, (size_t)(nl - data))) {
+                dec->failed = true;
+                break;
+            }
+            handle_line(dec, dec->line, dec->line_len);
+            dec->line_len = 0;
+        } else {
+            handle_line(dec, data, (size_t)(nl - data));
+        }
+        data = nl + 1;
+    }
+    return !dec->failed;
+}
+
+char* sse_finish(SseDecoder* dec) {
+    // A stream cut off without its trailing blank line still counts
+    if (dec->line_len > 0) {
+        handle_line(dec, dec->line, dec->line_len);
+        dec->line_len = 0;
+    }
+    handle_line(dec, "", 0);
+    if (dec->failed) return NULL;
+    if (dec->error) return strdup(dec->error);
+
+    char* out = NULL;
+    size_t len = 0;
+    size_t capacity = 0;
+    bool ok = true;
+#define OUT(s, n) (ok = ok && buf_append(&out, &len, &capacity, (s), (n)))
+#define OUT_STR(s) OUT((s), strlen(s))
+
+    OUT_STR("{\"type\":\"message\",\"role\":\"assistant\",\"content\":[");
+    bool first = true;
+    for (uint32_t i = 0; i < dec->block_count; i++) {
+        SseBlock* block = &dec->blocks[i];
+        if (!block->tool_use && block->len == 0) continue;
+        if (!first) OUT_STR(",");
+        first = false;
+
+        if (block->tool_use) {
+            OUT_STR("{\"type\":\"tool_use\",\"id\":\"");
+            OUT_STR(block->id ? block->id : "");
+            OUT_STR("\",\"name\":\"");
+            OUT_STR(block->name ? block->name : "");
+            OUT_STR("\",\"input\":");
+            if (block->len > 0) {
+                // partial_json fragments concatenate to the escaped input
+                char* input = malloc(block->len + 1);
+                if (!input) {
+                    ok = false;
+                } else {
+                    size_t input_len = json_unescape(block->raw, block->len, input);
+                    OUT(input, input_len);
+                    free(input);
+                }
+            } else {
+                OUT_STR("{}");
+            }
+            OUT_STR("}");
+        } else {
+            OUT_STR("{\"type\":\"text\",\"text\":\"");
+            char* text = malloc(block->len + 1);
+            if (!text) {
+                ok = false;
+            } else {
+                size_t text_len = json_unescape(block->raw, block->len, text);
+                ok = ok && buf_append_escaped(&out, &len, &capacity, text, text_len);
+                free(text);
+            }
+            OUT_STR("\"}");
+        }
+    }
+
+    char tail[256];
+    if (dec->stop_reason) {
+        OUT_STR("],\"stop_reason\":\"");
+        OUT_STR(dec->stop_reason);
+        OUT_STR("\"");
+    } else {
+        OUT_STR("],\"stop_reason\":null");
+    }
+    snprintf(tail, sizeof(tail),
+             ",\"usage\":{\"input_tokens\":%u,\"output_tokens\":%u,"
+             "\"cache_creation_input_tokens\":%u,\"cache_read_input_tokens\":%u}}",
+             dec->input_tokens, dec->output_tokens,
+             dec->cache_write_tokens, dec->cache_read_tokens);
+    OUT_STR(tail);
+
+#undef OUT_STR
+#undef OUT
+
+    if (!ok) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+void sse_free(SseDecoder* dec) {
+    for (uint32_t i = 0; i < dec->block_count; i++) {
+        free(dec->blocks[i].id);
+        free(dec->blocks[i].name);
+        free(dec->blocks[i].raw);
+    }
+    free(dec->blocks);
+    free(dec->line);
+    free(dec->data);
+    free(dec->stop_reason);
+    free(dec->error);
+    memset(dec, 0, sizeof(*dec));
+}
@@ -0,0 +1,68 @@
+#ifndef VEGA_SSE_H
+#define VEGA_SSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Vega SSE Decoder
+ *
+ * Incremental decoder for streamed Messages API responses
+ * ("stream": true). Bytes are fed as they come off the socket, in chunks of
+ * any size. Each complete event is folded into the message it describes,
+ * and text deltas are handed to a callback as soon as they are decoded.
+ * sse_finish rebuilds the body the non-streamed API would have returned, so
+ * the response helpers in http.h work unchanged on streamed replies.
+ */
+
+// Called with each decoded (unescaped) text delta
+typedef void (*SseTextFn)(void* userdata, const char* text, size_t len);
+
+typedef struct {
+    bool tool_use;              // tool_use block (else text)
+    char* id;                   // tool_use id
+    char* name;                 // tool_use name
+    char* raw;                  // Text or partial_json, still JSON-escaped
+    size_t len;
+    size_t capacity;
+} SseBlock;
+
+typedef struct {
+    // Event assembly
+    char* line;
+    size_t line_len;
+    size_t line_capacity;
+    char event[32];             // Current "event:" name
+    char* data;                 // Current "data:" payload
+    size_t data_len;
+    size_t data_capacity;
+
+    // Message being rebuilt
+    SseBlock* blocks;
+    uint32_t block_count;
+    char* stop_reason;
+    char* error;                // Raw "error" event payload
+    char error_type[64];        // error.type of that payload
+    uint32_t input_tokens;
+    uint32_t output_tokens;
+    uint32_t cache_read_tokens;
+    uint32_t cache_write_tokens;
+    bool failed;                // Out of memory; the stream is unusable
+
+    SseTextFn on_text;
+    void* userdata;
+} SseDecoder;
+
+void sse_init(SseDecoder* dec, SseTextFn on_text, void* userdata);
+
+// Feed raw response bytes. Returns false once the decoder has failed.
+bool sse_feed(SseDecoder* dec, const char* data, size_t len);
+
+// Build the equivalent non-streamed response body (caller frees). An error
+// event yields its payload unchanged. Returns NULL on allocation failure.
+char* sse_finish(SseDecoder* dec);
+
+void sse_free(SseDecoder* dec);
+
+#endif // VEGA_SSE_H
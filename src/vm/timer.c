@@ -0,0 +1,166 @@
+#include "timer.h"
+#include <string.h>
+#include <time.h>
+
+#define TIMER_WHEEL_MASK    (TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level)  ((level) * TIMER_WHEEL_BITS)
+#define WHEEL_SPAN          ((uint64_t)1 << LEVEL_SHIFT(TIMER_WHEEL_LEVELS))
+
+uint64_t timer_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// ============================================================================
+// Slot Lists
+// ============================================================================
+
+static void slot_push(Timer** slot, Timer* timer) {
+    timer->next = *slot;
+    if (*slot) (*slot)->pprev = &timer->next;
+    *slot = timer;
+    timer->pprev = slot;
+}
+
+static void slot_unlink(Timer* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// File a timer under the lowest level whose span reaches its deadline,
+// counted from the wheel's clock. Timers due by `earliest` go in its level
+// 0 slot: during a cascade that is the tick being fired, from timer_arm
+// the next one.
+static void wheel_place(TimerWheel* wheel, Timer* timer, uint64_t earliest) {
+    uint64_t at = timer->deadline > earliest ? timer->deadline : earliest;
+    if (at - wheel->now >= WHEEL_SPAN) {
+        at = wheel->now + WHEEL_SPAN - 1;  // Re-placed when the top level reaches it
+    }
+
+    uint64_t delta = at - wheel->now;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= ((uint64_t)1 << LEVEL_SHIFT(level + 1))) {
+        level++;
+    }
+    slot_push(&wheel->slots[level][(at >> LEVEL_SHIFT(level)) & TIMER_WHEEL_MASK], timer);
+}
+
+// ============================================================================
+// Wheel Lifecycle
+// ============================================================================
+
+void timer_wheel_init(TimerWheel* wheel) {
+    memset(wheel->slots, 0, sizeof(wheel->slots));
+    wheel->now = timer_now_ms();
+    wheel->count = 0;
+}
+
+void timer_wheel_cleanup(TimerWheel* wheel) {
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (uint32_t i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            while (wheel->slots[level][i]) {
+                Timer* timer = wheel->slots[level][i];
+                slot_unlink(timer);
+                timer->wheel = NULL;
+            }
+        }
+    }
+    wheel->count = 0;
+}
+
+// ============================================================================
+// Timers
+// ============================================================================
+
+void timer_init(Timer* timer, TimerFn fire, void* owner) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->wheel = NULL;
+    timer->deadline = 0;
+    timer->fire = fire;
+    timer->owner = owner;
+}
+
+void timer_arm(TimerWheel* wheel, Timer* timer, uint64_t deadline) {
+    timer_cancel(timer);
+
+    // The wheel's clock may lag (an idle wheel isn't advanced): the timer
+    // then starts on a higher level and advancing skips the empty ticks
+    timer->deadline = deadline;
+    timer->wheel = wheel;
+    wheel_place(wheel, timer, wheel->now + 1);
+    wheel->count++;
+}
+
+void timer_cancel(Timer* timer) {
+    if (!timer->pprev) return;
+    slot_unlink(timer);
+    timer->wheel->count--;
+    timer->wheel = NULL;
+}
+
+// ============================================================================
+// Advancing
+// ============================================================================
+
+uint64_t timer_wheel_next_tick(const TimerWheel* wheel) {
+    if (wheel->count == 0) return UINT64_MAX;
+
+    // The first occupied slot ahead on each level: level 0 slots fire at
+    // their tick, higher ones cascade at the start of their block
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t block = wheel->now >> LEVEL_SHIFT(level);
+        for (uint32_t i = 1; i <= TIMER_WHEEL_SLOTS; i++) {
+            if (wheel->slots[level][(block + i) & TIMER_WHEEL_MASK]) {
+                uint64_t tick = (block + i) << LEVEL_SHIFT(level);
+                if (tick < next) next = tick;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+void timer_wheel_advance(TimerWheel* wheel, uint64_t now, struct VegaVM* vm) {
+    while (wheel->now < now) {
+        // Skip straight to the next tick with work on it
+        uint64_t tick = timer_wheel_next_tick(wheel);
+        if (tick > now) {
+            wheel->now = now;
+            return;
+        }
+        wheel->now = tick;
+
+        // Cascade from the top down: a timer moving down may land in the
+        // lower level slot that is cascaded next
+        for (int level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+            uint64_t span = (uint64_t)1 << LEVEL_SHIFT(level);
+            if (tick & (span - 1)) continue;
+
+            Timer** slot = &wheel->slots[level][(tick >> LEVEL_SHIFT(level)) & TIMER_WHEEL_MASK];
+            Timer* list = *slot;
+            *slot = NULL;
+            while (list) {
+                Timer* timer = list;
+                list = timer->next;
+                wheel_place(wheel, timer, tick);
+            }
+        }
+
+        // Fire the tick's slot. Callbacks may arm or cancel timers; those
+        // armed now land on a later tick.
+        Timer** slot = &wheel->slots[0][tick & TIMER_WHEEL_MASK];
+        while (*slot) {
+            Timer* timer = *slot;
+            slot_unlink(timer);
+            timer->wheel = NULL;
+            wheel->count--;
+            if (timer->fire) timer->fire(vm, timer);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef VEGA_TIMER_H
+#define VEGA_TIMER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Vega Timer Wheel
+ *
+ * Hierarchical timing wheel behind every timed wait in the VM: sleeping
+ * processes, supervised retry backoff and request deadlines. Four levels
+ * of 64 slots at 1 ms resolution; a timer sits on the lowest level whose
+ * span covers its deadline and cascades one level down each time the
+ * level below wraps, so arming and cancelling are O(1) and a timer is
+ * moved at most once per level before it fires. Deadlines past the top
+ * level's span (~4.6 hours) wait there and are re-placed when reached.
+ *
+ * Timers are embedded in their owners (a process, an agent, the VM) and
+ * fire a callback when the wheel is advanced. The scheduler owns the
+ * wheel; the VM advances it when it polls for async work, so callbacks
+ * run on the VM thread. There is no locking.
+ */
+
+// ============================================================================
+// Types
+// ============================================================================
+
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1u << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS  4
+
+struct VegaVM;
+typedef struct Timer Timer;
+typedef struct TimerWheel TimerWheel;
+
+// Called once when the timer's deadline passes; it may re-arm the timer
+typedef void (*TimerFn)(struct VegaVM* vm, Timer* timer);
+
+struct Timer {
+    Timer* next;            // Slot list (while armed)
+    Timer** pprev;          // NULL when not armed
+    TimerWheel* wheel;
+    uint64_t deadline;      // Monotonic milliseconds (timer_now_ms)
+    TimerFn fire;
+    void* owner;
+};
+
+struct TimerWheel {
+    Timer* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t now;           // Last tick processed
+    uint32_t count;         // Armed timers
+};
+
+// ============================================================================
+// Timer API
+// ============================================================================
+
+// Monotonic clock the deadlines are measured on
+uint64_t timer_now_ms(void);
+
+void timer_wheel_init(TimerWheel* wheel);
+
+// Disarm every timer still on the wheel
+void timer_wheel_cleanup(TimerWheel* wheel);
+
+// Set what a timer does when it fires (fire may be NULL for a timer that
+// only bounds how long the VM sleeps); it starts disarmed
+void timer_init(Timer* timer, TimerFn fire, void* owner);
+
+// Arm a timer to fire at deadline, moving it if it is already armed
+void timer_arm(TimerWheel* wheel, Timer* timer, uint64_t deadline);
+
+// Disarm a timer (a no-op if it isn't armed)
+void timer_cancel(Timer* timer);
+
+static inline bool timer_armed(const Timer* timer) {
+    return timer->pprev != NULL;
+}
+
+// Fire every timer due by now, in deadline order at 1 ms granularity
+void timer_wheel_advance(TimerWheel* wheel, uint64_t now, struct VegaVM* vm);
+
+// The next tick at which advancing may fire or cascade a timer: never
+// later than the earliest deadline. UINT64_MAX if no timer is armed.
+uint64_t timer_wheel_next_tick(const TimerWheel* wheel);
+
+#endif // VEGA_TIMER_H
@@ -4,27 +4,41 @@
 #include <string.h>
 #include <math.h>
 
+#ifdef VEGA_NAN_BOXING
+_Static_assert(sizeof(Value) == 8, "NaN-boxed Value must be 8 bytes");
+
+// ============================================================================
+// Boxed Integers
+// ============================================================================
+
+Value value_box_int(int64_t i) {
+    VegaBoxedInt* box = vega_obj_alloc(sizeof(VegaBoxedInt), OBJ_BOXED_INT);
+    box->value = i;
+    return nb_box(NB_TAG_BIGINT, (uintptr_t)box);
+}
+#endif
+
 // ============================================================================
 // Type Coercion
 // ============================================================================
 
 double value_as_number(Value v) {
-    switch (v.type) {
-        case VAL_INT:   return (double)v.as.integer;
-        case VAL_FLOAT: return v.as.floating;
-        case VAL_BOOL:  return v.as.boolean ? 1.0 : 0.0;
+    switch (value_type(v)) {
+        case VAL_INT:   return (double)value_as_int(v);
+        case VAL_FLOAT: return value_as_float(v);
+        case VAL_BOOL:  return value_as_bool(v) ? 1.0 : 0.0;
         default:        return 0.0;
     }
 }
 
 bool value_is_truthy(Value v) {
-    switch (v.type) {
+    switch (value_type(v)) {
         case VAL_NULL:   return false;
-        case VAL_BOOL:   return v.as.boolean;
-        case VAL_INT:    return v.as.integer != 0;
-        case VAL_FLOAT:  return v.as.floating != 0.0;
-        case VAL_STRING: return v.as.string && v.as.string->length > 0;
-        case VAL_AGENT:  return v.as.agent != NULL;
+        case VAL_BOOL:   return value_as_bool(v);
+        case VAL_INT:    return value_as_int(v) != 0;
+        case VAL_FLOAT:  return value_as_float(v) != 0.0;
+        case VAL_STRING: return value_as_string(v) && value_as_string(v)->length > 0;
+        case VAL_AGENT:  return value_as_agent(v) != NULL;
         default:         return true;
     }
 }
@@ -34,7 +48,7 @@ bool value_is_truthy(Value v) {
 // ============================================================================
 
 bool value_equals(Value a, Value b) {
-    if (a.type != b.type) {
+    if (value_type(a) != value_type(b)) {
         // Allow int/float comparison
         if (value_is_number(a) && value_is_number(b)) {
             return value_as_number(a) == value_as_number(b);
@@ -42,13 +56,13 @@ bool value_equals(Value a, Value b) {
         return false;
     }
 
-    switch (a.type) {
+    switch (value_type(a)) {
         case VAL_NULL:   return true;
-        case VAL_BOOL:   return a.as.boolean == b.as.boolean;
-        case VAL_INT:    return a.as.integer == b.as.integer;
-        case VAL_FLOAT:  return a.as.floating == b.as.floating;
-        case VAL_STRING: return vega_string_equals(a.as.string, b.as.string);
-        case VAL_AGENT:  return a.as.agent == b.as.agent;
+        case VAL_BOOL:   return value_as_bool(a) == value_as_bool(b);
+        case VAL_INT:    return value_as_int(a) == value_as_int(b);
+        case VAL_FLOAT:  return value_as_float(a) == value_as_float(b);
+        case VAL_STRING: return vega_string_equals(value_as_string(a), value_as_string(b));
+        case VAL_AGENT:  return value_as_agent(a) == value_as_agent(b);
         default:         return false;
     }
 }
@@ -62,8 +76,8 @@ int value_compare(Value a, Value b) {
         return 0;
     }
 
-    if (a.type == VAL_STRING && b.type == VAL_STRING) {
-        return vega_string_compare(a.as.string, b.as.string);
+    if (value_type(a) == VAL_STRING && value_type(b) == VAL_STRING) {
+        return vega_string_compare(value_as_string(a), value_as_string(b));
     }
 
     // Incomparable types
@@ -76,9 +90,9 @@ int value_compare(Value a, Value b) {
 
 Value value_add(Value a, Value b) {
     // Array concatenation
-    if (a.type == VAL_ARRAY && b.type == VAL_ARRAY) {
-        VegaArray* arr_a = a.as.array;
-        VegaArray* arr_b = b.as.array;
+    if (value_type(a) == VAL_ARRAY && value_type(b) == VAL_ARRAY) {
+        VegaArray* arr_a = value_as_array(a);
+        VegaArray* arr_b = value_as_array(b);
         uint32_t total = (arr_a ? arr_a->count : 0) + (arr_b ? arr_b->count : 0);
         VegaArray* result = array_new(total > 0 ? total : 4);
 
@@ -93,25 +107,25 @@ Value value_add(Value a, Value b) {
             }
         }
 
-        return (Value){.type = VAL_ARRAY, .as.array = result};
+        return value_array(result);
     }
 
     // String concatenation
-    if (a.type == VAL_STRING || b.type == VAL_STRING) {
+    if (value_type(a) == VAL_STRING || value_type(b) == VAL_STRING) {
         VegaString* sa = value_to_string(a);
         VegaString* sb = value_to_string(b);
         VegaString* result = vega_string_concat(sa, sb);
 
         // Release temporaries if we created them
-        if (a.type != VAL_STRING) vega_obj_release(sa);
-        if (b.type != VAL_STRING) vega_obj_release(sb);
+        if (value_type(a) != VAL_STRING) vega_obj_release(sa);
+        if (value_type(b) != VAL_STRING) vega_obj_release(sb);
 
         return value_string(result);
     }
 
     // Numeric addition
-    if (a.type == VAL_INT && b.type == VAL_INT) {
-        return value_int(a.as.integer + b.as.integer);
+    if (value_type(a) == VAL_INT && value_type(b) == VAL_INT) {
+        return value_int(value_as_int(a) + value_as_int(b));
     }
 
     if (value_is_number(a) && value_is_number(b)) {
@@ -122,8 +136,8 @@ Value value_add(Value a, Value b) {
 }
 
 Value value_sub(Value a, Value b) {
-    if (a.type == VAL_INT && b.type == VAL_INT) {
-        return value_int(a.as.integer - b.as.integer);
+    if (value_type(a) == VAL_INT && value_type(b) == VAL_INT) {
+        return value_int(value_as_int(a) - value_as_int(b));
     }
     if (value_is_number(a) && value_is_number(b)) {
         return value_float(value_as_number(a) - value_as_number(b));
@@ -132,8 +146,8 @@ Value value_sub(Value a, Value b) {
 }
 
 Value value_mul(Value a, Value b) {
-    if (a.type == VAL_INT && b.type == VAL_INT) {
-        return value_int(a.as.integer * b.as.integer);
+    if (value_type(a) == VAL_INT && value_type(b) == VAL_INT) {
+        return value_int(value_as_int(a) * value_as_int(b));
     }
     if (value_is_number(a) && value_is_number(b)) {
         return value_float(value_as_number(a) * value_as_number(b));
@@ -143,9 +157,9 @@ Value value_mul(Value a, Value b) {
 
 Value value_div(Value a, Value b) {
     // Integer division returns integer (truncates toward zero)
-    if (a.type == VAL_INT && b.type == VAL_INT) {
-        if (b.as.integer == 0) return value_null();
-        return value_int(a.as.integer / b.as.integer);
+    if (value_type(a) == VAL_INT && value_type(b) == VAL_INT) {
+        if (value_as_int(b) == 0) return value_null();
+        return value_int(value_as_int(a) / value_as_int(b));
     }
 
     // Float division
@@ -157,9 +171,9 @@ Value value_div(Value a, Value b) {
 }
 
 Value value_mod(Value a, Value b) {
-    if (a.type == VAL_INT && b.type == VAL_INT) {
-        if (b.as.integer == 0) return value_null();
-        return value_int(a.as.integer % b.as.integer);
+    if (value_type(a) == VAL_INT && value_type(b) == VAL_INT) {
+        if (value_as_int(b) == 0) return value_null();
+        return value_int(value_as_int(a) % value_as_int(b));
     }
 
     double da = value_as_number(a);
@@ -169,11 +183,11 @@ Value value_mod(Value a, Value b) {
 }
 
 Value value_neg(Value v) {
-    if (v.type == VAL_INT) {
-        return value_int(-v.as.integer);
+    if (value_type(v) == VAL_INT) {
+        return value_int(-value_as_int(v));
     }
-    if (v.type == VAL_FLOAT) {
-        return value_float(-v.as.floating);
+    if (value_type(v) == VAL_FLOAT) {
+        return value_float(-value_as_float(v));
     }
     return value_null();
 }
@@ -185,27 +199,27 @@ Value value_neg(Value v) {
 VegaString* value_to_string(Value v) {
     char buffer[64];
 
-    switch (v.type) {
+    switch (value_type(v)) {
         case VAL_NULL:
             return vega_string_from_cstr("null");
 
         case VAL_BOOL:
-            return vega_string_from_cstr(v.as.boolean ? "true" : "false");
+            return vega_string_from_cstr(value_as_bool(v) ? "true" : "false");
 
         case VAL_INT:
-            snprintf(buffer, sizeof(buffer), "%lld", (long long)v.as.integer);
+            snprintf(buffer, sizeof(buffer), "%lld", (long long)value_as_int(v));
             return vega_string_from_cstr(buffer);
 
         case VAL_FLOAT:
-            snprintf(buffer, sizeof(buffer), "%g", v.as.floating);
+            snprintf(buffer, sizeof(buffer), "%g", value_as_float(v));
             return vega_string_from_cstr(buffer);
 
         case VAL_STRING:
-            vega_obj_retain(v.as.string);
-            return v.as.string;
+            vega_obj_retain(value_as_string(v));
+            return value_as_string(v);
 
         case VAL_AGENT:
-            snprintf(buffer, sizeof(buffer), "<agent %p>", (void*)v.as.agent);
+            snprintf(buffer, sizeof(buffer), "<agent %p>", (void*)value_as_agent(v));
             return vega_string_from_cstr(buffer);
 
         case VAL_FUTURE:
@@ -218,7 +232,7 @@ VegaString* value_to_string(Value v) {
             return vega_string_from_cstr("<result>");
 
         case VAL_FUNCTION:
-            snprintf(buffer, sizeof(buffer), "<function %u>", v.as.function_id);
+            snprintf(buffer, sizeof(buffer), "<function %u>", value_as_function(v));
             return vega_string_from_cstr(buffer);
 
         default:
@@ -231,15 +245,21 @@ VegaString* value_to_string(Value v) {
 // ============================================================================
 
 void value_retain(Value v) {
-    switch (v.type) {
+#ifdef VEGA_NAN_BOXING
+    if (nb_tag(v) == NB_TAG_BIGINT) {
+        vega_obj_retain(nb_ptr(v));
+        return;
+    }
+#endif
+    switch (value_type(v)) {
         case VAL_STRING:
-            if (v.as.string) vega_obj_retain(v.as.string);
+            if (value_as_string(v)) vega_obj_retain(value_as_string(v));
             break;
         case VAL_ARRAY:
-            if (v.as.array) vega_obj_retain(v.as.array);
+            if (value_as_array(v)) vega_obj_retain(value_as_array(v));
             break;
         case VAL_RESULT:
-            if (v.as.result) vega_obj_retain(v.as.result);
+            if (value_as_result(v)) vega_obj_retain(value_as_result(v));
             break;
         default:
             break;
@@ -247,15 +267,21 @@ void value_retain(Value v) {
 }
 
 void value_release(Value v) {
-    switch (v.type) {
+#ifdef VEGA_NAN_BOXING
+    if (nb_tag(v) == NB_TAG_BIGINT) {
+        vega_obj_release(nb_ptr(v));
+        return;
+    }
+#endif
+    switch (value_type(v)) {
         case VAL_STRING:
-            if (v.as.string) vega_obj_release(v.as.string);
+            if (value_as_string(v)) vega_obj_release(value_as_string(v));
             break;
         case VAL_ARRAY:
-            if (v.as.array) vega_obj_release(v.as.array);
+            if (value_as_array(v)) vega_obj_release(value_as_array(v));
             break;
         case VAL_RESULT:
-            if (v.as.result) vega_obj_release(v.as.result);
+            if (value_as_result(v)) vega_obj_release(value_as_result(v));
             break;
         default:
             break;
@@ -272,38 +298,38 @@ Value value_clone(Value v) {
 // ============================================================================
 
 void value_print(Value v) {
-    switch (v.type) {
+    switch (value_type(v)) {
         case VAL_NULL:
             printf("null");
             break;
         case VAL_BOOL:
-            printf("%s", v.as.boolean ? "true" : "false");
+            printf("%s", value_as_bool(v) ? "true" : "false");
             break;
         case VAL_INT:
-            printf("%lld", (long long)v.as.integer);
+            printf("%lld", (long long)value_as_int(v));
             break;
         case VAL_FLOAT:
-            printf("%g", v.as.floating);
+            printf("%g", value_as_float(v));
             break;
         case VAL_STRING:
-            if (v.as.string) {
-                printf("%s", v.as.string->data);
+            if (value_as_string(v)) {
+                printf("%s", value_as_string(v)->data);
             } else {
                 printf("(null string)");
             }
             break;
         case VAL_AGENT:
-            printf("<agent %p>", (void*)v.as.agent);
+            printf("<agent %p>", (void*)value_as_agent(v));
             break;
         case VAL_FUTURE:
             printf("<future>");
             break;
         case VAL_ARRAY:
-            if (v.as.array) {
+            if (value_as_array(v)) {
                 printf("[");
-                for (uint32_t i = 0; i < v.as.array->count; i++) {
+                for (uint32_t i = 0; i < value_as_array(v)->count; i++) {
                     if (i > 0) printf(", ");
-                    value_print(v.as.array->items[i]);
+                    value_print(value_as_array(v)->items[i]);
                 }
                 printf("]");
             } else {
@@ -314,7 +340,7 @@ void value_print(Value v) {
             printf("<result>");
             break;
         case VAL_FUNCTION:
-            printf("<function %u>", v.as.function_id);
+            printf("<function %u>", value_as_function(v));
             break;
         default:
             printf("<unknown>");
@@ -426,18 +452,22 @@ Value result_unwrap_err(VegaResult* r) {
 
 Value value_result_ok(Value value) {
     VegaResult* r = result_ok(value);
-    return (Value){.type = VAL_RESULT, .as.result = r};
+    return value_result(r);
 }
 
 Value value_result_err(Value error) {
     VegaResult* r = result_err(error);
-    return (Value){.type = VAL_RESULT, .as.result = r};
+    return value_result(r);
 }
 
 // ============================================================================
 // Future Operations
 // ============================================================================
 
+// Futures settle on the VM thread; the sequence orders them for the
+// await combinators
+static uint64_t g_future_settled;
+
 VegaFuture* future_new(VegaAgent* agent, uint32_t request_id) {
     VegaFuture* f = vega_obj_alloc(sizeof(VegaFuture), OBJ_FUTURE);
     if (!f) return NULL;
@@ -447,6 +477,11 @@ VegaFuture* future_new(VegaAgent* agent, uint32_t request_id) {
     f->agent = agent;
     f->result = NULL;
     f->error = NULL;
+    f->settled = 0;
+    f->waiter = 0;
+    f->partial = NULL;
+    f->partial_len = 0;
+    f->partial_capacity = 0;
 
     return f;
 }
@@ -454,6 +489,7 @@ VegaFuture* future_new(VegaAgent* agent, uint32_t request_id) {
 void future_set_result(VegaFuture* f, VegaString* result) {
     if (!f) return;
     f->state = FUTURE_READY;
+    f->settled = ++g_future_settled;
     f->result = result;
     if (result) {
         vega_obj_retain(result);
@@ -463,10 +499,26 @@ void future_set_result(VegaFuture* f, VegaString* result) {
 void future_set_error(VegaFuture* f, const char* error) {
     if (!f) return;
     f->state = FUTURE_ERROR;
+    f->settled = ++g_future_settled;
     free(f->error);
     f->error = error ? strdup(error) : NULL;
 }
 
+void future_append_partial(VegaFuture* f, const char* text, size_t len) {
+    if (!f || !text || len == 0) return;
+    if (f->partial_len + len + 1 > f->partial_capacity) {
+        size_t capacity = f->partial_capacity ? f->partial_capacity * 2 : 256;
+        while (capacity < f->partial_len + len + 1) capacity *= 2;
+        char* grown = realloc(f->partial, capacity);
+        if (!grown) return;
+        f->partial = grown;
+        f->partial_capacity = capacity;
+    }
+    memcpy(f->partial + f->partial_len, text, len);
+    f->partial_len += len;
+    f->partial[f->partial_len] = '\0';
+}
+
 bool future_is_ready(VegaFuture* f) {
     return f && (f->state == FUTURE_READY || f->state == FUTURE_ERROR);
 }
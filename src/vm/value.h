@@ -4,11 +4,14 @@
 #include "../common/memory.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 /*
  * Vega Runtime Values
  *
  * All values are tagged unions with reference counting for heap objects.
+ * Code outside this header goes through the value_* constructors and
+ * accessors, so the representation can be switched to NaN-boxing.
  */
 
 // ============================================================================
@@ -35,9 +38,12 @@ typedef struct VegaArray VegaArray;
 typedef struct VegaResult VegaResult;
 
 // ============================================================================
-// Value Union
+// Value Representation
 // ============================================================================
 
+#ifndef VEGA_NAN_BOXING
+
+// 16-byte tagged union (default)
 typedef struct {
     ValueType type;
     union {
@@ -53,50 +59,69 @@ typedef struct {
     } as;
 } Value;
 
-// ============================================================================
-// Array Type
-// ============================================================================
+#else
 
-// Note: VegaObjHeader is prepended by vega_obj_alloc, not part of this struct
-struct VegaArray {
-    Value* items;
-    uint32_t count;
-    uint32_t capacity;
+/*
+ * NaN-boxed 8-byte value (build with -DVEGA_NAN_BOXING).
+ *
+ * Doubles are stored unboxed. Everything else lives in the quiet-NaN space:
+ * sign bit + bits 48-50 hold a 4-bit tag, the low 48 bits hold the payload
+ * (pointer, 48-bit int, bool, function id). Tag 0 is the canonical NaN, so
+ * value_float() collapses every NaN to it. Ints outside 48 bits are boxed
+ * on the heap and read back transparently by value_as_int().
+ */
+typedef uint64_t Value;
+
+#define NB_QNAN         0x7ff8000000000000ULL
+#define NB_SIGN         0x8000000000000000ULL
+#define NB_PAYLOAD      0x0000ffffffffffffULL
+
+enum {
+    NB_TAG_NAN      = 0,    // Canonical NaN (a double)
+    NB_TAG_NULL     = 1,
+    NB_TAG_BOOL     = 2,
+    NB_TAG_INT      = 3,    // 48-bit signed integer
+    NB_TAG_FUNCTION = 4,
+    NB_TAG_BIGINT   = 8,    // Pointer tags have the sign bit set
+    NB_TAG_STRING   = 9,
+    NB_TAG_AGENT    = 10,
+    NB_TAG_FUTURE   = 11,
+    NB_TAG_ARRAY    = 12,
+    NB_TAG_RESULT   = 13,
 };
 
-// ============================================================================
-// Future Type (for async agent results)
-// ============================================================================
+#define NB_INT_MIN      (-(INT64_C(1) << 47))
+#define NB_INT_MAX      ((INT64_C(1) << 47) - 1)
 
-typedef enum {
-    FUTURE_PENDING,     // Waiting for result
-    FUTURE_READY,       // Result available
-    FUTURE_ERROR,       // Error occurred
-} FutureState;
+static inline Value nb_box(uint32_t tag, uint64_t payload) {
+    return NB_QNAN | ((uint64_t)(tag & 8) << 60) | ((uint64_t)(tag & 7) << 48) |
+           (payload & NB_PAYLOAD);
+}
 
-// Note: VegaObjHeader is prepended by vega_obj_alloc, not part of this struct
-struct VegaFuture {
-    uint32_t request_id;    // Index into VM's pending_requests
-    FutureState state;
-    VegaAgent* agent;       // Agent handling this request
-    VegaString* result;     // Result string (NULL until ready)
-    char* error;            // Error message if state == FUTURE_ERROR
-};
+static inline uint32_t nb_tag(Value v) {
+    if ((v & NB_QNAN) != NB_QNAN) return NB_TAG_NAN;
+    return (uint32_t)(((v >> 60) & 8) | ((v >> 48) & 7));
+}
 
-// ============================================================================
-// Result Type (for error handling)
-// ============================================================================
+static inline void* nb_ptr(Value v) {
+    return (void*)(uintptr_t)(v & NB_PAYLOAD);
+}
 
-// Note: VegaObjHeader is prepended by vega_obj_alloc, not part of this struct
-struct VegaResult {
-    bool is_ok;
-    Value value;        // Success value or error
-};
+// Heap storage for integers that don't fit in 48 bits
+typedef struct {
+    int64_t value;
+} VegaBoxedInt;
+
+Value value_box_int(int64_t i);
+
+#endif
 
 // ============================================================================
 // Value Constructors
 // ============================================================================
 
+#ifndef VEGA_NAN_BOXING
+
 static inline Value value_null(void) {
     return (Value){.type = VAL_NULL};
 }
@@ -129,19 +154,162 @@ static inline Value value_future(VegaFuture* f) {
     return (Value){.type = VAL_FUTURE, .as.future = f};
 }
 
+static inline Value value_array(VegaArray* a) {
+    return (Value){.type = VAL_ARRAY, .as.array = a};
+}
+
+static inline Value value_result(VegaResult* r) {
+    return (Value){.type = VAL_RESULT, .as.result = r};
+}
+
+#else
+
+static inline Value value_null(void) { return nb_box(NB_TAG_NULL, 0); }
+static inline Value value_bool(bool b) { return nb_box(NB_TAG_BOOL, b ? 1 : 0); }
+
+static inline Value value_int(int64_t i) {
+    if (i < NB_INT_MIN || i > NB_INT_MAX) return value_box_int(i);
+    return nb_box(NB_TAG_INT, (uint64_t)i);
+}
+
+static inline Value value_float(double f) {
+    Value v;
+    if (f != f) return NB_QNAN;  // Canonical NaN
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+static inline Value value_string(VegaString* s) { return nb_box(NB_TAG_STRING, (uintptr_t)s); }
+static inline Value value_agent(VegaAgent* a) { return nb_box(NB_TAG_AGENT, (uintptr_t)a); }
+static inline Value value_function(uint32_t id) { return nb_box(NB_TAG_FUNCTION, id); }
+static inline Value value_future(VegaFuture* f) { return nb_box(NB_TAG_FUTURE, (uintptr_t)f); }
+static inline Value value_array(VegaArray* a) { return nb_box(NB_TAG_ARRAY, (uintptr_t)a); }
+static inline Value value_result(VegaResult* r) { return nb_box(NB_TAG_RESULT, (uintptr_t)r); }
+
+#endif
+
+// ============================================================================
+// Value Accessors
+// ============================================================================
+
+#ifndef VEGA_NAN_BOXING
+
+static inline ValueType value_type(Value v) { return v.type; }
+static inline bool value_as_bool(Value v) { return v.as.boolean; }
+static inline int64_t value_as_int(Value v) { return v.as.integer; }
+static inline double value_as_float(Value v) { return v.as.floating; }
+static inline VegaString* value_as_string(Value v) { return v.as.string; }
+static inline VegaAgent* value_as_agent(Value v) { return v.as.agent; }
+static inline VegaFuture* value_as_future(Value v) { return v.as.future; }
+static inline VegaArray* value_as_array(Value v) { return v.as.array; }
+static inline VegaResult* value_as_result(Value v) { return v.as.result; }
+static inline uint32_t value_as_function(Value v) { return v.as.function_id; }
+
+// An int with no heap storage behind it (every int in this layout)
+static inline bool value_is_inline_int(Value v) { return v.type == VAL_INT; }
+
+#else
+
+static inline ValueType value_type(Value v) {
+    static const uint8_t types[16] = {
+        [NB_TAG_NAN] = VAL_FLOAT,
+        [NB_TAG_NULL] = VAL_NULL,
+        [NB_TAG_BOOL] = VAL_BOOL,
+        [NB_TAG_INT] = VAL_INT,
+        [NB_TAG_FUNCTION] = VAL_FUNCTION,
+        [NB_TAG_BIGINT] = VAL_INT,
+        [NB_TAG_STRING] = VAL_STRING,
+        [NB_TAG_AGENT] = VAL_AGENT,
+        [NB_TAG_FUTURE] = VAL_FUTURE,
+        [NB_TAG_ARRAY] = VAL_ARRAY,
+        [NB_TAG_RESULT] = VAL_RESULT,
+    };
+    return (ValueType)types[nb_tag(v)];
+}
+
+static inline bool value_as_bool(Value v) { return (v & 1) != 0; }
+
+static inline int64_t value_as_int(Value v) {
+    if (nb_tag(v) == NB_TAG_BIGINT) return ((VegaBoxedInt*)nb_ptr(v))->value;
+    return (int64_t)(v << 16) >> 16;  // Sign-extend the 48-bit payload
+}
+
+// An int with no heap storage behind it (fits in the 48-bit payload)
+static inline bool value_is_inline_int(Value v) { return nb_tag(v) == NB_TAG_INT; }
+
+static inline double value_as_float(Value v) {
+    double f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static inline VegaString* value_as_string(Value v) { return (VegaString*)nb_ptr(v); }
+static inline VegaAgent* value_as_agent(Value v) { return (VegaAgent*)nb_ptr(v); }
+static inline VegaFuture* value_as_future(Value v) { return (VegaFuture*)nb_ptr(v); }
+static inline VegaArray* value_as_array(Value v) { return (VegaArray*)nb_ptr(v); }
+static inline VegaResult* value_as_result(Value v) { return (VegaResult*)nb_ptr(v); }
+static inline uint32_t value_as_function(Value v) { return (uint32_t)(v & NB_PAYLOAD); }
+
+#endif
+
+// ============================================================================
+// Array Type
+// ============================================================================
+
+// Note: VegaObjHeader is prepended by vega_obj_alloc, not part of this struct
+struct VegaArray {
+    Value* items;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+// ============================================================================
+// Future Type (for async agent results)
+// ============================================================================
+
+typedef enum {
+    FUTURE_PENDING,     // Waiting for result
+    FUTURE_READY,       // Result available
+    FUTURE_ERROR,       // Error occurred
+} FutureState;
+
+// Note: VegaObjHeader is prepended by vega_obj_alloc, not part of this struct
+struct VegaFuture {
+    uint32_t request_id;    // Slot in the VM's future table while in flight
+    FutureState state;
+    VegaAgent* agent;       // Agent handling this request
+    VegaString* result;     // Result string (NULL until ready)
+    char* error;            // Error message if state == FUTURE_ERROR
+    uint64_t settled;       // Order in which futures settled (0 while pending)
+    uint32_t waiter;        // Pid of a process parked on it (0 = none)
+    char* partial;          // Text streamed so far (streaming agents)
+    size_t partial_len;
+    size_t partial_capacity;
+};
+
+// ============================================================================
+// Result Type (for error handling)
+// ============================================================================
+
+// Note: VegaObjHeader is prepended by vega_obj_alloc, not part of this struct
+struct VegaResult {
+    bool is_ok;
+    Value value;        // Success value or error
+};
+
 // ============================================================================
 // Value Operations
 // ============================================================================
 
 // Type checking
-static inline bool value_is_null(Value v) { return v.type == VAL_NULL; }
-static inline bool value_is_bool(Value v) { return v.type == VAL_BOOL; }
-static inline bool value_is_int(Value v) { return v.type == VAL_INT; }
-static inline bool value_is_float(Value v) { return v.type == VAL_FLOAT; }
-static inline bool value_is_number(Value v) { return v.type == VAL_INT || v.type == VAL_FLOAT; }
-static inline bool value_is_string(Value v) { return v.type == VAL_STRING; }
-static inline bool value_is_agent(Value v) { return v.type == VAL_AGENT; }
-static inline bool value_is_future(Value v) { return v.type == VAL_FUTURE; }
+static inline bool value_is_null(Value v) { return value_type(v) == VAL_NULL; }
+static inline bool value_is_bool(Value v) { return value_type(v) == VAL_BOOL; }
+static inline bool value_is_int(Value v) { return value_type(v) == VAL_INT; }
+static inline bool value_is_float(Value v) { return value_type(v) == VAL_FLOAT; }
+static inline bool value_is_number(Value v) { return value_is_int(v) || value_is_float(v); }
+static inline bool value_is_string(Value v) { return value_type(v) == VAL_STRING; }
+static inline bool value_is_agent(Value v) { return value_type(v) == VAL_AGENT; }
+static inline bool value_is_future(Value v) { return value_type(v) == VAL_FUTURE; }
 
 // Type coercion
 double value_as_number(Value v);
@@ -202,6 +370,7 @@ Value value_result_err(Value error);
 VegaFuture* future_new(VegaAgent* agent, uint32_t request_id);
 void future_set_result(VegaFuture* f, VegaString* result);
 void future_set_error(VegaFuture* f, const char* error);
+void future_append_partial(VegaFuture* f, const char* text, size_t len);
 bool future_is_ready(VegaFuture* f);
 VegaString* future_get_result(VegaFuture* f);
 
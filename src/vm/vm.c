@@ -3,13 +3,19 @@
 #include "http.h"
 #include "process.h"
 #include "scheduler.h"
+#include "native.h"
 #include "../tui/trace.h"
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pwd.h>
 #include <unistd.h>
 
+static bool vm_link(VegaVM* vm);
+static void vm_free_constants(VegaVM* vm);
+static void vm_load_context(VegaVM* vm, ExecContext* context);
+
 // ============================================================================
 // Configuration
 // ============================================================================
@@ -75,12 +81,86 @@ static char* get_api_key(void) {
 
 void vm_init(VegaVM* vm) {
     memset(vm, 0, sizeof(VegaVM));
+    vm->waiting_msg = value_null();
     vm->api_key = get_api_key();
     vm->next_pid = 1;  // PID 0 reserved for "no parent"
+    vm->future_free = UINT32_MAX;
     scheduler_init(&vm->scheduler, vm->processes, &vm->process_count);
+    timer_init(&vm->sleep_timer, NULL, vm);
+    native_init();
+
+    // Root execution context
+    vm->root_context.stack = calloc(VM_STACK_INITIAL, sizeof(Value));
+    vm->root_context.stack_capacity = VM_STACK_INITIAL;
+    vm->root_context.frames = calloc(VM_FRAMES_INITIAL, sizeof(CallFrame));
+    vm->root_context.frame_capacity = VM_FRAMES_INITIAL;
+    vm->root_context.waiting_msg = value_null();
+    vm->context = &vm->root_context;
+    vm_load_context(vm, &vm->root_context);
 }
 
-void vm_free(VegaVM* vm) {
+// ============================================================================
+// Execution Contexts
+// ============================================================================
+
+static void vm_load_context(VegaVM* vm, ExecContext* context) {
+    vm->context = context;
+    vm->ip = context->ip;
+    vm->stack = context->stack;
+    vm->sp = context->sp;
+    vm->stack_capacity = context->stack_capacity;
+    vm->frames = context->frames;
+    vm->frame_count = context->frame_count;
+    vm->frame_capacity = context->frame_capacity;
+    vm->waiting_for_agent = context->waiting_for_agent;
+    vm->waiting_msg = context->waiting_msg;
+}
+
+void vm_switch_context(VegaVM* vm, ExecContext* context) {
+    ExecContext* current = vm->context;
+    current->ip = vm->ip;
+    current->stack = vm->stack;
+    current->sp = vm->sp;
+    current->stack_capacity = vm->stack_capacity;
+    current->frames = vm->frames;
+    current->frame_count = vm->frame_count;
+    current->frame_capacity = vm->frame_capacity;
+    current->waiting_for_agent = vm->waiting_for_agent;
+    current->waiting_msg = vm->waiting_msg;
+
+    vm_load_context(vm, context);
+}
+
+// The registers are the live copy of the current context; they are written
+// back on the next vm_switch_context.
+bool vm_reserve_stack(VegaVM* vm, uint32_t count) {
+    if (context_reserve_stack(&vm->stack, &vm->stack_capacity, vm->sp + count)) {
+        return true;
+    }
+    snprintf(vm->error_msg, sizeof(vm->error_msg), "Stack overflow");
+    vm->had_error = true;
+    vm->running = false;
+    return false;
+}
+
+bool vm_reserve_frames(VegaVM* vm, uint32_t count) {
+    if (context_reserve_frames(&vm->frames, &vm->frame_capacity, vm->frame_count + count)) {
+        return true;
+    }
+    snprintf(vm->error_msg, sizeof(vm->error_msg), "Call stack overflow");
+    vm->had_error = true;
+    vm->running = false;
+    return false;
+}
+
+// Drop the loaded program and everything that may refer to it: globals
+// hold its function ids, and globals, stacks, processes and in-flight
+// sends may hold its interned string constants. The interned constants
+// themselves are freed by the caller, after these references.
+static void vm_unload(VegaVM* vm) {
+    // Back on the root context: processes release their own state
+    vm_switch_context(vm, &vm->root_context);
+
     // Cancel any pending async request
     if (vm->waiting_for_agent) {
         agent_cancel_pending(vm->waiting_for_agent);
@@ -89,30 +169,77 @@ void vm_free(VegaVM* vm) {
     value_release(vm->waiting_msg);
     vm->waiting_msg = value_null();
 
-    free(vm->code);
-    free(vm->constants);
-    free(vm->functions);
-    free(vm->agents);
-    free(vm->api_key);
+    for (uint32_t i = 0; i < vm->future_slot_count; i++) {
+        VegaFuture* future = vm->future_slots[i].future;
+        if (future && future->agent && agent_has_pending_request(future->agent)) {
+            agent_cancel_pending(future->agent);
+        }
+        vega_obj_release(future);
+    }
+    vm->future_slot_count = 0;
+    vm->future_free = UINT32_MAX;
+    vm->pending_count = 0;
 
-    // Release global values
+    // Release global values; their slots are relinked by the next program
     for (uint32_t i = 0; i < vm->global_count; i++) {
         value_release(vm->globals[i]);
         free(vm->global_names[i]);
     }
+    vm->global_count = 0;
 
-    // Release stack values
+    // Release the root stack (processes own and release theirs)
     for (uint32_t i = 0; i < vm->sp; i++) {
         value_release(vm->stack[i]);
     }
+    vm->sp = 0;
+    vm->frame_count = 0;
+    vm->ip = 0;
 
-    // Free processes
+    // Processes run the program's code and hold its values
     for (uint32_t i = 0; i < vm->process_count; i++) {
         process_free(vm->processes[i]);
     }
+    vm->process_count = 0;
+    timer_cancel(&vm->sleep_timer);
+    vm->sleeping = false;
+    scheduler_cleanup(&vm->scheduler);
+    scheduler_init(&vm->scheduler, vm->processes, &vm->process_count);
+
+    free(vm->code);
+    free(vm->constants);
+    free(vm->functions);
+    free(vm->agents);
+    vm->code = NULL;
+    vm->constants = NULL;
+    vm->functions = NULL;
+    vm->agents = NULL;
+    vm->code_size = 0;
+    vm->const_size = 0;
+    vm->func_count = 0;
+    vm->agent_count = 0;
+}
+
+void vm_free(VegaVM* vm) {
+    vm_unload(vm);
+
+    free(vm->future_slots);
+    vm->future_slots = NULL;
+    vm->future_slot_capacity = 0;
+    free(vm->api_key);
+    free(vm->method_caches);
+    free(vm->globals);
+    free(vm->global_names);
+
+    free(vm->root_context.stack);
+    free(vm->root_context.frames);
+    vm->stack = NULL;
+    vm->frames = NULL;
 
     // Cleanup scheduler
     scheduler_cleanup(&vm->scheduler);
+
+    // Interned constants last: anything released above may reference them
+    vm_free_constants(vm);
 }
 
 // ============================================================================
@@ -137,14 +264,21 @@ void vm_set_budget_cost(VegaVM* vm, double max_cost_usd) {
     vm->budget_max_cost_usd = max_cost_usd;
 }
 
-void vm_add_token_usage(VegaVM* vm, uint32_t input, uint32_t output) {
-    vm->budget_used_input_tokens += input;
+// input counts only uncached prompt tokens; cache reads and writes are
+// reported (and billed) separately, but all of them count as input
+void vm_add_token_usage(VegaVM* vm, uint32_t input, uint32_t output,
+                        uint32_t cache_read, uint32_t cache_write) {
+    vm->budget_used_input_tokens += (uint64_t)input + cache_read + cache_write;
     vm->budget_used_output_tokens += output;
+    vm->budget_used_cache_read_tokens += cache_read;
+    vm->budget_used_cache_write_tokens += cache_write;
 
     // Calculate cost
     double input_cost = (input / 1000000.0) * PRICE_INPUT_PER_MTOK;
     double output_cost = (output / 1000000.0) * PRICE_OUTPUT_PER_MTOK;
-    vm->budget_used_cost_usd += input_cost + output_cost;
+    double cache_cost = (cache_read / 1000000.0) * PRICE_CACHE_READ_PER_MTOK +
+                        (cache_write / 1000000.0) * PRICE_CACHE_WRITE_PER_MTOK;
+    vm->budget_used_cost_usd += input_cost + output_cost + cache_cost;
 }
 
 double vm_get_current_cost(VegaVM* vm) {
@@ -231,6 +365,9 @@ bool vm_load(VegaVM* vm, uint8_t* bytecode, uint32_t size) {
         return false;
     }
 
+    // Loading into a VM that already holds a program replaces it
+    vm_unload(vm);
+
     uint8_t* ptr = bytecode + sizeof(VegaHeader);
 
     // Read function and agent counts
@@ -257,9 +394,218 @@ bool vm_load(VegaVM* vm, uint8_t* bytecode, uint32_t size) {
 
     // Read code
     vm->code_size = header->code_size;
-    vm->code = malloc(vm->code_size);
+    // Trailing OP_HALT sentinel so the dispatch loop never runs off the end
+    vm->code = malloc(vm->code_size + 1);
     memcpy(vm->code, ptr, vm->code_size);
+    vm->code[vm->code_size] = OP_HALT;
+
+    return vm_link(vm);
+}
+
+/*
+ * Decode the constant pool into vm->const_values. String constants are
+ * allocated once and flagged OBJ_FLAG_INTERNED, so pushing them costs no
+ * allocation and retain/release are no-ops; they are freed in vm_free.
+ * Returns a map from pool byte offset to table index (-1 for offsets that
+ * don't start an entry), or NULL if the pool is malformed.
+ */
+static int32_t* vm_materialize_constants(VegaVM* vm) {
+    vm_free_constants(vm);
+
+    int32_t* map = malloc((vm->const_size + 1) * sizeof(int32_t));
+    for (uint32_t i = 0; i <= vm->const_size; i++) {
+        map[i] = -1;
+    }
+
+    uint32_t capacity = 16;
+    vm->const_values = malloc(capacity * sizeof(Value));
+    vm->const_value_count = 0;
+
+    uint32_t offset = 0;
+    while (offset < vm->const_size) {
+        uint8_t* ptr = vm->constants + offset;
+        uint32_t entry_size;
+        Value v;
+
+        switch (ptr[0]) {
+            case CONST_INT: {
+                int32_t val;
+                entry_size = 1 + 4;
+                if (offset + entry_size > vm->const_size) goto malformed;
+                memcpy(&val, ptr + 1, 4);
+                v = value_int(val);
+                break;
+            }
+            case CONST_STRING: {
+                if (offset + 3 > vm->const_size) goto malformed;
+                uint16_t len = ptr[1] | (ptr[2] << 8);
+                entry_size = 1 + 2 + len;
+                if (offset + entry_size > vm->const_size) goto malformed;
+                VegaString* str = vega_string_new((char*)ptr + 3, len);
+                vega_obj_header(str)->flags |= OBJ_FLAG_INTERNED;
+                v = value_string(str);
+                break;
+            }
+            case CONST_FLOAT: {
+                double val;
+                entry_size = 1 + 8;
+                if (offset + entry_size > vm->const_size) goto malformed;
+                memcpy(&val, ptr + 1, 8);
+                v = value_float(val);
+                break;
+            }
+            default:
+                goto malformed;
+        }
+
+        if (vm->const_value_count >= capacity) {
+            capacity *= 2;
+            vm->const_values = realloc(vm->const_values, capacity * sizeof(Value));
+        }
+        map[offset] = (int32_t)vm->const_value_count;
+        vm->const_values[vm->const_value_count++] = v;
+        offset += entry_size;
+    }
+    return map;
+
+malformed:
+    free(map);
+    return NULL;
+}
 
+static void vm_free_constants(VegaVM* vm) {
+    for (uint32_t i = 0; i < vm->const_value_count; i++) {
+        Value v = vm->const_values[i];
+        if (value_type(v) == VAL_STRING && value_as_string(v)) {
+            vega_obj_header(value_as_string(v))->flags &= ~OBJ_FLAG_INTERNED;
+            vega_obj_release(value_as_string(v));
+        }
+    }
+    free(vm->const_values);
+    vm->const_values = NULL;
+    vm->const_value_count = 0;
+}
+
+/*
+ * Link pass: rewrite every OP_PUSH_CONST operand from a constant pool byte
+ * offset to a const_values index, every OP_CALL_NATIVE operand from a name
+ * to a native registry index, and every OP_LOAD_GLOBAL/OP_STORE_GLOBAL
+ * operand from a constant pool name offset to a dense global slot. Names
+ * that refer to a top-level function get their slot pre-populated with the
+ * function value, so these opcodes never touch strings at runtime. Each
+ * OP_CALL_METHOD site gets its own inline cache entry, and its name
+ * operand becomes the index of that entry.
+ */
+static bool vm_link_code(VegaVM* vm, const int32_t* const_map);
+
+static bool vm_link(VegaVM* vm) {
+    // Cache entries are per call site of the program being linked
+    vm->method_cache_count = 0;
+
+    int32_t* const_map = vm_materialize_constants(vm);
+    if (!const_map) {
+        snprintf(vm->error_msg, sizeof(vm->error_msg),
+                "Invalid bytecode: malformed constant pool");
+        vm->had_error = true;
+        return false;
+    }
+
+    bool ok = vm_link_code(vm, const_map);
+    free(const_map);
+    return ok;
+}
+
+static bool vm_link_code(VegaVM* vm, const int32_t* const_map) {
+    uint32_t ip = 0;
+    while (ip < vm->code_size) {
+        uint8_t op = vm->code[ip];
+        int operand_size = opcode_operand_size(op);
+        if (operand_size < 0 || ip + 1 + (uint32_t)operand_size > vm->code_size) {
+            snprintf(vm->error_msg, sizeof(vm->error_msg),
+                    "Invalid bytecode: bad instruction 0x%02x at %u", op, ip);
+            vm->had_error = true;
+            return false;
+        }
+
+        if (op == OP_PUSH_CONST) {
+            uint16_t offset = READ_U16(vm->code, ip + 1);
+            if (offset >= vm->const_size || const_map[offset] < 0) {
+                snprintf(vm->error_msg, sizeof(vm->error_msg),
+                        "Invalid bytecode: bad constant at %u", ip);
+                vm->had_error = true;
+                return false;
+            }
+            uint16_t index = (uint16_t)const_map[offset];
+            vm->code[ip + 1] = index & 0xFF;
+            vm->code[ip + 2] = (index >> 8) & 0xFF;
+        } else if (op == OP_CALL_NATIVE) {
+            uint16_t idx = READ_U16(vm->code, ip + 1);
+            uint32_t len;
+            const char* name = vm_read_string(vm, idx, &len);
+            int native_id = name ? native_find(name, len) : -1;
+            if (native_id < 0) {
+                snprintf(vm->error_msg, sizeof(vm->error_msg),
+                        "Unknown native function: %.*s", (int)len, name ? name : "");
+                vm->had_error = true;
+                return false;
+            }
+            vm->code[ip + 1] = native_id & 0xFF;
+            vm->code[ip + 2] = (native_id >> 8) & 0xFF;
+        } else if (op == OP_LOAD_GLOBAL || op == OP_STORE_GLOBAL) {
+            uint16_t idx = READ_U16(vm->code, ip + 1);
+            uint32_t len;
+            const char* name = vm_read_string(vm, idx, &len);
+            if (!name) {
+                snprintf(vm->error_msg, sizeof(vm->error_msg),
+                        "Invalid bytecode: bad global name at %u", ip);
+                vm->had_error = true;
+                return false;
+            }
+
+            char* name_z = strndup(name, len);
+            uint32_t slot = vm_global_slot(vm, name_z);
+            if (value_type(vm->globals[slot]) == VAL_NULL) {
+                int func_id = vm_find_function(vm, name_z);
+                if (func_id >= 0) {
+                    vm->globals[slot] = value_function((uint32_t)func_id);
+                }
+            }
+            free(name_z);
+
+            if (slot > UINT16_MAX) {
+                snprintf(vm->error_msg, sizeof(vm->error_msg),
+                        "Too many globals (max %u)", UINT16_MAX + 1);
+                vm->had_error = true;
+                return false;
+            }
+            vm->code[ip + 1] = slot & 0xFF;
+            vm->code[ip + 2] = (slot >> 8) & 0xFF;
+        } else if (op == OP_CALL_METHOD) {
+            uint16_t idx = READ_U16(vm->code, ip + 1);
+            uint32_t len;
+            const char* name = vm_read_string(vm, idx, &len);
+            if (!name || vm->method_cache_count > UINT16_MAX) {
+                snprintf(vm->error_msg, sizeof(vm->error_msg),
+                        "Invalid bytecode: bad method call at %u", ip);
+                vm->had_error = true;
+                return false;
+            }
+
+            uint32_t site = vm->method_cache_count++;
+            vm->method_caches = realloc(vm->method_caches,
+                                        vm->method_cache_count * sizeof(MethodCache));
+            vm->method_caches[site] = (MethodCache){
+                .name = name,
+                .name_len = len,
+                .receiver_type = METHOD_CACHE_EMPTY,
+                .method = NULL,
+            };
+            vm->code[ip + 1] = site & 0xFF;
+            vm->code[ip + 2] = (site >> 8) & 0xFF;
+        }
+
+        ip += 1 + (uint32_t)operand_size;
+    }
     return true;
 }
 
@@ -268,10 +614,7 @@ bool vm_load(VegaVM* vm, uint8_t* bytecode, uint32_t size) {
 // ============================================================================
 
 void vm_push(VegaVM* vm, Value v) {
-    if (vm->sp >= VM_STACK_MAX) {
-        snprintf(vm->error_msg, sizeof(vm->error_msg), "Stack overflow");
-        vm->had_error = true;
-        vm->running = false;
+    if (vm->sp >= vm->stack_capacity && !vm_reserve_stack(vm, 1)) {
         return;
     }
     vm->stack[vm->sp++] = v;
@@ -298,34 +641,12 @@ Value vm_peek(VegaVM* vm, uint32_t distance) {
 // Constant Pool Access
 // ============================================================================
 
+// Read a materialized constant by table index (not pool offset)
 Value vm_read_constant(VegaVM* vm, uint16_t index) {
-    if (index >= vm->const_size) {
+    if (index >= vm->const_value_count) {
         return value_null();
     }
-
-    uint8_t* ptr = vm->constants + index;
-    uint8_t type = *ptr++;
-
-    switch (type) {
-        case CONST_INT: {
-            int32_t val;
-            memcpy(&val, ptr, 4);
-            return value_int(val);
-        }
-        case CONST_STRING: {
-            uint16_t len = ptr[0] | (ptr[1] << 8);
-            ptr += 2;
-            VegaString* str = vega_string_new((char*)ptr, len);
-            return value_string(str);
-        }
-        case CONST_FLOAT: {
-            double val;
-            memcpy(&val, ptr, 8);
-            return value_float(val);
-        }
-        default:
-            return value_null();
-    }
+    return vm->const_values[index];
 }
 
 const char* vm_read_string(VegaVM* vm, uint16_t index, uint32_t* out_len) {
@@ -391,33 +712,42 @@ const char* vm_find_string_after_key(VegaVM* vm, const char* key, uint32_t* out_
 // Global Variables
 // ============================================================================
 
-Value vm_get_global(VegaVM* vm, const char* name) {
+// Find or create the slot for a global. Slots are dense and never move,
+// so linked bytecode can index vm->globals directly.
+uint32_t vm_global_slot(VegaVM* vm, const char* name) {
     for (uint32_t i = 0; i < vm->global_count; i++) {
         if (strcmp(vm->global_names[i], name) == 0) {
-            return vm->globals[i];
+            return i;
         }
     }
-    return value_null();
+
+    if (vm->global_count >= vm->global_capacity) {
+        uint32_t new_cap = vm->global_capacity < 16 ? 16 : vm->global_capacity * 2;
+        vm->globals = realloc(vm->globals, new_cap * sizeof(Value));
+        vm->global_names = realloc(vm->global_names, new_cap * sizeof(char*));
+        vm->global_capacity = new_cap;
+    }
+
+    uint32_t slot = vm->global_count++;
+    vm->global_names[slot] = strdup(name);
+    vm->globals[slot] = value_null();
+    return slot;
 }
 
-void vm_set_global(VegaVM* vm, const char* name, Value v) {
-    // Check if exists
+Value vm_get_global(VegaVM* vm, const char* name) {
     for (uint32_t i = 0; i < vm->global_count; i++) {
         if (strcmp(vm->global_names[i], name) == 0) {
-            value_release(vm->globals[i]);
-            value_retain(v);
-            vm->globals[i] = v;
-            return;
+            return vm->globals[i];
         }
     }
+    return value_null();
+}
 
-    // Add new
-    if (vm->global_count < VM_GLOBALS_MAX) {
-        vm->global_names[vm->global_count] = strdup(name);
-        value_retain(v);
-        vm->globals[vm->global_count] = v;
-        vm->global_count++;
-    }
+void vm_set_global(VegaVM* vm, const char* name, Value v) {
+    uint32_t slot = vm_global_slot(vm, name);
+    value_release(vm->globals[slot]);
+    value_retain(v);
+    vm->globals[slot] = v;
 }
 
 // ============================================================================
@@ -452,1241 +782,1603 @@ AgentDef* vm_get_agent(VegaVM* vm, uint32_t index) {
 }
 
 // ============================================================================
-// Native Calls
+// Execution
 // ============================================================================
 
-static Value call_native(VegaVM* vm, const char* name, Value* args, uint32_t argc) {
-    // file::read(path) -> str
-    if (strcmp(name, "file::read") == 0 && argc == 1) {
-        if (args[0].type != VAL_STRING) {
-            return value_null();
-        }
-        FILE* f = fopen(args[0].as.string->data, "r");
-        if (!f) return value_null();
+/*
+ * The interpreter core is vm_dispatch(). It keeps ip/sp and the current
+ * frame's base in locals and dispatches with computed goto where the compiler
+ * supports it (GCC/Clang), falling back to a switch elsewhere.
+ *
+ * Pending async work is not polled per instruction. It is only driven at
+ * safepoints: dispatch entry, calls, backward jumps, and agent/await opcodes.
+ * Every loop has a backward jump and every recursion has a call, so async
+ * agents keep making progress while compute-heavy code runs.
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_COMPUTED_GOTO 1
+#define VM_NOINLINE __attribute__((noinline))
+#else
+#define VM_COMPUTED_GOTO 0
+#define VM_NOINLINE
+#endif
+
+// Stack underflow only happens with malformed bytecode. The error is sticky;
+// execution stops at the next safepoint or return.
+static Value vm_stack_underflow(VegaVM* vm) {
+    snprintf(vm->error_msg, sizeof(vm->error_msg), "Stack underflow");
+    vm->had_error = true;
+    vm->running = false;
+    return value_null();
+}
 
-        fseek(f, 0, SEEK_END);
-        long size = ftell(f);
-        fseek(f, 0, SEEK_SET);
+static void vm_runtime_error(VegaVM* vm, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(vm->error_msg, sizeof(vm->error_msg), fmt, args);
+    va_end(args);
+    vm->had_error = true;
+    vm->running = false;
+}
 
-        char* content = malloc(size + 1);
-        size_t read = fread(content, 1, size, f);
-        content[read] = '\0';
-        fclose(f);
+// ============================================================================
+// Future Table
+// ============================================================================
 
-        VegaString* str = vega_string_new(content, (uint32_t)read);
-        free(content);
-        return value_string(str);
-    }
+static uint64_t future_token(VegaVM* vm, uint32_t index) {
+    return ((uint64_t)vm->future_slots[index].generation << 32) | index;
+}
 
-    // file::write(path, content) -> void
-    if (strcmp(name, "file::write") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_STRING) {
-            return value_null();
-        }
-        FILE* f = fopen(args[0].as.string->data, "w");
-        if (!f) return value_null();
-        fwrite(args[1].as.string->data, 1, args[1].as.string->length, f);
-        fclose(f);
-        return value_null();
+// Track a future whose send is about to start (the table holds its own
+// reference: the program may drop the future while it is in flight).
+// Returns its token, or 0 if out of memory.
+static uint64_t future_table_add(VegaVM* vm, VegaFuture* future) {
+    uint32_t index = vm->future_free;
+    if (index != UINT32_MAX) {
+        vm->future_free = vm->future_slots[index].next_free;
+    } else {
+        if (vm->future_slot_count >= vm->future_slot_capacity) {
+            uint32_t capacity = vm->future_slot_capacity ? vm->future_slot_capacity * 2 : 16;
+            FutureSlot* slots = realloc(vm->future_slots, capacity * sizeof(FutureSlot));
+            if (!slots) return 0;
+            vm->future_slots = slots;
+            vm->future_slot_capacity = capacity;
+        }
+        index = vm->future_slot_count++;
+        vm->future_slots[index].generation = 0;
     }
 
-    // file::exists(path) -> bool
-    if (strcmp(name, "file::exists") == 0 && argc == 1) {
-        if (args[0].type != VAL_STRING) {
-            return value_bool(false);
-        }
-        FILE* f = fopen(args[0].as.string->data, "r");
-        if (f) {
-            fclose(f);
-            return value_bool(true);
-        }
-        return value_bool(false);
-    }
+    FutureSlot* slot = &vm->future_slots[index];
+    slot->generation++;  // Never 0, so neither is a token
+    slot->future = future;
+    vega_obj_retain(future);
+    future->request_id = index;
+    vm->pending_count++;
+    return future_token(vm, index);
+}
+
+// Stop tracking a future (settled, or its send never started)
+static void future_table_remove(VegaVM* vm, VegaFuture* future) {
+    if (!future) return;
+    uint32_t index = future->request_id;
+    if (index >= vm->future_slot_count || vm->future_slots[index].future != future) return;
+
+    FutureSlot* slot = &vm->future_slots[index];
+    slot->future = NULL;
+    slot->next_free = vm->future_free;
+    vm->future_free = index;
+    vm->pending_count--;
+    vega_obj_release(future);
+}
 
-    // str::len(s) -> int
-    if (strcmp(name, "str::len") == 0 && argc == 1) {
-        if (args[0].type != VAL_STRING) return value_int(0);
-        return value_int(args[0].as.string->length);
+// Drive one tracked future's agent: publish streamed text, and settle the
+// future once the agent has its final response
+static void vm_poll_future(VegaVM* vm, VegaFuture* future) {
+    VegaAgent* agent = future->agent;
+    if (!agent || !agent_has_pending_request(agent)) return;
+
+    int poll_result = agent_poll_message(agent);
+
+    // Publish streamed text before the request is consumed
+    char* text = agent_take_stream_text(agent);
+    if (text) {
+        future_append_partial(future, text, strlen(text));
+        free(text);
     }
+    if (poll_result == 0) return;  // Still pending
 
-    // str::contains(s, substr) -> bool
-    if (strcmp(name, "str::contains") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_STRING) {
-            return value_bool(false);
-        }
-        return value_bool(vega_string_contains(args[0].as.string, args[1].as.string));
+    // Finished, or failed without a response: either way the agent
+    // consumes the request and reports what happened
+    VegaString* response = agent_get_message_result(vm, agent);
+    if (response == NULL) {
+        return;  // A tool loop or retry started; its requests post again
+    }
+    if (agent->failed) {
+        future_set_error(future, response->data);
+    } else {
+        future_set_result(future, response);
     }
+    vega_obj_release(response);
+    if (future->waiter) {
+        scheduler_unblock(&vm->scheduler, future->waiter);
+    }
+    future_table_remove(vm, future);
+}
 
-    // str::char_at(s, index) -> str (single character)
-    if (strcmp(name, "str::char_at") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_INT) {
-            return value_null();
-        }
-        VegaString* s = args[0].as.string;
-        int64_t idx = args[1].as.integer;
-        if (idx < 0 || (uint32_t)idx >= s->length) {
-            return value_string(vega_string_new("", 0));
-        }
-        char buf[2] = {s->data[idx], '\0'};
-        return value_string(vega_string_new(buf, 1));
+// ============================================================================
+// Parked Processes
+// ============================================================================
+
+// A scheduled process's sync send tags its requests with its pid. Future
+// tokens always have a generation in the high half, so the two never mix.
+static uint32_t vm_current_pid(VegaVM* vm) {
+    VegaProcess* proc = vm->scheduler.current;
+    return proc && vm->context == &proc->context ? proc->pid : 0;
+}
+
+static bool token_is_pid(uint64_t token) {
+    return (token >> 32) == 0;
+}
+
+// Ask for the current process to be woken when a pending future settles.
+// Fails if another parked process already waits on it.
+static bool future_claim(VegaVM* vm, VegaFuture* future, uint32_t pid) {
+    if (future->state != FUTURE_PENDING) return false;
+    if (future->waiter && future->waiter != pid) {
+        VegaProcess* other = scheduler_find(&vm->scheduler, future->waiter);
+        if (other && other->state == PROC_WAITING) return false;
     }
+    future->waiter = pid;
+    return true;
+}
 
-    // str::from_int(n) -> str
-    if (strcmp(name, "str::from_int") == 0 && argc == 1) {
-        if (args[0].type != VAL_INT) {
-            return value_string(vega_string_from_cstr(""));
-        }
-        char buf[32];
-        snprintf(buf, sizeof(buf), "%lld", (long long)args[0].as.integer);
-        return value_string(vega_string_from_cstr(buf));
+// Stop dispatch to wait on futures (single, or the pending ones of group).
+// A scheduled process parks until one settles and wakes it by pid; if it
+// could claim none of them, it yields and looks again instead.
+static void vm_block_on_futures(VegaVM* vm, VegaFuture* single, VegaArray* group) {
+    vm->async_blocked = true;
+    uint32_t pid = vm_current_pid(vm);
+    if (!pid) return;
+
+    bool claimed = single && future_claim(vm, single, pid);
+    for (uint32_t i = 0; group && i < group->count; i++) {
+        claimed |= future_claim(vm, value_as_future(group->items[i]), pid);
     }
+    vm->async_yield = !claimed;
+}
 
-    // str::split(s, delimiter) -> str[] (array of strings)
-    if (strcmp(name, "str::split") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_STRING) {
-            return (Value){.type = VAL_ARRAY, .as.array = array_new(0)};
-        }
-        VegaString* s = args[0].as.string;
-        VegaString* delim = args[1].as.string;
+// ============================================================================
+// Polling
+// ============================================================================
 
-        VegaArray* result = array_new(8);
+void vm_poll_events(VegaVM* vm) {
+    // Fire due timers first: retry backoffs resend, deadlines abort and
+    // sleeping processes wake, all before their results are looked for
+    if (vm->scheduler.timers.count > 0) {
+        timer_wheel_advance(&vm->scheduler.timers, timer_now_ms(), vm);
+    }
 
-        if (delim->length == 0) {
-            // Empty delimiter - return array with original string
-            array_push(result, value_string(s));
-            vega_obj_retain(s);
-            return (Value){.type = VAL_ARRAY, .as.array = result};
+    // Anything that lands after this read wakes vm_wait_async
+    uint64_t epoch = http_async_events();
+    vm->async_epoch = epoch;
+
+    // Futures of <~ sends and parked sync sends: only those whose requests
+    // posted a token. Tokens are posted with an event, so an unchanged
+    // count means none are new.
+    bool listening = vm->pending_count > 0 || vm->scheduler.waiting_count > 0;
+    if (listening && epoch != vm->ready_epoch) {
+        vm->ready_epoch = epoch;
+        uint64_t* tokens;
+        uint32_t count;
+        if (http_async_take_ready(&tokens, &count)) {
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t index = (uint32_t)tokens[i];
+                if (token_is_pid(tokens[i])) {
+                    scheduler_unblock(&vm->scheduler, index);
+                } else if (index < vm->future_slot_count && vm->future_slots[index].future &&
+                           future_token(vm, index) == tokens[i]) {
+                    vm_poll_future(vm, vm->future_slots[index].future);
+                }
+            }
+        } else {
+            for (uint32_t i = 0; i < vm->future_slot_count; i++) {
+                if (vm->future_slots[i].future) {
+                    vm_poll_future(vm, vm->future_slots[i].future);
+                }
+            }
+            for (uint32_t i = 0; i < vm->process_count; i++) {
+                scheduler_unblock(&vm->scheduler, vm->processes[i]->pid);
+            }
         }
+        free(tokens);
+    }
+}
 
-        const char* start = s->data;
-        const char* end = s->data + s->length;
-        const char* pos;
+// Drive pending async requests. Returns true if the VM is blocked waiting
+// on a synchronous send and must not execute further instructions yet.
+static bool vm_poll_async(VegaVM* vm) {
+    vm_poll_events(vm);
 
-        while ((pos = strstr(start, delim->data)) != NULL && start < end) {
-            uint32_t len = pos - start;
-            VegaString* part = vega_string_new(start, len);
-            array_push(result, value_string(part));
-            start = pos + delim->length;
+    // Check if waiting for async agent response (synchronous send)
+    if (vm->waiting_for_agent) {
+        VegaAgent* agent = vm->waiting_for_agent;
+        int poll_result = agent_poll_message(agent);
+        free(agent_take_stream_text(agent));  // Traced for the TUI
+        if (poll_result == 0) {
+            // Still pending (or backing off before a retry) - stay blocked
+            return true;
         }
 
-        // Add remaining part
-        if (start <= end) {
-            uint32_t len = end - start;
-            VegaString* part = vega_string_new(start, len);
-            array_push(result, value_string(part));
+        // HTTP complete or failed - clear waiting state BEFORE get_result
+        // (get_result may call execute_tool which calls vm_step)
+        vm->waiting_for_agent = NULL;
+        Value saved_msg = vm->waiting_msg;
+        vm->waiting_msg = value_null();
+
+        // Get result (may trigger another async request for tool loop or
+        // a retry); failures come back as error text
+        VegaString* response = agent_get_message_result(vm, agent);
+        if (response == NULL) {
+            // Tool loop or retry in progress
+            vm->waiting_for_agent = agent;
+            vm->waiting_msg = saved_msg;
+            return true;
         }
+        // Got final result
+        value_release(saved_msg);
+        vm_push(vm, value_string(response));
+    }
+
+    return false;
+}
+
+// ============================================================================
+// Await Combinators
+// ============================================================================
 
-        return (Value){.type = VAL_ARRAY, .as.array = result};
+// What awaiting a settled future yields: its response, or its error text
+static Value future_value(VegaFuture* future) {
+    if (future->state == FUTURE_READY) {
+        if (!future->result) return value_null();
+        vega_obj_retain(future->result);
+        return value_string(future->result);
     }
+    const char* err = future->error ? future->error : "Unknown error";
+    return value_string(vega_string_from_cstr(err));
+}
 
-    // str::char_code(c) -> int (ASCII value of first char)
-    if (strcmp(name, "str::char_code") == 0 && argc == 1) {
-        if (args[0].type != VAL_STRING || args[0].as.string->length == 0) {
-            return value_int(0);
+static bool value_is_future_array(Value v) {
+    if (value_type(v) != VAL_ARRAY || !value_as_array(v)) return false;
+    VegaArray* arr = value_as_array(v);
+    for (uint32_t i = 0; i < arr->count; i++) {
+        if (value_type(arr->items[i]) != VAL_FUTURE || !value_as_future(arr->items[i])) {
+            return false;
         }
-        return value_int((unsigned char)args[0].as.string->data[0]);
     }
+    return true;
+}
 
-    // str::char_lower(c) -> str (lowercase single char)
-    if (strcmp(name, "str::char_lower") == 0 && argc == 1) {
-        if (args[0].type != VAL_STRING || args[0].as.string->length == 0) {
-            return value_string(vega_string_new("", 0));
-        }
-        char c = args[0].as.string->data[0];
-        if (c >= 'A' && c <= 'Z') {
-            c = c + ('a' - 'A');
-        }
-        char buf[2] = {c, '\0'};
-        return value_string(vega_string_new(buf, 1));
+// Whether an await over a group must keep waiting: for every future to
+// settle (all), or for need successes while that many are still possible
+static bool future_group_waiting(VegaArray* futures, bool all, uint32_t need) {
+    uint32_t ok = 0, pending = 0;
+    for (uint32_t i = 0; i < futures->count; i++) {
+        VegaFuture* f = value_as_future(futures->items[i]);
+        if (f->state == FUTURE_READY) ok++;
+        else if (f->state == FUTURE_PENDING) pending++;
     }
+    if (all) return pending > 0;
+    return ok < need && ok + pending >= need;
+}
 
-    // str::split_len(s, delimiter) -> int (count of parts after split)
-    if (strcmp(name, "str::split_len") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_STRING) {
-            return value_int(0);
-        }
-        VegaString* s = args[0].as.string;
-        VegaString* delim = args[1].as.string;
+// Successes before failures, each in the order they settled
+static int future_settled_cmp(const void* a, const void* b) {
+    const VegaFuture* fa = *(VegaFuture* const*)a;
+    const VegaFuture* fb = *(VegaFuture* const*)b;
+    if (fa->state != fb->state) return fa->state == FUTURE_READY ? -1 : 1;
+    return fa->settled < fb->settled ? -1 : fa->settled > fb->settled;
+}
 
-        if (delim->length == 0) return value_int(1);
+// The first n settled futures of a group, successes first; pending ones
+// are cancelled: nobody awaits them any more, and their agents are freed
+// for the next send
+static VegaArray* future_take_first(VegaVM* vm, VegaArray* futures, uint32_t n) {
+    VegaFuture** settled = malloc((futures->count + 1) * sizeof(VegaFuture*));
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < futures->count; i++) {
+        VegaFuture* f = value_as_future(futures->items[i]);
+        if (future_is_ready(f)) {
+            if (settled) settled[count++] = f;
+            continue;
+        }
+        if (f->agent && agent_has_pending_request(f->agent)) {
+            agent_cancel_pending(f->agent);
+        }
+        future_set_error(f, "Cancelled");
+        future_table_remove(vm, f);
+    }
 
-        int count = 1;
-        const char* pos = s->data;
-        while ((pos = strstr(pos, delim->data)) != NULL) {
-            count++;
-            pos += delim->length;
+    VegaArray* results = array_new(n);
+    if (settled) {
+        qsort(settled, count, sizeof(VegaFuture*), future_settled_cmp);
+        for (uint32_t i = 0; i < count && i < n; i++) {
+            Value v = future_value(settled[i]);
+            array_push(results, v);
+            value_release(v);
         }
-        return value_int(count);
+        free(settled);
     }
+    return results;
+}
 
-    // http::get(url) -> str (response body)
-    if (strcmp(name, "http::get") == 0 && argc == 1) {
-        if (args[0].type != VAL_STRING) {
-            return value_string(vega_string_from_cstr(""));
-        }
-        HttpResponse* resp = http_get(args[0].as.string->data);
-        if (!resp) {
-            return value_string(vega_string_from_cstr(""));
-        }
-        VegaString* result;
-        if (resp->body) {
-            result = vega_string_new(resp->body, (uint32_t)resp->body_len);
-        } else if (resp->error) {
-            result = vega_string_from_cstr(resp->error);
-        } else {
-            result = vega_string_from_cstr("");
-        }
-        http_response_free(resp);
-        return value_string(result);
+// Run bytecode until the program stops, an error occurs, or the VM blocks on
+// async work. With single_step set, at most one instruction is executed.
+// Returns vm->running.
+static VM_NOINLINE bool vm_dispatch(VegaVM* vm, bool single_step) {
+    vm->async_blocked = false;
+    vm->async_yield = false;
+    if (!vm->running || vm->ip >= vm->code_size) {
+        return false;
     }
 
-    // json::get_string(json, key) -> str
-    if (strcmp(name, "json::get_string") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_STRING) {
-            return value_string(vega_string_from_cstr(""));
-        }
-        const char* json = args[0].as.string->data;
-        const char* key = args[1].as.string->data;
+    uint8_t* code = vm->code;
+    uint8_t* ip = code + vm->ip;
+    Value* stack = vm->stack;
+    Value* stack_end = vm->stack + vm->stack_capacity;
+    Value* sp = stack + vm->sp;
+    Value* slots = stack + (vm->frame_count > 0 ? vm->frames[vm->frame_count - 1].bp : 0);
+
+#define READ_BYTE()  (*ip++)
+#define READ_SHORT() (ip += 2, READ_U16(ip, -2))
+#define READ_WORD()  (ip += 4, READ_U32(ip, -4))
+
+#define SAVE_STATE() do { \
+        vm->ip = (uint32_t)(ip - code); \
+        vm->sp = (uint32_t)(sp - stack); \
+    } while (0)
+
+#define LOAD_STATE() do { \
+        code = vm->code; \
+        stack = vm->stack; \
+        stack_end = stack + vm->stack_capacity; \
+        ip = code + vm->ip; \
+        sp = stack + vm->sp; \
+        slots = stack + (vm->frame_count > 0 ? vm->frames[vm->frame_count - 1].bp : 0); \
+    } while (0)
+
+// The stack is reallocated when full, so every cached pointer is rebased
+#define RESERVE(n) do { \
+        SAVE_STATE(); \
+        if (!vm_reserve_stack(vm, (n))) return false; \
+        LOAD_STATE(); \
+    } while (0)
+
+#define PUSH(v) do { \
+        if (sp >= stack_end) RESERVE(1); \
+        *sp++ = (v); \
+    } while (0)
+
+#define POP()  (sp > stack ? *--sp : vm_stack_underflow(vm))
+#define PEEK() (sp > stack ? sp[-1] : value_null())
+
+#define RUNTIME_ERROR(...) do { \
+        SAVE_STATE(); \
+        vm_runtime_error(vm, __VA_ARGS__); \
+        return false; \
+    } while (0)
+
+// Poll async work; leave the loop if the VM is blocked or was stopped
+#define SAFEPOINT() do { \
+        SAVE_STATE(); \
+        if (vm_poll_async(vm)) { \
+            vm->async_blocked = true; \
+            return vm->running; \
+        } \
+        if (!vm->running) return false; \
+        LOAD_STATE(); \
+    } while (0)
+
+#if VM_COMPUTED_GOTO
+    static void* op_table[256];
+    static void* step_table[256];
+    static bool tables_ready = false;
+    if (!tables_ready) {
+        for (int i = 0; i < 256; i++) {
+            op_table[i] = &&op_unknown;
+            step_table[i] = &&step_done;
+        }
+        op_table[OP_NOP] = &&op_nop;
+        op_table[OP_PUSH_CONST] = &&op_push_const;
+        op_table[OP_PUSH_INT] = &&op_push_int;
+        op_table[OP_PUSH_TRUE] = &&op_push_true;
+        op_table[OP_PUSH_FALSE] = &&op_push_false;
+        op_table[OP_PUSH_NULL] = &&op_push_null;
+        op_table[OP_POP] = &&op_pop;
+        op_table[OP_DUP] = &&op_dup;
+        op_table[OP_LOAD_LOCAL] = &&op_load_local;
+        op_table[OP_STORE_LOCAL] = &&op_store_local;
+        op_table[OP_LOAD_GLOBAL] = &&op_load_global;
+        op_table[OP_STORE_GLOBAL] = &&op_store_global;
+        op_table[OP_ADD] = &&op_add;
+        op_table[OP_SUB] = &&op_sub;
+        op_table[OP_MUL] = &&op_mul;
+        op_table[OP_DIV] = &&op_div;
+        op_table[OP_MOD] = &&op_mod;
+        op_table[OP_NEG] = &&op_neg;
+        op_table[OP_EQ] = &&op_eq;
+        op_table[OP_NE] = &&op_ne;
+        op_table[OP_LT] = &&op_lt;
+        op_table[OP_LE] = &&op_le;
+        op_table[OP_GT] = &&op_gt;
+        op_table[OP_GE] = &&op_ge;
+        op_table[OP_NOT] = &&op_not;
+        op_table[OP_AND] = &&op_and;
+        op_table[OP_OR] = &&op_or;
+        op_table[OP_JUMP] = &&op_jump;
+        op_table[OP_JUMP_IF] = &&op_jump_if;
+        op_table[OP_JUMP_IF_NOT] = &&op_jump_if_not;
+        op_table[OP_LOAD_LOCAL2] = &&op_load_local2;
+        op_table[OP_INC_LOCAL] = &&op_inc_local;
+        op_table[OP_DEC_LOCAL] = &&op_dec_local;
+        op_table[OP_JUMP_IF_NOT_EQ] = &&op_jump_if_not_eq;
+        op_table[OP_JUMP_IF_NOT_NE] = &&op_jump_if_not_ne;
+        op_table[OP_JUMP_IF_NOT_LT] = &&op_jump_if_not_lt;
+        op_table[OP_JUMP_IF_NOT_LE] = &&op_jump_if_not_le;
+        op_table[OP_JUMP_IF_NOT_GT] = &&op_jump_if_not_gt;
+        op_table[OP_JUMP_IF_NOT_GE] = &&op_jump_if_not_ge;
+        op_table[OP_JUMP_IF_NOT_EQ_II] = &&op_jump_if_not_eq_ii;
+        op_table[OP_JUMP_IF_NOT_NE_II] = &&op_jump_if_not_ne_ii;
+        op_table[OP_JUMP_IF_NOT_LT_II] = &&op_jump_if_not_lt_ii;
+        op_table[OP_JUMP_IF_NOT_LE_II] = &&op_jump_if_not_le_ii;
+        op_table[OP_JUMP_IF_NOT_GT_II] = &&op_jump_if_not_gt_ii;
+        op_table[OP_JUMP_IF_NOT_GE_II] = &&op_jump_if_not_ge_ii;
+        op_table[OP_ADD_II] = &&op_add_ii;
+        op_table[OP_SUB_II] = &&op_sub_ii;
+        op_table[OP_MUL_II] = &&op_mul_ii;
+        op_table[OP_DIV_II] = &&op_div_ii;
+        op_table[OP_MOD_II] = &&op_mod_ii;
+        op_table[OP_EQ_II] = &&op_eq_ii;
+        op_table[OP_NE_II] = &&op_ne_ii;
+        op_table[OP_LT_II] = &&op_lt_ii;
+        op_table[OP_LE_II] = &&op_le_ii;
+        op_table[OP_GT_II] = &&op_gt_ii;
+        op_table[OP_GE_II] = &&op_ge_ii;
+        op_table[OP_ADD_FF] = &&op_add_ff;
+        op_table[OP_SUB_FF] = &&op_sub_ff;
+        op_table[OP_MUL_FF] = &&op_mul_ff;
+        op_table[OP_DIV_FF] = &&op_div_ff;
+        op_table[OP_LT_FF] = &&op_lt_ff;
+        op_table[OP_LE_FF] = &&op_le_ff;
+        op_table[OP_GT_FF] = &&op_gt_ff;
+        op_table[OP_GE_FF] = &&op_ge_ff;
+        op_table[OP_CALL] = &&op_call;
+        op_table[OP_RETURN] = &&op_return;
+        op_table[OP_CALL_NATIVE] = &&op_call_native;
+        op_table[OP_SPAWN_AGENT] = &&op_spawn_agent;
+        op_table[OP_SEND_MSG] = &&op_send_msg;
+        op_table[OP_SPAWN_ASYNC] = &&op_spawn_async;
+        op_table[OP_AWAIT] = &&op_await;
+        op_table[OP_SEND_ASYNC] = &&op_send_async;
+        op_table[OP_AWAIT_ALL] = &&op_await_all;
+        op_table[OP_AWAIT_ANY] = &&op_await_any;
+        op_table[OP_AWAIT_FIRST] = &&op_await_first;
+        op_table[OP_CALL_METHOD] = &&op_call_method;
+        op_table[OP_STR_HAS] = &&op_str_has;
+        op_table[OP_ARRAY_NEW] = &&op_array_new;
+        op_table[OP_ARRAY_PUSH] = &&op_array_push;
+        op_table[OP_ARRAY_GET] = &&op_array_get;
+        op_table[OP_ARRAY_SET] = &&op_array_set;
+        op_table[OP_ARRAY_LEN] = &&op_array_len;
+        op_table[OP_RESULT_OK] = &&op_result_ok;
+        op_table[OP_RESULT_ERR] = &&op_result_err;
+        op_table[OP_RESULT_IS_OK] = &&op_result_is_ok;
+        op_table[OP_RESULT_UNWRAP] = &&op_result_unwrap;
+        op_table[OP_YIELD] = &&op_yield;
+        op_table[OP_SLEEP] = &&op_sleep;
+        op_table[OP_SPAWN_SUPERVISED] = &&op_spawn_supervised;
+        op_table[OP_PRINT] = &&op_print;
+        op_table[OP_HALT] = &&op_halt;
+        tables_ready = true;
+    }
 
-        // Build search pattern: "key":
-        char pattern[256];
-        snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    // In single-step mode every dispatch after the first lands on step_done
+    void** dispatch = single_step ? step_table : op_table;
+
+#define CASE(label, opcode) label:
+#define DISPATCH() goto *dispatch[*ip++]
+#else
+#define CASE(label, opcode) case opcode:
+#define DISPATCH() do { if (single_step) goto step_done; goto dispatch_switch; } while (0)
+#endif
+
+    // The entry point is a safepoint
+    SAFEPOINT();
+
+#if VM_COMPUTED_GOTO
+    goto *op_table[*ip++];
+#else
+dispatch_switch:
+    switch (*ip++) {
+#endif
+
+    CASE(op_nop, OP_NOP)
+        DISPATCH();
+
+    CASE(op_push_const, OP_PUSH_CONST) {
+        // Operand is a const_values index (rewritten by vm_link); string
+        // constants are interned, so no retain is needed
+        uint16_t idx = READ_SHORT();
+        PUSH(vm->const_values[idx]);
+        DISPATCH();
+    }
+
+    CASE(op_push_int, OP_PUSH_INT) {
+        int32_t val = (int32_t)READ_WORD();
+        PUSH(value_int(val));
+        DISPATCH();
+    }
 
-        const char* pos = strstr(json, pattern);
-        if (!pos) return value_string(vega_string_from_cstr(""));
+    CASE(op_push_true, OP_PUSH_TRUE)
+        PUSH(value_bool(true));
+        DISPATCH();
 
-        pos += strlen(pattern);
-        while (*pos == ' ' || *pos == '\t' || *pos == '\n') pos++;
+    CASE(op_push_false, OP_PUSH_FALSE)
+        PUSH(value_bool(false));
+        DISPATCH();
 
-        if (*pos != '"') return value_string(vega_string_from_cstr(""));
-        pos++;
+    CASE(op_push_null, OP_PUSH_NULL)
+        PUSH(value_null());
+        DISPATCH();
 
-        const char* end = pos;
-        while (*end && *end != '"') {
-            if (*end == '\\' && *(end + 1)) end += 2;
-            else end++;
-        }
+    CASE(op_pop, OP_POP)
+        value_release(POP());
+        DISPATCH();
 
-        VegaString* result = vega_string_new(pos, (uint32_t)(end - pos));
-        return value_string(result);
+    CASE(op_dup, OP_DUP) {
+        Value v = PEEK();
+        value_retain(v);
+        PUSH(v);
+        DISPATCH();
     }
 
-    // json::get_float(json, key) -> float
-    if (strcmp(name, "json::get_float") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_STRING) {
-            return value_float(0.0);
-        }
-        const char* json = args[0].as.string->data;
-        const char* key = args[1].as.string->data;
+    CASE(op_load_local, OP_LOAD_LOCAL) {
+        uint8_t slot = READ_BYTE();
+        Value v = slots[slot];
+        value_retain(v);
+        PUSH(v);
+        DISPATCH();
+    }
 
-        char pattern[256];
-        snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    CASE(op_store_local, OP_STORE_LOCAL) {
+        uint8_t slot = READ_BYTE();
+        Value v = POP();
+        value_release(slots[slot]);
+        slots[slot] = v;
+        DISPATCH();
+    }
 
-        const char* pos = strstr(json, pattern);
-        if (!pos) return value_float(0.0);
+    CASE(op_load_global, OP_LOAD_GLOBAL) {
+        // Operand is a global slot (rewritten by vm_link)
+        uint16_t slot = READ_SHORT();
+        Value v = vm->globals[slot];
+        value_retain(v);
+        PUSH(v);
+        DISPATCH();
+    }
 
-        pos += strlen(pattern);
-        while (*pos == ' ' || *pos == '\t' || *pos == '\n') pos++;
+    CASE(op_store_global, OP_STORE_GLOBAL) {
+        uint16_t slot = READ_SHORT();
+        Value v = POP();
+        value_release(vm->globals[slot]);
+        vm->globals[slot] = v;
+        DISPATCH();
+    }
 
-        double val = atof(pos);
-        return value_float(val);
+    CASE(op_add, OP_ADD) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_add(a, b));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
     }
 
-    // json::get_int(json, key) -> int
-    if (strcmp(name, "json::get_int") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_STRING) {
-            return value_int(0);
-        }
-        const char* json = args[0].as.string->data;
-        const char* key = args[1].as.string->data;
+    CASE(op_sub, OP_SUB) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_sub(a, b));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        char pattern[256];
-        snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    CASE(op_mul, OP_MUL) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_mul(a, b));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        const char* pos = strstr(json, pattern);
-        if (!pos) return value_int(0);
+    CASE(op_div, OP_DIV) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_div(a, b));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        pos += strlen(pattern);
-        while (*pos == ' ' || *pos == '\t' || *pos == '\n') pos++;
+    CASE(op_mod, OP_MOD) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_mod(a, b));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        int val = atoi(pos);
-        return value_int(val);
+    CASE(op_neg, OP_NEG) {
+        Value v = POP();
+        PUSH(value_neg(v));
+        value_release(v);
+        DISPATCH();
     }
 
-    // json::get_array(json, key) -> str (array as JSON string)
-    if (strcmp(name, "json::get_array") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_STRING) {
-            return value_string(vega_string_from_cstr("[]"));
-        }
-        const char* json = args[0].as.string->data;
-        const char* key = args[1].as.string->data;
+    CASE(op_eq, OP_EQ) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_bool(value_equals(a, b)));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        char pattern[256];
-        snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    CASE(op_ne, OP_NE) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_bool(!value_equals(a, b)));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        const char* pos = strstr(json, pattern);
-        if (!pos) return value_string(vega_string_from_cstr("[]"));
+    CASE(op_lt, OP_LT) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_bool(value_compare(a, b) < 0));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        pos += strlen(pattern);
-        while (*pos == ' ' || *pos == '\t' || *pos == '\n') pos++;
+    CASE(op_le, OP_LE) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_bool(value_compare(a, b) <= 0));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        if (*pos != '[') return value_string(vega_string_from_cstr("[]"));
+    CASE(op_gt, OP_GT) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_bool(value_compare(a, b) > 0));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        const char* start = pos;
-        int depth = 1;
-        pos++;
-        while (*pos && depth > 0) {
-            if (*pos == '[') depth++;
-            else if (*pos == ']') depth--;
-            else if (*pos == '"') {
-                pos++;
-                while (*pos && *pos != '"') {
-                    if (*pos == '\\' && *(pos + 1)) pos++;
-                    pos++;
-                }
-            }
-            pos++;
-        }
+    CASE(op_ge, OP_GE) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_bool(value_compare(a, b) >= 0));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        VegaString* result = vega_string_new(start, (uint32_t)(pos - start));
-        return value_string(result);
+    CASE(op_not, OP_NOT) {
+        Value v = POP();
+        PUSH(value_bool(!value_is_truthy(v)));
+        value_release(v);
+        DISPATCH();
     }
 
-    // json::array_len(array_json) -> int
-    if (strcmp(name, "json::array_len") == 0 && argc == 1) {
-        if (args[0].type != VAL_STRING) {
-            return value_int(0);
-        }
-        const char* json = args[0].as.string->data;
-        if (!json || *json != '[') return value_int(0);
+    CASE(op_and, OP_AND) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_bool(value_is_truthy(a) && value_is_truthy(b)));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        int count = 0;
-        int depth = 0;
-        bool in_string = false;
+    CASE(op_or, OP_OR) {
+        Value b = POP();
+        Value a = POP();
+        PUSH(value_bool(value_is_truthy(a) || value_is_truthy(b)));
+        value_release(a);
+        value_release(b);
+        DISPATCH();
+    }
 
-        for (const char* p = json; *p; p++) {
-            if (in_string) {
-                if (*p == '\\' && *(p + 1)) p++;
-                else if (*p == '"') in_string = false;
-                continue;
-            }
-            if (*p == '"') in_string = true;
-            else if (*p == '[') depth++;
-            else if (*p == ']') depth--;
-            else if (*p == ',' && depth == 1) count++;
+    CASE(op_jump, OP_JUMP) {
+        int16_t offset = (int16_t)READ_SHORT();
+        ip += offset;
+        if (offset < 0) {
+            // Backward jump closes a loop
+            SAFEPOINT();
         }
+        DISPATCH();
+    }
 
-        // If we have any content, count is items - 1, so add 1
-        const char* p = json + 1;
-        while (*p == ' ' || *p == '\t' || *p == '\n') p++;
-        if (*p != ']') count++;
-
-        return value_int(count);
+    CASE(op_jump_if, OP_JUMP_IF) {
+        int16_t offset = (int16_t)READ_SHORT();
+        Value cond = POP();
+        if (value_is_truthy(cond)) {
+            ip += offset;
+        }
+        value_release(cond);
+        DISPATCH();
     }
 
-    // json::array_get(array_json, index) -> str
-    if (strcmp(name, "json::array_get") == 0 && argc == 2) {
-        if (args[0].type != VAL_STRING || args[1].type != VAL_INT) {
-            return value_string(vega_string_from_cstr(""));
+    CASE(op_jump_if_not, OP_JUMP_IF_NOT) {
+        int16_t offset = (int16_t)READ_SHORT();
+        Value cond = POP();
+        if (!value_is_truthy(cond)) {
+            ip += offset;
         }
-        const char* json = args[0].as.string->data;
-        int64_t target_idx = args[1].as.integer;
+        value_release(cond);
+        DISPATCH();
+    }
 
-        if (!json || *json != '[') return value_string(vega_string_from_cstr(""));
+    // Superinstructions (see the codegen peephole pass)
 
-        int current_idx = 0;
-        int depth = 0;
-        bool in_string = false;
-        const char* item_start = NULL;
+    CASE(op_load_local2, OP_LOAD_LOCAL2) {
+        Value a = slots[READ_BYTE()];
+        Value b = slots[READ_BYTE()];
+        value_retain(a);
+        value_retain(b);
+        PUSH(a);
+        PUSH(b);
+        DISPATCH();
+    }
 
-        for (const char* p = json; *p; p++) {
-            if (in_string) {
-                if (*p == '\\' && *(p + 1)) p++;
-                else if (*p == '"') in_string = false;
-                continue;
-            }
-            if (*p == '"') {
-                in_string = true;
-                if (depth == 1 && item_start == NULL) {
-                    item_start = p;
-                }
-            }
-            else if (*p == '[') {
-                depth++;
-                if (depth == 1) {
-                    const char* next = p + 1;
-                    while (*next == ' ' || *next == '\t' || *next == '\n') next++;
-                    if (*next != ']') item_start = next;
-                }
-            }
-            else if (*p == ']') {
-                if (depth == 1 && current_idx == target_idx && item_start) {
-                    if (*item_start == '"') {
-                        item_start++;
-                        const char* end = item_start;
-                        while (*end && *end != '"') {
-                            if (*end == '\\' && *(end + 1)) end++;
-                            end++;
-                        }
-                        return value_string(vega_string_new(item_start, (uint32_t)(end - item_start)));
-                    }
-                }
-                depth--;
-            }
-            else if (*p == ',' && depth == 1) {
-                if (current_idx == target_idx && item_start) {
-                    if (*item_start == '"') {
-                        item_start++;
-                        const char* end = item_start;
-                        while (*end && *end != '"') {
-                            if (*end == '\\' && *(end + 1)) end++;
-                            end++;
-                        }
-                        return value_string(vega_string_new(item_start, (uint32_t)(end - item_start)));
-                    }
-                }
-                current_idx++;
-                item_start = NULL;
-                const char* next = p + 1;
-                while (*next == ' ' || *next == '\t' || *next == '\n') next++;
-                item_start = next;
-            }
-        }
-
-        return value_string(vega_string_from_cstr(""));
+    CASE(op_inc_local, OP_INC_LOCAL) {
+        uint8_t slot = READ_BYTE();
+        int8_t imm = (int8_t)READ_BYTE();
+        Value v = slots[slot];
+        slots[slot] = value_type(v) == VAL_INT ? value_int(value_as_int(v) + imm)
+                                               : value_add(v, value_int(imm));
+        value_release(v);
+        DISPATCH();
     }
 
-    return value_null();
-}
-
-// ============================================================================
-// Execution
-// ============================================================================
-
-bool vm_step(VegaVM* vm) {
-    if (!vm->running || vm->ip >= vm->code_size) {
-        return false;
+    CASE(op_dec_local, OP_DEC_LOCAL) {
+        uint8_t slot = READ_BYTE();
+        int8_t imm = (int8_t)READ_BYTE();
+        Value v = slots[slot];
+        slots[slot] = value_type(v) == VAL_INT ? value_int(value_as_int(v) - imm)
+                                               : value_sub(v, value_int(imm));
+        value_release(v);
+        DISPATCH();
     }
 
-    // Always poll all pending async futures first (from <~ sends)
-    // This ensures all async agents make progress even during awaits
-    for (uint32_t i = 0; i < vm->pending_count; i++) {
-        VegaFuture* future = vm->pending_futures[i];
-        if (!future || future_is_ready(future)) continue;
+// Pop two operands and take the branch when the comparison is false
+#define COMPARE_JUMP_IF_NOT(cond) do { \
+        int16_t offset = (int16_t)READ_SHORT(); \
+        Value b = POP(); \
+        Value a = POP(); \
+        bool taken = !(cond); \
+        value_release(a); \
+        value_release(b); \
+        if (taken) { \
+            ip += offset; \
+            if (offset < 0) SAFEPOINT(); \
+        } \
+    } while (0)
+
+    CASE(op_jump_if_not_eq, OP_JUMP_IF_NOT_EQ)
+        COMPARE_JUMP_IF_NOT(value_equals(a, b));
+        DISPATCH();
+
+    CASE(op_jump_if_not_ne, OP_JUMP_IF_NOT_NE)
+        COMPARE_JUMP_IF_NOT(!value_equals(a, b));
+        DISPATCH();
+
+    CASE(op_jump_if_not_lt, OP_JUMP_IF_NOT_LT)
+        COMPARE_JUMP_IF_NOT(value_compare(a, b) < 0);
+        DISPATCH();
+
+    CASE(op_jump_if_not_le, OP_JUMP_IF_NOT_LE)
+        COMPARE_JUMP_IF_NOT(value_compare(a, b) <= 0);
+        DISPATCH();
+
+    CASE(op_jump_if_not_gt, OP_JUMP_IF_NOT_GT)
+        COMPARE_JUMP_IF_NOT(value_compare(a, b) > 0);
+        DISPATCH();
+
+    CASE(op_jump_if_not_ge, OP_JUMP_IF_NOT_GE)
+        COMPARE_JUMP_IF_NOT(value_compare(a, b) >= 0);
+        DISPATCH();
+
+// Int compare-and-branch; non-int operands take the generic comparison
+#define COMPARE_JUMP_IF_NOT_II(op, generic) \
+        COMPARE_JUMP_IF_NOT(value_is_inline_int(a) && value_is_inline_int(b) \
+                            ? value_as_int(a) op value_as_int(b) : (generic))
+
+    CASE(op_jump_if_not_eq_ii, OP_JUMP_IF_NOT_EQ_II)
+        COMPARE_JUMP_IF_NOT_II(==, value_equals(a, b));
+        DISPATCH();
+
+    CASE(op_jump_if_not_ne_ii, OP_JUMP_IF_NOT_NE_II)
+        COMPARE_JUMP_IF_NOT_II(!=, !value_equals(a, b));
+        DISPATCH();
+
+    CASE(op_jump_if_not_lt_ii, OP_JUMP_IF_NOT_LT_II)
+        COMPARE_JUMP_IF_NOT_II(<, value_compare(a, b) < 0);
+        DISPATCH();
+
+    CASE(op_jump_if_not_le_ii, OP_JUMP_IF_NOT_LE_II)
+        COMPARE_JUMP_IF_NOT_II(<=, value_compare(a, b) <= 0);
+        DISPATCH();
+
+    CASE(op_jump_if_not_gt_ii, OP_JUMP_IF_NOT_GT_II)
+        COMPARE_JUMP_IF_NOT_II(>, value_compare(a, b) > 0);
+        DISPATCH();
+
+    CASE(op_jump_if_not_ge_ii, OP_JUMP_IF_NOT_GE_II)
+        COMPARE_JUMP_IF_NOT_II(>=, value_compare(a, b) >= 0);
+        DISPATCH();
+
+#undef COMPARE_JUMP_IF_NOT_II
+#undef COMPARE_JUMP_IF_NOT
+
+    // Type-specialized operations. Codegen only emits these when sema proved
+    // the operand types, but sema can't see every value (array elements,
+    // arguments to untyped call sites), so the tags are re-checked: a hit
+    // skips the type dispatch and refcounting, a miss falls back to the
+    // generic operation.
+
+#define BINARY_SPECIALIZED(guard, fast, generic) do { \
+        Value b = POP(); \
+        Value a = POP(); \
+        if (guard) { \
+            PUSH(fast); \
+        } else { \
+            PUSH(generic); \
+            value_release(a); \
+            value_release(b); \
+        } \
+    } while (0)
+
+#define INT_GUARD   (value_is_inline_int(a) && value_is_inline_int(b))
+#define FLOAT_GUARD (value_is_float(a) && value_is_float(b))
+#define II(op)      (value_as_int(a) op value_as_int(b))
+#define FF(op)      (value_as_float(a) op value_as_float(b))
+
+    CASE(op_add_ii, OP_ADD_II)
+        BINARY_SPECIALIZED(INT_GUARD, value_int(II(+)),
+                           value_add(a, b));
+        DISPATCH();
+
+    CASE(op_sub_ii, OP_SUB_II)
+        BINARY_SPECIALIZED(INT_GUARD, value_int(II(-)),
+                           value_sub(a, b));
+        DISPATCH();
+
+    CASE(op_mul_ii, OP_MUL_II)
+        BINARY_SPECIALIZED(INT_GUARD, value_int(II(*)),
+                           value_mul(a, b));
+        DISPATCH();
+
+    CASE(op_div_ii, OP_DIV_II)
+        BINARY_SPECIALIZED(INT_GUARD && value_as_int(b) != 0, value_int(II(/)),
+                           value_div(a, b));
+        DISPATCH();
+
+    CASE(op_mod_ii, OP_MOD_II)
+        BINARY_SPECIALIZED(INT_GUARD && value_as_int(b) != 0, value_int(II(%)),
+                           value_mod(a, b));
+        DISPATCH();
+
+    CASE(op_eq_ii, OP_EQ_II)
+        BINARY_SPECIALIZED(INT_GUARD, value_bool(II(==)),
+                           value_bool(value_equals(a, b)));
+        DISPATCH();
+
+    CASE(op_ne_ii, OP_NE_II)
+        BINARY_SPECIALIZED(INT_GUARD, value_bool(II(!=)),
+                           value_bool(!value_equals(a, b)));
+        DISPATCH();
+
+    CASE(op_lt_ii, OP_LT_II)
+        BINARY_SPECIALIZED(INT_GUARD, value_bool(II(<)),
+                           value_bool(value_compare(a, b) < 0));
+        DISPATCH();
+
+    CASE(op_le_ii, OP_LE_II)
+        BINARY_SPECIALIZED(INT_GUARD, value_bool(II(<=)),
+                           value_bool(value_compare(a, b) <= 0));
+        DISPATCH();
+
+    CASE(op_gt_ii, OP_GT_II)
+        BINARY_SPECIALIZED(INT_GUARD, value_bool(II(>)),
+                           value_bool(value_compare(a, b) > 0));
+        DISPATCH();
+
+    CASE(op_ge_ii, OP_GE_II)
+        BINARY_SPECIALIZED(INT_GUARD, value_bool(II(>=)),
+                           value_bool(value_compare(a, b) >= 0));
+        DISPATCH();
+
+    CASE(op_add_ff, OP_ADD_FF)
+        BINARY_SPECIALIZED(FLOAT_GUARD, value_float(FF(+)),
+                           value_add(a, b));
+        DISPATCH();
+
+    CASE(op_sub_ff, OP_SUB_FF)
+        BINARY_SPECIALIZED(FLOAT_GUARD, value_float(FF(-)),
+                           value_sub(a, b));
+        DISPATCH();
+
+    CASE(op_mul_ff, OP_MUL_FF)
+        BINARY_SPECIALIZED(FLOAT_GUARD, value_float(FF(*)),
+                           value_mul(a, b));
+        DISPATCH();
+
+    CASE(op_div_ff, OP_DIV_FF)
+        BINARY_SPECIALIZED(FLOAT_GUARD && value_as_float(b) != 0.0, value_float(FF(/)),
+                           value_div(a, b));
+        DISPATCH();
+
+    CASE(op_lt_ff, OP_LT_FF)
+        BINARY_SPECIALIZED(FLOAT_GUARD, value_bool(FF(<)),
+                           value_bool(value_compare(a, b) < 0));
+        DISPATCH();
+
+    // value_compare() treats NaN as equal to everything, so <= and >= are
+    // "not greater" and "not less" rather than the IEEE operators
+    CASE(op_le_ff, OP_LE_FF)
+        BINARY_SPECIALIZED(FLOAT_GUARD, value_bool(!FF(>)),
+                           value_bool(value_compare(a, b) <= 0));
+        DISPATCH();
+
+    CASE(op_gt_ff, OP_GT_FF)
+        BINARY_SPECIALIZED(FLOAT_GUARD, value_bool(FF(>)),
+                           value_bool(value_compare(a, b) > 0));
+        DISPATCH();
+
+    CASE(op_ge_ff, OP_GE_FF)
+        BINARY_SPECIALIZED(FLOAT_GUARD, value_bool(!FF(<)),
+                           value_bool(value_compare(a, b) >= 0));
+        DISPATCH();
+
+#undef FF
+#undef II
+#undef FLOAT_GUARD
+#undef INT_GUARD
+#undef BINARY_SPECIALIZED
+
+    CASE(op_call, OP_CALL) {
+        uint8_t argc = READ_BYTE();
+        Value callee = POP();
+
+        if (value_type(callee) != VAL_FUNCTION) {
+            RUNTIME_ERROR("Cannot call non-function");
+        }
+
+        uint32_t func_id = value_as_function(callee);
+        if (func_id >= vm->func_count) {
+            RUNTIME_ERROR("Invalid function id: %u", func_id);
+        }
+
+        FunctionDef* fn = &vm->functions[func_id];
+
+        // Push call frame
+        if (vm->frame_count >= vm->frame_capacity && !vm_reserve_frames(vm, 1)) {
+            SAVE_STATE();
+            return false;
+        }
+
+        CallFrame* frame = &vm->frames[vm->frame_count++];
+        frame->function_id = func_id;
+        frame->ip = (uint32_t)(ip - code);
+        frame->bp = (uint32_t)(sp - stack) - argc;
+        slots = stack + frame->bp;
+
+        // Reserve space for locals
+        if (slots + fn->local_count > stack_end) {
+            RESERVE((uint32_t)(slots + fn->local_count - sp));
+        }
+        Value* locals_end = slots + fn->local_count;
+        while (sp < locals_end) {
+            *sp++ = value_null();
+        }
+
+        ip = code + fn->code_offset;
+        SAFEPOINT();
+        DISPATCH();
+    }
 
-        VegaAgent* agent = future->agent;
-        if (!agent || !agent_has_pending_request(agent)) continue;
+    CASE(op_return, OP_RETURN) {
+        Value result = POP();
 
-        int poll_result = agent_poll_message(agent);
-        if (poll_result == 1) {
-            // Complete - get result
-            VegaString* response = agent_get_message_result(vm, agent);
-            if (response != NULL) {
-                future_set_result(future, response);
-            }
-            // Note: if response is NULL, a tool loop started - we'll keep polling
-        } else if (poll_result == -1) {
-            // Error
-            future_set_error(future, "Async request failed");
+        if (vm->frame_count == 0) {
+            vm->running = false;
+            PUSH(result);
+            SAVE_STATE();
+            return false;
         }
-        // poll_result == 0 means still pending
-    }
 
-    // Check if waiting for async agent response (synchronous send or await)
-    if (vm->waiting_for_agent) {
-        VegaAgent* agent = vm->waiting_for_agent;
-        int poll_result = agent_poll_message(agent);
-        if (poll_result == 0) {
-            // Still pending - yield
-            return true;
-        } else if (poll_result == 1) {
-            // HTTP complete - clear waiting state BEFORE get_result
-            // (get_result may call execute_tool which calls vm_step)
-            vm->waiting_for_agent = NULL;
-            Value saved_msg = vm->waiting_msg;
-            vm->waiting_msg = value_null();
-
-            // Get result (may trigger another async request for tool loop)
-            VegaString* response = agent_get_message_result(vm, agent);
-            if (response == NULL) {
-                // Tool loop in progress - another async request started
-                vm->waiting_for_agent = agent;
-                vm->waiting_msg = saved_msg;
-                return true;
-            }
-            // Got final result
-            value_release(saved_msg);
-            vm_push(vm, value_string(response));
-            return true;
-        } else {
-            // Error - poll returned -1
-            vm->waiting_for_agent = NULL;
-            value_release(vm->waiting_msg);
-            vm->waiting_msg = value_null();
-            vm_push(vm, value_string(vega_string_from_cstr("Error: Async request failed")));
-            return true;
-        }
-    }
+        CallFrame* frame = &vm->frames[--vm->frame_count];
 
-    uint8_t op = vm->code[vm->ip++];
+        // Pop locals and arguments
+        Value* base = stack + frame->bp;
+        while (sp > base) {
+            value_release(*--sp);
+        }
 
-    switch (op) {
-        case OP_NOP:
-            break;
+        ip = code + frame->ip;
+        slots = stack + (vm->frame_count > 0 ? vm->frames[vm->frame_count - 1].bp : 0);
+        PUSH(result);
+        DISPATCH();
+    }
 
-        case OP_PUSH_CONST: {
-            uint16_t idx = READ_U16(vm->code, vm->ip);
-            vm->ip += 2;
-            Value v = vm_read_constant(vm, idx);
-            vm_push(vm, v);
-            break;
+    CASE(op_call_native, OP_CALL_NATIVE) {
+        // Operand is a native registry index (rewritten by vm_link)
+        const NativeDef* native = native_get(READ_SHORT());
+        if ((uint32_t)(sp - stack) < native->arity) {
+            RUNTIME_ERROR("Stack underflow in native call: %s", native->name);
         }
 
-        case OP_PUSH_INT: {
-            int32_t val = (int32_t)READ_U32(vm->code, vm->ip);
-            vm->ip += 4;
-            vm_push(vm, value_int(val));
-            break;
+        // Arguments are passed in place and released after the call
+        Value* args = sp - native->arity;
+        SAVE_STATE();
+        Value result = native->fn(args);
+        while (sp > args) {
+            value_release(*--sp);
         }
+        PUSH(result);
+        DISPATCH();
+    }
 
-        case OP_PUSH_TRUE:
-            vm_push(vm, value_bool(true));
-            break;
-
-        case OP_PUSH_FALSE:
-            vm_push(vm, value_bool(false));
-            break;
-
-        case OP_PUSH_NULL:
-            vm_push(vm, value_null());
-            break;
+    CASE(op_spawn_agent, OP_SPAWN_AGENT)
+    CASE(op_spawn_async, OP_SPAWN_ASYNC) {
+        // Async spawn works like regular spawn for now
+        // (blocking behavior, but the syntax is supported)
+        uint16_t idx = READ_SHORT();
 
-        case OP_POP:
-            value_release(vm_pop(vm));
-            break;
+        uint32_t len;
+        const char* name = vm_read_string(vm, idx, &len);
+        char* name_z = strndup(name, len);
 
-        case OP_DUP: {
-            Value v = vm_peek(vm, 0);
-            value_retain(v);
-            vm_push(vm, v);
-            break;
+        int agent_idx = vm_find_agent(vm, name_z);
+        if (agent_idx < 0) {
+            SAVE_STATE();
+            vm_runtime_error(vm, "Unknown agent: %s", name_z);
+            free(name_z);
+            return false;
         }
 
-        case OP_LOAD_LOCAL: {
-            uint8_t slot = vm->code[vm->ip++];
-            uint32_t bp = vm->frame_count > 0 ?
-                vm->frames[vm->frame_count - 1].bp : 0;
-            Value v = vm->stack[bp + slot];
-            value_retain(v);
-            vm_push(vm, v);
-            break;
-        }
+        VegaAgent* agent = agent_spawn(vm, (uint32_t)agent_idx);
+        free(name_z);
+        PUSH(value_agent(agent));
+        SAFEPOINT();
+        DISPATCH();
+    }
 
-        case OP_STORE_LOCAL: {
-            uint8_t slot = vm->code[vm->ip++];
-            uint32_t bp = vm->frame_count > 0 ?
-                vm->frames[vm->frame_count - 1].bp : 0;
-            Value v = vm_pop(vm);
-            value_release(vm->stack[bp + slot]);
-            vm->stack[bp + slot] = v;
-            break;
+    CASE(op_await, OP_AWAIT) {
+        // Await a future: block until result is ready
+        Value future_val = POP();
+
+        if (value_type(future_val) != VAL_FUTURE || !value_as_future(future_val)) {
+            value_release(future_val);
+            RUNTIME_ERROR("Cannot await non-future value");
         }
 
-        case OP_LOAD_GLOBAL: {
-            uint16_t idx = READ_U16(vm->code, vm->ip);
-            vm->ip += 2;
-            uint32_t len;
-            const char* name = vm_read_string(vm, idx, &len);
-            char* name_z = strndup(name, len);
+        VegaFuture* future = value_as_future(future_val);
 
-            // First try to find a global variable
-            Value v = vm_get_global(vm, name_z);
-            if (v.type == VAL_NULL) {
-                // If not found, check if it's a function name
-                int func_id = vm_find_function(vm, name_z);
-                if (func_id >= 0) {
-                    v = value_function((uint32_t)func_id);
-                }
+        if (!future_is_ready(future)) {
+            // Not ready yet - put the future back, rewind to replay
+            // OP_AWAIT, and leave the loop so the caller can poll
+            PUSH(future_val);
+            ip--;
+            SAFEPOINT();
+            if (!future_is_ready(future)) {
+                SAVE_STATE();
+                vm_block_on_futures(vm, future, NULL);
+                return vm->running;
             }
-
-            value_retain(v);
-            vm_push(vm, v);
-            free(name_z);
-            break;
+            DISPATCH();
         }
 
-        case OP_STORE_GLOBAL: {
-            uint16_t idx = READ_U16(vm->code, vm->ip);
-            vm->ip += 2;
-            uint32_t len;
-            const char* name = vm_read_string(vm, idx, &len);
-            char* name_z = strndup(name, len);
-            Value v = vm_pop(vm);
-            vm_set_global(vm, name_z, v);
-            value_release(v);
-            free(name_z);
-            break;
-        }
+        // Resolved - push the result (or the error text)
+        PUSH(future_value(future));
+        vega_obj_release(future);
+        DISPATCH();
+    }
 
-        case OP_ADD: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_add(a, b));
-            value_release(a);
-            value_release(b);
-            break;
+    // The combinators block like OP_AWAIT: operands go back on the stack
+    // and the instruction is replayed until its condition holds
+    CASE(op_await_all, OP_AWAIT_ALL) {
+        // Await every future; each error lands in its place as text
+        Value list = POP();
+        if (!value_is_future_array(list)) {
+            value_release(list);
+            RUNTIME_ERROR("await all expects an array of futures");
+        }
+
+        VegaArray* futures = value_as_array(list);
+        if (future_group_waiting(futures, true, 0)) {
+            PUSH(list);
+            ip--;
+            SAFEPOINT();
+            if (future_group_waiting(futures, true, 0)) {
+                SAVE_STATE();
+                vm_block_on_futures(vm, NULL, futures);
+                return vm->running;
+            }
+            DISPATCH();
         }
 
-        case OP_SUB: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_sub(a, b));
-            break;
+        VegaArray* results = array_new(futures->count);
+        for (uint32_t i = 0; i < futures->count; i++) {
+            Value v = future_value(value_as_future(futures->items[i]));
+            array_push(results, v);
+            value_release(v);
         }
+        value_release(list);
+        PUSH(value_array(results));
+        DISPATCH();
+    }
 
-        case OP_MUL: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_mul(a, b));
-            break;
+    CASE(op_await_any, OP_AWAIT_ANY) {
+        // Await the first success and cancel the rest; if every future
+        // fails, the first error
+        Value list = POP();
+        if (!value_is_future_array(list) || value_as_array(list)->count == 0) {
+            value_release(list);
+            RUNTIME_ERROR("await any expects a non-empty array of futures");
+        }
+
+        VegaArray* futures = value_as_array(list);
+        if (future_group_waiting(futures, false, 1)) {
+            PUSH(list);
+            ip--;
+            SAFEPOINT();
+            if (future_group_waiting(futures, false, 1)) {
+                SAVE_STATE();
+                vm_block_on_futures(vm, NULL, futures);
+                return vm->running;
+            }
+            DISPATCH();
         }
 
-        case OP_DIV: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_div(a, b));
-            break;
-        }
+        VegaArray* first = future_take_first(vm, futures, 1);
+        Value result = array_get(first, 0);
+        value_retain(result);
+        vega_obj_release(first);
+        value_release(list);
+        PUSH(result);
+        DISPATCH();
+    }
 
-        case OP_MOD: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_mod(a, b));
-            break;
+    CASE(op_await_first, OP_AWAIT_FIRST) {
+        // Await the first n successes (a quorum) and cancel the rest. Once
+        // too many have failed for that, the failures' errors fill the
+        // remaining places.
+        Value list = POP();
+        Value n_val = POP();
+        if (!value_is_future_array(list) || value_type(n_val) != VAL_INT) {
+            value_release(list);
+            value_release(n_val);
+            RUNTIME_ERROR("await n of expects an int and an array of futures");
+        }
+
+        VegaArray* futures = value_as_array(list);
+        int64_t n = value_as_int(n_val);
+        if (n < 0) n = 0;
+        if (n > futures->count) n = futures->count;
+
+        if (future_group_waiting(futures, false, (uint32_t)n)) {
+            PUSH(n_val);
+            PUSH(list);
+            ip--;
+            SAFEPOINT();
+            if (future_group_waiting(futures, false, (uint32_t)n)) {
+                SAVE_STATE();
+                vm_block_on_futures(vm, NULL, futures);
+                return vm->running;
+            }
+            DISPATCH();
         }
 
-        case OP_NEG: {
-            Value v = vm_pop(vm);
-            vm_push(vm, value_neg(v));
-            break;
-        }
+        VegaArray* results = future_take_first(vm, futures, (uint32_t)n);
+        value_release(list);
+        value_release(n_val);
+        PUSH(value_array(results));
+        DISPATCH();
+    }
 
-        case OP_EQ: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_bool(value_equals(a, b)));
-            value_release(a);
-            value_release(b);
-            break;
-        }
+    CASE(op_spawn_supervised, OP_SPAWN_SUPERVISED) {
+        uint16_t idx = READ_SHORT();
 
-        case OP_NE: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_bool(!value_equals(a, b)));
-            value_release(a);
-            value_release(b);
-            break;
-        }
+        // Read supervision config
+        uint8_t strategy = READ_BYTE();
+        uint32_t max_restarts = READ_WORD();
+        uint32_t window_ms = READ_WORD();
 
-        case OP_LT: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_bool(value_compare(a, b) < 0));
-            break;
-        }
+        uint32_t len;
+        const char* name = vm_read_string(vm, idx, &len);
+        char* name_z = strndup(name, len);
 
-        case OP_LE: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_bool(value_compare(a, b) <= 0));
-            break;
+        int agent_idx = vm_find_agent(vm, name_z);
+        if (agent_idx < 0) {
+            SAVE_STATE();
+            vm_runtime_error(vm, "Unknown agent: %s", name_z);
+            free(name_z);
+            return false;
         }
 
-        case OP_GT: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_bool(value_compare(a, b) > 0));
-            break;
-        }
+        // Create supervision config
+        SupervisionConfig config = {
+            .strategy = (RestartStrategy)strategy,
+            .max_restarts = max_restarts,
+            .window_ms = window_ms,
+            .restart_count = 0,
+            .window_start = 0
+        };
 
-        case OP_GE: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_bool(value_compare(a, b) >= 0));
-            break;
-        }
+        // Spawn supervised agent (creates both agent and process)
+        VegaAgent* agent = agent_spawn_supervised(vm, (uint32_t)agent_idx, &config);
+        free(name_z);
 
-        case OP_NOT: {
-            Value v = vm_pop(vm);
-            vm_push(vm, value_bool(!value_is_truthy(v)));
-            value_release(v);
-            break;
-        }
+        PUSH(value_agent(agent));
+        SAFEPOINT();
+        DISPATCH();
+    }
 
-        case OP_AND: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_bool(value_is_truthy(a) && value_is_truthy(b)));
-            value_release(a);
-            value_release(b);
-            break;
+    CASE(op_yield, OP_YIELD)
+        // Inside a scheduled process, hand control back to the scheduler;
+        // in the root context this is just a safepoint
+        if (vm->scheduler.current && vm->context == &vm->scheduler.current->context) {
+            scheduler_yield(&vm->scheduler);
+            SAVE_STATE();
+            return true;
         }
+        SAFEPOINT();
+        DISPATCH();
 
-        case OP_OR: {
-            Value b = vm_pop(vm);
-            Value a = vm_pop(vm);
-            vm_push(vm, value_bool(value_is_truthy(a) || value_is_truthy(b)));
-            value_release(a);
-            value_release(b);
-            break;
+    CASE(op_sleep, OP_SLEEP) {
+        Value ms_val = POP();
+        if (!value_is_int(ms_val)) {
+            value_release(ms_val);
+            RUNTIME_ERROR("sleep expects an int (milliseconds)");
         }
-
-        case OP_JUMP: {
-            int16_t offset = READ_I16(vm->code, vm->ip);
-            vm->ip += 2 + offset;
-            break;
+        int64_t ms = value_as_int(ms_val);
+        value_release(ms_val);
+        if (ms <= 0) {
+            PUSH(value_null());
+            DISPATCH();
         }
 
-        case OP_JUMP_IF: {
-            int16_t offset = READ_I16(vm->code, vm->ip);
-            vm->ip += 2;
-            Value cond = vm_pop(vm);
-            if (value_is_truthy(cond)) {
-                vm->ip += offset;
-            }
-            value_release(cond);
-            break;
+        // A scheduled process parks on the timer wheel and the scheduler
+        // runs the others until it fires
+        if (vm->scheduler.current && vm->context == &vm->scheduler.current->context) {
+            PUSH(value_null());
+            scheduler_sleep(&vm->scheduler, timer_now_ms() + (uint64_t)ms);
+            SAVE_STATE();
+            return true;
         }
 
-        case OP_JUMP_IF_NOT: {
-            int16_t offset = READ_I16(vm->code, vm->ip);
-            vm->ip += 2;
-            Value cond = vm_pop(vm);
-            if (!value_is_truthy(cond)) {
-                vm->ip += offset;
+        // The root context blocks like OP_AWAIT, so futures and retries
+        // keep moving meanwhile: the instruction replays with the same
+        // duration until the sleep timer has fired
+        if (!vm->sleeping) {
+            vm->sleeping = true;
+            timer_arm(&vm->scheduler.timers, &vm->sleep_timer, timer_now_ms() + (uint64_t)ms);
+        }
+        if (timer_armed(&vm->sleep_timer)) {
+            PUSH(value_int(ms));
+            ip--;
+            SAFEPOINT();
+            if (timer_armed(&vm->sleep_timer)) {
+                SAVE_STATE();
+                vm->async_blocked = true;
+                return vm->running;
             }
-            value_release(cond);
-            break;
+            DISPATCH();
         }
+        vm->sleeping = false;
+        PUSH(value_null());
+        DISPATCH();
+    }
 
-        case OP_CALL: {
-            uint8_t argc = vm->code[vm->ip++];
-            Value callee = vm_pop(vm);
-
-            if (callee.type != VAL_FUNCTION) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Cannot call non-function");
-                vm->had_error = true;
-                vm->running = false;
-                break;
-            }
-
-            uint32_t func_id = callee.as.function_id;
-            if (func_id >= vm->func_count) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Invalid function id: %u", func_id);
-                vm->had_error = true;
-                vm->running = false;
-                break;
-            }
-
-            FunctionDef* fn = &vm->functions[func_id];
-
-            // Push call frame
-            if (vm->frame_count >= VM_FRAMES_MAX) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Call stack overflow");
-                vm->had_error = true;
-                vm->running = false;
-                break;
-            }
-
-            CallFrame* frame = &vm->frames[vm->frame_count++];
-            frame->function_id = func_id;
-            frame->ip = vm->ip;
-            frame->bp = vm->sp - argc;
-
-            // Reserve space for locals
-            while (vm->sp < frame->bp + fn->local_count) {
-                vm_push(vm, value_null());
-            }
+    CASE(op_send_msg, OP_SEND_MSG) {
+        Value msg = POP();
+        Value target = POP();
 
-            vm->ip = fn->code_offset;
-            break;
+        if (value_type(target) != VAL_AGENT || !value_as_agent(target)) {
+            value_release(msg);
+            value_release(target);
+            RUNTIME_ERROR("Cannot send message to non-agent");
         }
 
-        case OP_RETURN: {
-            Value result = vm_pop(vm);
-
-            if (vm->frame_count == 0) {
-                vm->running = false;
-                vm_push(vm, result);
-                break;
-            }
-
-            CallFrame* frame = &vm->frames[--vm->frame_count];
+        VegaAgent* agent = value_as_agent(target);
+        VegaString* msg_str = value_to_string(msg);
 
-            // Pop locals and arguments
-            while (vm->sp > frame->bp) {
-                value_release(vm_pop(vm));
-            }
-
-            vm->ip = frame->ip;
-            vm_push(vm, result);
-            break;
+        // Start async request
+        SAVE_STATE();
+        if (agent_start_message_async(vm, agent, msg_str->data, vm_current_pid(vm))) {
+            // Request started - store state and block
+            vm->waiting_for_agent = agent;
+            vm->waiting_msg = msg;  // Keep reference for debugging
+            vega_obj_release(msg_str);
+            value_release(target);
+            // Response will be pushed when polling completes
+            SAFEPOINT();
+        } else {
+            // Failed to start - push error
+            value_release(msg);
+            vega_obj_release(msg_str);
+            value_release(target);
+            PUSH(value_string(vega_string_from_cstr("Error: Failed to send message")));
         }
+        DISPATCH();
+    }
 
-        case OP_CALL_NATIVE: {
-            uint16_t idx = READ_U16(vm->code, vm->ip);
-            vm->ip += 2;
-
-            uint32_t len;
-            const char* name = vm_read_string(vm, idx, &len);
-            char* name_z = strndup(name, len);
-
-            // Count arguments (we need to peek backwards)
-            // For simplicity, assume max 4 args
-            Value args[4];
-            uint32_t argc = 0;
-
-            // The native call should have args on stack
-            // We'll pop them
-            if (strcmp(name_z, "file::read") == 0 ||
-                strcmp(name_z, "file::exists") == 0 ||
-                strcmp(name_z, "str::len") == 0 ||
-                strcmp(name_z, "str::from_int") == 0 ||
-                strcmp(name_z, "str::char_code") == 0 ||
-                strcmp(name_z, "str::char_lower") == 0 ||
-                strcmp(name_z, "http::get") == 0 ||
-                strcmp(name_z, "json::array_len") == 0) {
-                argc = 1;
-                args[0] = vm_pop(vm);
-            } else if (strcmp(name_z, "file::write") == 0 ||
-                       strcmp(name_z, "str::contains") == 0 ||
-                       strcmp(name_z, "str::char_at") == 0 ||
-                       strcmp(name_z, "str::split") == 0 ||
-                       strcmp(name_z, "str::split_len") == 0 ||
-                       strcmp(name_z, "json::get_string") == 0 ||
-                       strcmp(name_z, "json::get_float") == 0 ||
-                       strcmp(name_z, "json::get_int") == 0 ||
-                       strcmp(name_z, "json::get_array") == 0 ||
-                       strcmp(name_z, "json::array_get") == 0) {
-                argc = 2;
-                args[1] = vm_pop(vm);
-                args[0] = vm_pop(vm);
-            }
-
-            Value result = call_native(vm, name_z, args, argc);
-            vm_push(vm, result);
-
-            for (uint32_t i = 0; i < argc; i++) {
-                value_release(args[i]);
-            }
+    CASE(op_send_async, OP_SEND_ASYNC) {
+        // Async send: returns a future immediately instead of blocking
+        Value msg = POP();
+        Value target = POP();
 
-            free(name_z);
-            break;
+        if (value_type(target) != VAL_AGENT || !value_as_agent(target)) {
+            value_release(msg);
+            value_release(target);
+            RUNTIME_ERROR("Cannot send message to non-agent");
         }
 
-        case OP_SPAWN_AGENT: {
-            uint16_t idx = READ_U16(vm->code, vm->ip);
-            vm->ip += 2;
+        VegaAgent* agent = value_as_agent(target);
+        VegaString* msg_str = value_to_string(msg);
 
-            uint32_t len;
-            const char* name = vm_read_string(vm, idx, &len);
-            char* name_z = strndup(name, len);
+        // Create future for this request; it is tracked before the send
+        // starts, since a cached response completes at once
+        VegaFuture* future = future_new(agent, 0);
+        uint64_t token = future ? future_table_add(vm, future) : 0;
 
-            int agent_idx = vm_find_agent(vm, name_z);
-            if (agent_idx < 0) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Unknown agent: %s", name_z);
-                vm->had_error = true;
-                vm->running = false;
-                free(name_z);
-                break;
-            }
-
-            VegaAgent* agent = agent_spawn(vm, (uint32_t)agent_idx);
-            vm_push(vm, value_agent(agent));
-            free(name_z);
-            break;
+        // Start async request
+        SAVE_STATE();
+        if (!token || !agent_start_message_async(vm, agent, msg_str->data, token)) {
+            // Failed to start
+            future_set_error(future, "Failed to start async request");
+            future_table_remove(vm, future);
         }
+        // Push future onto stack immediately (non-blocking)
+        PUSH(value_future(future));
 
-        case OP_SPAWN_ASYNC: {
-            // For now, async spawn works like regular spawn
-            // (blocking behavior, but the syntax is supported)
-            uint16_t idx = READ_U16(vm->code, vm->ip);
-            vm->ip += 2;
-
-            uint32_t len;
-            const char* name = vm_read_string(vm, idx, &len);
-            char* name_z = strndup(name, len);
+        vega_obj_release(msg_str);
+        value_release(msg);
+        value_release(target);
+        SAFEPOINT();
+        DISPATCH();
+    }
 
-            int agent_idx = vm_find_agent(vm, name_z);
-            if (agent_idx < 0) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Unknown agent: %s", name_z);
-                vm->had_error = true;
-                vm->running = false;
-                free(name_z);
-                break;
-            }
+    CASE(op_str_has, OP_STR_HAS) {
+        Value substr = POP();
+        Value str = POP();
 
-            VegaAgent* agent = agent_spawn(vm, (uint32_t)agent_idx);
-            vm_push(vm, value_agent(agent));
-            free(name_z);
-            break;
+        bool result = false;
+        if (value_type(str) == VAL_STRING && value_type(substr) == VAL_STRING) {
+            result = vega_string_contains(value_as_string(str), value_as_string(substr));
         }
 
-        case OP_AWAIT: {
-            // Await a future: block until result is ready
-            Value future_val = vm_pop(vm);
-
-            if (future_val.type != VAL_FUTURE || !future_val.as.future) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Cannot await non-future value");
-                vm->had_error = true;
-                vm->running = false;
-                value_release(future_val);
-                break;
-            }
+        PUSH(value_bool(result));
+        value_release(str);
+        value_release(substr);
+        DISPATCH();
+    }
 
-            VegaFuture* future = future_val.as.future;
-
-            if (future_is_ready(future)) {
-                // Already resolved - push result
-                if (future->state == FUTURE_READY) {
-                    VegaString* result = future->result;
-                    if (result) {
-                        vega_obj_retain(result);
-                        vm_push(vm, value_string(result));
-                    } else {
-                        vm_push(vm, value_null());
-                    }
-                } else {
-                    // Error state
-                    const char* err = future->error ? future->error : "Unknown error";
-                    vm_push(vm, value_string(vega_string_from_cstr(err)));
-                }
-                vega_obj_release(future);
-            } else {
-                // Not ready yet - set up blocking wait on the agent
-                // Push future back so we can retry
-                vm->ip--;  // Replay OP_AWAIT
-                vm_push(vm, future_val);  // Put future back on stack
-                vm->waiting_for_agent = future->agent;
-                // Return true to yield
-            }
-            break;
+    CASE(op_call_method, OP_CALL_METHOD) {
+        // Operand is an inline cache index (rewritten by vm_link). The cache
+        // is monomorphic: a receiver of a different type re-resolves it.
+        MethodCache* cache = &vm->method_caches[READ_SHORT()];
+        uint8_t argc = READ_BYTE();
+        if (sp - stack < argc + 1) {
+            vm_stack_underflow(vm);
+            SAVE_STATE();
+            return false;
         }
 
-        case OP_SPAWN_SUPERVISED: {
-            uint16_t idx = READ_U16(vm->code, vm->ip);
-            vm->ip += 2;
-
-            // Read supervision config
-            uint8_t strategy = vm->code[vm->ip++];
-            uint32_t max_restarts = READ_U32(vm->code, vm->ip);
-            vm->ip += 4;
-            uint32_t window_ms = READ_U32(vm->code, vm->ip);
-            vm->ip += 4;
-
-            uint32_t len;
-            const char* name = vm_read_string(vm, idx, &len);
-            char* name_z = strndup(name, len);
-
-            int agent_idx = vm_find_agent(vm, name_z);
-            if (agent_idx < 0) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Unknown agent: %s", name_z);
-                vm->had_error = true;
-                vm->running = false;
-                free(name_z);
-                break;
-            }
-
-            // Create supervision config
-            SupervisionConfig config = {
-                .strategy = (RestartStrategy)strategy,
-                .max_restarts = max_restarts,
-                .window_ms = window_ms,
-                .restart_count = 0,
-                .window_start = 0
-            };
-
-            // Spawn supervised agent (creates both agent and process)
-            VegaAgent* agent = agent_spawn_supervised(vm, (uint32_t)agent_idx, &config);
-
-            vm_push(vm, value_agent(agent));
-            free(name_z);
-            break;
+        // Receiver and arguments stay in place: args[0] is the receiver
+        Value* args = sp - argc - 1;
+        uint8_t type = (uint8_t)value_type(args[0]);
+        if (cache->receiver_type != type) {
+            cache->receiver_type = type;
+            cache->method = native_find_method((ValueType)type, cache->name, cache->name_len);
         }
 
-        case OP_YIELD: {
-            // Yield to scheduler (for cooperative multitasking)
-            // For now, this is a no-op since we don't have full process integration yet
-            break;
+        Value result = value_null();
+        const NativeDef* method = cache->method;
+        if (method && method->arity == argc) {
+            SAVE_STATE();
+            result = method->fn(args);
         }
 
-        case OP_SEND_MSG: {
-            Value msg = vm_pop(vm);
-            Value target = vm_pop(vm);
-
-            if (target.type != VAL_AGENT || !target.as.agent) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Cannot send message to non-agent");
-                vm->had_error = true;
-                vm->running = false;
-                value_release(msg);
-                value_release(target);
-                break;
-            }
-
-            VegaAgent* agent = target.as.agent;
-            VegaString* msg_str = value_to_string(msg);
-
-            // Start async request
-            if (agent_start_message_async(vm, agent, msg_str->data)) {
-                // Request started - store state and yield
-                vm->waiting_for_agent = agent;
-                vm->waiting_msg = msg;  // Keep reference for debugging
-                vega_obj_release(msg_str);
-                value_release(target);
-                // Response will be pushed when polling completes
-            } else {
-                // Failed to start - push error
-                value_release(msg);
-                vega_obj_release(msg_str);
-                value_release(target);
-                vm_push(vm, value_string(vega_string_from_cstr("Error: Failed to send message")));
-            }
-            break;
+        for (uint32_t i = 0; i <= argc; i++) {
+            value_release(args[i]);
         }
+        sp = args;
+        PUSH(result);
+        DISPATCH();
+    }
 
-        case OP_SEND_ASYNC: {
-            // Async send: returns a future immediately instead of blocking
-            Value msg = vm_pop(vm);
-            Value target = vm_pop(vm);
-
-            if (target.type != VAL_AGENT || !target.as.agent) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Cannot send message to non-agent");
-                vm->had_error = true;
-                vm->running = false;
-                value_release(msg);
-                value_release(target);
-                break;
-            }
-
-            if (vm->pending_count >= VM_MAX_PENDING) {
-                snprintf(vm->error_msg, sizeof(vm->error_msg),
-                        "Too many pending async requests (max %d)", VM_MAX_PENDING);
-                vm->had_error = true;
-                vm->running = false;
-                value_release(msg);
-                value_release(target);
-                break;
-            }
-
-            VegaAgent* agent = target.as.agent;
-            VegaString* msg_str = value_to_string(msg);
-
-            // Create future for this request
-            uint32_t request_id = vm->next_request_id++;
-            VegaFuture* future = future_new(agent, request_id);
-
-            // Start async request
-            if (agent_start_message_async(vm, agent, msg_str->data)) {
-                // Request started - add to pending futures
-                vm->pending_futures[vm->pending_count++] = future;
-                // Push future onto stack immediately (non-blocking)
-                vm_push(vm, value_future(future));
-            } else {
-                // Failed to start
-                future_set_error(future, "Failed to start async request");
-                vm_push(vm, value_future(future));
-            }
+    CASE(op_array_new, OP_ARRAY_NEW) {
+        uint16_t capacity = READ_SHORT();
+        VegaArray* arr = array_new(capacity > 0 ? capacity : 4);
+        PUSH(value_array(arr));
+        DISPATCH();
+    }
 
-            vega_obj_release(msg_str);
-            value_release(msg);
-            value_release(target);
-            break;
+    CASE(op_array_push, OP_ARRAY_PUSH) {
+        Value elem = POP();
+        Value arr_val = POP();
+        if (value_type(arr_val) == VAL_ARRAY && value_as_array(arr_val)) {
+            array_push(value_as_array(arr_val), elem);
         }
+        PUSH(arr_val);  // Put array back on stack
+        DISPATCH();
+    }
 
-        case OP_STR_HAS: {
-            Value substr = vm_pop(vm);
-            Value str = vm_pop(vm);
-
-            bool result = false;
-            if (str.type == VAL_STRING && substr.type == VAL_STRING) {
-                result = vega_string_contains(str.as.string, substr.as.string);
-            }
-
-            vm_push(vm, value_bool(result));
-            value_release(str);
-            value_release(substr);
-            break;
+    CASE(op_array_get, OP_ARRAY_GET) {
+        Value idx = POP();
+        Value arr_val = POP();
+        if (value_type(arr_val) == VAL_ARRAY && value_as_array(arr_val) && value_type(idx) == VAL_INT) {
+            Value result = array_get(value_as_array(arr_val), (uint32_t)value_as_int(idx));
+            value_retain(result);
+            PUSH(result);
+        } else {
+            PUSH(value_null());
         }
+        value_release(arr_val);
+        DISPATCH();
+    }
 
-        case OP_CALL_METHOD: {
-            uint16_t name_idx = READ_U16(vm->code, vm->ip);
-            vm->ip += 2;
-            uint8_t argc = vm->code[vm->ip++];
-
-            uint32_t len;
-            const char* method = vm_read_string(vm, name_idx, &len);
-
-            // Pop args
-            Value args[8];
-            for (int i = argc - 1; i >= 0; i--) {
-                args[i] = vm_pop(vm);
-            }
-            Value obj = vm_pop(vm);
-
-            // String methods
-            if (obj.type == VAL_STRING && obj.as.string) {
-                if (strncmp(method, "has", len) == 0 && argc == 1) {
-                    bool result = false;
-                    if (args[0].type == VAL_STRING) {
-                        result = vega_string_contains(obj.as.string, args[0].as.string);
-                    }
-                    vm_push(vm, value_bool(result));
-                } else if (strncmp(method, "len", len) == 0 && argc == 0) {
-                    vm_push(vm, value_int(obj.as.string->length));
-                } else {
-                    vm_push(vm, value_null());
-                }
-            } else {
-                vm_push(vm, value_null());
-            }
-
-            value_release(obj);
-            for (uint32_t i = 0; i < argc; i++) {
-                value_release(args[i]);
-            }
-            break;
+    CASE(op_array_set, OP_ARRAY_SET) {
+        Value val = POP();
+        Value idx = POP();
+        Value arr_val = POP();
+        if (value_type(arr_val) == VAL_ARRAY && value_as_array(arr_val) && value_type(idx) == VAL_INT) {
+            array_set(value_as_array(arr_val), (uint32_t)value_as_int(idx), val);
         }
+        value_release(arr_val);
+        DISPATCH();
+    }
 
-        case OP_ARRAY_NEW: {
-            uint16_t capacity = READ_U16(vm->code, vm->ip);
-            vm->ip += 2;
-            VegaArray* arr = array_new(capacity > 0 ? capacity : 4);
-            vm_push(vm, (Value){.type = VAL_ARRAY, .as.array = arr});
-            break;
+    CASE(op_array_len, OP_ARRAY_LEN) {
+        Value arr_val = POP();
+        if (value_type(arr_val) == VAL_ARRAY && value_as_array(arr_val)) {
+            PUSH(value_int(array_length(value_as_array(arr_val))));
+        } else {
+            PUSH(value_int(0));
         }
+        value_release(arr_val);
+        DISPATCH();
+    }
 
-        case OP_ARRAY_PUSH: {
-            Value elem = vm_pop(vm);
-            Value arr_val = vm_pop(vm);
-            if (arr_val.type == VAL_ARRAY && arr_val.as.array) {
-                array_push(arr_val.as.array, elem);
-            }
-            vm_push(vm, arr_val);  // Put array back on stack
-            break;
-        }
+    CASE(op_print, OP_PRINT) {
+        Value v = POP();
+        // If tracing is enabled (TUI mode), route output through trace system
+        if (trace_is_enabled()) {
+            VegaString* str = value_to_string(v);
+            trace_print(str->data);
+            vega_obj_release(str);
+        } else {
+            value_print(v);
+            printf("\n");
+            fflush(stdout);
+        }
+        value_release(v);
+        // Push null as return value (for expression statement semantics)
+        PUSH(value_null());
+        DISPATCH();
+    }
 
-        case OP_ARRAY_GET: {
-            Value idx = vm_pop(vm);
-            Value arr_val = vm_pop(vm);
-            if (arr_val.type == VAL_ARRAY && arr_val.as.array && idx.type == VAL_INT) {
-                Value result = array_get(arr_val.as.array, (uint32_t)idx.as.integer);
-                value_retain(result);
-                vm_push(vm, result);
-            } else {
-                vm_push(vm, value_null());
-            }
-            value_release(arr_val);
-            break;
-        }
+    CASE(op_halt, OP_HALT)
+        vm->running = false;
+        SAVE_STATE();
+        return false;
 
-        case OP_ARRAY_SET: {
-            Value val = vm_pop(vm);
-            Value idx = vm_pop(vm);
-            Value arr_val = vm_pop(vm);
-            if (arr_val.type == VAL_ARRAY && arr_val.as.array && idx.type == VAL_INT) {
-                array_set(arr_val.as.array, (uint32_t)idx.as.integer, val);
-            }
-            value_release(arr_val);
-            break;
-        }
+    CASE(op_result_ok, OP_RESULT_OK) {
+        Value val = POP();
+        PUSH(value_result_ok(val));
+        DISPATCH();
+    }
 
-        case OP_ARRAY_LEN: {
-            Value arr_val = vm_pop(vm);
-            if (arr_val.type == VAL_ARRAY && arr_val.as.array) {
-                vm_push(vm, value_int(array_length(arr_val.as.array)));
-            } else {
-                vm_push(vm, value_int(0));
-            }
-            value_release(arr_val);
-            break;
-        }
+    CASE(op_result_err, OP_RESULT_ERR) {
+        Value val = POP();
+        PUSH(value_result_err(val));
+        DISPATCH();
+    }
 
-        case OP_PRINT: {
-            Value v = vm_pop(vm);
-            // If tracing is enabled (TUI mode), route output through trace system
-            if (trace_is_enabled()) {
-                VegaString* str = value_to_string(v);
-                trace_print(str->data);
-                vega_obj_release(str);
-            } else {
-                value_print(v);
-                printf("\n");
-                fflush(stdout);
-            }
-            value_release(v);
-            // Push null as return value (for expression statement semantics)
-            vm_push(vm, value_null());
-            break;
+    CASE(op_result_is_ok, OP_RESULT_IS_OK) {
+        Value result = POP();
+        bool is_ok = (value_type(result) == VAL_RESULT && value_as_result(result) && value_as_result(result)->is_ok);
+        PUSH(value_bool(is_ok));
+        value_release(result);
+        DISPATCH();
+    }
+
+    CASE(op_result_unwrap, OP_RESULT_UNWRAP) {
+        Value result = POP();
+        if (value_type(result) == VAL_RESULT && value_as_result(result)) {
+            Value unwrapped = value_as_result(result)->value;
+            value_retain(unwrapped);
+            PUSH(unwrapped);
+        } else {
+            PUSH(value_null());
         }
+        value_release(result);
+        DISPATCH();
+    }
 
-        case OP_HALT:
-            vm->running = false;
-            break;
+#if !VM_COMPUTED_GOTO
+    default:
+        goto op_unknown;
+    }
+#endif
 
-        case OP_RESULT_OK: {
-            Value val = vm_pop(vm);
-            Value result = value_result_ok(val);
-            vm_push(vm, result);
-            break;
-        }
+op_unknown:
+    RUNTIME_ERROR("Unknown opcode: 0x%02x at %u", ip[-1], (uint32_t)(ip - code - 1));
 
-        case OP_RESULT_ERR: {
-            Value val = vm_pop(vm);
-            Value result = value_result_err(val);
-            vm_push(vm, result);
-            break;
-        }
 
-        case OP_RESULT_IS_OK: {
-            Value result = vm_pop(vm);
-            bool is_ok = (result.type == VAL_RESULT && result.as.result && result.as.result->is_ok);
-            vm_push(vm, value_bool(is_ok));
-            value_release(result);
-            break;
-        }
+step_done:
+#if VM_COMPUTED_GOTO
+    ip--;  // Un-fetch the opcode that routed us here
+#endif
+    SAVE_STATE();
+    return vm->running;
 
-        case OP_RESULT_UNWRAP: {
-            Value result = vm_pop(vm);
-            if (result.type == VAL_RESULT && result.as.result) {
-                Value unwrapped = result.as.result->value;
-                value_retain(unwrapped);
-                vm_push(vm, unwrapped);
-            } else {
-                vm_push(vm, value_null());
-            }
-            value_release(result);
-            break;
-        }
+#undef READ_BYTE
+#undef READ_SHORT
+#undef READ_WORD
+#undef SAVE_STATE
+#undef LOAD_STATE
+#undef RESERVE
+#undef PUSH
+#undef POP
+#undef PEEK
+#undef RUNTIME_ERROR
+#undef SAFEPOINT
+#undef CASE
+#undef DISPATCH
+}
 
-        default:
-            snprintf(vm->error_msg, sizeof(vm->error_msg),
-                    "Unknown opcode: 0x%02x at %u", op, vm->ip - 1);
-            vm->had_error = true;
-            vm->running = false;
-            break;
-    }
+bool vm_step(VegaVM* vm) {
+    return vm_dispatch(vm, true);
+}
 
-    return vm->running;
+// Longest sleep without an HTTP event or a timer. Every awaited result
+// arrives as one of those, so this only bounds how long a wait on
+// something else can go unchecked.
+#define VM_ASYNC_WAIT_MS 1000
+
+void vm_wait_async(VegaVM* vm) {
+    if (!vm->async_blocked || !vm->running) return;
+    vm->async_blocked = false;
+
+    uint64_t timeout = VM_ASYNC_WAIT_MS;
+    uint64_t next = timer_wheel_next_tick(&vm->scheduler.timers);
+    if (next != UINT64_MAX) {
+        uint64_t now = timer_now_ms();
+        if (next <= now) return;  // A timer is due: poll again right away
+        if (next - now < timeout) timeout = next - now;
+    }
+    http_async_wait(vm->async_epoch, (int)timeout);
 }
 
 bool vm_run(VegaVM* vm) {
@@ -1714,9 +2406,10 @@ bool vm_run(VegaVM* vm) {
         vm_push(vm, value_null());
     }
 
-    // Run until done
-    while (vm_step(vm)) {
-        // Continue
+    // Run until done; vm_dispatch only returns early while blocked on
+    // async work, and then the VM sleeps until the HTTP engine has news
+    while (vm_dispatch(vm, false)) {
+        vm_wait_async(vm);
     }
 
     return !vm->had_error;
@@ -1754,59 +2447,34 @@ void vm_print_stack(VegaVM* vm) {
 void vm_execute_process(VegaVM* vm, VegaProcess* proc) {
     if (!proc || proc->state != PROC_RUNNING) return;
 
-    // Save current VM state
-    uint32_t saved_ip = vm->ip;
-    uint32_t saved_sp = vm->sp;
-    uint32_t saved_frame_count = vm->frame_count;
-
-    // Load process state into VM
-    vm->ip = proc->ip;
-
-    // Copy process stack to VM stack
-    for (uint32_t i = 0; i < proc->sp; i++) {
-        vm->stack[i] = proc->stack[i];
-    }
-    vm->sp = proc->sp;
-
-    // Copy frames
-    for (uint32_t i = 0; i < proc->frame_count; i++) {
-        vm->frames[i].function_id = proc->frames[i].function_id;
-        vm->frames[i].ip = proc->frames[i].ip;
-        vm->frames[i].bp = proc->frames[i].bp;
-    }
-    vm->frame_count = proc->frame_count;
-
+    // Run on the process's own stack; the caller's context is untouched
+    ExecContext* caller = vm->context;
+    vm_switch_context(vm, &proc->context);
     vm->running = true;
 
     // Execute until yield, block, or exit
     while (vm->running && proc->state == PROC_RUNNING) {
-        if (!vm_step(vm)) {
+        if (!vm_dispatch(vm, false)) {
             // Process has exited
             if (vm->had_error) {
                 process_exit(vm, proc, EXIT_ERROR, vm->error_msg);
+                vm->had_error = false;  // The error belongs to the process
             } else {
                 process_exit(vm, proc, EXIT_NORMAL, NULL);
             }
-            vm->scheduler.processes_exited++;
             break;
         }
+        if (vm->async_blocked) {
+            // Waiting on a send or a future: park until its completion
+            // wakes this pid, and let the other processes run meanwhile
+            vm->async_blocked = false;
+            if (vm->async_yield) {
+                scheduler_yield(&vm->scheduler);
+            } else {
+                scheduler_block(&vm->scheduler);
+            }
+        }
     }
 
-    // Save process state from VM
-    proc->ip = vm->ip;
-    proc->sp = vm->sp;
-    for (uint32_t i = 0; i < vm->sp; i++) {
-        proc->stack[i] = vm->stack[i];
-    }
-    proc->frame_count = vm->frame_count;
-    for (uint32_t i = 0; i < vm->frame_count; i++) {
-        proc->frames[i].function_id = vm->frames[i].function_id;
-        proc->frames[i].ip = vm->frames[i].ip;
-        proc->frames[i].bp = vm->frames[i].bp;
-    }
-
-    // Restore VM state
-    vm->ip = saved_ip;
-    vm->sp = saved_sp;
-    vm->frame_count = saved_frame_count;
+    vm_switch_context(vm, caller);
 }
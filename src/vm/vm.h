@@ -4,6 +4,7 @@
 #include "value.h"
 #include "process.h"
 #include "scheduler.h"
+#include "native.h"
 #include "../common/bytecode.h"
 #include <stdint.h>
 #include <stdbool.h>
@@ -18,20 +19,36 @@
 // Constants
 // ============================================================================
 
-#define VM_STACK_MAX       256
-#define VM_FRAMES_MAX      64
-#define VM_GLOBALS_MAX     256
-#define VM_MAX_PENDING     16   // Max concurrent async agent requests
+#define VM_STACK_INITIAL   256  // Root stack grows on demand up to CONTEXT_STACK_LIMIT
+#define VM_FRAMES_INITIAL  64
 
 // ============================================================================
-// Call Frame
+// Method Call Inline Cache
 // ============================================================================
 
+#define METHOD_CACHE_EMPTY 0xFF
+
+// One per OP_CALL_METHOD site; vm_link rewrites the name operand to an
+// index into VegaVM.method_caches
+typedef struct {
+    const char* name;           // Method name (points into the constant pool)
+    uint32_t name_len;
+    uint8_t receiver_type;      // ValueType the entry was resolved for
+    const NativeDef* method;    // Resolved handler, NULL if the type has none
+} MethodCache;
+
+// ============================================================================
+// Future Table
+// ============================================================================
+
+// A slot of the table of futures whose async send is in flight. Its token,
+// (generation << 32) | index, tags the agent's requests; a slot reused
+// for another future gets a new generation, so stale tokens are ignored.
 typedef struct {
-    uint32_t function_id;
-    uint32_t ip;            // Instruction pointer (return address)
-    uint32_t bp;            // Base pointer (stack frame start)
-} CallFrame;
+    struct VegaFuture* future;  // NULL when free
+    uint32_t generation;
+    uint32_t next_free;
+} FutureSlot;
 
 // ============================================================================
 // VM State
@@ -46,6 +63,14 @@ typedef struct VegaVM {
     uint8_t* constants;
     uint32_t const_size;
 
+    // Materialized constants (OP_PUSH_CONST operands index this table)
+    Value* const_values;
+    uint32_t const_value_count;
+
+    // OP_CALL_METHOD inline caches
+    MethodCache* method_caches;
+    uint32_t method_cache_count;
+
     // Function table
     FunctionDef* functions;
     uint32_t func_count;
@@ -54,19 +79,24 @@ typedef struct VegaVM {
     AgentDef* agents;
     uint32_t agent_count;
 
-    // Execution state
+    // Execution state: the live registers of the context being run. stack
+    // and frames point into that context's own storage (root_context, or a
+    // scheduled process), so a context switch is a pointer swap.
     uint32_t ip;            // Instruction pointer
-    Value stack[VM_STACK_MAX];
+    Value* stack;
     uint32_t sp;            // Stack pointer
-
-    // Call stack
-    CallFrame frames[VM_FRAMES_MAX];
+    uint32_t stack_capacity;
+    CallFrame* frames;
     uint32_t frame_count;
+    uint32_t frame_capacity;
+    ExecContext* context;   // Context the registers belong to
+    ExecContext root_context;  // main() / REPL
 
-    // Globals
-    Value globals[VM_GLOBALS_MAX];
-    char* global_names[VM_GLOBALS_MAX];
+    // Globals (slots assigned by the link pass in vm_load)
+    Value* globals;
+    char** global_names;
     uint32_t global_count;
+    uint32_t global_capacity;
 
     // Locals for current frame
     Value* locals;
@@ -81,10 +111,26 @@ typedef struct VegaVM {
     struct VegaAgent* waiting_for_agent;  // Agent with pending async request
     Value waiting_msg;                     // Message being sent (for retry/debug)
 
-    // Pending async requests (for <~ async send)
-    struct VegaFuture* pending_futures[VM_MAX_PENDING];
+    // Futures of in-flight async sends (<~). The HTTP ready queue hands
+    // back the tokens of requests that moved, so a poll touches only those
+    FutureSlot* future_slots;
+    uint32_t future_slot_count;
+    uint32_t future_slot_capacity;
+    uint32_t future_free;       // Free slot list head (UINT32_MAX = none)
     uint32_t pending_count;
-    uint32_t next_request_id;
+
+    // Set when dispatch stopped to wait on async work; async_epoch is the
+    // HTTP event count read before the last poll (see vm_wait_async).
+    // async_yield: a scheduled process can't be woken by pid when its wait
+    // ends (another process waits on the same futures), so it only yields.
+    bool async_blocked;
+    bool async_yield;
+    uint64_t async_epoch;
+    uint64_t ready_epoch;       // Event count when the ready queue was last taken
+
+    // Bounds vm_wait_async while the root context sleeps (see OP_SLEEP)
+    Timer sleep_timer;
+    bool sleeping;              // OP_SLEEP is replaying until sleep_timer fires
 
     // API key (from environment or ~/.vega config)
     char* api_key;
@@ -93,8 +139,10 @@ typedef struct VegaVM {
     uint64_t budget_max_input_tokens;   // 0 = unlimited
     uint64_t budget_max_output_tokens;  // 0 = unlimited
     double budget_max_cost_usd;         // 0.0 = unlimited
-    uint64_t budget_used_input_tokens;
+    uint64_t budget_used_input_tokens;  // Including cache reads and writes
     uint64_t budget_used_output_tokens;
+    uint64_t budget_used_cache_read_tokens;
+    uint64_t budget_used_cache_write_tokens;
     double budget_used_cost_usd;
 
     // Process model (Phase 2)
@@ -114,6 +162,19 @@ void vm_init(VegaVM* vm);
 // Free VM resources
 void vm_free(VegaVM* vm);
 
+// Save the registers into the current context and load another context
+void vm_switch_context(VegaVM* vm, ExecContext* context);
+
+// Fire due timers and take the requests that moved: settles their futures
+// and wakes the processes waiting on them. The scheduler calls this when
+// no process is ready; the VM itself polls at every safepoint.
+void vm_poll_events(VegaVM* vm);
+
+// Make room for `count` more stack values / call frames in the current
+// context. On failure, sets the VM error and returns false.
+bool vm_reserve_stack(VegaVM* vm, uint32_t count);
+bool vm_reserve_frames(VegaVM* vm, uint32_t count);
+
 // Load bytecode from file
 bool vm_load_file(VegaVM* vm, const char* filename);
 
@@ -126,6 +187,11 @@ bool vm_run(VegaVM* vm);
 // Execute single instruction (for debugging)
 bool vm_step(VegaVM* vm);
 
+// If the last dispatch stopped because the program is waiting on an agent
+// response or a sleep, sleep until the HTTP engine completes a request or
+// streams text, or the next timer is due. Returns immediately otherwise.
+void vm_wait_async(VegaVM* vm);
+
 // Error handling
 bool vm_had_error(VegaVM* vm);
 const char* vm_error_msg(VegaVM* vm);
@@ -141,6 +207,7 @@ const char* vm_read_string(VegaVM* vm, uint16_t index, uint32_t* out_len);
 const char* vm_find_string_after_key(VegaVM* vm, const char* key, uint32_t* out_len);
 
 // Global variable access
+uint32_t vm_global_slot(VegaVM* vm, const char* name);
 Value vm_get_global(VegaVM* vm, const char* name);
 void vm_set_global(VegaVM* vm, const char* name, Value v);
 
@@ -156,7 +223,8 @@ void vm_set_budget_input_tokens(VegaVM* vm, uint64_t max_tokens);
 void vm_set_budget_output_tokens(VegaVM* vm, uint64_t max_tokens);
 void vm_set_budget_cost(VegaVM* vm, double max_cost_usd);
 bool vm_budget_exceeded(VegaVM* vm);
-void vm_add_token_usage(VegaVM* vm, uint32_t input, uint32_t output);
+void vm_add_token_usage(VegaVM* vm, uint32_t input, uint32_t output,
+                        uint32_t cache_read, uint32_t cache_write);
 double vm_get_current_cost(VegaVM* vm);
 
 // Debug
@@ -0,0 +1,104 @@
+#ifndef VEGA_TESTS_BYTECODE_BUILDER_H
+#define VEGA_TESTS_BYTECODE_BUILDER_H
+
+#include "common/bytecode.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Bytecode builder for the VM tests
+ *
+ * Tests hand-assemble their programs: emit a constant pool and code into
+ * two Bufs, describe the functions (and agents) by their offsets, and
+ * link_program() lays them out as a loadable image for vm_load().
+ * A Buf that runs out of room aborts the test rather than overflowing.
+ */
+
+#define BUF_CAPACITY 1024
+
+typedef struct {
+    uint8_t data[BUF_CAPACITY];
+    uint32_t size;
+} Buf;
+
+static inline void emit(Buf* b, uint8_t byte) {
+    if (b->size >= BUF_CAPACITY) {
+        fprintf(stderr, "bytecode_builder: program larger than %d bytes\n", BUF_CAPACITY);
+        exit(1);
+    }
+    b->data[b->size++] = byte;
+}
+
+static inline void emit_u16(Buf* b, uint16_t v) {
+    emit(b, v & 0xFF);
+    emit(b, (v >> 8) & 0xFF);
+}
+
+static inline void emit_u32(Buf* b, uint32_t v) {
+    emit_u16(b, v & 0xFFFF);
+    emit_u16(b, (v >> 16) & 0xFFFF);
+}
+
+// Append a string constant, returning its pool offset
+static inline uint16_t emit_string(Buf* consts, const char* s) {
+    uint16_t offset = (uint16_t)consts->size;
+    uint16_t len = (uint16_t)strlen(s);
+    emit(consts, CONST_STRING);
+    emit_u16(consts, len);
+    for (uint16_t i = 0; i < len; i++) {
+        emit(consts, (uint8_t)s[i]);
+    }
+    return offset;
+}
+
+// Append a float constant, returning its pool offset
+static inline uint16_t emit_float(Buf* consts, double v) {
+    uint16_t offset = (uint16_t)consts->size;
+    uint8_t bytes[8];
+    memcpy(bytes, &v, 8);
+    emit(consts, CONST_FLOAT);
+    for (int i = 0; i < 8; i++) {
+        emit(consts, bytes[i]);
+    }
+    return offset;
+}
+
+// Lay out a program image: header, function and agent tables, constant
+// pool, code. The caller frees the result.
+static inline uint8_t* link_program(const Buf* consts, const Buf* code,
+                                    const FunctionDef* fns, uint16_t func_count,
+                                    const AgentDef* agents, uint16_t agent_count,
+                                    uint32_t* out_size) {
+    VegaHeader header = {
+        .magic = VEGA_MAGIC,
+        .version = VEGA_VERSION,
+        .flags = 0,
+        .const_pool_size = consts->size,
+        .code_size = code->size
+    };
+
+    size_t fns_size = func_count * sizeof(FunctionDef);
+    size_t agents_size = agent_count * sizeof(AgentDef);
+    uint32_t size = sizeof(header) + 4 + fns_size + agents_size + consts->size + code->size;
+    uint8_t* out = malloc(size);
+    if (!out) {
+        fprintf(stderr, "bytecode_builder: out of memory\n");
+        exit(1);
+    }
+
+    uint8_t* p = out;
+    memcpy(p, &header, sizeof(header)); p += sizeof(header);
+    memcpy(p, &func_count, 2); p += 2;
+    memcpy(p, &agent_count, 2); p += 2;
+    if (fns_size) { memcpy(p, fns, fns_size); p += fns_size; }
+    if (agents_size) { memcpy(p, agents, agents_size); p += agents_size; }
+    memcpy(p, consts->data, consts->size); p += consts->size;
+    memcpy(p, code->data, code->size);
+
+    *out_size = size;
+    return out;
+}
+
+#endif // VEGA_TESTS_BYTECODE_BUILDER_H
@@ -0,0 +1,208 @@
+/*
+ * Vega VM - Scheduler event loop test
+ *
+ * Drives scheduler_run() with processes that park instead of running:
+ * first a batch that only sleeps, to check the sleeps overlap rather than
+ * run one after another, then a mix that sleeps, awaits a future, awaits
+ * all of two futures, or sleeps and then awaits. Checks that every
+ * process exits normally with its own result.
+ *
+ * The sends need an endpoint. Without ANTHROPIC_BASE_URL they go to a
+ * closed local port and settle as errors after their retries, which
+ * still parks and wakes the awaiting processes; tests/stub/with_stub.sh
+ * gives them replies.
+ *
+ * Usage: scheduler_run_test
+ */
+
+#include "vm/vm.h"
+#include "vm/http.h"
+#include "vm/process.h"
+#include "vm/scheduler.h"
+#include "bytecode_builder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SLEEPERS 16
+#define PER_KIND 8
+#define SLEEP_MS 200
+
+enum { SLEEPER, AWAITER, GROUPER, SLEEP_THEN_AWAIT, KIND_COUNT };
+
+static const char* kind_names[KIND_COUNT] = {
+    "sleeper", "awaiter", "grouper", "sleep_then_await"
+};
+
+// sleeper()          { sleep(ms); return 1; }
+// awaiter()          { return await (spawn W <~ "ping"); }
+// grouper()          { return await all [spawn W <~ "ping", spawn W <~ "ping"]; }
+// sleep_then_await() { sleep(ms); return await (spawn W <~ "ping"); }
+static uint8_t* build_program(uint32_t* out_size) {
+    Buf consts = {0};
+    uint16_t names[KIND_COUNT];
+    for (int k = 0; k < KIND_COUNT; k++) {
+        names[k] = emit_string(&consts, kind_names[k]);
+    }
+    uint16_t agent_name = emit_string(&consts, "W");
+    uint16_t model = emit_string(&consts, "claude-sonnet-4-20250514");
+    uint16_t ping = emit_string(&consts, "ping");
+
+    Buf code = {0};
+    FunctionDef fns[KIND_COUNT];
+
+#define SEND() do { \
+        emit(&code, OP_SPAWN_AGENT); emit_u16(&code, agent_name); \
+        emit(&code, OP_PUSH_CONST); emit_u16(&code, ping); \
+        emit(&code, OP_SEND_ASYNC); \
+    } while (0)
+#define SLEEP() do { \
+        emit(&code, OP_PUSH_INT); emit_u32(&code, SLEEP_MS); \
+        emit(&code, OP_SLEEP); \
+        emit(&code, OP_POP); \
+    } while (0)
+
+    uint32_t start = code.size;
+    SLEEP();
+    emit(&code, OP_PUSH_INT); emit_u32(&code, 1);
+    emit(&code, OP_RETURN);
+    fns[SLEEPER] = (FunctionDef){ .name_idx = names[SLEEPER], .code_offset = start,
+                                  .code_length = code.size - start };
+
+    start = code.size;
+    SEND();
+    emit(&code, OP_AWAIT);
+    emit(&code, OP_RETURN);
+    fns[AWAITER] = (FunctionDef){ .name_idx = names[AWAITER], .code_offset = start,
+                                  .code_length = code.size - start };
+
+    start = code.size;
+    emit(&code, OP_ARRAY_NEW); emit_u16(&code, 0);
+    SEND();
+    emit(&code, OP_ARRAY_PUSH);
+    SEND();
+    emit(&code, OP_ARRAY_PUSH);
+    emit(&code, OP_AWAIT_ALL);
+    emit(&code, OP_RETURN);
+    fns[GROUPER] = (FunctionDef){ .name_idx = names[GROUPER], .code_offset = start,
+                                  .code_length = code.size - start };
+
+    start = code.size;
+    SLEEP();
+    SEND();
+    emit(&code, OP_AWAIT);
+    emit(&code, OP_RETURN);
+    fns[SLEEP_THEN_AWAIT] = (FunctionDef){ .name_idx = names[SLEEP_THEN_AWAIT],
+                                           .code_offset = start,
+                                           .code_length = code.size - start };
+
+#undef SEND
+#undef SLEEP
+
+    AgentDef agent = {
+        .name_idx = agent_name,
+        .model_idx = model,
+        .system_idx = 0xFFFF,
+        .tool_count = 0,
+        .temperature_x100 = 100,
+        .flags = AGENT_FLAG_NO_CACHE,
+        .hedge_percentile = 0
+    };
+    return link_program(&consts, &code, fns, KIND_COUNT, &agent, 1, out_size);
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "scheduler_run_test: FAIL: " __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+        failures++; \
+    } \
+} while (0)
+
+// What each kind of process should have left on top of its stack
+static bool result_matches(int kind, Value v) {
+    switch (kind) {
+        case SLEEPER:
+            return value_type(v) == VAL_INT && value_as_int(v) == 1;
+        case GROUPER:
+            return value_type(v) == VAL_ARRAY && value_as_array(v)->count == 2;
+        default:
+            return value_type(v) == VAL_STRING;
+    }
+}
+
+static void start_process(VegaVM* vm, int kind) {
+    VegaProcess* proc = process_create(vm, 0);
+    process_start_function(vm, proc, (uint32_t)kind);
+    scheduler_add(&vm->scheduler, proc);
+    scheduler_enqueue(&vm->scheduler, proc->pid);
+}
+
+int main(void) {
+    setenv("ANTHROPIC_BASE_URL", "http://127.0.0.1:1", 0);
+    setenv("ANTHROPIC_API_KEY", "test", 0);
+
+    if (!http_init()) {
+        fprintf(stderr, "http_init failed\n");
+        return 1;
+    }
+
+    uint32_t size;
+    uint8_t* program = build_program(&size);
+    VegaVM* vm = malloc(sizeof(VegaVM));
+    vm_init(vm);
+    if (!vm_load(vm, program, size)) {
+        fprintf(stderr, "load failed: %s\n", vm->error_msg);
+        return 1;
+    }
+
+    // Sleepers only: one after another they would take 3.2 s
+    for (uint32_t i = 0; i < SLEEPERS; i++) {
+        start_process(vm, SLEEPER);
+    }
+    double start = now_sec();
+    scheduler_run(vm);
+    double wall = now_sec() - start;
+    CHECK(wall < 2.0, "%u sleepers took %.2f s; sleeps did not overlap", SLEEPERS, wall);
+
+    // Every kind, interleaved
+    for (uint32_t i = 0; i < PER_KIND * KIND_COUNT; i++) {
+        start_process(vm, (int)(i % KIND_COUNT));
+    }
+    scheduler_run(vm);
+
+    uint32_t count = SLEEPERS + PER_KIND * KIND_COUNT;
+    CHECK(!vm->had_error, "runtime error: %s", vm->error_msg);
+    CHECK(vm->scheduler.processes_exited == count, "%llu of %u processes exited",
+          (unsigned long long)vm->scheduler.processes_exited, count);
+    CHECK(vm->scheduler.ready_count == 0 && vm->scheduler.waiting_count == 0,
+          "%u ready and %u waiting after scheduler_run",
+          vm->scheduler.ready_count, vm->scheduler.waiting_count);
+
+    for (uint32_t i = 0; i < vm->process_count; i++) {
+        VegaProcess* proc = vm->processes[i];
+        int kind = i < SLEEPERS ? SLEEPER : (int)((i - SLEEPERS) % KIND_COUNT);
+        CHECK(proc->state == PROC_EXITED && proc->exit_reason == EXIT_NORMAL,
+              "%s pid %u: state %d, exit reason %d", kind_names[kind], proc->pid,
+              proc->state, proc->exit_reason);
+        CHECK(proc->context.sp > 0 && result_matches(kind, proc->context.stack[proc->context.sp - 1]),
+              "%s pid %u: unexpected result", kind_names[kind], proc->pid);
+    }
+
+    vm_free(vm);
+    free(vm);
+    free(program);
+    http_cleanup();
+
+    if (failures) return 1;
+    printf("scheduler_run_test: passed (%u processes)\n", count);
+    return 0;
+}
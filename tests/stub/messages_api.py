@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Anthropic Messages API.
+
+Answers POST /v1/messages with a text reply that echoes the last user
+message, so tests and benches can drive agents without a network or an
+API key. Point the VM at it with ANTHROPIC_BASE_URL=http://127.0.0.1:<port>.
+
+The last user message can steer the reply:
+  "d<ms> ..."   wait <ms> milliseconds before answering
+  "fail"        answer 400 invalid_request_error
+  "busy<n>"     answer 503 overloaded_error to the first <n> attempts
+  "hang"        never answer (for timeouts)
+
+Requests whose roles don't alternate user/assistant get a 400, like the
+real API. Listens on the port given as the first argument (0 picks a free
+one) and prints "port <n>" once it is ready.
+"""
+
+import json
+import re
+import socketserver
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+attempts = {}
+attempts_lock = threading.Lock()
+
+
+def last_text(messages):
+    content = messages[-1]["content"]
+    if isinstance(content, list):
+        for block in content:
+            if block.get("type") == "text":
+                return block["text"]
+        return ""
+    return content
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def do_POST(self):
+        length = int(self.headers.get("content-length", 0))
+        body = json.loads(self.rfile.read(length))
+        messages = body.get("messages", [])
+        roles = [m["role"] for m in messages]
+        alternating = (bool(roles) and roles[0] == "user" and
+                       all(a != b for a, b in zip(roles, roles[1:])))
+        text = last_text(messages) if messages else ""
+
+        if "hang" in text:
+            time.sleep(3600)
+            return
+
+        delay = re.match(r"d(\d+) ", text)
+        if delay:
+            time.sleep(int(delay.group(1)) / 1000)
+
+        busy = re.search(r"busy(\d+)", text)
+        if busy:
+            with attempts_lock:
+                attempts[text] = attempts.get(text, 0) + 1
+                still_busy = attempts[text] <= int(busy.group(1))
+        else:
+            still_busy = False
+
+        if still_busy:
+            self.reply(503, {"type": "error",
+                             "error": {"type": "overloaded_error", "message": "Overloaded"}})
+        elif not alternating or "fail" in text:
+            self.reply(400, {"type": "error",
+                             "error": {"type": "invalid_request_error",
+                                       "message": "roles: %s" % roles}})
+        else:
+            self.reply(200, {"type": "message",
+                             "role": "assistant",
+                             "content": [{"type": "text", "text": "echo: " + text}],
+                             "stop_reason": "end_turn",
+                             "usage": {"input_tokens": 3, "output_tokens": 5}})
+
+    def reply(self, status, payload):
+        out = json.dumps(payload).encode()
+        try:
+            self.send_response(status)
+            self.send_header("content-type", "application/json")
+            self.send_header("content-length", str(len(out)))
+            self.end_headers()
+            self.wfile.write(out)
+        except OSError:
+            pass  # The client gave up (cancelled or timed out)
+
+    def log_message(self, *args):
+        pass
+
+
+class Server(socketserver.ThreadingMixIn, HTTPServer):
+    daemon_threads = True
+    request_queue_size = 1024
+
+
+def main():
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 0
+    server = Server(("127.0.0.1", port), Handler)
+    print("port %d" % server.server_address[1], flush=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
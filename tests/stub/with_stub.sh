@@ -0,0 +1,31 @@
+#!/bin/bash
+# Run a command against the local Messages API stand-in:
+#   tests/stub/with_stub.sh <command> [args...]
+# Starts messages_api.py on a free port, points ANTHROPIC_BASE_URL at it,
+# runs the command and returns its exit status.
+
+STUB_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+
+if ! command -v python3 > /dev/null; then
+    echo "with_stub.sh: python3 not found" >&2
+    exit 1
+fi
+
+PORT_FILE=$(mktemp)
+python3 "$STUB_DIR/messages_api.py" 0 > "$PORT_FILE" &
+STUB_PID=$!
+trap 'kill $STUB_PID 2> /dev/null; rm -f "$PORT_FILE"' EXIT
+
+for _ in $(seq 50); do
+    grep -q "^port " "$PORT_FILE" && break
+    sleep 0.1
+done
+PORT=$(sed -n 's/^port //p' "$PORT_FILE")
+if [ -z "$PORT" ]; then
+    echo "with_stub.sh: stand-in server did not start" >&2
+    exit 1
+fi
+
+export ANTHROPIC_BASE_URL="http://127.0.0.1:$PORT"
+export ANTHROPIC_API_KEY=stub
+"$@"
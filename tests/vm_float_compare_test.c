@@ -0,0 +1,97 @@
+/*
+ * Vega VM - Float comparison test
+ *
+ * The float-specialized comparisons (OP_LT_FF and friends) must give the
+ * same answer as the generic opcodes they stand in for, which go through
+ * value_compare(). Runs `a op b` both ways for ordinary values and NaN.
+ *
+ * Usage: vm_float_compare_test
+ */
+
+#include "vm/vm.h"
+#include "bytecode_builder.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// main() { return a op b; }
+static uint8_t* build_program(double a, double b, uint8_t op, uint32_t* out_size) {
+    Buf consts = {0};
+    emit_string(&consts, "main");
+    uint16_t a_idx = emit_float(&consts, a);
+    uint16_t b_idx = emit_float(&consts, b);
+
+    Buf code = {0};
+    emit(&code, OP_PUSH_CONST); emit_u16(&code, a_idx);
+    emit(&code, OP_PUSH_CONST); emit_u16(&code, b_idx);
+    emit(&code, op);
+    emit(&code, OP_RETURN);
+
+    FunctionDef fn = {
+        .name_idx = 0,
+        .param_count = 0,
+        .local_count = 0,
+        .code_offset = 0,
+        .code_length = code.size
+    };
+    return link_program(&consts, &code, &fn, 1, NULL, 0, out_size);
+}
+
+// Returns 0 or 1, or -1 if the program didn't leave a bool behind
+static int run(double a, double b, uint8_t op) {
+    uint32_t size;
+    uint8_t* program = build_program(a, b, op, &size);
+    VegaVM* vm = malloc(sizeof(VegaVM));
+    vm_init(vm);
+
+    int result = -1;
+    if (vm_load(vm, program, size)) {
+        vm->ip = vm->functions[0].code_offset;
+        vm->running = true;
+        while (vm_step(vm)) {}
+    }
+    if (!vm->had_error && vm->sp > 0) {
+        Value top = vm->stack[vm->sp - 1];
+        if (value_type(top) == VAL_BOOL) result = value_as_bool(top) ? 1 : 0;
+    }
+
+    vm_free(vm);
+    free(vm);
+    free(program);
+    return result;
+}
+
+int main(void) {
+    static const struct {
+        const char* name;
+        uint8_t generic;
+        uint8_t specialized;
+    } ops[] = {
+        { "<",  OP_LT, OP_LT_FF },
+        { "<=", OP_LE, OP_LE_FF },
+        { ">",  OP_GT, OP_GT_FF },
+        { ">=", OP_GE, OP_GE_FF },
+    };
+    static const double operands[][2] = {
+        { 1.0, 2.0 }, { 2.0, 1.0 }, { 1.5, 1.5 },
+        { NAN, 1.0 }, { 1.0, NAN }, { NAN, NAN },
+    };
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        for (size_t j = 0; j < sizeof(operands) / sizeof(operands[0]); j++) {
+            double a = operands[j][0], b = operands[j][1];
+            int generic = run(a, b, ops[i].generic);
+            int specialized = run(a, b, ops[i].specialized);
+            if (generic < 0 || generic != specialized) {
+                fprintf(stderr, "vm_float_compare_test: FAIL: %g %s %g: generic %d, specialized %d\n",
+                        a, ops[i].name, b, generic, specialized);
+                failures++;
+            }
+        }
+    }
+
+    if (failures) return 1;
+    printf("vm_float_compare_test: passed\n");
+    return 0;
+}
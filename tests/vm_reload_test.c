@@ -0,0 +1,129 @@
+/*
+ * Vega VM - Program reload test
+ *
+ * Loads two hand-assembled programs into the same VM, the way the REPL's
+ * `load` command and the TUI's reload do, and checks that the second
+ * program sees none of the first one's state: function-valued globals
+ * must resolve to the new program's function ids, globals and processes
+ * holding the first program's interned constants must be gone, and only
+ * the new program's call sites may have method cache entries.
+ *
+ * Usage: vm_reload_test
+ */
+
+#include "vm/vm.h"
+#include "vm/process.h"
+#include "vm/scheduler.h"
+#include "bytecode_builder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// main() { s = "hello"; return f; }  f() { return "hello".len(); }
+// -- f is function 1
+static uint8_t* build_first(uint32_t* out_size) {
+    Buf consts = {0};
+    uint16_t main_name = emit_string(&consts, "main");
+    uint16_t f_name = emit_string(&consts, "f");
+    uint16_t s_name = emit_string(&consts, "s");
+    uint16_t hello = emit_string(&consts, "hello");
+    uint16_t len_name = emit_string(&consts, "len");
+
+    Buf code = {0};
+    emit(&code, OP_PUSH_CONST); emit_u16(&code, hello);
+    emit(&code, OP_STORE_GLOBAL); emit_u16(&code, s_name);
+    emit(&code, OP_LOAD_GLOBAL); emit_u16(&code, f_name);
+    emit(&code, OP_RETURN);
+    uint32_t f_offset = code.size;
+    emit(&code, OP_PUSH_CONST); emit_u16(&code, hello);
+    emit(&code, OP_CALL_METHOD); emit_u16(&code, len_name); emit(&code, 0);
+    emit(&code, OP_RETURN);
+
+    FunctionDef fns[2] = {
+        { .name_idx = main_name, .code_offset = 0, .code_length = f_offset },
+        { .name_idx = f_name, .code_offset = f_offset, .code_length = code.size - f_offset },
+    };
+    return link_program(&consts, &code, fns, 2, NULL, 0, out_size);
+}
+
+// f() { return "hi".len(); }  main() { return f; }   -- f is function 0
+static uint8_t* build_second(uint32_t* out_size) {
+    Buf consts = {0};
+    uint16_t f_name = emit_string(&consts, "f");
+    uint16_t main_name = emit_string(&consts, "main");
+    uint16_t hi = emit_string(&consts, "hi");
+    uint16_t len_name = emit_string(&consts, "len");
+
+    Buf code = {0};
+    emit(&code, OP_PUSH_CONST); emit_u16(&code, hi);
+    emit(&code, OP_CALL_METHOD); emit_u16(&code, len_name); emit(&code, 0);
+    emit(&code, OP_RETURN);
+    uint32_t main_offset = code.size;
+    emit(&code, OP_LOAD_GLOBAL); emit_u16(&code, f_name);
+    emit(&code, OP_RETURN);
+
+    FunctionDef fns[2] = {
+        { .name_idx = f_name, .code_offset = 0, .code_length = main_offset },
+        { .name_idx = main_name, .code_offset = main_offset, .code_length = code.size - main_offset },
+    };
+    return link_program(&consts, &code, fns, 2, NULL, 0, out_size);
+}
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "vm_reload_test: FAIL: " __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+        failures++; \
+    } \
+} while (0)
+
+static int find_global(VegaVM* vm, const char* name) {
+    for (uint32_t i = 0; i < vm->global_count; i++) {
+        if (strcmp(vm->global_names[i], name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static bool run_expecting_function(VegaVM* vm, uint32_t func_id) {
+    if (!vm_run(vm) || vm->sp == 0) return false;
+    Value top = vm->stack[vm->sp - 1];
+    return value_type(top) == VAL_FUNCTION && value_as_function(top) == func_id;
+}
+
+int main(void) {
+    uint32_t first_size, second_size;
+    uint8_t* first = build_first(&first_size);
+    uint8_t* second = build_second(&second_size);
+
+    VegaVM* vm = malloc(sizeof(VegaVM));
+    vm_init(vm);
+
+    CHECK(vm_load(vm, first, first_size), "first load: %s", vm->error_msg);
+    CHECK(run_expecting_function(vm, 1), "first program: f should be function 1");
+    CHECK(find_global(vm, "s") >= 0, "first program: global s missing");
+
+    // A process left over from the first program
+    VegaProcess* proc = process_create(vm, 0);
+    process_start_function(vm, proc, 0);
+    scheduler_add(&vm->scheduler, proc);
+    scheduler_enqueue(&vm->scheduler, proc->pid);
+    scheduler_run(vm);
+
+    CHECK(vm_load(vm, second, second_size), "second load: %s", vm->error_msg);
+    CHECK(find_global(vm, "s") < 0, "reload kept the first program's global s");
+    CHECK(vm->process_count == 0, "reload kept the first program's processes");
+    CHECK(vm->method_cache_count == 1, "expected 1 method cache entry, got %u",
+          vm->method_cache_count);
+    CHECK(run_expecting_function(vm, 0), "second program: f should be function 0");
+
+    vm_free(vm);
+    free(vm);
+    free(first);
+    free(second);
+
+    if (failures) return 1;
+    printf("vm_reload_test: passed\n");
+    return 0;
+}